@@ -10,103 +10,79 @@
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "register_types.h"
 #include "codegen.h"
 #include "stackmng/stackmng.h"
 #include "expr_tree/expr_tree.h"
+#include "inst_buf/inst_buf.h"
+#include "emitter/emitter.h"
+#include "encoder/encoder.h"
+#include "elf/elf_obj.h"
+#include "jit/jit.h"
+#include "reg_locals/reg_locals.h"
+#include "peephole/peephole.h"
 #include "../../flags.h"
 #include "../../Parser/List/List.h"
 #include "../../Parser/ParseTree/tree.h"
 #include "../../Parser/ParseTree/tree_types.h"
 #include "../../Parser/LexAndYacc/y.tab.h"
 
-/* Generates a label */
-void gen_label(char *buf, int buf_len)
+/* Generates a label number (emitted as .L<num>) */
+int gen_label()
 {
-    snprintf(buf, buf_len, ".L%d", ++label_counter);
-}
-
-/* Adds instruction to instruction list */
-/* WARNING: Makes copy of given char * */
-ListNode_t *add_inst(ListNode_t *inst_list, char *inst)
-{
-    ListNode_t *new_node;
-
-    new_node = CreateListNode(strdup(inst), LIST_STRING);
-    if(inst_list == NULL)
-    {
-        inst_list = new_node;
-    }
-    else
-    {
-        PushListNodeBack(inst_list, new_node);
-    }
-
-    return inst_list;
-}
-
-/* Frees instruction list */
-void free_inst_list(ListNode_t *inst_list)
-{
-    ListNode_t *cur;
-
-    cur = inst_list;
-    while(cur != NULL)
-    {
-        free(cur->cur);
-        cur = cur->next;
-    }
-
-    DestroyList(inst_list);
+    return ++label_counter;
 }
 
 /* Generates jmp */
 /* Inverse jumps on the inverse of the type */
-ListNode_t *gencode_jmp(int type, int inverse, char *label, ListNode_t *inst_list)
+InstBuf_t *gencode_jmp(int type, int inverse, int label, InstBuf_t *inst_list)
 {
-    char buffer[30], jmp_buf[6];
+    enum InstOp jmp_op;
 
     switch(type)
     {
         case EQ:
             if(inverse > 0)
-                snprintf(jmp_buf, 6, "jne");
+                jmp_op = INST_JNE;
             else
-                snprintf(jmp_buf, 6, "je");
+                jmp_op = INST_JE;
             break;
         case NE:
             if(inverse > 0)
-                snprintf(jmp_buf, 6, "je");
+                jmp_op = INST_JE;
             else
-                snprintf(jmp_buf, 6, "jne");
+                jmp_op = INST_JNE;
             break;
         case LT:
             if(inverse > 0)
-                snprintf(jmp_buf, 6, "jge");
+                jmp_op = INST_JGE;
             else
-                snprintf(jmp_buf, 6, "jl");
+                jmp_op = INST_JL;
             break;
         case LE:
             if(inverse > 0)
-                snprintf(jmp_buf, 6, "jg");
+                jmp_op = INST_JG;
             else
-                snprintf(jmp_buf, 6, "jle");
+                jmp_op = INST_JLE;
             break;
         case GT:
             if(inverse > 0)
-                snprintf(jmp_buf, 6, "jle");
+                jmp_op = INST_JLE;
             else
-                snprintf(jmp_buf, 6, "jg");
+                jmp_op = INST_JG;
             break;
         case GE:
             if(inverse > 0)
-                snprintf(jmp_buf, 6, "jge");
+                jmp_op = INST_JL;
             else
-                snprintf(jmp_buf, 6, "jl");
+                jmp_op = INST_JGE;
             break;
 
         case NORMAL_JMP:
-            snprintf(jmp_buf, 6, "jmp");
+            jmp_op = INST_JMP;
             break;
 
         default:
@@ -114,80 +90,276 @@ ListNode_t *gencode_jmp(int type, int inverse, char *label, ListNode_t *inst_lis
             exit(1);
     }
 
-    snprintf(buffer, 30, "\t%s\t%s\n", jmp_buf, label);
-
-    return add_inst(inst_list, buffer);
+    return add_inst1(inst_list, jmp_op, opnd_label(label));
 }
 
-/* Generates a function header */
-void codegen_function_header(char *func_name, FILE *o_file)
+/* Set for the duration of codegen when writing an object file (-obj) or running (-run) */
+/* NULL when writing assembly text */
+MachineCode_t *machine_code = NULL;
+
+/* Results of the function calls in the expressions being generated (see FUNCTION CALLS) */
+CallResult_t *call_results = NULL;
+int num_call_results = 0;
+int call_results_capacity = 0;
+
+/* Set while a subprogram body is generated with optimizations on (see TAIL CALLS in codegen.h) */
+TailCalls_t *tail_calls = NULL;
+
+/* Ranges of the for variables of the loops being generated (see ARRAYS in codegen.h) */
+ForRange_t *for_ranges = NULL;
+int num_for_ranges = 0;
+int for_ranges_capacity = 0;
+
+/* Code for failed bounds checks of the function being generated, goes after its epilogue */
+/* Checks on the same line share the last one made */
+InstBuf_t *range_errors = NULL;
+int range_error_line = -1;
+int range_error_label = -1;
+
+/* How many array accesses were checked and how many were known to be in range */
+int num_checks_made = 0;
+int num_checks_removed = 0;
+
+/* Invariants of the vectorized loop being generated, and how many loops were (see VECTORS) */
+VectorInvariant_t vector_invariants[NUM_VREGS];
+int num_vector_invariants = 0;
+int num_vector_loops = 0;
+
+/* Generates a function prologue */
+InstBuf_t *codegen_function_header(InstBuf_t *inst_list)
 {
     /*
-        .globl	<func_name>
-    	.type	<func_name>, @function
-        <func_name>:
-            pushq   %rbp
-            movq    %rsp, %rbp
+        pushq   %rbp
+        movq    %rsp, %rbp
     */
 
-    fprintf(o_file, ".globl\t%s\n.type\t%s, @function\n", func_name, func_name);
-    fprintf(o_file, "%s:\n\tpushq\t%%rbp\n\tmovq\t%%rsp, %%rbp\n", func_name);
+    add_inst1(inst_list, INST_PUSHQ, opnd_reg64(REG_RBP));
+    add_inst2(inst_list, INST_MOVQ, opnd_reg64(REG_RSP), opnd_reg64(REG_RBP));
 
-    return;
+    return inst_list;
 }
 
-/* Generates a function footer */
-void codegen_function_footer(char *func_name, FILE *o_file)
+/* Generates the .size directive of a function */
+void codegen_size_directive(char *func_name, Emitter_t *o_file)
+{
+    /* .size	<func_name>, .-<func_name> */
+
+    emit_str(o_file, "\t.size\t");
+    emit_str(o_file, func_name);
+    emit_str(o_file, ", .-");
+    emit_str(o_file, func_name);
+    emit_char(o_file, '\n');
+}
+
+/* Generates a function epilogue */
+InstBuf_t *codegen_function_footer(InstBuf_t *inst_list)
 {
     /*
         nop
         leave
         ret
+    */
+
+    add_inst0(inst_list, INST_NOP);
+    add_inst0(inst_list, INST_LEAVE);
+    add_inst0(inst_list, INST_RET);
+
+    return inst_list;
+}
+
+/* Writes out a finished global function */
+/* Goes to the machine code when writing an object file, otherwise to the assembly */
+void codegen_write_symbol(char *func_name, InstBuf_t *inst_list, Emitter_t *o_file)
+{
+    if(machine_code != NULL)
+    {
+        encode_symbol(machine_code, func_name, inst_list);
+        return;
+    }
+
+    /*
+        .globl	<func_name>
+    	.type	<func_name>, @function
+        <func_name>:
+            <inst_list>
         .size	<func_name>, .-<func_name>
     */
 
-    fprintf(o_file, "\tnop\n\tleave\n\tret\n");
-    fprintf(o_file, "\t.size\t%s, .-%s\n", func_name, func_name);
+    emit_str(o_file, ".globl\t");
+    emit_str(o_file, func_name);
+    emit_str(o_file, "\n.type\t");
+    emit_str(o_file, func_name);
+    emit_str(o_file, ", @function\n");
+    emit_str(o_file, func_name);
+    emit_str(o_file, ":\n");
+    emit_inst_buf(inst_list, o_file);
+    codegen_size_directive(func_name, o_file);
+}
 
-    return;
+/* Moves the body's hottest locals into callee-saved registers */
+/* NOTE: Nested subprograms reach our locals through the frame when non-local is on */
+void codegen_promote_locals(InstBuf_t *body, ListNode_t *subprograms)
+{
+    if(nonlocal_flag() == 1 && subprograms != NULL)
+        return;
+
+    promote_locals(body, get_cur_scope(), get_reg_stack());
+}
+
+/* Wraps a function body in its prologue and epilogue and writes it out */
+/* Callee-saved registers the body used are saved below everything else in the frame */
+void codegen_write_function(char *func_name, InstBuf_t *body, Emitter_t *o_file)
+{
+    InstBuf_t inst_list;
+    int saved_regs[NUM_REG_IDS], saved_offsets[NUM_REG_IDS];
+    int num_saved, i;
+
+    num_saved = get_callee_saved_used(get_reg_stack(), saved_regs);
+    for(i = 0; i < num_saved; ++i)
+        saved_offsets[i] = add_q_t((char *)reg_name(saved_regs[i], 8))->offset;
+
+    init_inst_buf(&inst_list);
+    codegen_function_header(&inst_list);
+    codegen_stack_space(&inst_list);
+    for(i = 0; i < num_saved; ++i)
+        add_inst2(&inst_list, INST_MOVQ, opnd_reg64(saved_regs[i]),
+            opnd_mem(REG_RBP, -saved_offsets[i]));
+
+    /* Tail calls to other functions leave our frame just like the epilogue */
+    for(i = 0; i < body->num_insts; ++i)
+    {
+        if(body->insts[i].op == INST_TAIL_JMP)
+        {
+            codegen_restore_regs(&inst_list, saved_regs, saved_offsets, num_saved);
+            add_inst0(&inst_list, INST_LEAVE);
+        }
+        add_inst(&inst_list, &body->insts[i]);
+    }
+
+    codegen_restore_regs(&inst_list, saved_regs, saved_offsets, num_saved);
+    codegen_function_footer(&inst_list);
+
+    if(range_errors != NULL)
+    {
+        append_inst_buf(&inst_list, range_errors);
+        range_errors->num_insts = 0;
+        range_error_line = -1;
+    }
+
+    if(optimize_flag())
+        peephole_optimize(&inst_list);
+
+    codegen_write_symbol(func_name, &inst_list, o_file);
+    free_inst_buf(&inst_list);
+
+    /* Nested functions are always written before their parent's body is generated */
+    reset_regs_used(get_reg_stack());
+}
+
+
+/* Restores the callee-saved registers saved by codegen_write_function */
+void codegen_restore_regs(InstBuf_t *inst_list, int *saved_regs, int *saved_offsets, int num_saved)
+{
+    int i;
+
+    for(i = 0; i < num_saved; ++i)
+        add_inst2(inst_list, INST_MOVQ, opnd_mem(REG_RBP, -saved_offsets[i]),
+            opnd_reg64(saved_regs[i]));
 }
 
 
 /* This is the entry function */
+/* An output_file_name of "-" writes the assembly to stdout */
+/* With -run nothing is written and output_file_name may be NULL */
 void codegen(Tree_t *tree, char *input_file_name, char *output_file_name)
 {
-    FILE *output_file;
+    Emitter_t output_file;
+    MachineCode_t obj_code;
+    int output_fd;
     char *prgm_name;
 
-    output_file = fopen(output_file_name, "w");
-    if(output_file == NULL)
+    if(run_flag() || strcmp(output_file_name, "-") == 0)
     {
-        fprintf(stderr, "ERROR: Failed to open output file: %s\n", output_file_name);
-        exit(1);
+        output_fd = STDOUT_FILENO;
+    }
+    else
+    {
+        output_fd = open(output_file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(output_fd < 0)
+        {
+            fprintf(stderr, "ERROR: Failed to open output file: %s\n", output_file_name);
+            exit(1);
+        }
+    }
+    init_emitter(&output_file, output_fd);
+
+    if(obj_flag() || run_flag())
+    {
+        init_machine_code(&obj_code);
+        machine_code = &obj_code;
     }
 
     /* codegen.h */
     label_counter = 1;
+    num_checks_made = 0;
+    num_checks_removed = 0;
+    num_vector_loops = 0;
 
     init_stackmng();
+    reset_peephole_stats();
+
+    codegen_program_header(input_file_name, &output_file);
 
-    codegen_program_header(input_file_name, output_file);
+    prgm_name = codegen_program(tree, &output_file);
+    codegen_main(prgm_name, &output_file);
 
-    prgm_name = codegen_program(tree, output_file);
-    codegen_main(prgm_name, output_file);
+    codegen_program_footer(&output_file);
 
-    codegen_program_footer(output_file);
+    if(optimize_flag())
+    {
+        print_peephole_stats(stderr);
+        print_bounds_check_stats(stderr);
+        print_vector_stats(stderr);
+    }
+
+    if(machine_code != NULL)
+    {
+        resolve_labels(machine_code);
+        if(run_flag())
+            run_machine_code(machine_code, "main");
+        else
+            write_elf_obj(machine_code, input_file_name, &output_file);
+        free_machine_code(machine_code);
+        machine_code = NULL;
+    }
 
-    fclose(output_file);
-    output_file = NULL;
+    flush_emitter(&output_file);
+    free_emitter(&output_file);
+    if(output_fd != STDOUT_FILENO)
+        close(output_fd);
 
     free_stackmng();
 
+    free(call_results);
+    call_results = NULL;
+    call_results_capacity = 0;
+
+    free(for_ranges);
+    for_ranges = NULL;
+    for_ranges_capacity = 0;
+
+    if(range_errors != NULL)
+    {
+        free_inst_buf(range_errors);
+        free(range_errors);
+        range_errors = NULL;
+    }
+
     return;
 }
 
 /* Generates standard gcc headers and labels for printf and scanf */
-void codegen_program_header(char *fname, FILE *o_file)
+void codegen_program_header(char *fname, Emitter_t *o_file)
 {
     /*
         .file	"<FILE_NAME>"
@@ -198,74 +370,93 @@ void codegen_program_header(char *fname, FILE *o_file)
         .LC1:
             .string "%d"
             .text
+        .LC2:
+            .string "<RANGE_ERROR_FORMAT>"
+            .text
     */
+    char *cur;
+
+    if(machine_code != NULL)
+    {
+        add_code_data(machine_code, PRINTF_REGISTER, "%d\n");
+        add_code_data(machine_code, SCANF_REGISTER, "%d");
+        add_code_data(machine_code, RANGE_ERROR_REGISTER, RANGE_ERROR_FORMAT);
+        return;
+    }
 
-    fprintf(o_file, "\t.file\t\"%s\"\n\t.section\t.rodata\n", fname);
-    fprintf(o_file, "\t.LC0:\n\t\t.string\t\"%%d\\n\"\n\t\t.text\n");
-    fprintf(o_file, "\t.LC1:\n\t\t.string\t\"%%d\"\n\t\t.text\n");
+    emit_str(o_file, "\t.file\t\"");
+    emit_str(o_file, fname);
+    emit_str(o_file, "\"\n\t.section\t.rodata\n");
+    emit_str(o_file, "\t.LC0:\n\t\t.string\t\"%d\\n\"\n\t\t.text\n");
+    emit_str(o_file, "\t.LC1:\n\t\t.string\t\"%d\"\n\t\t.text\n");
+
+    emit_str(o_file, "\t.LC2:\n\t\t.string\t\"");
+    for(cur = RANGE_ERROR_FORMAT; *cur != '\0'; ++cur)
+    {
+        if(*cur == '\n')
+            emit_str(o_file, "\\n");
+        else
+            emit_char(o_file, *cur);
+    }
+    emit_str(o_file, "\"\n\t\t.text\n");
     return;
 }
 
 /* Generates the footer of the whole program */
 /* TODO: Fix footer to reflect true gcc and os type */
-void codegen_program_footer(FILE *o_file)
+void codegen_program_footer(Emitter_t *o_file)
 {
     /*
         .ident	"<Identifications>"
     	.section	.note.GNU-stack,"",@progbits
     */
 
-    fprintf(o_file, ".ident\t\"GPC: 0.0.0\"\n");
-    fprintf(o_file, ".section\t.note.GNU-stack,\"\",@progbits\n");
+    /* The object writer always adds its own .note.GNU-stack */
+    if(machine_code != NULL)
+        return;
+
+    emit_str(o_file, ".ident\t\"GPC: 0.0.0\"\n");
+    emit_str(o_file, ".section\t.note.GNU-stack,\"\",@progbits\n");
 }
 
 /* Generates main which calls our program */
-void codegen_main(char *prgm_name, FILE *o_file)
+void codegen_main(char *prgm_name, Emitter_t *o_file)
 {
     /*
-        HEADER
-            movl	$0, %eax
-            call	<prgm_name>
-            movl	$0, %eax
-            popq    %rbp
-            ret
+        pushq   %rbp
+        movq    %rsp, %rbp
+        movl	$0, %eax
+        call	<prgm_name>
+        movl	$0, %eax
+        popq    %rbp
+        ret
     */
-    codegen_function_header("main", o_file);
-
-    fprintf(o_file, "\tmovl\t$0, %%eax\n\tcall\t%s\n\tmovl\t$0, %%eax\n", prgm_name);
-    fprintf(o_file, "\tpopq\t%%rbp\n\tret\n");
-    fprintf(o_file, "\t.size\t%s, .-%s\n", "main", "main");
+    InstBuf_t inst_list;
+
+    init_inst_buf(&inst_list);
+    codegen_function_header(&inst_list);
+    add_inst2(&inst_list, INST_MOVL, opnd_imm(0), opnd_reg32(REG_RAX));
+    add_inst1(&inst_list, INST_CALL, opnd_sym(prgm_name));
+    add_inst2(&inst_list, INST_MOVL, opnd_imm(0), opnd_reg32(REG_RAX));
+    add_inst1(&inst_list, INST_POPQ, opnd_reg64(REG_RBP));
+    add_inst0(&inst_list, INST_RET);
+
+    codegen_write_symbol("main", &inst_list, o_file);
+    free_inst_buf(&inst_list);
 }
 
 /* Generates code to allocate needed stack space */
-void codegen_stack_space(FILE *o_file)
+InstBuf_t *codegen_stack_space(InstBuf_t *inst_list)
 {
     int needed_space;
     needed_space = get_full_stack_offset();
     assert(needed_space >= 0);
 
+    /* subq	$<needed_space>, %rsp */
     if(needed_space != 0)
-    {
-        /* subq	$<needed_space>, %rsp */
-        fprintf(o_file, "\tsubq\t$%d, %%rsp\n", needed_space);
-    }
-}
-
-/* Writes instruction list to file */
-/* A NULL inst_list is interpreted as no instructions */
-void codegen_inst_list(ListNode_t *inst_list, FILE *o_file)
-{
-    char *inst;
-
-    while(inst_list != NULL)
-    {
-        inst = (char *)inst_list->cur;
-        assert(inst != NULL);
-
-        fprintf(o_file, "%s", inst);
+        add_inst2(inst_list, INST_SUBQ, opnd_imm(needed_space), opnd_reg64(REG_RSP));
 
-        inst_list = inst_list->next;
-    }
+    return inst_list;
 }
 
 
@@ -273,13 +464,13 @@ void codegen_inst_list(ListNode_t *inst_list, FILE *o_file)
 
 /* TODO: Currently only handles local variables and body_statement */
 /* Returns the program name for use with main */
-char * codegen_program(Tree_t *prgm, FILE *o_file)
+char * codegen_program(Tree_t *prgm, Emitter_t *o_file)
 {
     assert(prgm->type == TREE_PROGRAM_TYPE);
 
     char *prgm_name;
     struct Program *data;
-    ListNode_t *inst_list;
+    InstBuf_t inst_list;
 
     data = &prgm->tree_data.program_data;
     prgm_name = data->program_id;
@@ -289,14 +480,12 @@ char * codegen_program(Tree_t *prgm, FILE *o_file)
     codegen_function_locals(data->var_declaration, o_file);
     codegen_subprograms(data->subprograms, o_file);
 
-    inst_list = NULL;
-    inst_list = codegen_stmt(data->body_statement, inst_list, o_file);
+    init_inst_buf(&inst_list);
+    codegen_stmt(data->body_statement, &inst_list, o_file);
 
-    codegen_function_header(prgm_name, o_file);
-    codegen_stack_space(o_file);
-    codegen_inst_list(inst_list, o_file);
-    codegen_function_footer(prgm_name, o_file);
-    free_inst_list(inst_list);
+    codegen_promote_locals(&inst_list, data->subprograms);
+    codegen_write_function(prgm_name, &inst_list, o_file);
+    free_inst_buf(&inst_list);
 
     pop_stackscope();
 
@@ -304,10 +493,11 @@ char * codegen_program(Tree_t *prgm, FILE *o_file)
 }
 
 /* Pushes function locals onto the stack */
-void codegen_function_locals(ListNode_t *local_decl, FILE *o_file)
+void codegen_function_locals(ListNode_t *local_decl, Emitter_t *o_file)
 {
      ListNode_t *cur, *id_list;
      Tree_t *tree;
+     int s_range, e_range;
 
      cur = local_decl;
 
@@ -315,7 +505,7 @@ void codegen_function_locals(ListNode_t *local_decl, FILE *o_file)
      {
          tree = (Tree_t *)cur->cur;
          assert(tree != NULL);
-         assert(tree->type == TREE_VAR_DECL);
+         assert(tree->type == TREE_VAR_DECL || tree->type == TREE_ARR_DECL);
 
          id_list = tree->tree_data.var_decl_data.ids;
          if(tree->tree_data.var_decl_data.type == REAL_TYPE)
@@ -325,7 +515,22 @@ void codegen_function_locals(ListNode_t *local_decl, FILE *o_file)
 
          while(id_list != NULL)
          {
-             add_l_x((char *)id_list->cur);
+             if(tree->type == TREE_ARR_DECL)
+             {
+                 s_range = tree->tree_data.arr_decl_data.s_range;
+                 e_range = tree->tree_data.arr_decl_data.e_range;
+                 if(e_range < s_range)
+                 {
+                     fprintf(stderr, "ERROR: Array %s has no elements [%d..%d]!\n",
+                         (char *)id_list->cur, s_range, e_range);
+                     exit(1);
+                 }
+                 add_array_x((char *)id_list->cur, s_range, e_range);
+             }
+             else
+             {
+                 add_l_x((char *)id_list->cur);
+             }
              id_list = id_list->next;
          };
 
@@ -334,18 +539,14 @@ void codegen_function_locals(ListNode_t *local_decl, FILE *o_file)
 }
 
 /* Sets number of vector registers (floating points) before a function call */
-ListNode_t *codegen_vect_reg(ListNode_t *inst_list, int num_vec)
+InstBuf_t *codegen_vect_reg(InstBuf_t *inst_list, int num_vec)
 {
-    char buffer[50];
-
-    snprintf(buffer, 50, "\tmovl\t$%d, %%eax\n", num_vec);
-
-    return add_inst(inst_list, buffer);
+    return add_inst2(inst_list, INST_MOVL, opnd_imm(num_vec), opnd_reg32(REG_RAX));
 }
 
 /* Codegen for a list of subprograms */
 /* NOTE: List can be null */
-void codegen_subprograms(ListNode_t *sub_list, FILE *o_file)
+void codegen_subprograms(ListNode_t *sub_list, Emitter_t *o_file)
 {
     Tree_t *sub;
 
@@ -375,59 +576,59 @@ void codegen_subprograms(ListNode_t *sub_list, FILE *o_file)
 
 /* Code generation for a procedure */
 /* TODO: Support non-local variables */
-void codegen_procedure(Tree_t *proc_tree, FILE *o_file)
+void codegen_procedure(Tree_t *proc_tree, Emitter_t *o_file)
 {
     assert(proc_tree != NULL);
     assert(proc_tree->type == TREE_SUBPROGRAM);
     assert(proc_tree->tree_data.subprogram_data.sub_type == TREE_SUBPROGRAM_PROC);
 
     struct Subprogram *proc;
-    ListNode_t *inst_list;
-    char buffer[50];
+    InstBuf_t inst_list;
     char *sub_id;
+    int entry_label;
 
     proc = &proc_tree->tree_data.subprogram_data;
     sub_id = proc->id;
 
     push_stackscope();
 
-    inst_list = NULL;
-    inst_list = codegen_subprogram_arguments(proc->args_var, inst_list, o_file);
+    init_inst_buf(&inst_list);
+    entry_label = codegen_subprogram_entry(&inst_list);
+    codegen_subprogram_arguments(proc->args_var, &inst_list, o_file);
 
     codegen_function_locals(proc->declarations, o_file);
     codegen_subprograms(proc->subprograms, o_file);
 
-    inst_list = codegen_stmt(proc->statement_list, inst_list, o_file);
+    codegen_subprogram_body(proc, entry_label, &inst_list, o_file);
 
-    codegen_function_header(sub_id, o_file);
-    codegen_stack_space(o_file);
-    codegen_inst_list(inst_list, o_file);
-    codegen_function_footer(sub_id, o_file);
-    free_inst_list(inst_list);
+    codegen_promote_locals(&inst_list, proc->subprograms);
+    codegen_write_function(sub_id, &inst_list, o_file);
+    free_inst_buf(&inst_list);
 
     pop_stackscope();
 }
 
 /* Code generation for a function */
-void codegen_function(Tree_t *func_tree, FILE *o_file)
+void codegen_function(Tree_t *func_tree, Emitter_t *o_file)
 {
     assert(func_tree != NULL);
     assert(func_tree->type == TREE_SUBPROGRAM);
     assert(func_tree->tree_data.subprogram_data.sub_type == TREE_SUBPROGRAM_FUNC);
 
     struct Subprogram *func;
-    ListNode_t *inst_list;
-    char buffer[50];
+    InstBuf_t inst_list;
     char *sub_id;
     StackNode_t *return_var;
+    int entry_label;
 
     func = &func_tree->tree_data.subprogram_data;
     sub_id = func->id;
 
     push_stackscope();
 
-    inst_list = NULL;
-    inst_list = codegen_subprogram_arguments(func->args_var, inst_list, o_file);
+    init_inst_buf(&inst_list);
+    entry_label = codegen_subprogram_entry(&inst_list);
+    codegen_subprogram_arguments(func->args_var, &inst_list, o_file);
 
     /* Function name treated as return variable */
     /* For simplicity, just treating it as a local variable (let semcheck deal with shenanigans) */
@@ -436,18 +637,15 @@ void codegen_function(Tree_t *func_tree, FILE *o_file)
     codegen_function_locals(func->declarations, o_file);
     codegen_subprograms(func->subprograms, o_file);
 
-    inst_list = codegen_stmt(func->statement_list, inst_list, o_file);
+    codegen_subprogram_body(func, entry_label, &inst_list, o_file);
 
     /* Return statement */
-    snprintf(buffer, 50, "\tmovl\t-%d(%%rbp), %s\n", return_var->offset, RETURN_REG_32);
-    inst_list = add_inst(inst_list, buffer);
+    add_inst2(&inst_list, INST_MOVL, opnd_mem(REG_RBP, -return_var->offset),
+        opnd_reg32(RETURN_REG));
 
-
-    codegen_function_header(sub_id, o_file);
-    codegen_stack_space(o_file);
-    codegen_inst_list(inst_list, o_file);
-    codegen_function_footer(sub_id, o_file);
-    free_inst_list(inst_list);
+    codegen_promote_locals(&inst_list, func->subprograms);
+    codegen_write_function(sub_id, &inst_list, o_file);
+    free_inst_buf(&inst_list);
 
     pop_stackscope();
 }
@@ -457,15 +655,15 @@ void codegen_function(Tree_t *func_tree, FILE *o_file)
 /* NOTE: List can be NULL */
 /* TODO: Support arrays */
 /* TODO: Support any number of arguments */
-ListNode_t *codegen_subprogram_arguments(ListNode_t *args, ListNode_t *inst_list, FILE *o_file)
+InstBuf_t *codegen_subprogram_arguments(ListNode_t *args, InstBuf_t *inst_list, Emitter_t *o_file)
 {
     Tree_t *arg_decl;
     int type, arg_num;
     ListNode_t *arg_ids;
-    char *arg_reg;
-    char buffer[50];
+    int arg_reg;
     StackNode_t *arg_stack;
 
+    arg_num = 0;
     while(args != NULL)
     {
         arg_decl = (Tree_t *)args->cur;
@@ -478,11 +676,10 @@ ListNode_t *codegen_subprogram_arguments(ListNode_t *args, ListNode_t *inst_list
                 if(type == REAL_TYPE)
                     fprintf(stderr, "WARNING: Only integers are supported!\n");
 
-                arg_num = 0;
                 while(arg_ids != NULL)
                 {
-                    arg_reg = get_arg_reg32_num(arg_num);
-                    if(arg_reg == NULL)
+                    arg_reg = get_arg_reg_id(arg_num);
+                    if(arg_reg == REG_NONE)
                     {
                         fprintf(stderr, "ERROR: Max argument limit: %d\n", NUM_ARG_REG);
                         exit(1);
@@ -490,8 +687,8 @@ ListNode_t *codegen_subprogram_arguments(ListNode_t *args, ListNode_t *inst_list
 
                     arg_stack = add_l_z((char *)arg_ids->cur);
 
-                    snprintf(buffer, 50, "\tmovl\t%s, -%d(%%rbp)\n", arg_reg, arg_stack->offset);
-                    inst_list = add_inst(inst_list, buffer);
+                    inst_list = add_inst2(inst_list, INST_MOVL, opnd_reg32(arg_reg),
+                        opnd_mem(REG_RBP, -arg_stack->offset));
 
                     arg_ids = arg_ids->next;
                     ++arg_num;
@@ -515,8 +712,138 @@ ListNode_t *codegen_subprogram_arguments(ListNode_t *args, ListNode_t *inst_list
     return inst_list;
 }
 
+/* Marks where tail calls to the subprogram itself jump back to (see TAIL CALLS in codegen.h) */
+/* Returns the label, or -1 when no tail calls are made */
+int codegen_subprogram_entry(InstBuf_t *inst_list)
+{
+    int label;
+
+    if(!optimize_flag())
+        return -1;
+
+    label = gen_label();
+    add_label(inst_list, label);
+    return label;
+}
+
+/* Code generation for the statements of a subprogram */
+InstBuf_t *codegen_subprogram_body(struct Subprogram *sub, int entry_label,
+    InstBuf_t *inst_list, Emitter_t *o_file)
+{
+    TailCalls_t tail;
+
+    if(entry_label < 0)
+        return codegen_stmt(sub->statement_list, inst_list, o_file);
+
+    tail.sub_id = sub->id;
+    tail.entry_label = entry_label;
+    tail.stmts = NULL;
+    codegen_find_tail_calls(sub->statement_list, &tail);
+
+    tail_calls = &tail;
+    inst_list = codegen_stmt(sub->statement_list, inst_list, o_file);
+    tail_calls = NULL;
+
+    DestroyList(tail.stmts);
+    return inst_list;
+}
+
+/* Finds the calls stmt ends on */
+void codegen_find_tail_calls(struct Statement *stmt, TailCalls_t *tail)
+{
+    ListNode_t *last;
+    struct Expression *var, *expr;
+    char *callee;
+
+    switch(stmt->type)
+    {
+        case STMT_COMPOUND_STATEMENT:
+            last = stmt->stmt_data.compound_statement;
+            if(last == NULL)
+                return;
+            while(last->next != NULL)
+                last = last->next;
+            codegen_find_tail_calls((struct Statement *)last->cur, tail);
+            return;
+
+        case STMT_IF_THEN:
+            codegen_find_tail_calls(stmt->stmt_data.if_then_data.if_stmt, tail);
+            if(stmt->stmt_data.if_then_data.else_stmt != NULL)
+                codegen_find_tail_calls(stmt->stmt_data.if_then_data.else_stmt, tail);
+            return;
+
+        case STMT_PROCEDURE_CALL:
+            callee = stmt->stmt_data.procedure_call_data.id;
+            if(strcmp(callee, "write") == 0 || strcmp(callee, "read") == 0)
+                return;
+            break;
+
+        /* Functions end on assigning a call to their return variable */
+        case STMT_VAR_ASSIGN:
+            var = stmt->stmt_data.var_assign_data.var;
+            expr = stmt->stmt_data.var_assign_data.expr;
+            if(var->type != EXPR_VAR_ID || strcmp(var->expr_data.id, tail->sub_id) != 0 ||
+                expr->type != EXPR_FUNCTION_CALL)
+                return;
+            callee = expr->expr_data.function_call_data.id;
+            break;
+
+        default:
+            return;
+    }
+
+    /* Other subprograms may need our frame to find their parent's */
+    if(strcmp(callee, tail->sub_id) != 0 && nonlocal_flag())
+        return;
+
+    if(tail->stmts == NULL)
+        tail->stmts = CreateListNode(stmt, LIST_STMT);
+    else
+        tail->stmts = PushListNodeFront(tail->stmts, CreateListNode(stmt, LIST_STMT));
+}
+
+/* Whether the body being generated ends on stmt, a call */
+int codegen_is_tail_call(struct Statement *stmt)
+{
+    ListNode_t *cur;
+
+    if(tail_calls == NULL)
+        return 0;
+
+    for(cur = tail_calls->stmts; cur != NULL; cur = cur->next)
+        if(cur->cur == stmt)
+            return 1;
+
+    return 0;
+}
+
+/* Code generation for a call the body ends on, which reuses our frame */
+InstBuf_t *codegen_tail_call(char *callee, ListNode_t *args, InstBuf_t *inst_list,
+    Emitter_t *o_file)
+{
+    assert(tail_calls != NULL);
+
+    #ifdef DEBUG_CODEGEN
+    fprintf(stderr, "CODEGEN: Tail call to %s in %s\n", callee, tail_calls->sub_id);
+    #endif
+
+    inst_list = codegen_pass_arguments(args, inst_list, o_file);
+    if(strcmp(callee, tail_calls->sub_id) == 0)
+    {
+        inst_list = gencode_jmp(NORMAL_JMP, 0, tail_calls->entry_label, inst_list);
+    }
+    else
+    {
+        inst_list = codegen_vect_reg(inst_list, 0);
+        inst_list = add_inst1(inst_list, INST_TAIL_JMP, opnd_sym(callee));
+    }
+    free_arg_regs();
+
+    return inst_list;
+}
+
 /* Codegen for a statement */
-ListNode_t *codegen_stmt(struct Statement *stmt, ListNode_t *inst_list, FILE *o_file)
+InstBuf_t *codegen_stmt(struct Statement *stmt, InstBuf_t *inst_list, Emitter_t *o_file)
 {
     assert(stmt != NULL);
 
@@ -558,7 +885,7 @@ ListNode_t *codegen_stmt(struct Statement *stmt, ListNode_t *inst_list, FILE *o_
 
 /* TODO: Only handles assignments and read/write builtins */
 /* Returns a list of instructions */
-ListNode_t *codegen_compound_stmt(struct Statement *stmt, ListNode_t *inst_list, FILE *o_file)
+InstBuf_t *codegen_compound_stmt(struct Statement *stmt, InstBuf_t *inst_list, Emitter_t *o_file)
 {
     assert(stmt != NULL);
     assert(stmt->type == STMT_COMPOUND_STATEMENT);
@@ -581,37 +908,54 @@ ListNode_t *codegen_compound_stmt(struct Statement *stmt, ListNode_t *inst_list,
 }
 
 /* Code generation for a variable assignment */
-/* TODO: Array assignments not currently supported */
-ListNode_t *codegen_var_assignment(struct Statement *stmt, ListNode_t *inst_list, FILE *o_file)
+InstBuf_t *codegen_var_assignment(struct Statement *stmt, InstBuf_t *inst_list, Emitter_t *o_file)
 {
     assert(stmt != NULL);
     assert(stmt->type == STMT_VAR_ASSIGN);
 
-    StackNode_t *var;
     Register_t *reg;
-    char buffer[50];
+    Operand_t dest;
     struct Expression *var_expr, *assign_expr;
-    int offset;
 
     var_expr = stmt->stmt_data.var_assign_data.var;
     assign_expr = stmt->stmt_data.var_assign_data.expr;
 
-    /* Getting stack address of variable to set */
-    assert(var_expr->type == EXPR_VAR_ID);
-    var = find_label(var_expr->expr_data.id);
+    if(codegen_is_tail_call(stmt))
+        return codegen_tail_call(assign_expr->expr_data.function_call_data.id,
+            assign_expr->expr_data.function_call_data.args_expr, inst_list, o_file);
+
+    if(var_expr->type == EXPR_ARRAY_ACCESS)
+        return codegen_array_assignment(stmt, inst_list, o_file);
 
     inst_list = codegen_expr(assign_expr, inst_list, o_file);
 
     reg = front_reg_stack(get_reg_stack());
 
+    inst_list = codegen_var_dest(var_expr, inst_list, &dest);
+    return add_inst2(inst_list, INST_MOVL, opnd_reg32(reg->id), dest);
+}
+
+/* Gives the memory operand of a variable about to be written */
+/* NOTE: May add instructions to find non-local variables */
+InstBuf_t *codegen_var_dest(struct Expression *var_expr, InstBuf_t *inst_list, Operand_t *dest)
+{
+    assert(var_expr != NULL);
+    assert(dest != NULL);
+
+    StackNode_t *var;
+
+    /* Getting stack address of variable to set */
+    assert(var_expr->type == EXPR_VAR_ID);
+    var = find_label(var_expr->expr_data.id);
+
     if(var != NULL)
     {
-        snprintf(buffer, 50, "\tmovl\t%s, -%d(%%rbp)\n", reg->bit_32, var->offset);
+        *dest = opnd_mem(REG_RBP, -var->offset);
     }
     else if(nonlocal_flag() == 1)
     {
-        inst_list = codegen_get_nonlocal(inst_list, var_expr->expr_data.id, &offset);
-        snprintf(buffer, 50, "\tmovl\t%s, -%d(%s)\n", reg->bit_32, offset, NON_LOCAL_REG_64);
+        inst_list = codegen_get_nonlocal(inst_list, var_expr->expr_data.id, &var);
+        *dest = opnd_mem(NON_LOCAL_REG, -var->offset);
     }
     else
     {
@@ -620,68 +964,378 @@ ListNode_t *codegen_var_assignment(struct Statement *stmt, ListNode_t *inst_list
         exit(1);
     }
 
-    return add_inst(inst_list, buffer);
+    return inst_list;
 }
 
-/* Code generation for a procedure call */
-/* NOTE: This function will also recognize builtin procedures */
-/* TODO: Currently only handles builtins */
-/* TODO: Functions and procedures only handle max 2 arguments */
-ListNode_t *codegen_proc_call(struct Statement *stmt, ListNode_t *inst_list, FILE *o_file)
+/* Code generation for an assignment to an array element */
+/* The value is computed first and held in a register while the index is */
+InstBuf_t *codegen_array_assignment(struct Statement *stmt, InstBuf_t *inst_list,
+    Emitter_t *o_file)
 {
     assert(stmt != NULL);
-    assert(stmt->type == STMT_PROCEDURE_CALL);
+    assert(stmt->type == STMT_VAR_ASSIGN);
 
-    char *proc_name;
-    ListNode_t *args_expr;
-    char buffer[50];
+    Register_t *value_reg, *index_reg;
+    Operand_t dest;
+    struct Expression *var_expr, *index_expr;
+    expr_node_t *expr_tree;
+    int num_kept;
 
-    proc_name = stmt->stmt_data.procedure_call_data.id;
-    args_expr = stmt->stmt_data.procedure_call_data.expr_args;
+    var_expr = stmt->stmt_data.var_assign_data.var;
+    index_expr = var_expr->expr_data.array_access_data.array_expr;
 
-    /* First check for builtins */
-    if(strcmp("write", proc_name) == 0)
+    /* Calls in the index can't be made while the value is held */
+    num_kept = num_call_results;
+    inst_list = codegen_expr_calls(index_expr, inst_list, o_file);
+
+    inst_list = codegen_expr(stmt->stmt_data.var_assign_data.expr, inst_list, o_file);
+    value_reg = pop_reg_stack(get_reg_stack());
+
+    expr_tree = build_expr_tree(index_expr);
+    inst_list = gencode_expr_tree(expr_tree, get_reg_stack(), inst_list);
+    free_expr_tree(expr_tree);
+    index_reg = front_reg_stack(get_reg_stack());
+
+    inst_list = codegen_array_element(var_expr, index_reg->id, inst_list, &dest);
+    inst_list = add_inst2(inst_list, INST_MOVL, opnd_reg32(value_reg->id), dest);
+
+    push_reg_stack(get_reg_stack(), value_reg);
+    codegen_free_calls(num_kept);
+
+    return inst_list;
+}
+
+/* Gives the memory operand of an array element whose index was evaluated into index_reg */
+/* Checks the index first unless it's known to be in range (see ARRAYS in codegen.h) */
+/* NOTE: index_reg may be changed, and may add instructions to find non-local arrays */
+InstBuf_t *codegen_array_element(struct Expression *access, int index_reg,
+    InstBuf_t *inst_list, Operand_t *elem)
+{
+    assert(access != NULL);
+    assert(access->type == EXPR_ARRAY_ACCESS);
+    assert(elem != NULL);
+
+    StackNode_t *array;
+    struct Expression *index_expr;
+    char *id;
+    int base, checked;
+
+    id = access->expr_data.array_access_data.id;
+    index_expr = access->expr_data.array_access_data.array_expr;
+
+    array = find_label(id);
+    base = REG_RBP;
+    if(array == NULL)
     {
-        inst_list = codegen_builtin_write(args_expr, inst_list, o_file);
+        if(nonlocal_flag() != 1)
+        {
+            fprintf(stderr, "ERROR: Non-local codegen support disabled (buggy)!\n");
+            fprintf(stderr, "Enable with flag '-non-local' after required flags\n");
+            exit(1);
+        }
+        inst_list = codegen_get_nonlocal(inst_list, id, &array);
+        base = NON_LOCAL_REG;
     }
-    else if(strcmp("read", proc_name) == 0)
+    if(!array->is_array)
     {
-        inst_list = codegen_builtin_read(args_expr, inst_list, o_file);
+        fprintf(stderr, "ERROR: %s is not an array in codegen!\n", id);
+        exit(1);
     }
 
-    /* Not builtin */
+    checked = 0;
+    if(checks_flag())
+    {
+        checked = !codegen_index_in_range(index_expr, array);
+        ++num_checks_made;
+        if(!checked)
+            ++num_checks_removed;
+    }
+
+    /* Known elements are addressed directly */
+    if(!checked && index_expr->type == EXPR_INUM &&
+        index_expr->expr_data.i_num >= array->s_range &&
+        index_expr->expr_data.i_num <= array->e_range)
+    {
+        *elem = opnd_mem(base, -array->offset +
+            (index_expr->expr_data.i_num - array->s_range) * DOUBLEWORD);
+        return inst_list;
+    }
+
+    /* The index register is used as a quadword, so it can only be negative in range */
+    /* once the start of the range is taken off */
+    if(checked || array->s_range < 0)
+    {
+        if(array->s_range != 0)
+            inst_list = add_inst2(inst_list, INST_SUBL, opnd_imm(array->s_range),
+                opnd_reg32(index_reg));
+        *elem = opnd_mem_index(base, -array->offset, index_reg);
+    }
     else
     {
-        inst_list = codegen_pass_arguments(args_expr, inst_list, o_file);
-        inst_list = codegen_vect_reg(inst_list, 0);
-        snprintf(buffer, 50, "\tcall\t%s\n", proc_name);
-        inst_list = add_inst(inst_list, buffer);
-        free_arg_regs();
+        *elem = opnd_mem_index(base, -array->offset - array->s_range * DOUBLEWORD,
+            index_reg);
+    }
+
+    if(checked)
+    {
+        inst_list = add_inst2(inst_list, INST_CMPL,
+            opnd_imm(array->e_range - array->s_range + 1), opnd_reg32(index_reg));
+        inst_list = add_inst1(inst_list, INST_JAE,
+            opnd_label(codegen_range_error(access->line_num)));
     }
 
     return inst_list;
 }
 
-/* Code generation for if-then-else statements */
-/* TODO: Support more than simple relops */
-ListNode_t *codegen_if_then(struct Statement *stmt, ListNode_t *inst_list, FILE *o_file)
+/* Gives the label of code reporting a failed bounds check on line_num */
+int codegen_range_error(int line_num)
 {
-    assert(stmt != NULL);
-    assert(stmt->type == STMT_IF_THEN);
+    if(range_errors == NULL)
+    {
+        range_errors = (InstBuf_t *)malloc(sizeof(InstBuf_t));
+        assert(range_errors != NULL);
+        init_inst_buf(range_errors);
+    }
 
-    int relop_type, inverse;
-    struct Expression *expr;
-    struct Statement *if_stmt, *else_stmt;
-    char label1[18], label2[18], buffer[50];
+    if(line_num == range_error_line)
+        return range_error_label;
+    range_error_line = line_num;
+    range_error_label = gen_label();
+
+    add_label(range_errors, range_error_label);
+    add_inst2(range_errors, INST_LEAQ, opnd_rip_sym(RANGE_ERROR_REGISTER),
+        opnd_reg64(get_arg_reg_id(0)));
+    add_inst2(range_errors, INST_MOVL, opnd_imm(line_num), opnd_reg32(get_arg_reg_id(1)));
+    codegen_vect_reg(range_errors, 0);
+    add_inst1(range_errors, INST_CALL, opnd_sym(PRINTF_CALL));
+    add_inst2(range_errors, INST_MOVL, opnd_imm(1), opnd_reg32(get_arg_reg_id(0)));
+    add_inst1(range_errors, INST_CALL, opnd_sym(EXIT_CALL));
+
+    return range_error_label;
+}
 
-    /* Evaluating the relop */
-    expr = stmt->stmt_data.if_then_data.relop_expr;
-    inst_list = codegen_simple_relop(expr, inst_list, o_file, &relop_type);
+/* Whether index_expr is known to be within the range of array */
+int codegen_index_in_range(struct Expression *index_expr, StackNode_t *array)
+{
+    long lo, hi;
 
-    /* Preparing labels and data */
-    gen_label(label1, 18);
-    gen_label(label2, 18);
-    if_stmt = stmt->stmt_data.if_then_data.if_stmt;
+    if(!optimize_flag())
+        return 0;
+    if(!codegen_expr_range(index_expr, &lo, &hi))
+        return 0;
+
+    return lo >= array->s_range && hi <= array->e_range;
+}
+
+/* Gives the smallest and largest values expr can take, from numbers and ranged for variables */
+/* Returns 0 if expr isn't bounded that way */
+int codegen_expr_range(struct Expression *expr, long *lo, long *hi)
+{
+    assert(expr != NULL);
+
+    long left_lo, left_hi, right_lo, right_hi, products[4];
+    int i;
+
+    switch(expr->type)
+    {
+        case EXPR_INUM:
+            *lo = *hi = expr->expr_data.i_num;
+            return 1;
+
+        case EXPR_VAR_ID:
+            for(i = num_for_ranges - 1; i >= 0; --i)
+            {
+                if(strcmp(for_ranges[i].id, expr->expr_data.id) == 0)
+                {
+                    *lo = for_ranges[i].lo;
+                    *hi = for_ranges[i].hi;
+                    return 1;
+                }
+            }
+            return 0;
+
+        case EXPR_SIGN_TERM:
+            if(!codegen_expr_range(expr->expr_data.sign_term, &left_lo, &left_hi))
+                return 0;
+            *lo = -left_hi;
+            *hi = -left_lo;
+            break;
+
+        case EXPR_ADDOP:
+            if(!codegen_expr_range(expr->expr_data.addop_data.left_expr, &left_lo, &left_hi) ||
+                !codegen_expr_range(expr->expr_data.addop_data.right_term, &right_lo, &right_hi))
+                return 0;
+
+            if(expr->expr_data.addop_data.addop_type == PLUS)
+            {
+                *lo = left_lo + right_lo;
+                *hi = left_hi + right_hi;
+            }
+            else if(expr->expr_data.addop_data.addop_type == MINUS)
+            {
+                *lo = left_lo - right_hi;
+                *hi = left_hi - right_lo;
+            }
+            else
+                return 0;
+            break;
+
+        case EXPR_MULOP:
+            if(!codegen_expr_range(expr->expr_data.mulop_data.left_term, &left_lo, &left_hi) ||
+                !codegen_expr_range(expr->expr_data.mulop_data.right_factor,
+                &right_lo, &right_hi))
+                return 0;
+
+            if(expr->expr_data.mulop_data.mulop_type == STAR)
+            {
+                products[0] = left_lo * right_lo;
+                products[1] = left_lo * right_hi;
+                products[2] = left_hi * right_lo;
+                products[3] = left_hi * right_hi;
+                *lo = *hi = products[0];
+                for(i = 1; i < 4; ++i)
+                {
+                    if(products[i] < *lo)
+                        *lo = products[i];
+                    if(products[i] > *hi)
+                        *hi = products[i];
+                }
+            }
+            /* Dividing by a positive number never changes the order of values */
+            else if(expr->expr_data.mulop_data.mulop_type == SLASH && right_lo > 0)
+            {
+                *lo = left_lo / ((left_lo < 0) ? right_lo : right_hi);
+                *hi = left_hi / ((left_hi < 0) ? right_hi : right_lo);
+            }
+            else
+                return 0;
+            break;
+
+        default:
+            return 0;
+    }
+
+    /* Anything that could overflow wraps around at runtime */
+    return *lo >= INT_MIN && *hi <= INT_MAX;
+}
+
+/* Bounds the for variable of stmt while its body is generated (see ARRAYS in codegen.h) */
+/* Returns 1 if a range was pushed, which has to be popped once the body is done */
+int codegen_push_for_range(struct Statement *stmt)
+{
+    assert(stmt != NULL);
+    assert(stmt->type == STMT_FOR);
+
+    struct Statement *for_assign;
+    struct Expression *for_var;
+    long start_lo, start_hi, end_lo, end_hi;
+
+    if(!optimize_flag() || !checks_flag() ||
+        stmt->stmt_data.for_data.for_assign_type != STMT_FOR_ASSIGN_VAR)
+        return 0;
+
+    for_assign = stmt->stmt_data.for_data.for_assign_data.var_assign;
+    for_var = for_assign->stmt_data.var_assign_data.var;
+    if(for_var->type != EXPR_VAR_ID)
+        return 0;
+
+    /* Runs from the start up to one less than the end */
+    if(!codegen_expr_range(for_assign->stmt_data.var_assign_data.expr, &start_lo, &start_hi) ||
+        !codegen_expr_range(stmt->stmt_data.for_data.to, &end_lo, &end_hi))
+        return 0;
+    if(codegen_stmt_assigns(stmt->stmt_data.for_data.do_for, for_var->expr_data.id))
+        return 0;
+
+    if(num_for_ranges == for_ranges_capacity)
+    {
+        for_ranges_capacity = (for_ranges_capacity == 0) ? 8 : for_ranges_capacity * 2;
+        for_ranges = (ForRange_t *)realloc(for_ranges,
+            for_ranges_capacity * sizeof(ForRange_t));
+        assert(for_ranges != NULL);
+    }
+    for_ranges[num_for_ranges].id = for_var->expr_data.id;
+    for_ranges[num_for_ranges].lo = start_lo;
+    for_ranges[num_for_ranges].hi = end_hi - 1;
+    ++num_for_ranges;
+
+    #ifdef DEBUG_CODEGEN
+    fprintf(stderr, "CODEGEN: %s is in %ld..%ld in the for loop on line %d\n",
+        for_var->expr_data.id, start_lo, end_hi - 1, stmt->line_num);
+    #endif
+
+    return 1;
+}
+
+/* Prints how many array index checks were left out */
+void print_bounds_check_stats(FILE *f)
+{
+    if(num_checks_made > 0)
+        fprintf(f, "BOUNDS: %d of %d array index checks removed\n", num_checks_removed,
+            num_checks_made);
+}
+
+/* Code generation for a procedure call */
+/* NOTE: This function will also recognize builtin procedures */
+/* TODO: Currently only handles builtins */
+/* TODO: Functions and procedures only handle max 2 arguments */
+InstBuf_t *codegen_proc_call(struct Statement *stmt, InstBuf_t *inst_list, Emitter_t *o_file)
+{
+    assert(stmt != NULL);
+    assert(stmt->type == STMT_PROCEDURE_CALL);
+
+    char *proc_name;
+    ListNode_t *args_expr;
+
+    proc_name = stmt->stmt_data.procedure_call_data.id;
+    args_expr = stmt->stmt_data.procedure_call_data.expr_args;
+
+    /* First check for builtins */
+    if(strcmp("write", proc_name) == 0)
+    {
+        inst_list = codegen_builtin_write(args_expr, inst_list, o_file);
+    }
+    else if(strcmp("read", proc_name) == 0)
+    {
+        inst_list = codegen_builtin_read(args_expr, inst_list, o_file);
+    }
+
+    else if(codegen_is_tail_call(stmt))
+    {
+        inst_list = codegen_tail_call(proc_name, args_expr, inst_list, o_file);
+    }
+
+    /* Not builtin */
+    else
+    {
+        inst_list = codegen_pass_arguments(args_expr, inst_list, o_file);
+        inst_list = codegen_vect_reg(inst_list, 0);
+        inst_list = add_inst1(inst_list, INST_CALL, opnd_sym(proc_name));
+        free_arg_regs();
+    }
+
+    return inst_list;
+}
+
+/* Code generation for if-then-else statements */
+/* TODO: Support more than simple relops */
+InstBuf_t *codegen_if_then(struct Statement *stmt, InstBuf_t *inst_list, Emitter_t *o_file)
+{
+    assert(stmt != NULL);
+    assert(stmt->type == STMT_IF_THEN);
+
+    int relop_type, inverse;
+    struct Expression *expr;
+    struct Statement *if_stmt, *else_stmt;
+    int label1, label2;
+
+    /* Evaluating the relop */
+    expr = stmt->stmt_data.if_then_data.relop_expr;
+    inst_list = codegen_simple_relop(expr, inst_list, o_file, &relop_type);
+
+    /* Preparing labels and data */
+    label1 = gen_label();
+    label2 = gen_label();
+    if_stmt = stmt->stmt_data.if_then_data.if_stmt;
     else_stmt = stmt->stmt_data.if_then_data.else_stmt;
 
     /* IF STATEMENT */
@@ -692,21 +1346,18 @@ ListNode_t *codegen_if_then(struct Statement *stmt, ListNode_t *inst_list, FILE
     /* ELSE STATEMENT (if applicable) */
     if(else_stmt == NULL)
     {
-        snprintf(buffer, 50, "%s:\n", label1);
-        inst_list = add_inst(inst_list, buffer);
+        inst_list = add_label(inst_list, label1);
     }
     else
     {
         inverse = 0;
         inst_list = gencode_jmp(NORMAL_JMP, inverse, label2, inst_list);
 
-        snprintf(buffer, 50, "%s:\n", label1);
-        inst_list = add_inst(inst_list, buffer);
+        inst_list = add_label(inst_list, label1);
 
         inst_list = codegen_stmt(else_stmt, inst_list, o_file);
 
-        snprintf(buffer, 50, "%s:\n", label2);
-        inst_list = add_inst(inst_list, buffer);
+        inst_list = add_label(inst_list, label2);
     }
 
     return inst_list;
@@ -714,7 +1365,7 @@ ListNode_t *codegen_if_then(struct Statement *stmt, ListNode_t *inst_list, FILE
 
 /* Code generation for while statements */
 /* TODO: Support more than simple relops */
-ListNode_t *codegen_while(struct Statement *stmt, ListNode_t *inst_list, FILE *o_file)
+InstBuf_t *codegen_while(struct Statement *stmt, InstBuf_t *inst_list, Emitter_t *o_file)
 {
     assert(stmt != NULL);
     assert(stmt->type == STMT_WHILE);
@@ -722,11 +1373,11 @@ ListNode_t *codegen_while(struct Statement *stmt, ListNode_t *inst_list, FILE *o
     int relop_type, inverse;
     struct Expression *expr;
     struct Statement *while_stmt;
-    char label1[18], label2[18], buffer[50];
+    int label1, label2;
 
     /* Preparing labels and data */
-    gen_label(label1, 18);
-    gen_label(label2, 18);
+    label1 = gen_label();
+    label2 = gen_label();
     while_stmt = stmt->stmt_data.while_data.while_stmt;
     expr = stmt->stmt_data.while_data.relop_expr;
 
@@ -735,13 +1386,11 @@ ListNode_t *codegen_while(struct Statement *stmt, ListNode_t *inst_list, FILE *o
     inst_list = gencode_jmp(NORMAL_JMP, inverse, label1, inst_list);
 
     /* WHILE STMT */
-    snprintf(buffer, 50, "%s:\n", label2);
-    inst_list = add_inst(inst_list, buffer);
+    inst_list = add_label(inst_list, label2);
     inst_list = codegen_stmt(while_stmt, inst_list, o_file);
 
     /* Comparison area */
-    snprintf(buffer, 50, "%s:\n", label1);
-    inst_list = add_inst(inst_list, buffer);
+    inst_list = add_label(inst_list, label1);
     inst_list = codegen_simple_relop(expr, inst_list, o_file, &relop_type);
 
     inverse = 0;
@@ -752,21 +1401,30 @@ ListNode_t *codegen_while(struct Statement *stmt, ListNode_t *inst_list, FILE *o
 
 /* Code generation for for statements */
 /* TODO: Support more than simple relops */
-ListNode_t *codegen_for(struct Statement *stmt, ListNode_t *inst_list, FILE *o_file)
+InstBuf_t *codegen_for(struct Statement *stmt, InstBuf_t *inst_list, Emitter_t *o_file)
 {
     assert(stmt != NULL);
     assert(stmt->type == STMT_FOR);
 
-    int relop_type, inverse;
-    struct Expression *expr, *for_var, *comparison_expr, *update_expr, *one_expr;
-    struct Statement *for_body, *for_assign, *update_stmt;
-    char label1[18], label2[18], buffer[50];
+    struct Expression *for_var;
+    struct Statement *for_assign;
+    int ranged;
 
-    /* Preparing labels and data */
-    gen_label(label1, 18);
-    gen_label(label2, 18);
-    for_body = stmt->stmt_data.for_data.do_for;
-    expr = stmt->stmt_data.for_data.to;
+    ranged = codegen_push_for_range(stmt);
+
+    /* Array loops run several iterations at once, counted loops are unrolled instead */
+    if(codegen_vector_assign(stmt) != NULL)
+    {
+        inst_list = codegen_vector_for(stmt, inst_list, o_file);
+        num_for_ranges -= ranged;
+        return inst_list;
+    }
+    if(unroll_flag() > 1 && codegen_for_is_counted(stmt))
+    {
+        inst_list = codegen_unrolled_for(stmt, inst_list, o_file);
+        num_for_ranges -= ranged;
+        return inst_list;
+    }
 
     /* First do for variable assignment (if applicable) */
     if(stmt->stmt_data.for_data.for_assign_type == STMT_FOR_ASSIGN_VAR)
@@ -780,54 +1438,636 @@ ListNode_t *codegen_for(struct Statement *stmt, ListNode_t *inst_list, FILE *o_f
         for_var = stmt->stmt_data.for_data.for_assign_data.var;
     }
 
+    inst_list = codegen_for_loop(stmt, for_var, inst_list, o_file);
+
+    num_for_ranges -= ranged;
+    return inst_list;
+}
+
+/* Code generation for a for loop once its variable is assigned */
+InstBuf_t *codegen_for_loop(struct Statement *stmt, struct Expression *for_var,
+    InstBuf_t *inst_list, Emitter_t *o_file)
+{
+    int relop_type, inverse;
+    struct Expression *expr, *comparison_expr;
+    struct Statement *for_body;
+    Operand_t dest;
+    int label1, label2;
+
+    /* Preparing labels and data */
+    label1 = gen_label();
+    label2 = gen_label();
+    for_body = stmt->stmt_data.for_data.do_for;
+    expr = stmt->stmt_data.for_data.to;
+
     assert(for_var->type == EXPR_VAR_ID);
     comparison_expr = mk_relop(-1, LT, for_var, expr);
-    one_expr = mk_inum(-1, 1);
-    update_expr = mk_addop(-1, PLUS, for_var, one_expr);
-    update_stmt = mk_varassign(-1, for_var, update_expr);
 
     /* First jmp to comparison area */
     inverse = 0;
     inst_list = gencode_jmp(NORMAL_JMP, inverse, label1, inst_list);
 
     /* FOR STMT */
-    snprintf(buffer, 50, "%s:\n", label2);
-    inst_list = add_inst(inst_list, buffer);
+    inst_list = add_label(inst_list, label2);
     inst_list = codegen_stmt(for_body, inst_list, o_file);
 
     /* UPDATE */
-    inst_list = codegen_stmt(update_stmt, inst_list, o_file);
+    /* NOTE: Increments in place rather than through a register */
+    inst_list = codegen_var_dest(for_var, inst_list, &dest);
+    inst_list = add_inst2(inst_list, INST_ADDL, opnd_imm(1), dest);
 
     /* Comparison area */
-    snprintf(buffer, 50, "%s:\n", label1);
-    inst_list = add_inst(inst_list, buffer);
+    inst_list = add_label(inst_list, label1);
     inst_list = codegen_simple_relop(comparison_expr, inst_list, o_file, &relop_type);
 
     inverse = 0;
     inst_list = gencode_jmp(relop_type, inverse, label2, inst_list);
 
-    free(comparison_expr);
-    free(one_expr);
-    free(update_expr);
-    free(update_stmt);
+    tree_free(comparison_expr);
+    return inst_list;
+}
+
+/* Whether a for loop runs a number of times known at compile time */
+/* Both bounds have to be numbers and the body can't change the for variable */
+int codegen_for_is_counted(struct Statement *stmt)
+{
+    struct Statement *for_assign;
+
+    if(stmt->stmt_data.for_data.for_assign_type != STMT_FOR_ASSIGN_VAR)
+        return 0;
+
+    for_assign = stmt->stmt_data.for_data.for_assign_data.var_assign;
+    if(for_assign->stmt_data.var_assign_data.var->type != EXPR_VAR_ID ||
+        for_assign->stmt_data.var_assign_data.expr->type != EXPR_INUM ||
+        stmt->stmt_data.for_data.to->type != EXPR_INUM)
+        return 0;
+
+    return !codegen_stmt_assigns(stmt->stmt_data.for_data.do_for,
+        for_assign->stmt_data.var_assign_data.var->expr_data.id);
+}
+
+/* Whether stmt may assign the variable id */
+/* NOTE: Any call other than read and write may when non-local chasing is on */
+int codegen_stmt_assigns(struct Statement *stmt, char *id)
+{
+    ListNode_t *cur;
+    struct Expression *var;
+
+    switch(stmt->type)
+    {
+        case STMT_VAR_ASSIGN:
+            var = stmt->stmt_data.var_assign_data.var;
+            return var->type == EXPR_VAR_ID && strcmp(var->expr_data.id, id) == 0;
+
+        case STMT_PROCEDURE_CALL:
+            if(strcmp(stmt->stmt_data.procedure_call_data.id, "read") == 0)
+            {
+                for(cur = stmt->stmt_data.procedure_call_data.expr_args; cur != NULL; cur = cur->next)
+                {
+                    var = (struct Expression *)cur->cur;
+                    if(var->type == EXPR_VAR_ID && strcmp(var->expr_data.id, id) == 0)
+                        return 1;
+                }
+                return 0;
+            }
+            return strcmp(stmt->stmt_data.procedure_call_data.id, "write") != 0 &&
+                nonlocal_flag();
+
+        case STMT_COMPOUND_STATEMENT:
+            for(cur = stmt->stmt_data.compound_statement; cur != NULL; cur = cur->next)
+                if(codegen_stmt_assigns((struct Statement *)cur->cur, id))
+                    return 1;
+            return 0;
+
+        case STMT_IF_THEN:
+            return codegen_stmt_assigns(stmt->stmt_data.if_then_data.if_stmt, id) ||
+                (stmt->stmt_data.if_then_data.else_stmt != NULL &&
+                codegen_stmt_assigns(stmt->stmt_data.if_then_data.else_stmt, id));
+
+        case STMT_WHILE:
+            return codegen_stmt_assigns(stmt->stmt_data.while_data.while_stmt, id);
+
+        case STMT_FOR:
+            if(stmt->stmt_data.for_data.for_assign_type == STMT_FOR_ASSIGN_VAR)
+                var = stmt->stmt_data.for_data.for_assign_data.var_assign->
+                    stmt_data.var_assign_data.var;
+            else
+                var = stmt->stmt_data.for_data.for_assign_data.var;
+            return (var->type == EXPR_VAR_ID && strcmp(var->expr_data.id, id) == 0) ||
+                codegen_stmt_assigns(stmt->stmt_data.for_data.do_for, id);
+
+        default:
+            return 1;
+    }
+}
+
+/* Code generation for a counted for loop (see codegen_for_is_counted) */
+/* The body is generated unroll_flag() times per iteration of a loop tested at the bottom, */
+/* then once for each leftover iteration. Loops running fewer than twice that many times are */
+/* fully unrolled, with no jumps at all. The for variable still counts up by one after every copy */
+InstBuf_t *codegen_unrolled_for(struct Statement *stmt, InstBuf_t *inst_list, Emitter_t *o_file)
+{
+    assert(stmt != NULL);
+    assert(stmt->type == STMT_FOR);
+
+    int factor, start, trips, chunks, relop_type;
+    struct Expression *for_var, *comparison_expr;
+    struct Statement *for_assign, *for_body;
+    int label;
+
+    factor = unroll_flag();
+    for_body = stmt->stmt_data.for_data.do_for;
+    for_assign = stmt->stmt_data.for_data.for_assign_data.var_assign;
+    for_var = for_assign->stmt_data.var_assign_data.var;
+    start = for_assign->stmt_data.var_assign_data.expr->expr_data.i_num;
+    trips = stmt->stmt_data.for_data.to->expr_data.i_num - start;
+
+    inst_list = codegen_var_assignment(for_assign, inst_list, o_file);
+    if(trips <= 0)
+        return inst_list;
+
+    #ifdef DEBUG_CODEGEN
+    fprintf(stderr, "CODEGEN: Unrolling %d iterations of for loop by %d on line %d\n",
+        trips, factor, stmt->line_num);
+    #endif
+
+    chunks = trips / factor;
+    if(chunks > 1)
+    {
+        label = gen_label();
+        inst_list = add_label(inst_list, label);
+        inst_list = codegen_for_copies(for_body, for_var, factor, inst_list, o_file);
+
+        comparison_expr = mk_relop(-1, LT, for_var, mk_inum(-1, start + chunks * factor));
+        inst_list = codegen_simple_relop(comparison_expr, inst_list, o_file, &relop_type);
+        inst_list = gencode_jmp(relop_type, 0, label, inst_list);
+
+        tree_free(comparison_expr->expr_data.relop_data.right);
+        tree_free(comparison_expr);
+    }
+    else if(chunks == 1)
+    {
+        inst_list = codegen_for_copies(for_body, for_var, factor, inst_list, o_file);
+    }
+
+    return codegen_for_copies(for_body, for_var, trips % factor, inst_list, o_file);
+}
+
+/* Generates count copies of a for loop body, each followed by the increment */
+InstBuf_t *codegen_for_copies(struct Statement *for_body, struct Expression *for_var,
+    int count, InstBuf_t *inst_list, Emitter_t *o_file)
+{
+    Operand_t dest;
+
+    while(count > 0)
+    {
+        inst_list = codegen_stmt(for_body, inst_list, o_file);
+        inst_list = codegen_var_dest(for_var, inst_list, &dest);
+        inst_list = add_inst2(inst_list, INST_ADDL, opnd_imm(1), dest);
+        --count;
+    }
+
     return inst_list;
 }
 
+/* How many doublewords a vector instruction works on at once (see VECTORS in codegen.h) */
+int codegen_vector_width()
+{
+    return (march_flag() >= MARCH_X86_64_V3) ? YMM_SIZE / DOUBLEWORD : XMM_SIZE / DOUBLEWORD;
+}
+
+/* The assignment a for loop body is made of if the loop can be vectorized, otherwise NULL */
+/* It has to store to a local array indexed by the for variable, from elements of local */
+/* arrays at that same index and values the loop never changes, using +, - and * */
+struct Statement *codegen_vector_assign(struct Statement *stmt)
+{
+    assert(stmt != NULL);
+    assert(stmt->type == STMT_FOR);
+
+    struct Statement *body;
+    struct Expression *for_var, *target;
+    StackNode_t *node;
+    int num_invariants, num_temps;
+
+    if(optimize_flag() < 2)
+        return NULL;
+
+    if(stmt->stmt_data.for_data.for_assign_type == STMT_FOR_ASSIGN_VAR)
+        for_var = stmt->stmt_data.for_data.for_assign_data.var_assign->
+            stmt_data.var_assign_data.var;
+    else
+        for_var = stmt->stmt_data.for_data.for_assign_data.var;
+    if(for_var->type != EXPR_VAR_ID)
+        return NULL;
+    node = find_label(for_var->expr_data.id);
+    if(node == NULL || node->is_array)
+        return NULL;
+
+    body = stmt->stmt_data.for_data.do_for;
+    if(body->type == STMT_COMPOUND_STATEMENT && body->stmt_data.compound_statement != NULL &&
+        body->stmt_data.compound_statement->next == NULL)
+        body = (struct Statement *)body->stmt_data.compound_statement->cur;
+    if(body->type != STMT_VAR_ASSIGN)
+        return NULL;
+
+    /* The end is evaluated every iteration, so it can't read what the body writes */
+    target = body->stmt_data.var_assign_data.var;
+    if(!codegen_vector_element_ok(target, for_var->expr_data.id) ||
+        !codegen_is_invariant(stmt->stmt_data.for_data.to, for_var->expr_data.id))
+        return NULL;
+
+    num_invariants = 0;
+    if(codegen_is_invariant(body->stmt_data.var_assign_data.expr, for_var->expr_data.id))
+    {
+        num_temps = 0;
+        num_invariants = 1;
+    }
+    else
+    {
+        num_temps = codegen_vector_regs(body->stmt_data.var_assign_data.expr,
+            for_var->expr_data.id, &num_invariants);
+        if(num_temps == 0)
+            return NULL;
+    }
+    if(num_temps + num_invariants > NUM_VREGS)
+        return NULL;
+
+    return body;
+}
+
+/* Whether expr is an element of a local array indexed by just the for variable for_id */
+int codegen_vector_element_ok(struct Expression *expr, char *for_id)
+{
+    struct Expression *index_expr;
+    StackNode_t *node;
+
+    if(expr->type != EXPR_ARRAY_ACCESS)
+        return 0;
+
+    index_expr = expr->expr_data.array_access_data.array_expr;
+    if(index_expr->type != EXPR_VAR_ID || strcmp(index_expr->expr_data.id, for_id) != 0)
+        return 0;
+
+    node = find_label(expr->expr_data.array_access_data.id);
+    return node != NULL && node->is_array;
+}
+
+/* Whether expr has the same value in every iteration of a loop only assigning array elements */
+/* NOTE: Has no calls or array elements, and doesn't read the for variable for_id */
+int codegen_is_invariant(struct Expression *expr, char *for_id)
+{
+    switch(expr->type)
+    {
+        case EXPR_INUM:
+            return 1;
+
+        case EXPR_VAR_ID:
+            return strcmp(expr->expr_data.id, for_id) != 0;
+
+        case EXPR_SIGN_TERM:
+            return codegen_is_invariant(expr->expr_data.sign_term, for_id);
+
+        case EXPR_ADDOP:
+            return codegen_is_invariant(expr->expr_data.addop_data.left_expr, for_id) &&
+                codegen_is_invariant(expr->expr_data.addop_data.right_term, for_id);
+
+        case EXPR_MULOP:
+            return codegen_is_invariant(expr->expr_data.mulop_data.left_term, for_id) &&
+                codegen_is_invariant(expr->expr_data.mulop_data.right_factor, for_id);
+
+        default:
+            return 0;
+    }
+}
+
+/* Gives how many vector registers computing expr takes, 0 if it can't be done with them */
+/* Each invariant part of it takes one more register of its own, counted in num_invariants */
+int codegen_vector_regs(struct Expression *expr, char *for_id, int *num_invariants)
+{
+    struct Expression *left, *right;
+    int left_regs, right_regs;
+
+    if(codegen_is_invariant(expr, for_id))
+    {
+        ++(*num_invariants);
+        return 1;
+    }
+    if(expr->type == EXPR_ARRAY_ACCESS)
+        return codegen_vector_element_ok(expr, for_id);
+
+    if(expr->type == EXPR_ADDOP)
+    {
+        if(expr->expr_data.addop_data.addop_type != PLUS &&
+            expr->expr_data.addop_data.addop_type != MINUS)
+            return 0;
+        left = expr->expr_data.addop_data.left_expr;
+        right = expr->expr_data.addop_data.right_term;
+    }
+    /* pmulld came with SSE4.1 */
+    else if(expr->type == EXPR_MULOP && march_flag() >= MARCH_X86_64_V2)
+    {
+        if(expr->expr_data.mulop_data.mulop_type != STAR)
+            return 0;
+        left = expr->expr_data.mulop_data.left_term;
+        right = expr->expr_data.mulop_data.right_factor;
+    }
+    else
+        return 0;
+
+    left_regs = codegen_vector_regs(left, for_id, num_invariants);
+    if(codegen_is_invariant(right, for_id))
+    {
+        ++(*num_invariants);
+        right_regs = 0;
+    }
+    else
+        right_regs = codegen_vector_regs(right, for_id, num_invariants);
+    if(left_regs == 0 || (right_regs == 0 && !codegen_is_invariant(right, for_id)))
+        return 0;
+
+    return (left_regs > right_regs + 1) ? left_regs : right_regs + 1;
+}
+
+/* Code generation for a for loop whose body is a vectorizable assignment (see VECTORS) */
+InstBuf_t *codegen_vector_for(struct Statement *stmt, InstBuf_t *inst_list, Emitter_t *o_file)
+{
+    assert(stmt != NULL);
+    assert(stmt->type == STMT_FOR);
+
+    struct Statement *assign;
+    struct Expression *for_var, *value;
+    Register_t *end_reg, *index_reg;
+    Operand_t counter;
+    int width, size, guarded, max_start, min_end, vreg;
+    int top_label, scalar_label, clamped_label;
+
+    assign = codegen_vector_assign(stmt);
+    width = codegen_vector_width();
+    size = width * DOUBLEWORD;
+    ++num_vector_loops;
+
+    if(stmt->stmt_data.for_data.for_assign_type == STMT_FOR_ASSIGN_VAR)
+    {
+        inst_list = codegen_var_assignment(stmt->stmt_data.for_data.for_assign_data.var_assign,
+            inst_list, o_file);
+        for_var = stmt->stmt_data.for_data.for_assign_data.var_assign->
+            stmt_data.var_assign_data.var;
+    }
+    else
+        for_var = stmt->stmt_data.for_data.for_assign_data.var;
+    value = assign->stmt_data.var_assign_data.expr;
+
+    #ifdef DEBUG_CODEGEN
+    fprintf(stderr, "CODEGEN: Vectorizing for loop on line %d by %d\n", stmt->line_num, width);
+    #endif
+
+    /* Unless every array is known to cover the whole loop, the vector loop stays within */
+    /* all of them and the scalar loop runs into (and reports) any index out of range */
+    max_start = INT_MIN;
+    min_end = INT_MAX;
+    guarded = 0;
+    codegen_vector_bounds(assign->stmt_data.var_assign_data.var, for_var, &max_start, &min_end,
+        &guarded);
+    codegen_vector_bounds(value, for_var, &max_start, &min_end, &guarded);
+
+    top_label = gen_label();
+    scalar_label = gen_label();
+    inst_list = codegen_var_dest(for_var, inst_list, &counter);
+
+    /* The vector loop runs while for_var + width - 1 < end */
+    inst_list = codegen_expr(stmt->stmt_data.for_data.to, inst_list, o_file);
+    end_reg = pop_reg_stack(get_reg_stack());
+    if(guarded)
+    {
+        clamped_label = gen_label();
+        inst_list = add_inst2(inst_list, INST_CMPL, opnd_imm(min_end + 1),
+            opnd_reg32(end_reg->id));
+        inst_list = add_inst1(inst_list, INST_JLE, opnd_label(clamped_label));
+        inst_list = add_inst2(inst_list, INST_MOVL, opnd_imm(min_end + 1),
+            opnd_reg32(end_reg->id));
+        inst_list = add_label(inst_list, clamped_label);
+
+        inst_list = add_inst2(inst_list, INST_CMPL, opnd_imm(max_start), counter);
+        inst_list = add_inst1(inst_list, INST_JL, opnd_label(scalar_label));
+    }
+    inst_list = add_inst2(inst_list, INST_CMPL, opnd_imm(INT_MIN + width - 1),
+        opnd_reg32(end_reg->id));
+    inst_list = add_inst1(inst_list, INST_JL, opnd_label(scalar_label));
+    inst_list = add_inst2(inst_list, INST_SUBL, opnd_imm(width - 1), opnd_reg32(end_reg->id));
+    inst_list = add_inst2(inst_list, INST_CMPL, opnd_reg32(end_reg->id), counter);
+    inst_list = add_inst1(inst_list, INST_JGE, opnd_label(scalar_label));
+
+    /* Invariants are broadcast to every lane once the loop is known to run */
+    num_vector_invariants = 0;
+    if(codegen_is_invariant(value, for_var->expr_data.id))
+        inst_list = codegen_vector_invariant(value, size, inst_list);
+    else
+        inst_list = codegen_vector_invariants(value, for_var->expr_data.id, size, inst_list);
+
+    index_reg = front_reg_stack(get_reg_stack());
+    inst_list = add_label(inst_list, top_label);
+    inst_list = add_inst2(inst_list, INST_MOVL, counter, opnd_reg32(index_reg->id));
+    inst_list = codegen_vector_operand(value, 0, index_reg->id, size, inst_list, &vreg);
+    inst_list = add_inst2(inst_list, INST_MOVDQU, opnd_vreg(vreg, size),
+        codegen_vector_element(assign->stmt_data.var_assign_data.var, index_reg->id));
+    inst_list = add_inst2(inst_list, INST_ADDL, opnd_imm(width), counter);
+    inst_list = add_inst2(inst_list, INST_CMPL, opnd_reg32(end_reg->id), counter);
+    inst_list = add_inst1(inst_list, INST_JL, opnd_label(top_label));
+
+    /* Leaving the upper halves of the ymm registers dirty slows down any SSE code after */
+    if(size == YMM_SIZE)
+        inst_list = add_inst0(inst_list, INST_VZEROUPPER);
+
+    push_reg_stack(get_reg_stack(), end_reg);
+
+    /* The leftover iterations */
+    inst_list = add_label(inst_list, scalar_label);
+    return codegen_for_loop(stmt, for_var, inst_list, o_file);
+}
+
+/* Narrows [max_start, min_end] to the range of every array in expr, for elements of arrays */
+/* not known to cover the values of for_var guarded is set (see codegen_vector_for) */
+void codegen_vector_bounds(struct Expression *expr, struct Expression *for_var,
+    int *max_start, int *min_end, int *guarded)
+{
+    StackNode_t *array;
+
+    switch(expr->type)
+    {
+        case EXPR_ARRAY_ACCESS:
+            array = find_label(expr->expr_data.array_access_data.id);
+            assert(array != NULL);
+            if(array->s_range > *max_start)
+                *max_start = array->s_range;
+            if(array->e_range < *min_end)
+                *min_end = array->e_range;
+            if(checks_flag() && !codegen_index_in_range(for_var, array))
+                *guarded = 1;
+            break;
+
+        case EXPR_ADDOP:
+            codegen_vector_bounds(expr->expr_data.addop_data.left_expr, for_var,
+                max_start, min_end, guarded);
+            codegen_vector_bounds(expr->expr_data.addop_data.right_term, for_var,
+                max_start, min_end, guarded);
+            break;
+
+        case EXPR_MULOP:
+            codegen_vector_bounds(expr->expr_data.mulop_data.left_term, for_var,
+                max_start, min_end, guarded);
+            codegen_vector_bounds(expr->expr_data.mulop_data.right_factor, for_var,
+                max_start, min_end, guarded);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Broadcasts every invariant part of expr to a vector register of its own */
+InstBuf_t *codegen_vector_invariants(struct Expression *expr, char *for_id, int size,
+    InstBuf_t *inst_list)
+{
+    if(codegen_is_invariant(expr, for_id))
+        return codegen_vector_invariant(expr, size, inst_list);
+
+    switch(expr->type)
+    {
+        case EXPR_ADDOP:
+            inst_list = codegen_vector_invariants(expr->expr_data.addop_data.left_expr,
+                for_id, size, inst_list);
+            return codegen_vector_invariants(expr->expr_data.addop_data.right_term,
+                for_id, size, inst_list);
+
+        case EXPR_MULOP:
+            inst_list = codegen_vector_invariants(expr->expr_data.mulop_data.left_term,
+                for_id, size, inst_list);
+            return codegen_vector_invariants(expr->expr_data.mulop_data.right_factor,
+                for_id, size, inst_list);
+
+        default:
+            return inst_list;
+    }
+}
+
+/* Evaluates expr and copies it to every lane of the next free register from the top */
+InstBuf_t *codegen_vector_invariant(struct Expression *expr, int size, InstBuf_t *inst_list)
+{
+    expr_node_t *expr_tree;
+    Register_t *reg;
+    int vreg;
+
+    assert(num_vector_invariants < NUM_VREGS);
+
+    vreg = NUM_VREGS - 1 - num_vector_invariants;
+    vector_invariants[num_vector_invariants].expr = expr;
+    vector_invariants[num_vector_invariants].vreg = vreg;
+    ++num_vector_invariants;
+
+    expr_tree = build_expr_tree(expr);
+    inst_list = gencode_expr_tree(expr_tree, get_reg_stack(), inst_list);
+    free_expr_tree(expr_tree);
+    reg = front_reg_stack(get_reg_stack());
+
+    inst_list = add_inst2(inst_list, INST_MOVD, opnd_reg32(reg->id), opnd_vreg(vreg, XMM_SIZE));
+    if(size == YMM_SIZE)
+        return add_inst2(inst_list, INST_VPBROADCASTD, opnd_vreg(vreg, XMM_SIZE),
+            opnd_vreg(vreg, YMM_SIZE));
+
+    inst_list = add_inst2(inst_list, INST_PUNPCKLDQ, opnd_vreg(vreg, XMM_SIZE),
+        opnd_vreg(vreg, XMM_SIZE));
+    return add_inst2(inst_list, INST_PUNPCKLQDQ, opnd_vreg(vreg, XMM_SIZE),
+        opnd_vreg(vreg, XMM_SIZE));
+}
+
+/* Gives in result the vector register holding expr, computed into vreg and up unless it's */
+/* an invariant already broadcast. index_reg holds the for variable */
+InstBuf_t *codegen_vector_operand(struct Expression *expr, int vreg, int index_reg, int size,
+    InstBuf_t *inst_list, int *result)
+{
+    struct Expression *left, *right;
+    enum InstOp op;
+    int i, right_vreg;
+
+    for(i = 0; i < num_vector_invariants; ++i)
+    {
+        if(vector_invariants[i].expr == expr)
+        {
+            *result = vector_invariants[i].vreg;
+            return inst_list;
+        }
+    }
+
+    *result = vreg;
+    if(expr->type == EXPR_ARRAY_ACCESS)
+        return add_inst2(inst_list, INST_MOVDQU, codegen_vector_element(expr, index_reg),
+            opnd_vreg(vreg, size));
+
+    if(expr->type == EXPR_ADDOP)
+    {
+        left = expr->expr_data.addop_data.left_expr;
+        right = expr->expr_data.addop_data.right_term;
+        op = (expr->expr_data.addop_data.addop_type == PLUS) ? INST_PADDD : INST_PSUBD;
+    }
+    else
+    {
+        assert(expr->type == EXPR_MULOP);
+        left = expr->expr_data.mulop_data.left_term;
+        right = expr->expr_data.mulop_data.right_factor;
+        op = INST_PMULLD;
+    }
+
+    /* The left side has to end up in vreg itself since it's overwritten */
+    inst_list = codegen_vector_operand(left, vreg, index_reg, size, inst_list, &i);
+    if(i != vreg)
+        inst_list = add_inst2(inst_list, INST_MOVDQU, opnd_vreg(i, size), opnd_vreg(vreg, size));
+
+    inst_list = codegen_vector_operand(right, vreg + 1, index_reg, size, inst_list,
+        &right_vreg);
+    return add_inst2(inst_list, op, opnd_vreg(right_vreg, size), opnd_vreg(vreg, size));
+}
+
+/* Gives the memory operand of width elements of an array from the one at index_reg on */
+Operand_t codegen_vector_element(struct Expression *access, int index_reg)
+{
+    StackNode_t *array;
+
+    array = find_label(access->expr_data.array_access_data.id);
+    assert(array != NULL && array->is_array);
+
+    return opnd_mem_index(REG_RBP, -array->offset - array->s_range * DOUBLEWORD, index_reg);
+}
+
+/* Prints how many for loops were vectorized */
+void print_vector_stats(FILE *f)
+{
+    if(num_vector_loops > 0)
+        fprintf(f, "VECTOR: %d for loops vectorized %d wide\n", num_vector_loops,
+            codegen_vector_width());
+}
+
 /* Code generation for passing arguments */
-ListNode_t *codegen_pass_arguments(ListNode_t *args, ListNode_t *inst_list, FILE *o_file)
+/* NOTE: Divisions and non-local chasing use rdx and rcx, so arguments passed in those */
+/* wait in temporaries until every later argument is evaluated */
+InstBuf_t *codegen_pass_arguments(ListNode_t *args, InstBuf_t *inst_list, Emitter_t *o_file)
 {
-    int arg_num;
-    StackNode_t *stack_node;
+    int arg_num, i, num_kept;
     Register_t *top_reg;
-    char buffer[50];
-    char *arg_reg_char;
+    int arg_reg;
+    int waiting[NUM_ARG_REG];
+    ListNode_t *cur;
     expr_node_t *expr_tree;
 
+    /* Calls in the arguments would clobber the ones already passed */
+    num_kept = num_call_results;
+    for(cur = args; cur != NULL; cur = cur->next)
+        inst_list = codegen_expr_calls((struct Expression *)cur->cur, inst_list, o_file);
+
     arg_num = 0;
     while(args != NULL)
     {
-        arg_reg_char = get_arg_reg32_num(arg_num);
-        if(arg_reg_char == NULL)
+        arg_reg = get_arg_reg_id(arg_num);
+        if(arg_reg == REG_NONE)
         {
             fprintf(stderr, "ERROR: Could not get arg register: %d\n", arg_num);
             exit(1);
@@ -838,30 +2078,46 @@ ListNode_t *codegen_pass_arguments(ListNode_t *args, ListNode_t *inst_list, FILE
         free_expr_tree(expr_tree);
 
         top_reg = front_reg_stack(get_reg_stack());
-        snprintf(buffer, 50, "\tmovl\t%s, %s\n", top_reg->bit_32, arg_reg_char);
-        inst_list = add_inst(inst_list, buffer);
+        waiting[arg_num] = -1;
+        if((arg_reg == REG_RDX || arg_reg == REG_RCX) && args->next != NULL)
+        {
+            waiting[arg_num] = add_spill_t();
+            inst_list = add_inst2(inst_list, INST_MOVL, opnd_reg32(top_reg->id),
+                opnd_mem(REG_RBP, -waiting[arg_num]));
+        }
+        else
+        {
+            inst_list = add_inst2(inst_list, INST_MOVL, opnd_reg32(top_reg->id),
+                opnd_reg32(arg_reg));
+        }
 
         args = args->next;
         ++arg_num;
     }
 
+    for(i = 0; i < arg_num; ++i)
+    {
+        if(waiting[i] >= 0)
+        {
+            inst_list = add_inst2(inst_list, INST_MOVL, opnd_mem(REG_RBP, -waiting[i]),
+                opnd_reg32(get_arg_reg_id(i)));
+            free_spill_t(waiting[i]);
+        }
+    }
+
+    codegen_free_calls(num_kept);
     return inst_list;
 }
 
 /* Helper for codegen_get_nonlocal */
-ListNode_t * codegen_goto_prev_scope(ListNode_t *inst_list, StackScope_t *cur_scope, char *base)
+InstBuf_t *codegen_goto_prev_scope(InstBuf_t *inst_list, StackScope_t *cur_scope, int base)
 {
-    char buffer[50];
-
-    snprintf(buffer, 50, "\tmovq\t(%s), %s\n", base, NON_LOCAL_REG_64);
-    inst_list = add_inst(inst_list, buffer);
-
-    return inst_list;
+    return add_inst2(inst_list, INST_MOVQ, opnd_mem(base, 0), opnd_reg64(NON_LOCAL_REG));
 }
 
 /* Performs non-local variable chasing with the appropriate register */
-/* Gives the offset to use on the register */
-ListNode_t *codegen_get_nonlocal(ListNode_t *inst_list, char *label, int *offset)
+/* Gives the variable found, its offset is to be used on the register */
+InstBuf_t *codegen_get_nonlocal(InstBuf_t *inst_list, char *label, StackNode_t **node)
 {
     StackScope_t *cur_scope;
     StackNode_t *cur_node;
@@ -871,7 +2127,7 @@ ListNode_t *codegen_get_nonlocal(ListNode_t *inst_list, char *label, int *offset
     assert(cur_scope != NULL);
     found = 0;
 
-    inst_list = codegen_goto_prev_scope(inst_list, cur_scope, "%rbp");
+    inst_list = codegen_goto_prev_scope(inst_list, cur_scope, REG_RBP);
     cur_scope = cur_scope->prev_scope;
 
     while(cur_scope != NULL)
@@ -880,7 +2136,7 @@ ListNode_t *codegen_get_nonlocal(ListNode_t *inst_list, char *label, int *offset
         if(cur_node != NULL)
         {
             found = 1;
-            *offset = cur_node->offset;
+            *node = cur_node;
             break;
         }
 
@@ -888,11 +2144,11 @@ ListNode_t *codegen_get_nonlocal(ListNode_t *inst_list, char *label, int *offset
         if(cur_node != NULL)
         {
             found = 1;
-            *offset = cur_node->offset;
+            *node = cur_node;
             break;
         }
 
-        inst_list = codegen_goto_prev_scope(inst_list, cur_scope, NON_LOCAL_REG_64);
+        inst_list = codegen_goto_prev_scope(inst_list, cur_scope, NON_LOCAL_REG);
         cur_scope = cur_scope->prev_scope;
     }
 
@@ -902,13 +2158,14 @@ ListNode_t *codegen_get_nonlocal(ListNode_t *inst_list, char *label, int *offset
 }
 
 /* For codegen on a simple_relop */
-ListNode_t *codegen_simple_relop(struct Expression *expr, ListNode_t *inst_list,
-    FILE *o_file, int *type)
+InstBuf_t *codegen_simple_relop(struct Expression *expr, InstBuf_t *inst_list,
+    Emitter_t *o_file, int *type)
 {
     assert(expr != NULL);
     assert(expr->type == EXPR_RELOP);
 
     expr_node_t *expr_tree;
+    int num_kept;
 
     switch(expr->expr_data.relop_data.type)
     {
@@ -919,9 +2176,12 @@ ListNode_t *codegen_simple_relop(struct Expression *expr, ListNode_t *inst_list,
         case GT:
         case GE:
             *type = expr->expr_data.relop_data.type;
+            num_kept = num_call_results;
+            inst_list = codegen_expr_calls(expr, inst_list, o_file);
             expr_tree = build_expr_tree(expr);
             inst_list = gencode_expr_tree(expr_tree, get_reg_stack(), inst_list);
             free_expr_tree(expr_tree);
+            codegen_free_calls(num_kept);
 
             break;
 
@@ -935,11 +2195,15 @@ ListNode_t *codegen_simple_relop(struct Expression *expr, ListNode_t *inst_list,
 }
 
 /* Code generation for an expression */
-ListNode_t *codegen_expr(struct Expression *expr, ListNode_t *inst_list, FILE *o_file)
+InstBuf_t *codegen_expr(struct Expression *expr, InstBuf_t *inst_list, Emitter_t *o_file)
 {
     assert(expr != NULL);
 
     expr_node_t *expr_tree;
+    int num_kept;
+
+    num_kept = num_call_results;
+    inst_list = codegen_expr_calls(expr, inst_list, o_file);
 
     expr_tree = build_expr_tree(expr);
 
@@ -951,24 +2215,114 @@ ListNode_t *codegen_expr(struct Expression *expr, ListNode_t *inst_list, FILE *o
     free_expr_tree(expr_tree);
     expr_tree = NULL;
 
+    codegen_free_calls(num_kept);
     return inst_list;
 }
 
+/* Makes the function calls in expr, keeping their results for gencode (see FUNCTION CALLS) */
+InstBuf_t *codegen_expr_calls(struct Expression *expr, InstBuf_t *inst_list, Emitter_t *o_file)
+{
+    assert(expr != NULL);
+
+    CallResult_t *result;
+
+    switch(expr->type)
+    {
+        case EXPR_RELOP:
+            inst_list = codegen_expr_calls(expr->expr_data.relop_data.left, inst_list, o_file);
+            if(expr->expr_data.relop_data.right != NULL)
+                inst_list = codegen_expr_calls(expr->expr_data.relop_data.right,
+                    inst_list, o_file);
+            break;
+
+        case EXPR_SIGN_TERM:
+            inst_list = codegen_expr_calls(expr->expr_data.sign_term, inst_list, o_file);
+            break;
+
+        case EXPR_ARRAY_ACCESS:
+            inst_list = codegen_expr_calls(expr->expr_data.array_access_data.array_expr,
+                inst_list, o_file);
+            break;
+
+        case EXPR_ADDOP:
+            inst_list = codegen_expr_calls(expr->expr_data.addop_data.left_expr,
+                inst_list, o_file);
+            inst_list = codegen_expr_calls(expr->expr_data.addop_data.right_term,
+                inst_list, o_file);
+            break;
+
+        case EXPR_MULOP:
+            inst_list = codegen_expr_calls(expr->expr_data.mulop_data.left_term,
+                inst_list, o_file);
+            inst_list = codegen_expr_calls(expr->expr_data.mulop_data.right_factor,
+                inst_list, o_file);
+            break;
+
+        case EXPR_FUNCTION_CALL:
+            inst_list = codegen_pass_arguments(expr->expr_data.function_call_data.args_expr,
+                inst_list, o_file);
+            inst_list = codegen_vect_reg(inst_list, 0);
+            inst_list = add_inst1(inst_list, INST_CALL,
+                opnd_sym(expr->expr_data.function_call_data.id));
+            free_arg_regs();
+
+            if(num_call_results == call_results_capacity)
+            {
+                call_results_capacity = (call_results_capacity == 0) ? 8 :
+                    call_results_capacity * 2;
+                call_results = (CallResult_t *)realloc(call_results,
+                    call_results_capacity * sizeof(CallResult_t));
+                assert(call_results != NULL);
+            }
+            result = &call_results[num_call_results++];
+            result->call = expr;
+            result->offset = add_spill_t();
+            inst_list = add_inst2(inst_list, INST_MOVL, opnd_reg32(RETURN_REG),
+                opnd_mem(REG_RBP, -result->offset));
+            break;
+
+        default:
+            break;
+    }
+
+    return inst_list;
+}
+
+/* Forgets every call result after the first num_kept, freeing their temporaries */
+void codegen_free_calls(int num_kept)
+{
+    while(num_call_results > num_kept)
+        free_spill_t(call_results[--num_call_results].offset);
+}
+
+/* Offset of the temporary holding the result of call */
+int codegen_call_result(struct Expression *call)
+{
+    int i;
+
+    for(i = num_call_results - 1; i >= 0; --i)
+        if(call_results[i].call == call)
+            return call_results[i].offset;
+
+    fprintf(stderr, "ERROR: Function call %s was never made in codegen!\n",
+        call->expr_data.function_call_data.id);
+    exit(1);
+}
+
 /* Write builtin */
-ListNode_t *codegen_builtin_write(ListNode_t *args, ListNode_t *inst_list, FILE *o_file)
+InstBuf_t *codegen_builtin_write(ListNode_t *args, InstBuf_t *inst_list, Emitter_t *o_file)
 {
     assert(args != NULL);
     assert(args->next == NULL);
 
     int count;
     struct Expression *expr;
-    char *arg_reg1, *arg_reg2;
-    char full_buffer[50];
+    int arg_reg1, arg_reg2;
     // Register_t *register1, *register2;
     Register_t *top;
 
-    arg_reg1 = get_arg_reg64_num(0);
-    arg_reg2 = get_arg_reg32_num(1);
+    arg_reg1 = get_arg_reg_id(0);
+    arg_reg2 = get_arg_reg_id(1);
 
     // get_register_64bit(get_reg_stack(), arg_reg1, &register1);
     inst_list = codegen_expr((struct Expression *)args->cur, inst_list, o_file);
@@ -976,18 +2330,16 @@ ListNode_t *codegen_builtin_write(ListNode_t *args, ListNode_t *inst_list, FILE
 
     // get_register_32bit(get_reg_stack(), arg_reg2, &register2);
 
-    if(strcmp(top->bit_32, arg_reg2) != 0)
+    if(top->id != arg_reg2)
     {
-        snprintf(full_buffer, 50, "\tmovl\t%s, %s\n", top->bit_32, arg_reg2);
-        inst_list = add_inst(inst_list, full_buffer);
+        inst_list = add_inst2(inst_list, INST_MOVL, opnd_reg32(top->id), opnd_reg32(arg_reg2));
     }
 
-    snprintf(full_buffer, 50, "\tleaq\t%s, %s\n", PRINTF_REGISTER, arg_reg1);
-    inst_list = add_inst(inst_list, full_buffer);
+    inst_list = add_inst2(inst_list, INST_LEAQ, opnd_rip_sym(PRINTF_REGISTER),
+        opnd_reg64(arg_reg1));
 
     codegen_vect_reg(inst_list, 0);
-    snprintf(full_buffer, 50, "\tcall\t%s\n", PRINTF_CALL);
-    inst_list = add_inst(inst_list, full_buffer);
+    inst_list = add_inst1(inst_list, INST_CALL, opnd_sym(PRINTF_CALL));
 
     // push_reg_stack(get_reg_stack(), register1);
     // push_reg_stack(get_reg_stack(), register2);
@@ -997,19 +2349,18 @@ ListNode_t *codegen_builtin_write(ListNode_t *args, ListNode_t *inst_list, FILE
 
 /* Read builtin */
 /* TODO: Process reading into arrays */
-ListNode_t *codegen_builtin_read(ListNode_t *args, ListNode_t *inst_list, FILE *o_file)
+InstBuf_t *codegen_builtin_read(ListNode_t *args, InstBuf_t *inst_list, Emitter_t *o_file)
 {
     assert(args != NULL);
     assert(args->next == NULL);
 
     StackNode_t *var;
     struct Expression *expr;
-    char *arg_reg1, *arg_reg2;
-    char full_buffer[50];
+    int arg_reg1, arg_reg2;
     // Register_t *register1, *register2;
 
-    arg_reg1 = get_arg_reg64_num(0);
-    arg_reg2 = get_arg_reg64_num(1);
+    arg_reg1 = get_arg_reg_id(0);
+    arg_reg2 = get_arg_reg_id(1);
 
     // get_register_64bit(get_reg_stack(), arg_reg1, &register1);
     // get_register_64bit(get_reg_stack(), arg_reg2, &register2);
@@ -1020,15 +2371,14 @@ ListNode_t *codegen_builtin_read(ListNode_t *args, ListNode_t *inst_list, FILE *
     assert(expr->type == EXPR_VAR_ID);
 
     var = find_label(expr->expr_data.id);
-    snprintf(full_buffer, 50, "\tleaq\t-%d(%%rbp), %s\n", var->offset, arg_reg2);
-    inst_list = add_inst(inst_list, full_buffer);
+    inst_list = add_inst2(inst_list, INST_LEAQ, opnd_mem(REG_RBP, -var->offset),
+        opnd_reg64(arg_reg2));
 
-    snprintf(full_buffer, 50, "\tleaq\t%s, %s\n", SCANF_REGISTER, arg_reg1);
-    inst_list = add_inst(inst_list, full_buffer);
+    inst_list = add_inst2(inst_list, INST_LEAQ, opnd_rip_sym(SCANF_REGISTER),
+        opnd_reg64(arg_reg1));
 
     codegen_vect_reg(inst_list, 0);
-    snprintf(full_buffer, 50, "\tcall\t%s\n", SCANF_CALL);
-    inst_list = add_inst(inst_list, full_buffer);
+    inst_list = add_inst1(inst_list, INST_CALL, opnd_sym(SCANF_CALL));
 
     // push_reg_stack(get_reg_stack(), register1);
     // push_reg_stack(get_reg_stack(), register2);
@@ -1037,12 +2387,11 @@ ListNode_t *codegen_builtin_read(ListNode_t *args, ListNode_t *inst_list, FILE *
 }
 
 /* TODO: Functions and procedures only handle max 2 arguments */
-ListNode_t *codegen_args(ListNode_t *args, ListNode_t *inst_list, FILE *o_file)
+InstBuf_t *codegen_args(ListNode_t *args, InstBuf_t *inst_list, Emitter_t *o_file)
 {
     int count;
     struct Expression *expr;
-    char *arg_reg;
-    char full_buffer[50];
+    int arg_reg;
     Register_t *top, *arg;
 
     count = 0;
@@ -1058,15 +2407,14 @@ ListNode_t *codegen_args(ListNode_t *args, ListNode_t *inst_list, FILE *o_file)
 
         codegen_expr(expr, inst_list, o_file);
 
-        arg_reg = get_arg_reg32_num(count);
-        assert(arg_reg != NULL);
+        arg_reg = get_arg_reg_id(count);
+        assert(arg_reg != REG_NONE);
 
         top = front_reg_stack(get_reg_stack());
 
-        if(strcmp(top->bit_32, arg_reg) != 0)
+        if(top->id != arg_reg)
         {
-            snprintf(full_buffer, 50, "\tmovl\t%s, %s\n", top->bit_32, arg_reg);
-            inst_list = add_inst(inst_list, full_buffer);
+            inst_list = add_inst2(inst_list, INST_MOVL, opnd_reg32(top->id), opnd_reg32(arg_reg));
         }
 
         args = args->next;
@@ -1079,12 +2427,11 @@ ListNode_t *codegen_args(ListNode_t *args, ListNode_t *inst_list, FILE *o_file)
 
 
 /* (DEPRECATED) */
-ListNode_t *codegen_expr_varid(struct Expression *expr, ListNode_t *inst_list, FILE *o_file)
+InstBuf_t *codegen_expr_varid(struct Expression *expr, InstBuf_t *inst_list, Emitter_t *o_file)
 {
     assert(expr != NULL);
     assert(expr->type == EXPR_VAR_ID);
 
-    char full_buffer[50];
     Register_t *reg;
     StackNode_t *var;
 
@@ -1092,27 +2439,18 @@ ListNode_t *codegen_expr_varid(struct Expression *expr, ListNode_t *inst_list, F
 
     reg = front_reg_stack(get_reg_stack());
 
-    snprintf(full_buffer, 50, "\tmovl\t-%d(%%rbp), %s\n", var->offset, reg->bit_32);
-
-    /*fprintf(stderr, "%s\n", full_buffer);*/
-
-    return add_inst(inst_list, full_buffer);
+    return add_inst2(inst_list, INST_MOVL, opnd_mem(REG_RBP, -var->offset), opnd_reg32(reg->id));
 }
 
 /* (DEPRECATED) */
-ListNode_t *codegen_expr_inum(struct Expression *expr, ListNode_t *inst_list, FILE *o_file)
+InstBuf_t *codegen_expr_inum(struct Expression *expr, InstBuf_t *inst_list, Emitter_t *o_file)
 {
     assert(expr != NULL);
     assert(expr->type == EXPR_INUM);
 
-    char full_buffer[50];
     Register_t *reg;
 
     reg = front_reg_stack(get_reg_stack());
 
-    snprintf(full_buffer, 50, "\tmovl\t$%d, %s\n", expr->expr_data.i_num, reg->bit_32);
-
-    /*fprintf(stderr, "%s\n", full_buffer);*/
-
-    return add_inst(inst_list, full_buffer);
+    return add_inst2(inst_list, INST_MOVL, opnd_imm(expr->expr_data.i_num), opnd_reg32(reg->id));
 }
@@ -14,11 +14,11 @@
             - Support non-local variables
             - Support generalized reading and writing
             - Support real numbers
-            - Support more general purpose registers
-            - Support registers r8-15 as general purpose registers
 
         LOW ADDRESSES
         ============
+        s   q_words (saved callee-saved registers)
+        ============
         t   d_words (temporaries)
         ============
         x   d_words (local variables)
@@ -38,8 +38,19 @@
         - Function return "variable" pushed to x stack portion (SemCheck makes sure there's no issues)
 
     GENERAL PURPOSE REGISTERS:
-        - RBX
-        - RDI
+        Handed out for expressions in this order (see init_reg_stack):
+        - R10, R11, R8, R9 (caller-saved)
+        - RBX, R12, R13, R14, R15 (callee-saved)
+
+        Callee-saved registers a function body used are saved to q_word slots below the
+        temporaries after the prologue and restored before the epilogue.
+
+        Whatever callee-saved registers a body leaves free are given to its most used
+        locals and arguments (loop uses count for more), which then never touch the stack.
+        See reg_locals/reg_locals.h.
+
+        RAX, RCX and RDX are reserved (see REGISTER CONVENTIONS), RDI and RSI are kept out
+        so evaluating an argument can never clobber one already passed.
 
     SPECIAL REGISTERS:
         - RSP (Stack pointer)
@@ -49,6 +60,7 @@
         - RAX for returns
         - RAX and RDX for division (div in RAX, mod in RDX)
             - Dividend in RAX, divisor in RDX
+            - Constant divisors use RAX and RDX as scratch for the magic multiply instead
         - RCX used for base pointer chasing (var in different scope)
 
     ARGUMENT CONVENTIONS:
@@ -79,8 +91,23 @@
 
         The final section is the epilogue which performs required gcc function exiting standards
 
+        Body instructions are collected as records in an InstBuf_t (see inst_buf/inst_buf.h)
+        and only turned into text once the whole function has been generated.
+
+        With optimizations on, the finished function goes through the peephole optimizer
+        (see peephole/peephole.h) before it is written.
+
     OUTPUT:
         Output is written as a gcc assembly file (.s). Assembly is then assembled using gcc.
+        All text goes through an Emitter_t (see emitter/emitter.h) which writes the whole
+        file at once, or streams it when the output is stdout ("-") or a pipe.
+
+        With -obj the finished instruction buffers are instead encoded straight to machine
+        code (see encoder/encoder.h) and written as a relocatable ELF object
+        (see elf/elf_obj.h), so no assembler is needed before linking.
+
+        With -run the encoded program is instead loaded into memory and called directly
+        (see jit/jit.h), nothing is written at all.
 
         The write bultin currently only takes integer types and has the
             label LC0 with %d\n. The function call is "call printf"
@@ -91,6 +118,56 @@
 
     TEMPORARIES:
         Temporaries are allocated as needed and reused once freed for efficiency
+
+    FUNCTION CALLS:
+        Calls inside an expression are made before the rest of it is evaluated, and
+        their results (from RAX) kept in spill temporaries the expression then reads
+        like variables. No expression register is ever live across a call this way,
+        and arguments of an outer call are only passed once every inner call is done.
+
+    TAIL CALLS:
+        With optimizations on, a subprogram body ending on a call (as its last statement,
+        or the last of either branch of an if) makes no new frame for it. The arguments
+        are passed as usual, then:
+            - A call to itself jumps back to right after the prologue, where the
+              arguments are stored again, so recursion of this kind runs as a loop
+            - Any other call restores the callee-saved registers, leaves our frame and
+              jumps to the callee (INST_TAIL_JMP), which returns straight to our caller
+        For a function the ending call is an assignment of a call to the return variable.
+        Other subprograms aren't tail called with non-local chasing on, since those
+        find their parent's frame through ours.
+
+    ARRAYS:
+        Arrays take up a run of x d_words, the first element at the lowest address, and
+        their elements are reached with disp(base,index,4) operands (OPND_MEM_INDEX).
+        The index is evaluated into a register and, unless -checks=off is given, has the
+        start of the range taken off and is compared against the number of elements with
+        a single unsigned jump, so indices below the range fail the check too. A failed
+        check jumps to code placed after the epilogue that prints the line and exits.
+
+        With optimizations on, indices known to be in range aren't checked. A for loop
+        bounds its variable while its body is generated (see ForRange_t) when the body
+        never assigns it and both bounds are made of numbers and the variables of
+        enclosing loops. Indices made of those and numbers with +, -, * and division by a
+        positive number get their range by interval arithmetic, so a[i] and a[2 * i - 1]
+        need no check inside for i := 1 to 10 when a is indexed 1..20.
+
+    VECTORS:
+        With -O2, a for loop whose body is a single assignment a[i] := <expr>, where i is
+        the for variable, is vectorized when <expr> is made of elements of local arrays at
+        that same index and of values the loop never changes (numbers and variables other
+        than i) with +, - and *. Several iterations then run at once with packed
+        doubleword instructions (see VECTOR INSTRUCTIONS in inst_buf/inst_buf.h), 4 per
+        xmm register, or 8 per ymm register with -march=x86-64-v3. Multiplication needs
+        pmulld, so it is only vectorized from -march=x86-64-v2 on.
+
+        The parts that never change are computed once and broadcast to every lane before
+        the loop. The vector loop runs while at least a full register of iterations is
+        left, then the normal loop runs whatever is left over. With bounds checks on and
+        the range of i not known to fit every array, the vector loop also stays within
+        the ranges of the arrays, so the normal loop is the one reporting a bad index.
+        Each element is at the same index in every array, so it makes no difference
+        whether they are the same array.
 */
 
 #ifndef CODE_GEN_H
@@ -102,15 +179,23 @@
 
 #define NORMAL_JMP -1
 
-#define PRINTF_REGISTER ".LC0(%rip)"
+/* NOTE: Format labels are addressed relative to %rip */
+#define PRINTF_REGISTER ".LC0"
 #define PRINTF_CALL "printf@PLT"
 
-#define SCANF_REGISTER ".LC1(%rip)"
+#define SCANF_REGISTER ".LC1"
 #define SCANF_CALL "__isoc99_scanf@PLT"
 
+/* Format of the message a failed bounds check prints (see ARRAYS) */
+#define RANGE_ERROR_REGISTER ".LC2"
+#define RANGE_ERROR_FORMAT "ERROR: Array index out of range on line %d!\n"
+#define EXIT_CALL "exit@PLT"
+
 #include <stdlib.h>
 #include <stdio.h>
 #include "stackmng/stackmng.h"
+#include "inst_buf/inst_buf.h"
+#include "emitter/emitter.h"
 #include "../../Parser/List/List.h"
 #include "../../Parser/ParseTree/tree.h"
 #include "../../Parser/ParseTree/tree_types.h"
@@ -119,47 +204,110 @@
 /* Please initialize to 1 */
 int label_counter;
 
+/* Where a function call in an expression left its result (see codegen_expr_calls) */
+typedef struct CallResult
+{
+    struct Expression *call;
+    int offset; /* Of a spill temporary */
+} CallResult_t;
+
+/* Calls the subprogram being generated ends on (see TAIL CALLS) */
+typedef struct TailCalls
+{
+    char *sub_id;
+    int entry_label; /* Right after the prologue */
+    ListNode_t *stmts; /* Statements ending the body on a call */
+} TailCalls_t;
+
+/* Values a for variable takes in its loop body (see ARRAYS) */
+typedef struct ForRange
+{
+    char *id;
+    long lo, hi;
+} ForRange_t;
+
+/* The part of a vectorized assignment that never changes, broadcast to vreg (see VECTORS) */
+typedef struct VectorInvariant
+{
+    struct Expression *expr;
+    int vreg;
+} VectorInvariant_t;
+
 /* This is the entry function */
 void codegen(Tree_t *, char *input_file_name, char *output_file_name);
 
-ListNode_t *add_inst(ListNode_t *, char *);
-
-void codegen_program_header(char *, FILE *);;
-void codegen_program_footer(FILE *);
-void codegen_main(char *prgm_name, FILE *o_file);
-void codegen_stack_space(FILE *);
-void codegen_inst_list(ListNode_t *, FILE *);
-
-char * codegen_program(Tree_t *, FILE *);
-void codegen_function_locals(ListNode_t *, FILE *);
-ListNode_t *codegen_vect_reg(ListNode_t *, int);
-
-void codegen_subprograms(ListNode_t *, FILE *);
-void codegen_procedure(Tree_t *, FILE *);
-void codegen_function(Tree_t *, FILE *);
-ListNode_t *codegen_subprogram_arguments(ListNode_t *, ListNode_t *, FILE *);
-
-ListNode_t *codegen_stmt(struct Statement *, ListNode_t *,FILE *);
-ListNode_t *codegen_compound_stmt(struct Statement *, ListNode_t *, FILE *);
-ListNode_t *codegen_var_assignment(struct Statement *, ListNode_t *, FILE *);
-ListNode_t *codegen_proc_call(struct Statement *, ListNode_t *, FILE *);
-ListNode_t *codegen_if_then(struct Statement *, ListNode_t *, FILE *);
-ListNode_t *codegen_while(struct Statement *, ListNode_t *, FILE *);
-ListNode_t *codegen_for(struct Statement *, ListNode_t *, FILE *);
-
-ListNode_t *codegen_pass_arguments(ListNode_t *, ListNode_t *, FILE *);
-ListNode_t *codegen_get_nonlocal(ListNode_t *, char *, int *);
-
-ListNode_t *codegen_simple_relop(struct Expression *, ListNode_t *,
-    FILE *, int *);
-
-ListNode_t *codegen_expr(struct Expression *, ListNode_t *, FILE *);
-ListNode_t *codegen_builtin_write(ListNode_t *, ListNode_t *, FILE *);
-ListNode_t *codegen_builtin_read(ListNode_t *, ListNode_t *, FILE *);
-ListNode_t *codegen_args(ListNode_t*, ListNode_t *, FILE *);
+void codegen_program_header(char *, Emitter_t *);
+void codegen_program_footer(Emitter_t *);
+void codegen_main(char *prgm_name, Emitter_t *o_file);
+InstBuf_t *codegen_stack_space(InstBuf_t *);
+void codegen_write_symbol(char *, InstBuf_t *, Emitter_t *);
+void codegen_promote_locals(InstBuf_t *, ListNode_t *);
+void codegen_write_function(char *, InstBuf_t *, Emitter_t *);
+void codegen_restore_regs(InstBuf_t *, int *, int *, int);
+
+char * codegen_program(Tree_t *, Emitter_t *);
+void codegen_function_locals(ListNode_t *, Emitter_t *);
+InstBuf_t *codegen_vect_reg(InstBuf_t *, int);
+
+void codegen_subprograms(ListNode_t *, Emitter_t *);
+void codegen_procedure(Tree_t *, Emitter_t *);
+void codegen_function(Tree_t *, Emitter_t *);
+InstBuf_t *codegen_subprogram_arguments(ListNode_t *, InstBuf_t *, Emitter_t *);
+int codegen_subprogram_entry(InstBuf_t *);
+InstBuf_t *codegen_subprogram_body(struct Subprogram *, int, InstBuf_t *, Emitter_t *);
+void codegen_find_tail_calls(struct Statement *, TailCalls_t *);
+int codegen_is_tail_call(struct Statement *);
+InstBuf_t *codegen_tail_call(char *, ListNode_t *, InstBuf_t *, Emitter_t *);
+
+InstBuf_t *codegen_stmt(struct Statement *, InstBuf_t *,Emitter_t *);
+InstBuf_t *codegen_compound_stmt(struct Statement *, InstBuf_t *, Emitter_t *);
+InstBuf_t *codegen_var_assignment(struct Statement *, InstBuf_t *, Emitter_t *);
+InstBuf_t *codegen_var_dest(struct Expression *, InstBuf_t *, Operand_t *);
+InstBuf_t *codegen_array_assignment(struct Statement *, InstBuf_t *, Emitter_t *);
+InstBuf_t *codegen_array_element(struct Expression *, int, InstBuf_t *, Operand_t *);
+int codegen_range_error(int line_num);
+int codegen_index_in_range(struct Expression *, StackNode_t *);
+int codegen_expr_range(struct Expression *, long *, long *);
+int codegen_push_for_range(struct Statement *);
+void print_bounds_check_stats(FILE *);
+InstBuf_t *codegen_proc_call(struct Statement *, InstBuf_t *, Emitter_t *);
+InstBuf_t *codegen_if_then(struct Statement *, InstBuf_t *, Emitter_t *);
+InstBuf_t *codegen_while(struct Statement *, InstBuf_t *, Emitter_t *);
+InstBuf_t *codegen_for(struct Statement *, InstBuf_t *, Emitter_t *);
+InstBuf_t *codegen_for_loop(struct Statement *, struct Expression *, InstBuf_t *, Emitter_t *);
+int codegen_for_is_counted(struct Statement *);
+int codegen_stmt_assigns(struct Statement *, char *);
+InstBuf_t *codegen_unrolled_for(struct Statement *, InstBuf_t *, Emitter_t *);
+InstBuf_t *codegen_for_copies(struct Statement *, struct Expression *, int, InstBuf_t *, Emitter_t *);
+int codegen_vector_width();
+struct Statement *codegen_vector_assign(struct Statement *);
+int codegen_vector_element_ok(struct Expression *, char *);
+int codegen_is_invariant(struct Expression *, char *);
+int codegen_vector_regs(struct Expression *, char *, int *);
+InstBuf_t *codegen_vector_for(struct Statement *, InstBuf_t *, Emitter_t *);
+void codegen_vector_bounds(struct Expression *, struct Expression *, int *, int *, int *);
+InstBuf_t *codegen_vector_invariants(struct Expression *, char *, int, InstBuf_t *);
+InstBuf_t *codegen_vector_invariant(struct Expression *, int, InstBuf_t *);
+InstBuf_t *codegen_vector_operand(struct Expression *, int, int, int, InstBuf_t *, int *);
+Operand_t codegen_vector_element(struct Expression *, int);
+void print_vector_stats(FILE *);
+
+InstBuf_t *codegen_pass_arguments(ListNode_t *, InstBuf_t *, Emitter_t *);
+InstBuf_t *codegen_get_nonlocal(InstBuf_t *, char *, StackNode_t **);
+
+InstBuf_t *codegen_simple_relop(struct Expression *, InstBuf_t *,
+    Emitter_t *, int *);
+
+InstBuf_t *codegen_expr(struct Expression *, InstBuf_t *, Emitter_t *);
+InstBuf_t *codegen_expr_calls(struct Expression *, InstBuf_t *, Emitter_t *);
+void codegen_free_calls(int num_kept);
+int codegen_call_result(struct Expression *);
+InstBuf_t *codegen_builtin_write(ListNode_t *, InstBuf_t *, Emitter_t *);
+InstBuf_t *codegen_builtin_read(ListNode_t *, InstBuf_t *, Emitter_t *);
+InstBuf_t *codegen_args(ListNode_t*, InstBuf_t *, Emitter_t *);
 
 /* (DEPRECATED) */
-ListNode_t *codegen_expr_varid(struct Expression *, ListNode_t *, FILE *);
-ListNode_t *codegen_expr_inum(struct Expression *, ListNode_t *, FILE *);
+InstBuf_t *codegen_expr_varid(struct Expression *, InstBuf_t *, Emitter_t *);
+InstBuf_t *codegen_expr_inum(struct Expression *, InstBuf_t *, Emitter_t *);
 
 #endif
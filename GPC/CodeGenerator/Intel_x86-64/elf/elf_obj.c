@@ -0,0 +1,269 @@
+/*
+    Damon Gwinn
+    ELF object file writer (see elf_obj.h)
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <elf.h>
+#include "elf_obj.h"
+#include "../encoder/encoder.h"
+#include "../emitter/emitter.h"
+
+/* Symbols referenced by relocations but not defined here */
+typedef struct ElfExterns
+{
+    char **names; /* NOTE: Not owned, point into the relocations */
+    int num_names;
+} ElfExterns_t;
+
+/* Adds name to the string table, returns its offset */
+int add_elf_string(ByteBuf_t *strtab, const char *name)
+{
+    int offset;
+
+    offset = strtab->len;
+    do
+    {
+        code_byte(strtab, *name);
+    } while(*name++ != '\0');
+
+    return offset;
+}
+
+void find_elf_externs(MachineCode_t *code, ElfExterns_t *externs)
+{
+    int i, j;
+    char *name;
+
+    externs->names = (char **)malloc((code->num_relocs + 1) * sizeof(char *));
+    assert(externs->names != NULL);
+    externs->num_names = 0;
+
+    for(i = 0; i < code->num_relocs; ++i)
+    {
+        name = code->relocs[i].name;
+        if(find_code_func(code, name) >= 0 || find_code_data(code, name) >= 0)
+            continue;
+
+        for(j = 0; j < externs->num_names; ++j)
+            if(strcmp(externs->names[j], name) == 0)
+                break;
+
+        if(j == externs->num_names)
+            externs->names[externs->num_names++] = name;
+    }
+}
+
+/* Symbol table index of name, laid out as described in elf_obj.h */
+int elf_sym_index(MachineCode_t *code, ElfExterns_t *externs, char *name)
+{
+    int index, i;
+
+    /* Null and file symbols come first */
+    index = find_code_data(code, name);
+    if(index >= 0)
+        return 2 + index;
+
+    index = find_code_func(code, name);
+    if(index >= 0)
+        return 2 + code->num_data + index;
+
+    for(i = 0; i < externs->num_names; ++i)
+        if(strcmp(externs->names[i], name) == 0)
+            return 2 + code->num_data + code->num_funcs + i;
+
+    assert(0 && "Relocation against unknown symbol");
+    return -1;
+}
+
+int elf_align(int offset, int align)
+{
+    return (offset + align - 1) / align * align;
+}
+
+/* Zero pads the output from *pos up to offset */
+void emit_elf_padding(Emitter_t *emitter, int *pos, int offset)
+{
+    assert(offset >= *pos);
+
+    while(*pos < offset)
+    {
+        emit_char(emitter, '\0');
+        ++(*pos);
+    }
+}
+
+void emit_elf_section(Emitter_t *emitter, int *pos, int offset, const void *bytes, int len)
+{
+    emit_elf_padding(emitter, pos, offset);
+    emit_bytes(emitter, bytes, len);
+    *pos += len;
+}
+
+void set_elf_shdr(Elf64_Shdr *shdr, int name, int type, int flags, int offset, int size,
+    int link, int info, int align, int entsize)
+{
+    memset(shdr, 0, sizeof(Elf64_Shdr));
+    shdr->sh_name = name;
+    shdr->sh_type = type;
+    shdr->sh_flags = flags;
+    shdr->sh_offset = offset;
+    shdr->sh_size = size;
+    shdr->sh_link = link;
+    shdr->sh_info = info;
+    shdr->sh_addralign = align;
+    shdr->sh_entsize = entsize;
+}
+
+void write_elf_obj(MachineCode_t *code, char *file_name, Emitter_t *emitter)
+{
+    assert(code != NULL);
+    assert(file_name != NULL);
+    assert(emitter != NULL);
+
+    Elf64_Ehdr ehdr;
+    Elf64_Shdr shdrs[NUM_ELF_SECS];
+    Elf64_Sym *syms, *sym;
+    Elf64_Rela *relas;
+    ElfExterns_t externs;
+    ByteBuf_t strtab, shstrtab;
+    int sec_names[NUM_ELF_SECS];
+    int num_syms, num_locals, i, pos;
+    int text_off, rodata_off, rela_off, symtab_off, strtab_off, shstrtab_off, shdr_off;
+    int rela_type;
+
+    find_elf_externs(code, &externs);
+
+    /***** Symbol table *****/
+    num_locals = 2 + code->num_data;
+    num_syms = num_locals + code->num_funcs + externs.num_names;
+    syms = (Elf64_Sym *)calloc(num_syms, sizeof(Elf64_Sym));
+    assert(syms != NULL);
+
+    init_byte_buf(&strtab);
+    code_byte(&strtab, '\0');
+
+    sym = &syms[1];
+    sym->st_name = add_elf_string(&strtab, file_name);
+    sym->st_info = ELF64_ST_INFO(STB_LOCAL, STT_FILE);
+    sym->st_shndx = SHN_ABS;
+
+    for(i = 0; i < code->num_data; ++i)
+    {
+        sym = &syms[2 + i];
+        sym->st_name = add_elf_string(&strtab, code->data[i].name);
+        sym->st_info = ELF64_ST_INFO(STB_LOCAL, STT_NOTYPE);
+        sym->st_shndx = ELF_SEC_RODATA;
+        sym->st_value = code->data[i].offset;
+    }
+
+    for(i = 0; i < code->num_funcs; ++i)
+    {
+        sym = &syms[num_locals + i];
+        sym->st_name = add_elf_string(&strtab, code->funcs[i].name);
+        sym->st_info = ELF64_ST_INFO(STB_GLOBAL, STT_FUNC);
+        sym->st_shndx = ELF_SEC_TEXT;
+        sym->st_value = code->funcs[i].offset;
+        sym->st_size = code->funcs[i].size;
+    }
+
+    for(i = 0; i < externs.num_names; ++i)
+    {
+        sym = &syms[num_locals + code->num_funcs + i];
+        sym->st_name = add_elf_string(&strtab, externs.names[i]);
+        sym->st_info = ELF64_ST_INFO(STB_GLOBAL, STT_NOTYPE);
+        sym->st_shndx = SHN_UNDEF;
+    }
+
+    /***** Relocations *****/
+    relas = (Elf64_Rela *)calloc(code->num_relocs + 1, sizeof(Elf64_Rela));
+    assert(relas != NULL);
+    for(i = 0; i < code->num_relocs; ++i)
+    {
+        if(code->relocs[i].type == RELOC_PLT32)
+            rela_type = R_X86_64_PLT32;
+        else
+            rela_type = R_X86_64_PC32;
+
+        relas[i].r_offset = code->relocs[i].offset;
+        relas[i].r_info = ELF64_R_INFO(elf_sym_index(code, &externs, code->relocs[i].name),
+            rela_type);
+        relas[i].r_addend = code->relocs[i].addend;
+    }
+
+    /***** Section names *****/
+    init_byte_buf(&shstrtab);
+    code_byte(&shstrtab, '\0');
+    sec_names[ELF_SEC_NULL] = 0;
+    sec_names[ELF_SEC_TEXT] = add_elf_string(&shstrtab, ".text");
+    sec_names[ELF_SEC_RELA_TEXT] = add_elf_string(&shstrtab, ".rela.text");
+    sec_names[ELF_SEC_RODATA] = add_elf_string(&shstrtab, ".rodata");
+    sec_names[ELF_SEC_NOTE_STACK] = add_elf_string(&shstrtab, ".note.GNU-stack");
+    sec_names[ELF_SEC_SYMTAB] = add_elf_string(&shstrtab, ".symtab");
+    sec_names[ELF_SEC_STRTAB] = add_elf_string(&shstrtab, ".strtab");
+    sec_names[ELF_SEC_SHSTRTAB] = add_elf_string(&shstrtab, ".shstrtab");
+
+    /***** Layout *****/
+    text_off = elf_align(sizeof(Elf64_Ehdr), ELF_TEXT_ALIGN);
+    rodata_off = text_off + code->text.len;
+    rela_off = elf_align(rodata_off + code->rodata.len, 8);
+    symtab_off = rela_off + code->num_relocs * sizeof(Elf64_Rela);
+    strtab_off = symtab_off + num_syms * sizeof(Elf64_Sym);
+    shstrtab_off = strtab_off + strtab.len;
+    shdr_off = elf_align(shstrtab_off + shstrtab.len, 8);
+
+    set_elf_shdr(&shdrs[ELF_SEC_NULL], 0, SHT_NULL, 0, 0, 0, 0, 0, 0, 0);
+    set_elf_shdr(&shdrs[ELF_SEC_TEXT], sec_names[ELF_SEC_TEXT], SHT_PROGBITS,
+        SHF_ALLOC | SHF_EXECINSTR, text_off, code->text.len, 0, 0, ELF_TEXT_ALIGN, 0);
+    set_elf_shdr(&shdrs[ELF_SEC_RELA_TEXT], sec_names[ELF_SEC_RELA_TEXT], SHT_RELA,
+        SHF_INFO_LINK, rela_off, code->num_relocs * sizeof(Elf64_Rela), ELF_SEC_SYMTAB,
+        ELF_SEC_TEXT, 8, sizeof(Elf64_Rela));
+    set_elf_shdr(&shdrs[ELF_SEC_RODATA], sec_names[ELF_SEC_RODATA], SHT_PROGBITS,
+        SHF_ALLOC, rodata_off, code->rodata.len, 0, 0, 1, 0);
+    set_elf_shdr(&shdrs[ELF_SEC_NOTE_STACK], sec_names[ELF_SEC_NOTE_STACK], SHT_PROGBITS,
+        0, rela_off, 0, 0, 0, 1, 0);
+    set_elf_shdr(&shdrs[ELF_SEC_SYMTAB], sec_names[ELF_SEC_SYMTAB], SHT_SYMTAB, 0,
+        symtab_off, num_syms * sizeof(Elf64_Sym), ELF_SEC_STRTAB, num_locals, 8,
+        sizeof(Elf64_Sym));
+    set_elf_shdr(&shdrs[ELF_SEC_STRTAB], sec_names[ELF_SEC_STRTAB], SHT_STRTAB, 0,
+        strtab_off, strtab.len, 0, 0, 1, 0);
+    set_elf_shdr(&shdrs[ELF_SEC_SHSTRTAB], sec_names[ELF_SEC_SHSTRTAB], SHT_STRTAB, 0,
+        shstrtab_off, shstrtab.len, 0, 0, 1, 0);
+
+    /***** ELF header *****/
+    memset(&ehdr, 0, sizeof(Elf64_Ehdr));
+    memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+    ehdr.e_ident[EI_CLASS] = ELFCLASS64;
+    ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+    ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+    ehdr.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+    ehdr.e_type = ET_REL;
+    ehdr.e_machine = EM_X86_64;
+    ehdr.e_version = EV_CURRENT;
+    ehdr.e_shoff = shdr_off;
+    ehdr.e_ehsize = sizeof(Elf64_Ehdr);
+    ehdr.e_shentsize = sizeof(Elf64_Shdr);
+    ehdr.e_shnum = NUM_ELF_SECS;
+    ehdr.e_shstrndx = ELF_SEC_SHSTRTAB;
+
+    /***** Writing it all out in file order *****/
+    pos = 0;
+    emit_elf_section(emitter, &pos, 0, &ehdr, sizeof(Elf64_Ehdr));
+    emit_elf_section(emitter, &pos, text_off, code->text.bytes, code->text.len);
+    emit_elf_section(emitter, &pos, rodata_off, code->rodata.bytes, code->rodata.len);
+    emit_elf_section(emitter, &pos, rela_off, relas,
+        code->num_relocs * sizeof(Elf64_Rela));
+    emit_elf_section(emitter, &pos, symtab_off, syms, num_syms * sizeof(Elf64_Sym));
+    emit_elf_section(emitter, &pos, strtab_off, strtab.bytes, strtab.len);
+    emit_elf_section(emitter, &pos, shstrtab_off, shstrtab.bytes, shstrtab.len);
+    emit_elf_section(emitter, &pos, shdr_off, shdrs, sizeof(shdrs));
+
+    free(externs.names);
+    free(syms);
+    free(relas);
+    free(strtab.bytes);
+    free(shstrtab.bytes);
+}
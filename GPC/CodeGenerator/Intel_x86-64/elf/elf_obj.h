@@ -0,0 +1,32 @@
+/*
+    Damon Gwinn
+    ELF object file writer
+
+    Writes encoded machine code (see encoder/encoder.h) as a relocatable ELF64 x86-64
+    object that gcc/ld can link like one produced by the assembler.
+
+    SECTIONS:
+        .text, .rela.text, .rodata, .note.GNU-stack, .symtab, .strtab, .shstrtab
+
+    SYMBOLS:
+        The source file, then the rodata constants as locals, then every encoded function
+        as a global, then every symbol only referenced by a relocation (printf, scanf) as
+        an undefined global.
+*/
+
+#ifndef ELF_OBJ_H
+#define ELF_OBJ_H
+
+#include "../encoder/encoder.h"
+#include "../emitter/emitter.h"
+
+/* Section header indices */
+enum ElfSection{ELF_SEC_NULL, ELF_SEC_TEXT, ELF_SEC_RELA_TEXT, ELF_SEC_RODATA,
+    ELF_SEC_NOTE_STACK, ELF_SEC_SYMTAB, ELF_SEC_STRTAB, ELF_SEC_SHSTRTAB, NUM_ELF_SECS};
+
+#define ELF_TEXT_ALIGN 16
+
+/* NOTE: resolve_labels must already have been called on code */
+void write_elf_obj(MachineCode_t *code, char *file_name, Emitter_t *emitter);
+
+#endif
@@ -0,0 +1,141 @@
+/*
+    Damon Gwinn
+    Buffered assembly emitter (see emitter.h)
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "emitter.h"
+
+void init_emitter(Emitter_t *emitter, int fd)
+{
+    assert(emitter != NULL);
+    assert(fd >= 0);
+
+    struct stat fd_stat;
+
+    emitter->buf = (char *)malloc(EMITTER_START_SIZE);
+    assert(emitter->buf != NULL);
+    emitter->len = 0;
+    emitter->capacity = EMITTER_START_SIZE;
+
+    emitter->fd = fd;
+    if(fstat(fd, &fd_stat) == 0 && S_ISREG(fd_stat.st_mode))
+        emitter->stream = 0;
+    else
+        emitter->stream = 1;
+}
+
+/* Writes out everything buffered so far */
+void flush_emitter(Emitter_t *emitter)
+{
+    assert(emitter != NULL);
+
+    int written;
+    ssize_t ret;
+
+    written = 0;
+    while(written < emitter->len)
+    {
+        ret = write(emitter->fd, emitter->buf + written, emitter->len - written);
+        if(ret < 0)
+        {
+            if(errno == EINTR)
+                continue;
+
+            fprintf(stderr, "ERROR: Failed to write assembly output: %s\n", strerror(errno));
+            exit(1);
+        }
+
+        written += ret;
+    }
+
+    emitter->len = 0;
+}
+
+void free_emitter(Emitter_t *emitter)
+{
+    assert(emitter != NULL);
+
+    free(emitter->buf);
+    emitter->buf = NULL;
+    emitter->len = 0;
+    emitter->capacity = 0;
+}
+
+/* Makes room for size more bytes */
+void emitter_reserve(Emitter_t *emitter, int size)
+{
+    if(emitter->stream && emitter->len + size > EMITTER_STREAM_CHUNK)
+        flush_emitter(emitter);
+
+    if(emitter->len + size > emitter->capacity)
+    {
+        while(emitter->len + size > emitter->capacity)
+            emitter->capacity *= 2;
+
+        emitter->buf = (char *)realloc(emitter->buf, emitter->capacity);
+        if(emitter->buf == NULL)
+        {
+            fprintf(stderr, "ERROR: Out of memory for assembly output!\n");
+            exit(1);
+        }
+    }
+}
+
+void emit_char(Emitter_t *emitter, char c)
+{
+    emitter_reserve(emitter, 1);
+    emitter->buf[emitter->len++] = c;
+}
+
+void emit_str(Emitter_t *emitter, const char *str)
+{
+    assert(str != NULL);
+
+    int len;
+
+    len = strlen(str);
+    emitter_reserve(emitter, len);
+    memcpy(emitter->buf + emitter->len, str, len);
+    emitter->len += len;
+}
+
+/* Decimal formatting without going through printf */
+void emit_int(Emitter_t *emitter, int num)
+{
+    char digits[12];
+    unsigned int abs_num;
+    int i;
+
+    /* Negating as unsigned keeps INT_MIN correct */
+    abs_num = (num < 0) ? 0u - (unsigned int)num : (unsigned int)num;
+
+    i = 0;
+    do
+    {
+        digits[i++] = '0' + (abs_num % 10);
+        abs_num /= 10;
+    } while(abs_num != 0);
+
+    emitter_reserve(emitter, i + 1);
+    if(num < 0)
+        emitter->buf[emitter->len++] = '-';
+
+    while(i > 0)
+        emitter->buf[emitter->len++] = digits[--i];
+}
+
+void emit_bytes(Emitter_t *emitter, const void *bytes, int len)
+{
+    assert(bytes != NULL || len == 0);
+
+    emitter_reserve(emitter, len);
+    memcpy(emitter->buf + emitter->len, bytes, len);
+    emitter->len += len;
+}
@@ -0,0 +1,44 @@
+/*
+    Damon Gwinn
+    Buffered assembly emitter
+
+    All assembly text is rendered into one in-memory buffer and handed to the OS with
+    write(2) instead of going through fprintf line by line.
+
+    A regular output file is written in a single write when the emitter is flushed.
+    Anything else (stdout, a pipe into as, etc.) is streamed out in EMITTER_STREAM_CHUNK
+    sized writes so the reader can start before codegen is done.
+*/
+
+#ifndef EMITTER_H
+#define EMITTER_H
+
+#define EMITTER_START_SIZE 65536
+#define EMITTER_STREAM_CHUNK 65536
+
+typedef struct Emitter
+{
+    char *buf;
+    int len;
+    int capacity;
+
+    int fd;
+    int stream; /* Flush every EMITTER_STREAM_CHUNK bytes instead of once at the end */
+} Emitter_t;
+
+/* NOTE: Does not take ownership of fd */
+void init_emitter(Emitter_t *emitter, int fd);
+void flush_emitter(Emitter_t *emitter);
+
+/* WARNING: Does NOT flush, call flush_emitter first */
+void free_emitter(Emitter_t *emitter);
+
+/* Appending text */
+void emit_char(Emitter_t *emitter, char c);
+void emit_str(Emitter_t *emitter, const char *str);
+void emit_int(Emitter_t *emitter, int num);
+
+/* Raw output (object files) */
+void emit_bytes(Emitter_t *emitter, const void *bytes, int len);
+
+#endif
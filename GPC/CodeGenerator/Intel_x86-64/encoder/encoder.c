@@ -0,0 +1,803 @@
+/*
+    Damon Gwinn
+    x86-64 machine code encoder (see encoder.h)
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "encoder.h"
+#include "../inst_buf/inst_buf.h"
+#include "../register_types.h"
+
+/* ModRM mod field values */
+#define MOD_INDIRECT 0
+#define MOD_DISP8 1
+#define MOD_DISP32 2
+#define MOD_REG 3
+
+/* r/m value meaning a SIB byte follows (or %rip relative with MOD_INDIRECT) */
+#define RM_SIB 4
+#define RM_RIP 5
+#define SIB_NO_INDEX 0x24
+
+/* SIB scale field of an index times 4 */
+#define SIB_SCALE4 2
+
+/* Opcode extensions (ModRM reg field) for the group 1 and group 3 instructions */
+#define EXT_ADD 0
+#define EXT_SUB 5
+#define EXT_CMP 7
+#define EXT_NEG 3
+#define EXT_IDIV 7
+#define EXT_IMUL 5
+#define EXT_SHR 5
+#define EXT_SAR 7
+#define EXT_MOV 0
+
+/* Mandatory prefixes of the SSE instructions, and the same as VEX pp field values */
+#define SSE_PREFIX_66 0x66
+#define SSE_PREFIX_F3 0xF3
+#define VEX_PP_66 1
+#define VEX_PP_F3 2
+
+/* VEX opcode maps, for 0F and 0F 38 opcodes */
+#define VEX_MAP_0F 1
+#define VEX_MAP_0F38 2
+
+/******** Table routines *********/
+
+void init_byte_buf(ByteBuf_t *buf)
+{
+    buf->bytes = (unsigned char *)malloc(MACHINE_CODE_START_SIZE);
+    assert(buf->bytes != NULL);
+    buf->len = 0;
+    buf->capacity = MACHINE_CODE_START_SIZE;
+}
+
+/* Makes room for needed entries of elem_size bytes, returns the (possibly moved) table */
+void *grow_code_table(void *table, int *capacity, int needed, int elem_size)
+{
+    if(needed <= *capacity)
+        return table;
+
+    if(*capacity == 0)
+        *capacity = CODE_TABLE_START_SIZE;
+    while(needed > *capacity)
+        *capacity *= 2;
+
+    table = realloc(table, (size_t)(*capacity) * elem_size);
+    if(table == NULL)
+    {
+        fprintf(stderr, "ERROR: Out of memory for machine code!\n");
+        exit(1);
+    }
+
+    return table;
+}
+
+void code_byte(ByteBuf_t *buf, unsigned char byte)
+{
+    buf->bytes = (unsigned char *)grow_code_table(buf->bytes, &buf->capacity,
+        buf->len + 1, 1);
+    buf->bytes[buf->len++] = byte;
+}
+
+/* Little endian */
+void code_int32(ByteBuf_t *buf, int num)
+{
+    unsigned int bits;
+
+    bits = (unsigned int)num;
+    code_byte(buf, bits & 0xff);
+    code_byte(buf, (bits >> 8) & 0xff);
+    code_byte(buf, (bits >> 16) & 0xff);
+    code_byte(buf, (bits >> 24) & 0xff);
+}
+
+void patch_int32(ByteBuf_t *buf, int offset, int num)
+{
+    unsigned int bits;
+
+    assert(offset >= 0 && offset + 4 <= buf->len);
+
+    bits = (unsigned int)num;
+    buf->bytes[offset] = bits & 0xff;
+    buf->bytes[offset + 1] = (bits >> 8) & 0xff;
+    buf->bytes[offset + 2] = (bits >> 16) & 0xff;
+    buf->bytes[offset + 3] = (bits >> 24) & 0xff;
+}
+
+CodeSym_t *add_code_sym(CodeSym_t **table, int *num, int *capacity, char *name,
+    int offset)
+{
+    CodeSym_t *sym;
+
+    *table = (CodeSym_t *)grow_code_table(*table, capacity, *num + 1, sizeof(CodeSym_t));
+    sym = &(*table)[(*num)++];
+    sym->name = strdup(name);
+    assert(sym->name != NULL);
+    sym->offset = offset;
+    sym->size = 0;
+
+    return sym;
+}
+
+int find_code_sym(CodeSym_t *table, int num, char *name)
+{
+    int i;
+
+    for(i = 0; i < num; ++i)
+        if(strcmp(table[i].name, name) == 0)
+            return i;
+
+    return -1;
+}
+
+/******** Machine code routines *********/
+
+void init_machine_code(MachineCode_t *code)
+{
+    assert(code != NULL);
+
+    init_byte_buf(&code->text);
+    init_byte_buf(&code->rodata);
+
+    code->funcs = NULL;
+    code->num_funcs = 0;
+    code->funcs_capacity = 0;
+
+    code->data = NULL;
+    code->num_data = 0;
+    code->data_capacity = 0;
+
+    code->relocs = NULL;
+    code->num_relocs = 0;
+    code->relocs_capacity = 0;
+
+    code->label_offsets = NULL;
+    code->labels_capacity = 0;
+
+    code->fixups = NULL;
+    code->num_fixups = 0;
+    code->fixups_capacity = 0;
+}
+
+void free_machine_code(MachineCode_t *code)
+{
+    assert(code != NULL);
+
+    int i;
+
+    for(i = 0; i < code->num_funcs; ++i)
+        free(code->funcs[i].name);
+    for(i = 0; i < code->num_data; ++i)
+        free(code->data[i].name);
+    for(i = 0; i < code->num_relocs; ++i)
+        free(code->relocs[i].name);
+
+    free(code->text.bytes);
+    free(code->rodata.bytes);
+    free(code->funcs);
+    free(code->data);
+    free(code->relocs);
+    free(code->label_offsets);
+    free(code->fixups);
+
+    code->funcs = NULL;
+    code->data = NULL;
+    code->relocs = NULL;
+    code->label_offsets = NULL;
+    code->fixups = NULL;
+    code->num_funcs = code->num_data = code->num_relocs = code->num_fixups = 0;
+}
+
+int find_code_func(MachineCode_t *code, char *name)
+{
+    return find_code_sym(code->funcs, code->num_funcs, name);
+}
+
+int find_code_data(MachineCode_t *code, char *name)
+{
+    return find_code_sym(code->data, code->num_data, name);
+}
+
+void add_code_data(MachineCode_t *code, char *name, char *str)
+{
+    assert(code != NULL);
+    assert(name != NULL);
+    assert(str != NULL);
+
+    CodeSym_t *sym;
+    int len, i;
+
+    len = strlen(str) + 1;
+    sym = add_code_sym(&code->data, &code->num_data, &code->data_capacity, name,
+        code->rodata.len);
+    sym->size = len;
+
+    for(i = 0; i < len; ++i)
+        code_byte(&code->rodata, str[i]);
+}
+
+/* Relocation for the 4 bytes about to be written at the end of text */
+void add_code_reloc(MachineCode_t *code, char *name, enum RelocType type, int addend)
+{
+    Reloc_t *reloc;
+    int name_len, suffix_len;
+
+    code->relocs = (Reloc_t *)grow_code_table(code->relocs, &code->relocs_capacity,
+        code->num_relocs + 1, sizeof(Reloc_t));
+    reloc = &code->relocs[code->num_relocs++];
+
+    reloc->offset = code->text.len;
+    reloc->type = type;
+    reloc->addend = addend;
+
+    name_len = strlen(name);
+    suffix_len = strlen(PLT_SUFFIX);
+    if(name_len > suffix_len && strcmp(name + name_len - suffix_len, PLT_SUFFIX) == 0)
+        name_len -= suffix_len;
+
+    reloc->name = strndup(name, name_len);
+    assert(reloc->name != NULL);
+}
+
+void place_code_label(MachineCode_t *code, int label)
+{
+    int old_capacity, i;
+
+    assert(label >= 0);
+
+    old_capacity = code->labels_capacity;
+    code->label_offsets = (int *)grow_code_table(code->label_offsets,
+        &code->labels_capacity, label + 1, sizeof(int));
+    for(i = old_capacity; i < code->labels_capacity; ++i)
+        code->label_offsets[i] = -1;
+
+    code->label_offsets[label] = code->text.len;
+}
+
+/******** Instruction encoding *********/
+
+/* True when the operand needs REX.B/REX.R to reach r8-r15 */
+int reg_high(int reg)
+{
+    return (reg & 8) != 0;
+}
+
+int fits_int8(int num)
+{
+    return num >= -128 && num <= 127;
+}
+
+/* Whether rm needs REX.B (or the VEX equivalent) to reach its register */
+int rm_base_high(Operand_t *rm)
+{
+    return (rm->type == OPND_REG || rm->type == OPND_VREG || rm->type == OPND_MEM ||
+        rm->type == OPND_MEM_INDEX) && reg_high(rm->reg);
+}
+
+/* Whether rm needs REX.X (or the VEX equivalent) to reach its index register */
+int rm_index_high(Operand_t *rm)
+{
+    return rm->type == OPND_MEM_INDEX && reg_high(rm->index);
+}
+
+/* Emits ModRM with any SIB and displacement */
+void encode_modrm(MachineCode_t *code, int reg_field, Operand_t *rm, int imm_size)
+{
+    ByteBuf_t *text;
+    int mod, disp;
+
+    text = &code->text;
+
+    switch(rm->type)
+    {
+        case OPND_REG:
+        case OPND_VREG:
+            code_byte(text, (MOD_REG << 6) | ((reg_field & 7) << 3) | (rm->reg & 7));
+            break;
+
+        case OPND_MEM:
+            disp = rm->val.num;
+
+            /* A base of rbp/r13 always needs a displacement */
+            if(disp == 0 && (rm->reg & 7) != RM_RIP)
+                mod = MOD_INDIRECT;
+            else if(fits_int8(disp))
+                mod = MOD_DISP8;
+            else
+                mod = MOD_DISP32;
+
+            code_byte(text, (mod << 6) | ((reg_field & 7) << 3) | (rm->reg & 7));
+
+            /* A base of rsp/r12 always needs a SIB */
+            if((rm->reg & 7) == RM_SIB)
+                code_byte(text, SIB_NO_INDEX);
+
+            if(mod == MOD_DISP8)
+                code_byte(text, disp & 0xff);
+            else if(mod == MOD_DISP32)
+                code_int32(text, disp);
+            break;
+
+        case OPND_MEM_INDEX:
+            disp = rm->val.num;
+
+            /* Same as above, with the index in the SIB */
+            if(disp == 0 && (rm->reg & 7) != RM_RIP)
+                mod = MOD_INDIRECT;
+            else if(fits_int8(disp))
+                mod = MOD_DISP8;
+            else
+                mod = MOD_DISP32;
+
+            code_byte(text, (mod << 6) | ((reg_field & 7) << 3) | RM_SIB);
+            code_byte(text, (SIB_SCALE4 << 6) | ((rm->index & 7) << 3) | (rm->reg & 7));
+
+            if(mod == MOD_DISP8)
+                code_byte(text, disp & 0xff);
+            else if(mod == MOD_DISP32)
+                code_int32(text, disp);
+            break;
+
+        case OPND_RIP_SYM:
+            code_byte(text, (MOD_INDIRECT << 6) | ((reg_field & 7) << 3) | RM_RIP);
+            add_code_reloc(code, rm->val.sym, RELOC_PC32, -4 - imm_size);
+            code_int32(text, 0);
+            break;
+
+        default:
+            fprintf(stderr, "ERROR: Operand type %d can not be encoded as r/m!\n", rm->type);
+            exit(1);
+    }
+}
+
+/* Emits an optional REX prefix, the opcode, then ModRM (and SIB/displacement) */
+/* imm_size is the size of any immediate following, needed for %rip relative addends */
+void encode_rm(MachineCode_t *code, int wide, const unsigned char *opcode, int opcode_len,
+    int reg_field, Operand_t *rm, int imm_size)
+{
+    ByteBuf_t *text;
+    unsigned char rex;
+    int i;
+
+    text = &code->text;
+
+    rex = 0;
+    if(wide)
+        rex |= 0x08;
+    if(reg_high(reg_field))
+        rex |= 0x04;
+    if(rm_base_high(rm))
+        rex |= 0x01;
+    if(rm_index_high(rm))
+        rex |= 0x02;
+    if(rex != 0)
+        code_byte(text, 0x40 | rex);
+
+    for(i = 0; i < opcode_len; ++i)
+        code_byte(text, opcode[i]);
+
+    encode_modrm(code, reg_field, rm, imm_size);
+}
+
+void encode_rm1(MachineCode_t *code, int wide, unsigned char opcode, int reg_field,
+    Operand_t *rm, int imm_size)
+{
+    encode_rm(code, wide, &opcode, 1, reg_field, rm, imm_size);
+}
+
+/* add, sub and cmp share their encodings apart from the opcode */
+void encode_arith(MachineCode_t *code, int wide, unsigned char to_rm_op,
+    unsigned char from_rm_op, int ext, Operand_t *src, Operand_t *dst)
+{
+    if(src->type == OPND_IMM)
+    {
+        if(fits_int8(src->val.num))
+        {
+            encode_rm1(code, wide, 0x83, ext, dst, 1);
+            code_byte(&code->text, src->val.num & 0xff);
+        }
+        else
+        {
+            encode_rm1(code, wide, 0x81, ext, dst, 4);
+            code_int32(&code->text, src->val.num);
+        }
+    }
+    else if(src->type == OPND_REG)
+        encode_rm1(code, wide, to_rm_op, src->reg, dst, 0);
+    else if(dst->type == OPND_REG)
+        encode_rm1(code, wide, from_rm_op, dst->reg, src, 0);
+    else
+    {
+        fprintf(stderr, "ERROR: Memory to memory arithmetic can not be encoded!\n");
+        exit(1);
+    }
+}
+
+void encode_mov(MachineCode_t *code, int wide, Operand_t *src, Operand_t *dst)
+{
+    if(src->type == OPND_IMM)
+    {
+        if(dst->type == OPND_REG && !wide)
+        {
+            /* movl $imm, %reg */
+            if(reg_high(dst->reg))
+                code_byte(&code->text, 0x41);
+            code_byte(&code->text, 0xB8 + (dst->reg & 7));
+        }
+        else
+            encode_rm1(code, wide, 0xC7, EXT_MOV, dst, 4);
+
+        code_int32(&code->text, src->val.num);
+    }
+    else if(src->type == OPND_REG)
+        encode_rm1(code, wide, 0x89, src->reg, dst, 0);
+    else if(dst->type == OPND_REG)
+        encode_rm1(code, wide, 0x8B, dst->reg, src, 0);
+    else
+    {
+        fprintf(stderr, "ERROR: Memory to memory mov can not be encoded!\n");
+        exit(1);
+    }
+}
+
+void encode_imul(MachineCode_t *code, Operand_t *src, Operand_t *dst)
+{
+    const unsigned char imul_op[2] = {0x0F, 0xAF};
+
+    if(dst->type != OPND_REG)
+    {
+        fprintf(stderr, "ERROR: imul destination must be a register!\n");
+        exit(1);
+    }
+
+    if(src->type == OPND_IMM)
+    {
+        /* imull $imm, %reg is imull $imm, %reg, %reg */
+        if(fits_int8(src->val.num))
+        {
+            encode_rm1(code, 0, 0x6B, dst->reg, dst, 1);
+            code_byte(&code->text, src->val.num & 0xff);
+        }
+        else
+        {
+            encode_rm1(code, 0, 0x69, dst->reg, dst, 4);
+            code_int32(&code->text, src->val.num);
+        }
+    }
+    else
+        encode_rm(code, 0, imul_op, 2, dst->reg, src, 0);
+}
+
+/* Shifts by an immediate count */
+void encode_shift(MachineCode_t *code, int ext, Operand_t *count, Operand_t *dst)
+{
+    if(count->type != OPND_IMM)
+    {
+        fprintf(stderr, "ERROR: Shift count must be an immediate!\n");
+        exit(1);
+    }
+
+    if(count->val.num == 1)
+        encode_rm1(code, 0, 0xD1, ext, dst, 0);
+    else
+    {
+        encode_rm1(code, 0, 0xC1, ext, dst, 1);
+        code_byte(&code->text, count->val.num & 0xff);
+    }
+}
+
+/* Vector instructions (see VECTOR INSTRUCTIONS in inst_buf.h) */
+/* The legacy SSE encoding is used for xmm registers and VEX.256 for ymm registers */
+void encode_vector(MachineCode_t *code, Inst_t *inst)
+{
+    Operand_t *reg, *rm;
+    unsigned char opcode, bytes[3];
+    int map, pp, vvvv, len;
+
+    /* vzeroupper is VEX.128.0F 77 with nothing else to it */
+    if(inst->op == INST_VZEROUPPER)
+    {
+        code_byte(&code->text, 0xC5);
+        code_byte(&code->text, 0xF8);
+        code_byte(&code->text, 0x77);
+        return;
+    }
+
+    assert(inst->num_opnds == 2);
+
+    /* The register operand goes in ModRM reg, the other one in r/m */
+    reg = &inst->opnds[1];
+    rm = &inst->opnds[0];
+    map = VEX_MAP_0F;
+    pp = VEX_PP_66;
+    vvvv = 0;
+
+    switch(inst->op)
+    {
+        case INST_MOVD:
+            opcode = 0x6E;
+            break;
+        case INST_MOVDQU:
+            pp = VEX_PP_F3;
+            if(reg->type == OPND_VREG)
+                opcode = 0x6F;
+            else
+            {
+                opcode = 0x7F;
+                reg = &inst->opnds[0];
+                rm = &inst->opnds[1];
+            }
+            break;
+        case INST_PADDD:
+            opcode = 0xFE;
+            vvvv = reg->reg;
+            break;
+        case INST_PSUBD:
+            opcode = 0xFA;
+            vvvv = reg->reg;
+            break;
+        case INST_PMULLD:
+            map = VEX_MAP_0F38;
+            opcode = 0x40;
+            vvvv = reg->reg;
+            break;
+        case INST_PUNPCKLDQ:
+            opcode = 0x62;
+            vvvv = reg->reg;
+            break;
+        case INST_PUNPCKLQDQ:
+            opcode = 0x6C;
+            vvvv = reg->reg;
+            break;
+        case INST_VPBROADCASTD:
+            map = VEX_MAP_0F38;
+            opcode = 0x58;
+            break;
+        default:
+            assert(0 && "Not a vector instruction");
+    }
+    assert(reg->type == OPND_VREG);
+
+    if(inst_is_avx(inst) || inst->op == INST_VPBROADCASTD)
+    {
+        /* 3 byte VEX with inverted R, X, B and vvvv, W0 and L1 */
+        code_byte(&code->text, 0xC4);
+        code_byte(&code->text, (!reg_high(reg->reg) << 7) | (!rm_index_high(rm) << 6) |
+            (!rm_base_high(rm) << 5) | map);
+        code_byte(&code->text, ((~vvvv & 0xF) << 3) | (1 << 2) | pp);
+        code_byte(&code->text, opcode);
+        encode_modrm(code, reg->reg, rm, 0);
+    }
+    else
+    {
+        /* The mandatory prefix goes before any REX */
+        code_byte(&code->text, (pp == VEX_PP_F3) ? SSE_PREFIX_F3 : SSE_PREFIX_66);
+
+        len = 0;
+        bytes[len++] = 0x0F;
+        if(map == VEX_MAP_0F38)
+            bytes[len++] = 0x38;
+        bytes[len++] = opcode;
+        encode_rm(code, 0, bytes, len, reg->reg, rm, 0);
+    }
+}
+
+/* Jumps always use rel32, the offset is patched in resolve_labels */
+void encode_jmp(MachineCode_t *code, enum InstOp op, Operand_t *target)
+{
+    LabelFixup_t *fixup;
+
+    assert(target->type == OPND_LABEL);
+
+    switch(op)
+    {
+        case INST_JMP:
+            code_byte(&code->text, 0xE9);
+            break;
+        case INST_JE:
+            code_byte(&code->text, 0x0F);
+            code_byte(&code->text, 0x84);
+            break;
+        case INST_JNE:
+            code_byte(&code->text, 0x0F);
+            code_byte(&code->text, 0x85);
+            break;
+        case INST_JL:
+            code_byte(&code->text, 0x0F);
+            code_byte(&code->text, 0x8C);
+            break;
+        case INST_JGE:
+            code_byte(&code->text, 0x0F);
+            code_byte(&code->text, 0x8D);
+            break;
+        case INST_JLE:
+            code_byte(&code->text, 0x0F);
+            code_byte(&code->text, 0x8E);
+            break;
+        case INST_JG:
+            code_byte(&code->text, 0x0F);
+            code_byte(&code->text, 0x8F);
+            break;
+        case INST_JB:
+            code_byte(&code->text, 0x0F);
+            code_byte(&code->text, 0x82);
+            break;
+        case INST_JAE:
+            code_byte(&code->text, 0x0F);
+            code_byte(&code->text, 0x83);
+            break;
+        default:
+            assert(0 && "Not a jump");
+    }
+
+    code->fixups = (LabelFixup_t *)grow_code_table(code->fixups, &code->fixups_capacity,
+        code->num_fixups + 1, sizeof(LabelFixup_t));
+    fixup = &code->fixups[code->num_fixups++];
+    fixup->offset = code->text.len;
+    fixup->label = target->val.num;
+
+    code_int32(&code->text, 0);
+}
+
+void encode_inst(MachineCode_t *code, Inst_t *inst)
+{
+    assert(code != NULL);
+    assert(inst != NULL);
+
+    Operand_t *src, *dst;
+
+    src = &inst->opnds[0];
+    dst = &inst->opnds[1];
+
+    switch(inst->op)
+    {
+        case INST_LABEL:
+            place_code_label(code, src->val.num);
+            break;
+
+        case INST_MOVL:
+            encode_mov(code, 0, src, dst);
+            break;
+        case INST_MOVQ:
+            encode_mov(code, 1, src, dst);
+            break;
+        case INST_LEAQ:
+            encode_rm1(code, 1, 0x8D, dst->reg, src, 0);
+            break;
+
+        case INST_ADDL:
+            encode_arith(code, 0, 0x01, 0x03, EXT_ADD, src, dst);
+            break;
+        case INST_SUBL:
+            encode_arith(code, 0, 0x29, 0x2B, EXT_SUB, src, dst);
+            break;
+        case INST_SUBQ:
+            encode_arith(code, 1, 0x29, 0x2B, EXT_SUB, src, dst);
+            break;
+        case INST_CMPL:
+            encode_arith(code, 0, 0x39, 0x3B, EXT_CMP, src, dst);
+            break;
+        case INST_IMULL:
+            /* imull src is %edx:%eax = %eax * src */
+            if(inst->num_opnds == 1)
+                encode_rm1(code, 0, 0xF7, EXT_IMUL, src, 0);
+            else
+                encode_imul(code, src, dst);
+            break;
+        case INST_IDIVL:
+            encode_rm1(code, 0, 0xF7, EXT_IDIV, src, 0);
+            break;
+        case INST_NEGL:
+            encode_rm1(code, 0, 0xF7, EXT_NEG, src, 0);
+            break;
+        case INST_SARL:
+            encode_shift(code, EXT_SAR, src, dst);
+            break;
+        case INST_SHRL:
+            encode_shift(code, EXT_SHR, src, dst);
+            break;
+
+        case INST_CLTD:
+            code_byte(&code->text, 0x99);
+            break;
+        case INST_NOP:
+            code_byte(&code->text, 0x90);
+            break;
+        case INST_LEAVE:
+            code_byte(&code->text, 0xC9);
+            break;
+        case INST_RET:
+            code_byte(&code->text, 0xC3);
+            break;
+
+        case INST_PUSHQ:
+        case INST_POPQ:
+            assert(src->type == OPND_REG);
+            if(reg_high(src->reg))
+                code_byte(&code->text, 0x41);
+            code_byte(&code->text, (inst->op == INST_PUSHQ ? 0x50 : 0x58) + (src->reg & 7));
+            break;
+
+        case INST_CALL:
+        case INST_TAIL_JMP:
+            assert(src->type == OPND_SYM);
+            code_byte(&code->text, inst->op == INST_CALL ? 0xE8 : 0xE9);
+            add_code_reloc(code, src->val.sym, RELOC_PLT32, -4);
+            code_int32(&code->text, 0);
+            break;
+
+        case INST_JMP:
+        case INST_JE:
+        case INST_JNE:
+        case INST_JL:
+        case INST_JLE:
+        case INST_JG:
+        case INST_JGE:
+        case INST_JB:
+        case INST_JAE:
+            encode_jmp(code, inst->op, src);
+            break;
+
+        case INST_MOVD:
+        case INST_MOVDQU:
+        case INST_PADDD:
+        case INST_PSUBD:
+        case INST_PMULLD:
+        case INST_PUNPCKLDQ:
+        case INST_PUNPCKLQDQ:
+        case INST_VPBROADCASTD:
+        case INST_VZEROUPPER:
+            encode_vector(code, inst);
+            break;
+
+        default:
+            fprintf(stderr, "ERROR: Unrecognized instruction %d in encoder!\n", inst->op);
+            exit(1);
+    }
+}
+
+void encode_symbol(MachineCode_t *code, char *name, InstBuf_t *inst_list)
+{
+    assert(code != NULL);
+    assert(name != NULL);
+    assert(inst_list != NULL);
+
+    int i, start;
+
+    start = code->text.len;
+    for(i = 0; i < inst_list->num_insts; ++i)
+        encode_inst(code, &inst_list->insts[i]);
+
+    add_code_sym(&code->funcs, &code->num_funcs, &code->funcs_capacity, name,
+        start)->size = code->text.len - start;
+}
+
+void resolve_labels(MachineCode_t *code)
+{
+    assert(code != NULL);
+
+    LabelFixup_t *fixup;
+    int i, target;
+
+    for(i = 0; i < code->num_fixups; ++i)
+    {
+        fixup = &code->fixups[i];
+
+        target = -1;
+        if(fixup->label < code->labels_capacity)
+            target = code->label_offsets[fixup->label];
+        if(target < 0)
+        {
+            fprintf(stderr, "ERROR: Jump to undefined label .L%d!\n", fixup->label);
+            exit(1);
+        }
+
+        /* rel32 is relative to the end of the jump */
+        patch_int32(&code->text, fixup->offset, target - (fixup->offset + 4));
+    }
+}
@@ -0,0 +1,112 @@
+/*
+    Damon Gwinn
+    x86-64 machine code encoder
+
+    Turns finished instruction buffers (see inst_buf/inst_buf.h) straight into machine code
+    so an object file can be written without going through an assembler.
+
+    Only the instructions and operand forms the code generator actually produces are
+    supported. Anything else is a compiler bug and exits with an error.
+
+    LABELS:
+        Jumps are always encoded with a rel32 so instruction sizes never depend on label
+        positions. Jump targets are recorded as fixups and patched by resolve_labels once
+        every function has been encoded.
+
+    RELOCATIONS:
+        Calls and %rip relative operands are left as zeroes with a relocation against the
+        symbol name. A "@PLT" suffix is dropped from the name, the relocation type says
+        how it is resolved instead.
+*/
+
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include "../inst_buf/inst_buf.h"
+
+#define MACHINE_CODE_START_SIZE 4096
+#define CODE_TABLE_START_SIZE 16
+
+#define PLT_SUFFIX "@PLT"
+
+/* Mirrors R_X86_64_PLT32 and R_X86_64_PC32 */
+enum RelocType{RELOC_PLT32, RELOC_PC32};
+
+typedef struct ByteBuf
+{
+    unsigned char *bytes;
+    int len;
+    int capacity;
+} ByteBuf_t;
+
+/* A function in text or a constant in rodata */
+typedef struct CodeSym
+{
+    char *name; /* Owned */
+    int offset;
+    int size;
+} CodeSym_t;
+
+typedef struct Reloc
+{
+    int offset; /* Into text */
+    char *name; /* Owned, without any @PLT suffix */
+    enum RelocType type;
+    int addend;
+} Reloc_t;
+
+typedef struct LabelFixup
+{
+    int offset; /* Of the rel32 in text */
+    int label;
+} LabelFixup_t;
+
+typedef struct MachineCode
+{
+    ByteBuf_t text;
+    ByteBuf_t rodata;
+
+    CodeSym_t *funcs;
+    int num_funcs;
+    int funcs_capacity;
+
+    CodeSym_t *data;
+    int num_data;
+    int data_capacity;
+
+    Reloc_t *relocs;
+    int num_relocs;
+    int relocs_capacity;
+
+    /* Indexed by label number, -1 until the label is placed */
+    int *label_offsets;
+    int labels_capacity;
+
+    LabelFixup_t *fixups;
+    int num_fixups;
+    int fixups_capacity;
+} MachineCode_t;
+
+/* Byte buffer routines */
+void init_byte_buf(ByteBuf_t *buf);
+void code_byte(ByteBuf_t *buf, unsigned char byte);
+void code_int32(ByteBuf_t *buf, int num);
+
+void init_machine_code(MachineCode_t *code);
+void free_machine_code(MachineCode_t *code);
+
+/* Adds a nul terminated string constant to rodata */
+void add_code_data(MachineCode_t *code, char *name, char *str);
+
+/* Encodes a whole function into text */
+void encode_symbol(MachineCode_t *code, char *name, InstBuf_t *inst_list);
+void encode_inst(MachineCode_t *code, Inst_t *inst);
+
+/* Patches every jump once all functions are encoded */
+void resolve_labels(MachineCode_t *code);
+
+/* Lookups, return -1 when not found */
+int find_code_func(MachineCode_t *code, char *name);
+int find_code_data(MachineCode_t *code, char *name);
+
+#endif
@@ -1,9 +1,7 @@
 /*
     Damon Gwinn
     Tree of simple expressions for the gencode algorithm
-    TODO: Does not handle function calls or arrays
     TODO: Does not handle real numbers
-    TODO: Does not handle panic case (not enough registers)
 */
 
 #include <stdlib.h>
@@ -13,6 +11,7 @@
 #include "expr_tree.h"
 #include "../register_types.h"
 #include "../codegen.h"
+#include "../inst_buf/inst_buf.h"
 #include "../stackmng/stackmng.h"
 #include "../../../flags.h"
 #include "../../../Parser/List/List.h"
@@ -21,19 +20,25 @@
 #include "../../../Parser/LexAndYacc/y.tab.h"
 
 /* Helper functions */
-ListNode_t *gencode_sign_term(expr_node_t *node, RegStack_t *reg_stack, ListNode_t *inst_list);
-ListNode_t *gencode_case0(expr_node_t *node, RegStack_t *reg_stack, ListNode_t *inst_list);
-ListNode_t *gencode_case1(expr_node_t *node, RegStack_t *reg_stack, ListNode_t *inst_list);
-ListNode_t *gencode_case2(expr_node_t *node, RegStack_t *reg_stack, ListNode_t *inst_list);
-ListNode_t *gencode_case3(expr_node_t *node, RegStack_t *reg_stack, ListNode_t *inst_list);
-ListNode_t *gencode_leaf_var(struct Expression *, ListNode_t *, char *, int );
-ListNode_t *gencode_op(struct Expression *expr, char *left, char *right,
-    ListNode_t *inst_list);
-ListNode_t *gencode_op_deprecated(struct Expression *expr, ListNode_t *inst_list,
+InstBuf_t *gencode_sign_term(expr_node_t *node, RegStack_t *reg_stack, InstBuf_t *inst_list);
+InstBuf_t *gencode_array_access(expr_node_t *node, RegStack_t *reg_stack, InstBuf_t *inst_list);
+InstBuf_t *gencode_case0(expr_node_t *node, RegStack_t *reg_stack, InstBuf_t *inst_list);
+InstBuf_t *gencode_case1(expr_node_t *node, RegStack_t *reg_stack, InstBuf_t *inst_list);
+InstBuf_t *gencode_case2(expr_node_t *node, RegStack_t *reg_stack, InstBuf_t *inst_list);
+InstBuf_t *gencode_case3(expr_node_t *node, RegStack_t *reg_stack, InstBuf_t *inst_list);
+InstBuf_t *gencode_case4(expr_node_t *node, RegStack_t *reg_stack, InstBuf_t *inst_list);
+InstBuf_t *gencode_leaf_var(struct Expression *, InstBuf_t *, Operand_t *);
+InstBuf_t *gencode_op(struct Expression *expr, Operand_t left, Operand_t right,
+    InstBuf_t *inst_list);
+InstBuf_t *gencode_op_deprecated(struct Expression *expr, InstBuf_t *inst_list,
     char *buffer, int buf_len);
 
-ListNode_t *gencode_divide_const_no_optimize(char *left, char *right, ListNode_t *inst_list);
-ListNode_t *gencode_divide_no_const(char *left, char *right, ListNode_t *inst_list);
+InstBuf_t *gencode_divide_const(Operand_t left, Operand_t right, InstBuf_t *inst_list);
+InstBuf_t *gencode_divide_pow2(int divisor, Operand_t right, InstBuf_t *inst_list);
+InstBuf_t *gencode_divide_magic(int divisor, Operand_t right, InstBuf_t *inst_list);
+InstBuf_t *gencode_divide_const_no_optimize(Operand_t left, Operand_t right,
+    InstBuf_t *inst_list);
+InstBuf_t *gencode_divide_no_const(Operand_t left, Operand_t right, InstBuf_t *inst_list);
 
 /* Builds an expression tree out of an expression */
 /* WARNING: Does not make deep copy of expression */
@@ -59,13 +64,25 @@ expr_node_t *build_expr_tree(struct Expression *expr)
             new_node->right_expr = build_expr_tree(expr->expr_data.mulop_data.right_factor);
             break;
 
+        /* A negative number is a leaf like any other number (ex: a divisor of -7) */
         case EXPR_SIGN_TERM:
-            new_node->left_expr = build_expr_tree(expr->expr_data.sign_term);
+            if(expr->expr_data.sign_term->type == EXPR_INUM)
+                new_node->left_expr = NULL;
+            else
+                new_node->left_expr = build_expr_tree(expr->expr_data.sign_term);
             new_node->right_expr = NULL;
             break;
 
+        /* The index is the only child */
+        case EXPR_ARRAY_ACCESS:
+            new_node->left_expr = build_expr_tree(expr->expr_data.array_access_data.array_expr);
+            new_node->right_expr = NULL;
+            break;
+
+        /* Calls are already made, their results are read like variables */
         case EXPR_VAR_ID:
         case EXPR_INUM:
+        case EXPR_FUNCTION_CALL:
             new_node->left_expr = NULL;
             new_node->right_expr = NULL;
             break;
@@ -119,22 +136,26 @@ expr_node_t *build_expr_tree(struct Expression *expr)
 }
 
 /* The famous gencode algorithm */
-ListNode_t *gencode_expr_tree(expr_node_t *node, RegStack_t *reg_stack, ListNode_t *inst_list)
+InstBuf_t *gencode_expr_tree(expr_node_t *node, RegStack_t *reg_stack, InstBuf_t *inst_list)
 {
     assert(node != NULL);
     assert(node->expr != NULL);
 
-    if(node->label > get_num_registers(reg_stack))
+    if(get_num_registers(reg_stack) < 1)
     {
-        fprintf(stderr, "ERROR: codegen more complex than number of registers is unsupported!\n");
+        fprintf(stderr, "ERROR: No registers left for gencode!\n");
         exit(1);
     }
 
     /* Handle special cases first */
-    if(node->expr->type == EXPR_SIGN_TERM)
+    if(node->expr->type == EXPR_SIGN_TERM && node->left_expr != NULL)
     {
         inst_list = gencode_sign_term(node, reg_stack, inst_list);
     }
+    else if(node->expr->type == EXPR_ARRAY_ACCESS)
+    {
+        inst_list = gencode_array_access(node, reg_stack, inst_list);
+    }
 
     /* CASE 0 */
     else if(expr_tree_is_leaf(node) == 1)
@@ -146,6 +167,12 @@ ListNode_t *gencode_expr_tree(expr_node_t *node, RegStack_t *reg_stack, ListNode
     {
         inst_list = gencode_case1(node, reg_stack, inst_list);
     }
+    /* CASE 4 (panic, neither side fits in the registers left) */
+    else if(node->left_expr->label >= get_num_registers(reg_stack) &&
+        node->right_expr->label >= get_num_registers(reg_stack))
+    {
+        inst_list = gencode_case4(node, reg_stack, inst_list);
+    }
     /* CASE 2 */
     else if(node->left_expr->label < node->right_expr->label)
     {
@@ -217,32 +244,49 @@ void free_expr_tree(expr_node_t *node)
 }
 
 /* Special case for a sign term */
-ListNode_t *gencode_sign_term(expr_node_t *node, RegStack_t *reg_stack, ListNode_t *inst_list)
+InstBuf_t *gencode_sign_term(expr_node_t *node, RegStack_t *reg_stack, InstBuf_t *inst_list)
 {
     assert(node != NULL);
     assert(node->expr != NULL);
     assert(node->expr->type == EXPR_SIGN_TERM);
 
-    char buffer[50];
     Register_t *reg;
 
     inst_list = gencode_expr_tree(node->left_expr, reg_stack, inst_list);
     reg = front_reg_stack(reg_stack);
 
-    snprintf(buffer, 50, "\tnegl\t%s\n", reg->bit_32);
-    inst_list = add_inst(inst_list, buffer);
+    inst_list = add_inst1(inst_list, INST_NEGL, opnd_reg32(reg->id));
+
+    return inst_list;
+}
+
+/* Special case for an array element */
+/* The element is loaded over its index (see codegen_array_element) */
+InstBuf_t *gencode_array_access(expr_node_t *node, RegStack_t *reg_stack, InstBuf_t *inst_list)
+{
+    assert(node != NULL);
+    assert(node->expr != NULL);
+    assert(node->expr->type == EXPR_ARRAY_ACCESS);
+
+    Register_t *reg;
+    Operand_t elem;
+
+    inst_list = gencode_expr_tree(node->left_expr, reg_stack, inst_list);
+    reg = front_reg_stack(reg_stack);
+
+    inst_list = codegen_array_element(node->expr, reg->id, inst_list, &elem);
+    inst_list = add_inst2(inst_list, INST_MOVL, elem, opnd_reg32(reg->id));
 
     return inst_list;
 }
 
 /* node is a leaf */
-ListNode_t *gencode_case0(expr_node_t *node, RegStack_t *reg_stack, ListNode_t *inst_list)
+InstBuf_t *gencode_case0(expr_node_t *node, RegStack_t *reg_stack, InstBuf_t *inst_list)
 {
     assert(node != NULL);
     assert(node->expr != NULL);
 
-    char buffer[50];
-    char buf_leaf[30];
+    Operand_t leaf;
     struct Expression *expr;
     Register_t *reg;
 
@@ -250,23 +294,20 @@ ListNode_t *gencode_case0(expr_node_t *node, RegStack_t *reg_stack, ListNode_t *
     reg = front_reg_stack(reg_stack);
     assert(reg != NULL);
 
-    inst_list = gencode_leaf_var(expr, inst_list, buf_leaf, 30);
-
-    snprintf(buffer, 50, "\tmovl\t%s, %s\n", buf_leaf, reg->bit_32);
+    inst_list = gencode_leaf_var(expr, inst_list, &leaf);
 
-    return add_inst(inst_list, buffer);
+    return add_inst2(inst_list, INST_MOVL, leaf, opnd_reg32(reg->id));
 }
 
 /* right node is a leaf */
-ListNode_t *gencode_case1(expr_node_t *node, RegStack_t *reg_stack, ListNode_t *inst_list)
+InstBuf_t *gencode_case1(expr_node_t *node, RegStack_t *reg_stack, InstBuf_t *inst_list)
 {
     assert(node != NULL);
     assert(node->expr != NULL);
     assert(node->right_expr != NULL);
     assert(node->right_expr->expr != NULL);
 
-    char buffer[50];
-    char name_buf[30];
+    Operand_t leaf;
     struct Expression *expr, *right_expr;
     Register_t *reg;
 
@@ -275,22 +316,20 @@ ListNode_t *gencode_case1(expr_node_t *node, RegStack_t *reg_stack, ListNode_t *
     expr = node->expr;
     right_expr = node->right_expr->expr;
     assert(right_expr != NULL);
-    inst_list = gencode_leaf_var(right_expr, inst_list, name_buf, 30);
+    inst_list = gencode_leaf_var(right_expr, inst_list, &leaf);
     reg = front_reg_stack(reg_stack);
 
-    inst_list = gencode_op(expr, name_buf, reg->bit_32, inst_list);
+    inst_list = gencode_op(expr, leaf, opnd_reg32(reg->id), inst_list);
 
     return inst_list;
 }
 
 
-ListNode_t *gencode_case2(expr_node_t *node, RegStack_t *reg_stack, ListNode_t *inst_list)
+InstBuf_t *gencode_case2(expr_node_t *node, RegStack_t *reg_stack, InstBuf_t *inst_list)
 {
     assert(node != NULL);
     assert(node->expr != NULL);
 
-    char buffer[50];
-    char op_buf[30];
     Register_t *reg1, *reg2;
 
     swap_reg_stack(reg_stack);
@@ -299,7 +338,7 @@ ListNode_t *gencode_case2(expr_node_t *node, RegStack_t *reg_stack, ListNode_t *
     inst_list = gencode_expr_tree(node->left_expr, reg_stack, inst_list);
 
     reg2 = front_reg_stack(reg_stack);
-    inst_list = gencode_op(node->expr, reg1->bit_32, reg2->bit_32, inst_list);
+    inst_list = gencode_op(node->expr, opnd_reg32(reg1->id), opnd_reg32(reg2->id), inst_list);
 
     push_reg_stack(reg_stack, reg1);
     swap_reg_stack(reg_stack);
@@ -307,13 +346,11 @@ ListNode_t *gencode_case2(expr_node_t *node, RegStack_t *reg_stack, ListNode_t *
     return inst_list;
 }
 
-ListNode_t *gencode_case3(expr_node_t *node, RegStack_t *reg_stack, ListNode_t *inst_list)
+InstBuf_t *gencode_case3(expr_node_t *node, RegStack_t *reg_stack, InstBuf_t *inst_list)
 {
     assert(node != NULL);
     assert(node->expr != NULL);
 
-    char buffer[50];
-    char op_buf[30];
     Register_t *reg1, *reg2;
 
     inst_list = gencode_expr_tree(node->left_expr, reg_stack, inst_list);
@@ -321,22 +358,47 @@ ListNode_t *gencode_case3(expr_node_t *node, RegStack_t *reg_stack, ListNode_t *
     inst_list = gencode_expr_tree(node->right_expr, reg_stack, inst_list);
 
     reg2 = front_reg_stack(reg_stack);
-    inst_list = gencode_op(node->expr, reg2->bit_32, reg1->bit_32, inst_list);
+    inst_list = gencode_op(node->expr, opnd_reg32(reg2->id), opnd_reg32(reg1->id), inst_list);
 
     push_reg_stack(reg_stack, reg1);
 
     return inst_list;
 }
 
-/* Returns the corresponding string and instructions for a leaf */
-/* TODO: Only supports var_id and i_num */
-ListNode_t *gencode_leaf_var(struct Expression *expr, ListNode_t *inst_list,
-    char *buffer, int buf_len)
+/* Both sides need every register left */
+/* Right side is evaluated first and spilled to a temporary while the left side is done */
+InstBuf_t *gencode_case4(expr_node_t *node, RegStack_t *reg_stack, InstBuf_t *inst_list)
+{
+    assert(node != NULL);
+    assert(node->expr != NULL);
+
+    Register_t *reg;
+    int temp_offset;
+
+    inst_list = gencode_expr_tree(node->right_expr, reg_stack, inst_list);
+    reg = front_reg_stack(reg_stack);
+    temp_offset = add_spill_t();
+    inst_list = add_inst2(inst_list, INST_MOVL, opnd_reg32(reg->id),
+        opnd_mem(REG_RBP, -temp_offset));
+
+    inst_list = gencode_expr_tree(node->left_expr, reg_stack, inst_list);
+    reg = front_reg_stack(reg_stack);
+    inst_list = gencode_op(node->expr, opnd_mem(REG_RBP, -temp_offset), opnd_reg32(reg->id),
+        inst_list);
+
+    free_spill_t(temp_offset);
+
+    return inst_list;
+}
+
+/* Returns the corresponding operand and instructions for a leaf */
+/* TODO: Only supports var_id, (negated) i_num and function calls (see codegen_expr_calls) */
+InstBuf_t *gencode_leaf_var(struct Expression *expr, InstBuf_t *inst_list,
+    Operand_t *opnd)
 {
     assert(expr != NULL);
 
     StackNode_t *stack_node;
-    int offset;
 
     switch(expr->type)
     {
@@ -345,12 +407,12 @@ ListNode_t *gencode_leaf_var(struct Expression *expr, ListNode_t *inst_list,
 
             if(stack_node != NULL)
             {
-                snprintf(buffer, buf_len, "-%d(%%rbp)", stack_node->offset);
+                *opnd = opnd_mem(REG_RBP, -stack_node->offset);
             }
             else if(nonlocal_flag() == 1)
             {
-                inst_list = codegen_get_nonlocal(inst_list, expr->expr_data.id, &offset);
-                snprintf(buffer, buf_len, "-%d(%s)", offset, NON_LOCAL_REG_64);
+                inst_list = codegen_get_nonlocal(inst_list, expr->expr_data.id, &stack_node);
+                *opnd = opnd_mem(NON_LOCAL_REG, -stack_node->offset);
             }
             else
             {
@@ -362,7 +424,17 @@ ListNode_t *gencode_leaf_var(struct Expression *expr, ListNode_t *inst_list,
             break;
 
         case EXPR_INUM:
-            snprintf(buffer, buf_len, "$%d", expr->expr_data.i_num);
+            *opnd = opnd_imm(expr->expr_data.i_num);
+            break;
+
+        /* Negated number (see build_expr_tree), wraps like negl */
+        case EXPR_SIGN_TERM:
+            assert(expr->expr_data.sign_term->type == EXPR_INUM);
+            *opnd = opnd_imm((int)(0U - (unsigned int)expr->expr_data.sign_term->expr_data.i_num));
+            break;
+
+        case EXPR_FUNCTION_CALL:
+            *opnd = opnd_mem(REG_RBP, -codegen_call_result(expr));
             break;
 
         default:
@@ -374,15 +446,12 @@ ListNode_t *gencode_leaf_var(struct Expression *expr, ListNode_t *inst_list,
 }
 
 /* TODO: Assumes eax and edx registers are free for division */
-ListNode_t *gencode_op(struct Expression *expr, char *left, char *right,
-    ListNode_t *inst_list)
+InstBuf_t *gencode_op(struct Expression *expr, Operand_t left, Operand_t right,
+    InstBuf_t *inst_list)
 {
     assert(expr != NULL);
-    assert(left != NULL);
-    assert(right != NULL);
 
     int type;
-    char buffer[50];
 
     switch(expr->type)
     {
@@ -390,13 +459,11 @@ ListNode_t *gencode_op(struct Expression *expr, char *left, char *right,
             type = expr->expr_data.addop_data.addop_type;
             if(type == PLUS)
             {
-                snprintf(buffer, 50, "\taddl\t%s, %s\n", left, right);
-                inst_list = add_inst(inst_list, buffer);
+                inst_list = add_inst2(inst_list, INST_ADDL, left, right);
             }
             else if(type == MINUS)
             {
-                snprintf(buffer, 50, "\tsubl\t%s, %s\n", left, right);
-                inst_list = add_inst(inst_list, buffer);
+                inst_list = add_inst2(inst_list, INST_SUBL, left, right);
             }
             else
             {
@@ -410,17 +477,15 @@ ListNode_t *gencode_op(struct Expression *expr, char *left, char *right,
             type = expr->expr_data.mulop_data.mulop_type;
             if(type == STAR)
             {
-                snprintf(buffer, 50, "\timull\t%s, %s\n", left, right);
-                inst_list = add_inst(inst_list, buffer);
+                inst_list = add_inst2(inst_list, INST_IMULL, left, right);
             }
             /* NOTE: Division and modulus is a more special case */
             else if(type == SLASH)
             {
                 /* Constant divisor */
-                /* TODO: Optimize */
-                if(left[0] == '$')
+                if(left.type == OPND_IMM)
                 {
-                    inst_list = gencode_divide_const_no_optimize(left, right, inst_list);
+                    inst_list = gencode_divide_const(left, right, inst_list);
                 }
                 /* Non-constant divisor */
                 else
@@ -437,8 +502,7 @@ ListNode_t *gencode_op(struct Expression *expr, char *left, char *right,
             break;
 
         case EXPR_RELOP:
-            snprintf(buffer, 50, "\tcmpl\t%s, %s\n", left, right);
-            inst_list = add_inst(inst_list, buffer);
+            inst_list = add_inst2(inst_list, INST_CMPL, left, right);
 
             break;
 
@@ -450,58 +514,159 @@ ListNode_t *gencode_op(struct Expression *expr, char *left, char *right,
     return inst_list;
 }
 
-/* Gencode for division with constant divisor (no optimization) */
-/* Throws constant divisor into temporary stack (TODO: This is bad) */
-ListNode_t *gencode_divide_const_no_optimize(char *left, char *right, ListNode_t *inst_list)
+/* Gencode for division with constant divisor */
+/* Avoids idivl with shifts or a multiply by the divisor's magic number */
+InstBuf_t *gencode_divide_const(Operand_t left, Operand_t right, InstBuf_t *inst_list)
 {
-    StackNode_t *temp;
-    char buffer[50];
+    int divisor;
+    unsigned int abs_divisor;
 
-    temp = find_in_temp("TEMP_DIV");
-    if(temp == NULL)
-        temp = add_l_t("TEMP_DIV");
+    divisor = left.val.num;
+    abs_divisor = divisor < 0 ? -(unsigned int)divisor : (unsigned int)divisor;
 
-    snprintf(buffer, 50, "\tmovl\t%s, %%eax\n", right);
-    inst_list = add_inst(inst_list, buffer);
+    /* Division by zero is left to fault at runtime like it always has */
+    if(divisor == 0)
+        return gencode_divide_const_no_optimize(left, right, inst_list);
 
-    snprintf(buffer, 50, "\tmovl\t%s, -%d(%%rbp)\n", left, temp->offset);
-    inst_list = add_inst(inst_list, buffer);
+    if(divisor == 1)
+        return inst_list;
+    if(divisor == -1)
+        return add_inst1(inst_list, INST_NEGL, right);
 
-    snprintf(buffer, 50, "\tcltd\n");
-    inst_list = add_inst(inst_list, buffer);
+    if((abs_divisor & (abs_divisor - 1)) == 0)
+        return gencode_divide_pow2(divisor, right, inst_list);
 
-    snprintf(buffer, 50, "\tidivl\t-%d(%%rbp)\n", temp->offset);
-    inst_list = add_inst(inst_list, buffer);
+    return gencode_divide_magic(divisor, right, inst_list);
+}
 
-    snprintf(buffer, 50, "\tmovl\t%%eax, %s\n", right);
-    inst_list = add_inst(inst_list, buffer);
+/* Gencode for division by +/- 2^k */
+/* Negative dividends are biased by 2^k - 1 so the shift truncates toward zero */
+InstBuf_t *gencode_divide_pow2(int divisor, Operand_t right, InstBuf_t *inst_list)
+{
+    int shift;
+    unsigned int abs_divisor;
+
+    abs_divisor = divisor < 0 ? -(unsigned int)divisor : (unsigned int)divisor;
+    shift = 0;
+    while((1U << shift) != abs_divisor)
+        ++shift;
+
+    inst_list = add_inst2(inst_list, INST_MOVL, right, opnd_reg32(REG_RAX));
+    if(shift > 1)
+        inst_list = add_inst2(inst_list, INST_SARL, opnd_imm(shift - 1), opnd_reg32(REG_RAX));
+    inst_list = add_inst2(inst_list, INST_SHRL, opnd_imm(32 - shift), opnd_reg32(REG_RAX));
+    inst_list = add_inst2(inst_list, INST_ADDL, right, opnd_reg32(REG_RAX));
+    inst_list = add_inst2(inst_list, INST_SARL, opnd_imm(shift), opnd_reg32(REG_RAX));
+    if(divisor < 0)
+        inst_list = add_inst1(inst_list, INST_NEGL, opnd_reg32(REG_RAX));
+    inst_list = add_inst2(inst_list, INST_MOVL, opnd_reg32(REG_RAX), right);
 
     return inst_list;
 }
 
-/* Gencode for division with non-constant divisor */
-ListNode_t *gencode_divide_no_const(char *left, char *right, ListNode_t *inst_list)
+/* Magic number and shift for signed division (Hacker's Delight, 10-1) */
+/* NOTE: divisor must not be -1, 0, or 1 */
+void divide_magic_number(int divisor, int *magic, int *shift)
 {
-    char buffer[50];
+    const unsigned int two31 = 0x80000000U;
+    unsigned int abs_divisor, t, anc, delta, q1, r1, q2, r2;
+    int p;
+
+    abs_divisor = divisor < 0 ? -(unsigned int)divisor : (unsigned int)divisor;
+    t = two31 + ((unsigned int)divisor >> 31);
+    anc = t - 1 - t % abs_divisor;
+    p = 31;
+    q1 = two31 / anc;
+    r1 = two31 - q1 * anc;
+    q2 = two31 / abs_divisor;
+    r2 = two31 - q2 * abs_divisor;
+
+    do
+    {
+        ++p;
+        q1 = 2 * q1;
+        r1 = 2 * r1;
+        if(r1 >= anc)
+        {
+            ++q1;
+            r1 -= anc;
+        }
+        q2 = 2 * q2;
+        r2 = 2 * r2;
+        if(r2 >= abs_divisor)
+        {
+            ++q2;
+            r2 -= abs_divisor;
+        }
+        delta = abs_divisor - r2;
+    } while(q1 < delta || (q1 == delta && r1 == 0));
 
-    snprintf(buffer, 50, "\tmovl\t%s, %%eax\n", right);
-    inst_list = add_inst(inst_list, buffer);
+    *magic = (int)(q2 + 1);
+    if(divisor < 0)
+        *magic = -*magic;
+    *shift = p - 32;
+}
 
-    snprintf(buffer, 50, "\tcltd\n");
-    inst_list = add_inst(inst_list, buffer);
+/* Gencode for division by any other constant */
+/* Takes the high half of dividend * magic, then rounds toward zero */
+InstBuf_t *gencode_divide_magic(int divisor, Operand_t right, InstBuf_t *inst_list)
+{
+    int magic, shift;
 
-    snprintf(buffer, 50, "\tidivl\t%s\n", left);
-    inst_list = add_inst(inst_list, buffer);
+    divide_magic_number(divisor, &magic, &shift);
 
-    snprintf(buffer, 50, "\tmovl\t%%eax, %s\n", right);
-    inst_list = add_inst(inst_list, buffer);
+    inst_list = add_inst2(inst_list, INST_MOVL, opnd_imm(magic), opnd_reg32(REG_RAX));
+    inst_list = add_inst1(inst_list, INST_IMULL, right);
+    if(divisor > 0 && magic < 0)
+        inst_list = add_inst2(inst_list, INST_ADDL, right, opnd_reg32(REG_RDX));
+    else if(divisor < 0 && magic > 0)
+        inst_list = add_inst2(inst_list, INST_SUBL, right, opnd_reg32(REG_RDX));
+    if(shift > 0)
+        inst_list = add_inst2(inst_list, INST_SARL, opnd_imm(shift), opnd_reg32(REG_RDX));
+
+    /* Adds one when the quotient is negative */
+    inst_list = add_inst2(inst_list, INST_MOVL, opnd_reg32(REG_RDX), opnd_reg32(REG_RAX));
+    inst_list = add_inst2(inst_list, INST_SHRL, opnd_imm(31), opnd_reg32(REG_RAX));
+    inst_list = add_inst2(inst_list, INST_ADDL, opnd_reg32(REG_RAX), opnd_reg32(REG_RDX));
+    inst_list = add_inst2(inst_list, INST_MOVL, opnd_reg32(REG_RDX), right);
+
+    return inst_list;
+}
+
+/* Gencode for division with constant divisor (no optimization) */
+/* Throws constant divisor into temporary stack, only used for dividing by zero */
+InstBuf_t *gencode_divide_const_no_optimize(Operand_t left, Operand_t right,
+    InstBuf_t *inst_list)
+{
+    StackNode_t *temp;
+
+    temp = find_in_temp("TEMP_DIV");
+    if(temp == NULL)
+        temp = add_l_t("TEMP_DIV");
+
+    inst_list = add_inst2(inst_list, INST_MOVL, right, opnd_reg32(REG_RAX));
+    inst_list = add_inst2(inst_list, INST_MOVL, left, opnd_mem(REG_RBP, -temp->offset));
+    inst_list = add_inst0(inst_list, INST_CLTD);
+    inst_list = add_inst1(inst_list, INST_IDIVL, opnd_mem(REG_RBP, -temp->offset));
+    inst_list = add_inst2(inst_list, INST_MOVL, opnd_reg32(REG_RAX), right);
+
+    return inst_list;
+}
+
+/* Gencode for division with non-constant divisor */
+InstBuf_t *gencode_divide_no_const(Operand_t left, Operand_t right, InstBuf_t *inst_list)
+{
+    inst_list = add_inst2(inst_list, INST_MOVL, right, opnd_reg32(REG_RAX));
+    inst_list = add_inst0(inst_list, INST_CLTD);
+    inst_list = add_inst1(inst_list, INST_IDIVL, left);
+    inst_list = add_inst2(inst_list, INST_MOVL, opnd_reg32(REG_RAX), right);
 
     return inst_list;
 }
 
 /* Gets simple operation of a node */
 /* DEPRECATED */
-ListNode_t *gencode_op_deprecated(struct Expression *expr, ListNode_t *inst_list,
+InstBuf_t *gencode_op_deprecated(struct Expression *expr, InstBuf_t *inst_list,
     char *buffer, int buf_len)
 {
     assert(expr != NULL);
@@ -1,7 +1,10 @@
 /*
     Damon Gwinn
     Tree of simple expressions for the gencode algorithm
-    TODO: Does not handle panic case (not enough registers)
+
+    When both sides of a node need more registers than are left (the panic case), the
+    right side is spilled to a reused temporary (see add_spill_t) while the left side is
+    evaluated, which keeps spills to the minimum for the tree.
 */
 
 #ifndef EXPR_TREE_H
@@ -11,6 +14,7 @@
 #include <stdio.h>
 #include "../../../Parser/List/List.h"
 #include "../stackmng/stackmng.h"
+#include "../inst_buf/inst_buf.h"
 #include "../../../Parser/ParseTree/tree.h"
 #include "../../../Parser/ParseTree/tree_types.h"
 #include "../../../Parser/LexAndYacc/y.tab.h"
@@ -28,7 +32,7 @@ typedef struct expr_node
 } expr_node_t;
 
 expr_node_t *build_expr_tree(struct Expression *);
-ListNode_t *gencode_expr_tree(expr_node_t *, RegStack_t *, ListNode_t *);
+InstBuf_t *gencode_expr_tree(expr_node_t *, RegStack_t *, InstBuf_t *);
 int expr_tree_is_leaf(expr_node_t *);
 void print_expr_tree(expr_node_t *, int num_indent, FILE *);
 void free_expr_tree(expr_node_t *);
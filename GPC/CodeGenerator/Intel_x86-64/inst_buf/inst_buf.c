@@ -0,0 +1,413 @@
+/*
+    Damon Gwinn
+    Instruction buffer for code generation (see inst_buf.h)
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "inst_buf.h"
+#include "../emitter/emitter.h"
+#include "../register_types.h"
+
+/* Indexed by InstOp */
+const char *inst_op_names[NUM_INST_OPS] = {NULL, "movl", "movq", "leaq", "addl",
+    "subl", "imull", "idivl", "negl", "cmpl", "cltd", "call", "jmp", "je", "jne", "jl",
+    "jle", "jg", "jge", "jb", "jae", "pushq", "popq", "subq", "nop", "leave", "ret",
+    "sarl", "shrl", "jmp", "movd", "movdqu", "paddd", "psubd", "pmulld", "punpckldq",
+    "punpcklqdq", "vpbroadcastd", "vzeroupper"};
+
+/* Indexed by RegId */
+const char *reg_names_64[NUM_REG_IDS] = {"%rax", "%rcx", "%rdx", "%rbx", "%rsp",
+    "%rbp", "%rsi", "%rdi", "%r8", "%r9", "%r10", "%r11", "%r12", "%r13", "%r14", "%r15",
+    "%rip"};
+
+const char *reg_names_32[NUM_REG_IDS] = {"%eax", "%ecx", "%edx", "%ebx", "%esp",
+    "%ebp", "%esi", "%edi", "%r8d", "%r9d", "%r10d", "%r11d", "%r12d", "%r13d", "%r14d",
+    "%r15d", NULL};
+
+/******** Buffer routines *********/
+
+void init_inst_buf(InstBuf_t *buf)
+{
+    assert(buf != NULL);
+
+    buf->insts = (Inst_t *)malloc(INST_BUF_START_SIZE * sizeof(Inst_t));
+    assert(buf->insts != NULL);
+    buf->num_insts = 0;
+    buf->capacity = INST_BUF_START_SIZE;
+}
+
+void free_inst_buf(InstBuf_t *buf)
+{
+    assert(buf != NULL);
+
+    free(buf->insts);
+    buf->insts = NULL;
+    buf->num_insts = 0;
+    buf->capacity = 0;
+}
+
+/* Returns the next free slot, doubling the buffer when full */
+Inst_t *inst_buf_next(InstBuf_t *buf)
+{
+    assert(buf != NULL);
+
+    if(buf->num_insts == buf->capacity)
+    {
+        buf->capacity *= 2;
+        buf->insts = (Inst_t *)realloc(buf->insts, buf->capacity * sizeof(Inst_t));
+        if(buf->insts == NULL)
+        {
+            fprintf(stderr, "ERROR: Out of memory for instruction buffer!\n");
+            exit(1);
+        }
+    }
+
+    return &buf->insts[buf->num_insts++];
+}
+
+InstBuf_t *add_inst0(InstBuf_t *buf, enum InstOp op)
+{
+    Inst_t *inst;
+
+    inst = inst_buf_next(buf);
+    inst->op = op;
+    inst->num_opnds = 0;
+
+    return buf;
+}
+
+InstBuf_t *add_inst1(InstBuf_t *buf, enum InstOp op, Operand_t opnd)
+{
+    Inst_t *inst;
+
+    inst = inst_buf_next(buf);
+    inst->op = op;
+    inst->num_opnds = 1;
+    inst->opnds[0] = opnd;
+
+    return buf;
+}
+
+InstBuf_t *add_inst2(InstBuf_t *buf, enum InstOp op, Operand_t src, Operand_t dst)
+{
+    Inst_t *inst;
+
+    inst = inst_buf_next(buf);
+    inst->op = op;
+    inst->num_opnds = 2;
+    inst->opnds[0] = src;
+    inst->opnds[1] = dst;
+
+    return buf;
+}
+
+InstBuf_t *add_label(InstBuf_t *buf, int label)
+{
+    return add_inst1(buf, INST_LABEL, opnd_label(label));
+}
+
+/* Copies one instruction onto the end of buf */
+InstBuf_t *add_inst(InstBuf_t *buf, Inst_t *inst)
+{
+    *inst_buf_next(buf) = *inst;
+    return buf;
+}
+
+/* Copies every instruction of other onto the end of buf */
+InstBuf_t *append_inst_buf(InstBuf_t *buf, InstBuf_t *other)
+{
+    assert(buf != NULL);
+    assert(other != NULL);
+
+    int i;
+
+    for(i = 0; i < other->num_insts; ++i)
+        *inst_buf_next(buf) = other->insts[i];
+
+    return buf;
+}
+
+/******** Operand routines *********/
+
+Operand_t opnd_reg32(int reg)
+{
+    Operand_t opnd;
+
+    assert(reg >= 0 && reg < NUM_REG_IDS);
+
+    opnd.type = OPND_REG;
+    opnd.size = 4;
+    opnd.reg = reg;
+    opnd.index = REG_RAX;
+    opnd.val.num = 0;
+
+    return opnd;
+}
+
+Operand_t opnd_reg64(int reg)
+{
+    Operand_t opnd;
+
+    opnd = opnd_reg32(reg);
+    opnd.size = 8;
+
+    return opnd;
+}
+
+Operand_t opnd_imm(int imm)
+{
+    Operand_t opnd;
+
+    opnd.type = OPND_IMM;
+    opnd.size = 4;
+    opnd.reg = REG_RAX;
+    opnd.index = REG_RAX;
+    opnd.val.num = imm;
+
+    return opnd;
+}
+
+Operand_t opnd_mem(int base_reg, int disp)
+{
+    Operand_t opnd;
+
+    opnd = opnd_reg64(base_reg);
+    opnd.type = OPND_MEM;
+    opnd.val.num = disp;
+
+    return opnd;
+}
+
+Operand_t opnd_mem_index(int base_reg, int disp, int index_reg)
+{
+    Operand_t opnd;
+
+    assert(index_reg >= 0 && index_reg < NUM_REG_IDS && index_reg != REG_RSP);
+
+    opnd = opnd_mem(base_reg, disp);
+    opnd.type = OPND_MEM_INDEX;
+    opnd.index = index_reg;
+
+    return opnd;
+}
+
+Operand_t opnd_label(int label)
+{
+    Operand_t opnd;
+
+    opnd.type = OPND_LABEL;
+    opnd.size = 0;
+    opnd.reg = REG_RAX;
+    opnd.index = REG_RAX;
+    opnd.val.num = label;
+
+    return opnd;
+}
+
+Operand_t opnd_sym(char *sym)
+{
+    Operand_t opnd;
+
+    assert(sym != NULL);
+
+    opnd.type = OPND_SYM;
+    opnd.size = 0;
+    opnd.reg = REG_RAX;
+    opnd.index = REG_RAX;
+    opnd.val.sym = sym;
+
+    return opnd;
+}
+
+Operand_t opnd_rip_sym(char *sym)
+{
+    Operand_t opnd;
+
+    opnd = opnd_sym(sym);
+    opnd.type = OPND_RIP_SYM;
+    opnd.reg = REG_RIP;
+
+    return opnd;
+}
+
+/* vreg is 0-15, size is 16 for xmm and 32 for ymm */
+Operand_t opnd_vreg(int vreg, int size)
+{
+    Operand_t opnd;
+
+    assert(vreg >= 0 && vreg < NUM_VREGS);
+    assert(size == XMM_SIZE || size == YMM_SIZE);
+
+    opnd.type = OPND_VREG;
+    opnd.size = size;
+    opnd.reg = vreg;
+    opnd.index = REG_RAX;
+    opnd.val.num = 0;
+
+    return opnd;
+}
+
+int inst_is_vector(enum InstOp op)
+{
+    return op >= INST_MOVD && op <= INST_VZEROUPPER;
+}
+
+/* NOTE: vpbroadcastd only has a VEX form, so it's already named that way */
+int inst_is_avx(Inst_t *inst)
+{
+    int i;
+
+    if(!inst_is_vector(inst->op) || inst->op == INST_VPBROADCASTD)
+        return 0;
+
+    for(i = 0; i < inst->num_opnds; ++i)
+        if(inst->opnds[i].type == OPND_VREG && inst->opnds[i].size == YMM_SIZE)
+            return 1;
+
+    return 0;
+}
+
+/******** Text output *********/
+
+const char *inst_op_name(enum InstOp op)
+{
+    assert(op > INST_LABEL && op < NUM_INST_OPS);
+    return inst_op_names[op];
+}
+
+const char *reg_name(int reg, int size)
+{
+    assert(reg >= 0 && reg < NUM_REG_IDS);
+
+    if(size == 8)
+        return reg_names_64[reg];
+
+    assert(reg_names_32[reg] != NULL);
+    return reg_names_32[reg];
+}
+
+/* Reverse of reg_name, REG_NONE if name is not a register of that size */
+int reg_id_from_name(const char *name, int size)
+{
+    assert(name != NULL);
+
+    const char **names;
+    int reg;
+
+    names = (size == 8) ? reg_names_64 : reg_names_32;
+    for(reg = 0; reg < NUM_REG_IDS; ++reg)
+        if(names[reg] != NULL && strcmp(names[reg], name) == 0)
+            return reg;
+
+    return REG_NONE;
+}
+
+void emit_operand(Operand_t *opnd, Emitter_t *emitter)
+{
+    assert(opnd != NULL);
+
+    switch(opnd->type)
+    {
+        case OPND_REG:
+            emit_str(emitter, reg_name(opnd->reg, opnd->size));
+            break;
+
+        case OPND_IMM:
+            emit_char(emitter, '$');
+            emit_int(emitter, opnd->val.num);
+            break;
+
+        case OPND_MEM:
+            if(opnd->val.num != 0)
+                emit_int(emitter, opnd->val.num);
+            emit_char(emitter, '(');
+            emit_str(emitter, reg_name(opnd->reg, 8));
+            emit_char(emitter, ')');
+            break;
+
+        case OPND_MEM_INDEX:
+            if(opnd->val.num != 0)
+                emit_int(emitter, opnd->val.num);
+            emit_char(emitter, '(');
+            emit_str(emitter, reg_name(opnd->reg, 8));
+            emit_char(emitter, ',');
+            emit_str(emitter, reg_name(opnd->index, 8));
+            emit_str(emitter, ",4)");
+            break;
+
+        case OPND_VREG:
+            emit_str(emitter, (opnd->size == YMM_SIZE) ? "%ymm" : "%xmm");
+            emit_int(emitter, opnd->reg);
+            break;
+
+        case OPND_LABEL:
+            emit_str(emitter, ".L");
+            emit_int(emitter, opnd->val.num);
+            break;
+
+        case OPND_SYM:
+            emit_str(emitter, opnd->val.sym);
+            break;
+
+        case OPND_RIP_SYM:
+            emit_str(emitter, opnd->val.sym);
+            emit_str(emitter, "(%rip)");
+            break;
+
+        default:
+            fprintf(stderr, "ERROR: Unrecognized operand type %d!\n", opnd->type);
+            exit(1);
+    }
+}
+
+void emit_inst(Inst_t *inst, Emitter_t *emitter)
+{
+    assert(inst != NULL);
+
+    int avx;
+
+    if(inst->op == INST_LABEL)
+    {
+        assert(inst->num_opnds == 1);
+        emit_operand(&inst->opnds[0], emitter);
+        emit_str(emitter, ":\n");
+        return;
+    }
+
+    avx = inst_is_avx(inst);
+
+    emit_char(emitter, '\t');
+    if(avx)
+        emit_char(emitter, 'v');
+    emit_str(emitter, inst_op_name(inst->op));
+    if(inst->num_opnds > 0)
+    {
+        emit_char(emitter, '\t');
+        emit_operand(&inst->opnds[0], emitter);
+    }
+    if(inst->num_opnds > 1)
+    {
+        emit_str(emitter, ", ");
+        emit_operand(&inst->opnds[1], emitter);
+    }
+    if(avx && inst->op >= INST_PADDD && inst->op <= INST_PUNPCKLQDQ)
+    {
+        emit_str(emitter, ", ");
+        emit_operand(&inst->opnds[1], emitter);
+    }
+    emit_char(emitter, '\n');
+}
+
+/* An empty buffer is interpreted as no instructions */
+void emit_inst_buf(InstBuf_t *buf, Emitter_t *emitter)
+{
+    int i;
+
+    assert(buf != NULL);
+
+    for(i = 0; i < buf->num_insts; ++i)
+        emit_inst(&buf->insts[i], emitter);
+}
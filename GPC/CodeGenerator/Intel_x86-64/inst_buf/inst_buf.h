@@ -0,0 +1,108 @@
+/*
+    Damon Gwinn
+    Instruction buffer for code generation
+
+    Instructions are stored as fixed-size records in one growable array instead of as
+    formatted strings. Text is only produced when the buffer is written out, so later
+    passes can look at opcodes and operands directly.
+
+    OPERAND ORDER:
+        Operands are kept in AT&T order. For two operand instructions opnds[0] is the
+        source and opnds[1] is the destination.
+
+        A one operand imull is the widening multiply of %eax into %edx:%eax.
+
+    VECTOR INSTRUCTIONS:
+        INST_MOVD through INST_VZEROUPPER work on packed doublewords in the xmm and ymm
+        registers (OPND_VREG). They are written with their SSE names and take the same two
+        operands. With a ymm operand they are the AVX2 forms instead, and the arithmetic
+        ones use the destination as their first source (vpaddd src, dst, dst).
+*/
+
+#ifndef INST_BUF_H
+#define INST_BUF_H
+
+#include "../emitter/emitter.h"
+
+#define INST_BUF_START_SIZE 64
+
+/* NOTE: Suffix gives the operand size */
+/* INST_TAIL_JMP is a jmp to a function symbol in place of a call and ret (see codegen_tail_call) */
+/* INST_JB and INST_JAE are the unsigned jumps, used by array bounds checks */
+enum InstOp{INST_LABEL, INST_MOVL, INST_MOVQ, INST_LEAQ, INST_ADDL, INST_SUBL, INST_IMULL,
+    INST_IDIVL, INST_NEGL, INST_CMPL, INST_CLTD, INST_CALL, INST_JMP, INST_JE, INST_JNE,
+    INST_JL, INST_JLE, INST_JG, INST_JGE, INST_JB, INST_JAE, INST_PUSHQ, INST_POPQ, INST_SUBQ, INST_NOP,
+    INST_LEAVE, INST_RET, INST_SARL, INST_SHRL, INST_TAIL_JMP,
+    INST_MOVD, INST_MOVDQU, INST_PADDD, INST_PSUBD, INST_PMULLD, INST_PUNPCKLDQ,
+    INST_PUNPCKLQDQ, INST_VPBROADCASTD, INST_VZEROUPPER, NUM_INST_OPS};
+
+/* OPND_MEM is disp(reg), OPND_RIP_SYM is sym(%rip), OPND_LABEL is .L<num> */
+/* OPND_MEM_INDEX is disp(reg,index,4), an element of an array of doublewords */
+/* OPND_VREG is %xmm<reg> (size 16) or %ymm<reg> (size 32) */
+enum OperandType{OPND_NONE, OPND_REG, OPND_IMM, OPND_MEM, OPND_LABEL, OPND_SYM,
+    OPND_RIP_SYM, OPND_MEM_INDEX, OPND_VREG};
+
+typedef struct Operand
+{
+    unsigned char type;
+    unsigned char size; /* Register width in bytes (4, 8, or 16 and 32 for vectors) */
+    unsigned char reg; /* Register or base register, see RegId in register_types.h */
+    unsigned char index; /* Index register of OPND_MEM_INDEX */
+
+    union operand_val
+    {
+        int num; /* Immediate, displacement, or label number */
+        char *sym; /* NOTE: Not owned by the operand */
+    } val;
+} Operand_t;
+
+typedef struct Inst
+{
+    enum InstOp op;
+    int num_opnds;
+    Operand_t opnds[2];
+} Inst_t;
+
+typedef struct InstBuf
+{
+    Inst_t *insts;
+    int num_insts;
+    int capacity;
+} InstBuf_t;
+
+/* Buffer routines */
+void init_inst_buf(InstBuf_t *buf);
+void free_inst_buf(InstBuf_t *buf);
+InstBuf_t *add_inst0(InstBuf_t *buf, enum InstOp op);
+InstBuf_t *add_inst1(InstBuf_t *buf, enum InstOp op, Operand_t opnd);
+InstBuf_t *add_inst2(InstBuf_t *buf, enum InstOp op, Operand_t src, Operand_t dst);
+InstBuf_t *add_label(InstBuf_t *buf, int label);
+InstBuf_t *add_inst(InstBuf_t *buf, Inst_t *inst);
+InstBuf_t *append_inst_buf(InstBuf_t *buf, InstBuf_t *other);
+
+/* Operand routines */
+Operand_t opnd_reg32(int reg);
+Operand_t opnd_reg64(int reg);
+Operand_t opnd_imm(int imm);
+Operand_t opnd_mem(int base_reg, int disp);
+Operand_t opnd_mem_index(int base_reg, int disp, int index_reg);
+Operand_t opnd_label(int label);
+Operand_t opnd_sym(char *sym);
+Operand_t opnd_rip_sym(char *sym);
+Operand_t opnd_vreg(int vreg, int size);
+
+/* Whether op is one of the vector instructions */
+int inst_is_vector(enum InstOp op);
+
+/* Whether inst is written as its AVX2 form (see VECTOR INSTRUCTIONS) */
+int inst_is_avx(Inst_t *inst);
+
+/* Text output (GNU as syntax) */
+const char *inst_op_name(enum InstOp op);
+const char *reg_name(int reg, int size);
+int reg_id_from_name(const char *name, int size);
+void emit_operand(Operand_t *opnd, Emitter_t *emitter);
+void emit_inst(Inst_t *inst, Emitter_t *emitter);
+void emit_inst_buf(InstBuf_t *buf, Emitter_t *emitter);
+
+#endif
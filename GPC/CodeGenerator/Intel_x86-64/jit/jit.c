@@ -0,0 +1,144 @@
+/*
+    Damon Gwinn
+    In-process execution of encoded machine code (see jit.h)
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "jit.h"
+#include "../encoder/encoder.h"
+
+/* Every extern the code generator can reference (see PRINTF_CALL, SCANF_CALL and EXIT_CALL) */
+/* NOTE: scanf and __isoc99_scanf only differ on %a, which the generated code never uses */
+JitExtern_t jit_externs[] = {
+    {"printf", (void *)printf},
+    {"__isoc99_scanf", (void *)scanf},
+    {"exit", (void *)exit},
+    {NULL, NULL}
+};
+
+int jit_align(int offset, int align)
+{
+    return (offset + align - 1) / align * align;
+}
+
+int find_jit_extern(char *name)
+{
+    int i;
+
+    for(i = 0; jit_externs[i].name != NULL; ++i)
+        if(strcmp(jit_externs[i].name, name) == 0)
+            return i;
+
+    return -1;
+}
+
+/* Writes "jmp *0(%rip)" followed by the absolute address */
+void write_jit_stub(unsigned char *stub, void *addr)
+{
+    uint64_t abs_addr;
+
+    memset(stub, 0x90, JIT_STUB_SIZE);
+    stub[0] = 0xFF;
+    stub[1] = 0x25;
+    memset(stub + 2, 0, 4);
+
+    abs_addr = (uint64_t)(uintptr_t)addr;
+    memcpy(stub + 6, &abs_addr, sizeof(abs_addr));
+}
+
+/* Address a relocation against name resolves to */
+unsigned char *jit_sym_addr(MachineCode_t *code, char *name, unsigned char *base,
+    int rodata_off, int stubs_off)
+{
+    int index;
+
+    index = find_code_func(code, name);
+    if(index >= 0)
+        return base + code->funcs[index].offset;
+
+    index = find_code_data(code, name);
+    if(index >= 0)
+        return base + rodata_off + code->data[index].offset;
+
+    index = find_jit_extern(name);
+    if(index >= 0)
+        return base + stubs_off + index * JIT_STUB_SIZE;
+
+    fprintf(stderr, "ERROR: Undefined reference to %s!\n", name);
+    exit(1);
+}
+
+int run_machine_code(MachineCode_t *code, char *entry)
+{
+    assert(code != NULL);
+    assert(entry != NULL);
+
+    unsigned char *base, *target, *site;
+    int rodata_off, stubs_off, num_stubs, size, page_size, entry_index, i, ret;
+    int64_t rel;
+    int32_t rel32;
+    int (*entry_func)();
+
+    entry_index = find_code_func(code, entry);
+    if(entry_index < 0)
+    {
+        fprintf(stderr, "ERROR: No entry point %s to run!\n", entry);
+        exit(1);
+    }
+
+    num_stubs = 0;
+    while(jit_externs[num_stubs].name != NULL)
+        ++num_stubs;
+
+    rodata_off = jit_align(code->text.len, JIT_SECTION_ALIGN);
+    stubs_off = jit_align(rodata_off + code->rodata.len, JIT_SECTION_ALIGN);
+    page_size = sysconf(_SC_PAGESIZE);
+    size = jit_align(stubs_off + num_stubs * JIT_STUB_SIZE, page_size);
+
+    base = (unsigned char *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(base == MAP_FAILED)
+    {
+        fprintf(stderr, "ERROR: Failed to map memory for running: %s\n", strerror(errno));
+        exit(1);
+    }
+
+    memcpy(base, code->text.bytes, code->text.len);
+    memcpy(base + rodata_off, code->rodata.bytes, code->rodata.len);
+    for(i = 0; i < num_stubs; ++i)
+        write_jit_stub(base + stubs_off + i * JIT_STUB_SIZE, jit_externs[i].addr);
+
+    /* Both relocation types are S + A - P */
+    for(i = 0; i < code->num_relocs; ++i)
+    {
+        site = base + code->relocs[i].offset;
+        target = jit_sym_addr(code, code->relocs[i].name, base, rodata_off, stubs_off);
+
+        rel = (int64_t)(target - site) + code->relocs[i].addend;
+        assert(rel >= INT32_MIN && rel <= INT32_MAX);
+        rel32 = (int32_t)rel;
+        memcpy(site, &rel32, sizeof(rel32));
+    }
+
+    if(mprotect(base, size, PROT_READ | PROT_EXEC) != 0)
+    {
+        fprintf(stderr, "ERROR: Failed to make code executable: %s\n", strerror(errno));
+        exit(1);
+    }
+
+    entry_func = (int (*)())(base + code->funcs[entry_index].offset);
+    ret = entry_func();
+
+    /* The program's printf output is still sitting in our stdio buffer */
+    fflush(stdout);
+    munmap(base, size);
+
+    return ret;
+}
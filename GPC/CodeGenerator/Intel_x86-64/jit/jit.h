@@ -0,0 +1,37 @@
+/*
+    Damon Gwinn
+    In-process execution of encoded machine code (-run)
+
+    Instead of writing an object file, the encoded program (see encoder/encoder.h) is
+    copied into one mmap'd buffer, its relocations are resolved against this process,
+    and main is called directly. No assembler, linker or temp files are involved.
+
+    BUFFER LAYOUT:
+        text | rodata | extern stubs
+
+        Everything lives in one mapping so every rel32 reaches. Calls to functions that
+        are not part of the program (printf, scanf) go through a stub of
+        "jmp *0(%rip)" followed by the absolute address, since libc is usually too far
+        away for a rel32.
+*/
+
+#ifndef JIT_H
+#define JIT_H
+
+#include "../encoder/encoder.h"
+
+#define JIT_SECTION_ALIGN 16
+#define JIT_STUB_SIZE 16
+
+/* Functions the generated code may call, resolved in-process */
+typedef struct JitExtern
+{
+    char *name;
+    void *addr;
+} JitExtern_t;
+
+/* NOTE: resolve_labels must already have been called on code */
+/* Returns what entry returned */
+int run_machine_code(MachineCode_t *code, char *entry);
+
+#endif
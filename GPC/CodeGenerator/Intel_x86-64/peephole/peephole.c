@@ -0,0 +1,878 @@
+/*
+    Damon Gwinn
+    Peephole optimizer for finished functions (see peephole.h)
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include "peephole.h"
+#include "../inst_buf/inst_buf.h"
+#include "../register_types.h"
+
+#define REG_BIT(reg) (1 << (reg))
+#define ALL_REGS ((1 << NUM_REG_IDS) - 1)
+
+#define CALL_USED_REGS (REG_BIT(REG_RDI) | REG_BIT(REG_RSI) | REG_BIT(REG_RDX) | \
+    REG_BIT(REG_RCX) | REG_BIT(REG_R8) | REG_BIT(REG_R9) | REG_BIT(REG_RAX))
+#define CALL_CLOBBERED_REGS (CALL_USED_REGS | REG_BIT(REG_R10) | REG_BIT(REG_R11))
+#define RET_USED_REGS (REG_BIT(REG_RAX) | REG_BIT(REG_RBX) | REG_BIT(REG_RSP) | \
+    REG_BIT(REG_RBP) | REG_BIT(REG_R12) | REG_BIT(REG_R13) | REG_BIT(REG_R14) | \
+    REG_BIT(REG_R15))
+
+int peephole_hits[NUM_PEEPHOLE_RULES];
+
+const char *peephole_rule_names[NUM_PEEPHOLE_RULES] = {"self-move", "store-load",
+    "load-store", "const-cmp", "coalesce", "copy-forward", "dead-move", "jcc-over-jmp",
+    "jump-to-next", "thread", "unreachable", "unused-label", "nop-leave"};
+
+/* Everything one pass knows about the buffer */
+typedef struct PeepholeState
+{
+    InstBuf_t *buf;
+    char *deleted;
+
+    /* Registers live after each instruction */
+    int *live_out;
+    /* Liveness can't be trusted before this index */
+    int live_valid_from;
+
+    /* Indexed by label number */
+    int *label_index;
+    int *label_refs;
+    int max_label;
+} PeepholeState_t;
+
+typedef int (*PeepholeRule_t)(PeepholeState_t *, int);
+
+void reset_peephole_stats()
+{
+    int i;
+
+    for(i = 0; i < NUM_PEEPHOLE_RULES; ++i)
+        peephole_hits[i] = 0;
+}
+
+void print_peephole_stats(FILE *f)
+{
+    int i;
+
+    for(i = 0; i < NUM_PEEPHOLE_RULES; ++i)
+        if(peephole_hits[i] > 0)
+            fprintf(f, "PEEPHOLE: %s applied %d times\n", peephole_rule_names[i],
+                peephole_hits[i]);
+}
+
+/******** Instruction properties ********/
+
+int peep_is_jump(enum InstOp op)
+{
+    return op >= INST_JMP && op <= INST_JAE;
+}
+
+int peep_is_jcc(enum InstOp op)
+{
+    return op > INST_JMP && op <= INST_JAE;
+}
+
+enum InstOp inverse_jcc(enum InstOp op)
+{
+    switch(op)
+    {
+        case INST_JE:
+            return INST_JNE;
+        case INST_JNE:
+            return INST_JE;
+        case INST_JL:
+            return INST_JGE;
+        case INST_JGE:
+            return INST_JL;
+        case INST_JLE:
+            return INST_JG;
+        case INST_JG:
+            return INST_JLE;
+        case INST_JB:
+            return INST_JAE;
+        case INST_JAE:
+            return INST_JB;
+        default:
+            assert(0 && "Not a conditional jump");
+    }
+
+    return op;
+}
+
+/* What a jcc after "cmpl src, dst" does when both are known */
+int jcc_taken(enum InstOp op, int src, int dst)
+{
+    switch(op)
+    {
+        case INST_JE:
+            return dst == src;
+        case INST_JNE:
+            return dst != src;
+        case INST_JL:
+            return dst < src;
+        case INST_JGE:
+            return dst >= src;
+        case INST_JLE:
+            return dst <= src;
+        case INST_JG:
+            return dst > src;
+        case INST_JB:
+            return (unsigned int)dst < (unsigned int)src;
+        case INST_JAE:
+            return (unsigned int)dst >= (unsigned int)src;
+        default:
+            assert(0 && "Not a conditional jump");
+    }
+
+    return 0;
+}
+
+int opnd_regs(Operand_t *opnd)
+{
+    if(opnd->type == OPND_REG || opnd->type == OPND_MEM)
+        return REG_BIT(opnd->reg);
+    if(opnd->type == OPND_MEM_INDEX)
+        return REG_BIT(opnd->reg) | REG_BIT(opnd->index);
+
+    return 0;
+}
+
+int opnd_is_mem(Operand_t *opnd)
+{
+    return opnd->type == OPND_MEM || opnd->type == OPND_MEM_INDEX;
+}
+
+int opnd_is_reg(Operand_t *opnd, int reg)
+{
+    return opnd->type == OPND_REG && opnd->reg == reg;
+}
+
+int opnd_equal(Operand_t *a, Operand_t *b)
+{
+    if(a->type != b->type)
+        return 0;
+
+    switch(a->type)
+    {
+        case OPND_REG:
+            return a->reg == b->reg && a->size == b->size;
+        case OPND_MEM:
+            return a->reg == b->reg && a->val.num == b->val.num;
+        case OPND_MEM_INDEX:
+            return a->reg == b->reg && a->index == b->index && a->val.num == b->val.num;
+        case OPND_IMM:
+        case OPND_LABEL:
+            return a->val.num == b->val.num;
+        default:
+            return 0;
+    }
+}
+
+/* Registers an instruction reads and writes */
+void inst_regs(Inst_t *inst, int *use, int *def)
+{
+    Operand_t *src, *dst;
+
+    src = &inst->opnds[0];
+    dst = &inst->opnds[1];
+    *use = 0;
+    *def = 0;
+
+    switch(inst->op)
+    {
+        case INST_MOVL:
+        case INST_MOVQ:
+        case INST_LEAQ:
+            *use = opnd_regs(src);
+            if(dst->type == OPND_REG)
+                *def = REG_BIT(dst->reg);
+            else
+                *use |= opnd_regs(dst);
+            break;
+
+        case INST_ADDL:
+        case INST_SUBL:
+        case INST_SUBQ:
+        case INST_SARL:
+        case INST_SHRL:
+            *use = opnd_regs(src) | opnd_regs(dst);
+            if(dst->type == OPND_REG)
+                *def = REG_BIT(dst->reg);
+            break;
+
+        case INST_CMPL:
+            *use = opnd_regs(src) | opnd_regs(dst);
+            break;
+
+        case INST_IMULL:
+            if(inst->num_opnds == 1)
+            {
+                *use = opnd_regs(src) | REG_BIT(REG_RAX);
+                *def = REG_BIT(REG_RAX) | REG_BIT(REG_RDX);
+            }
+            else
+            {
+                *use = opnd_regs(src) | opnd_regs(dst);
+                *def = REG_BIT(dst->reg);
+            }
+            break;
+
+        case INST_IDIVL:
+            *use = opnd_regs(src) | REG_BIT(REG_RAX) | REG_BIT(REG_RDX);
+            *def = REG_BIT(REG_RAX) | REG_BIT(REG_RDX);
+            break;
+
+        case INST_NEGL:
+            *use = opnd_regs(src);
+            if(src->type == OPND_REG)
+                *def = REG_BIT(src->reg);
+            break;
+
+        case INST_CLTD:
+            *use = REG_BIT(REG_RAX);
+            *def = REG_BIT(REG_RDX);
+            break;
+
+        case INST_CALL:
+            *use = CALL_USED_REGS;
+            *def = CALL_CLOBBERED_REGS;
+            break;
+
+        case INST_RET:
+            *use = RET_USED_REGS;
+            break;
+
+        case INST_TAIL_JMP:
+            *use = RET_USED_REGS | CALL_USED_REGS;
+            break;
+
+        case INST_LEAVE:
+            *use = REG_BIT(REG_RBP);
+            *def = REG_BIT(REG_RSP) | REG_BIT(REG_RBP);
+            break;
+
+        case INST_PUSHQ:
+            *use = opnd_regs(src) | REG_BIT(REG_RSP);
+            *def = REG_BIT(REG_RSP);
+            break;
+
+        case INST_POPQ:
+            *use = REG_BIT(REG_RSP);
+            *def = opnd_regs(src) | REG_BIT(REG_RSP);
+            break;
+
+        /* Only vector registers are written, which aren't tracked */
+        case INST_MOVD:
+        case INST_MOVDQU:
+        case INST_PADDD:
+        case INST_PSUBD:
+        case INST_PMULLD:
+        case INST_PUNPCKLDQ:
+        case INST_PUNPCKLQDQ:
+        case INST_VPBROADCASTD:
+            *use = opnd_regs(src) | opnd_regs(dst);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/******** Pass state ********/
+
+void init_peephole_state(PeepholeState_t *st, InstBuf_t *buf)
+{
+    Inst_t *inst;
+    int i;
+
+    st->buf = buf;
+    st->deleted = (char *)calloc(buf->num_insts + 1, sizeof(char));
+    st->live_out = (int *)malloc((buf->num_insts + 1) * sizeof(int));
+    assert(st->deleted != NULL);
+    assert(st->live_out != NULL);
+    st->live_valid_from = 0;
+
+    st->max_label = 0;
+    for(i = 0; i < buf->num_insts; ++i)
+    {
+        inst = &buf->insts[i];
+        if((inst->op == INST_LABEL || peep_is_jump(inst->op)) &&
+            inst->opnds[0].val.num > st->max_label)
+        {
+            st->max_label = inst->opnds[0].val.num;
+        }
+    }
+
+    st->label_index = (int *)malloc((st->max_label + 1) * sizeof(int));
+    st->label_refs = (int *)calloc(st->max_label + 1, sizeof(int));
+    assert(st->label_index != NULL);
+    assert(st->label_refs != NULL);
+
+    for(i = 0; i <= st->max_label; ++i)
+        st->label_index[i] = -1;
+    for(i = 0; i < buf->num_insts; ++i)
+    {
+        inst = &buf->insts[i];
+        if(inst->op == INST_LABEL)
+            st->label_index[inst->opnds[0].val.num] = i;
+        else if(peep_is_jump(inst->op))
+            ++st->label_refs[inst->opnds[0].val.num];
+    }
+}
+
+void free_peephole_state(PeepholeState_t *st)
+{
+    free(st->deleted);
+    free(st->live_out);
+    free(st->label_index);
+    free(st->label_refs);
+}
+
+/* Backward dataflow until nothing changes */
+void compute_liveness(PeepholeState_t *st)
+{
+    InstBuf_t *buf;
+    Inst_t *inst;
+    int *live_in;
+    int i, n, use, def, out, in, target, changed;
+
+    buf = st->buf;
+    n = buf->num_insts;
+    live_in = (int *)calloc(n + 1, sizeof(int));
+    assert(live_in != NULL);
+
+    /* Falling off the end of the buffer could go anywhere */
+    live_in[n] = ALL_REGS;
+
+    do
+    {
+        changed = 0;
+        for(i = n - 1; i >= 0; --i)
+        {
+            inst = &buf->insts[i];
+
+            out = 0;
+            if(inst->op != INST_JMP && inst->op != INST_RET && inst->op != INST_TAIL_JMP)
+                out = live_in[i + 1];
+            if(peep_is_jump(inst->op))
+            {
+                target = st->label_index[inst->opnds[0].val.num];
+                out |= (target < 0) ? ALL_REGS : live_in[target];
+            }
+
+            inst_regs(inst, &use, &def);
+            in = use | (out & ~def);
+
+            st->live_out[i] = out;
+            if(in != live_in[i])
+            {
+                live_in[i] = in;
+                changed = 1;
+            }
+        }
+    } while(changed);
+
+    free(live_in);
+}
+
+/* Next instruction that hasn't been deleted, -1 at the end */
+int next_inst(PeepholeState_t *st, int index)
+{
+    for(++index; index < st->buf->num_insts; ++index)
+        if(!st->deleted[index])
+            return index;
+
+    return -1;
+}
+
+void delete_inst(PeepholeState_t *st, int index)
+{
+    Inst_t *inst;
+
+    inst = &st->buf->insts[index];
+    if(peep_is_jump(inst->op))
+        --st->label_refs[inst->opnds[0].val.num];
+    st->deleted[index] = 1;
+}
+
+void retarget_jump(PeepholeState_t *st, int index, int label)
+{
+    Inst_t *inst;
+
+    inst = &st->buf->insts[index];
+    --st->label_refs[inst->opnds[0].val.num];
+    inst->opnds[0] = opnd_label(label);
+    ++st->label_refs[label];
+}
+
+/* Whether label is placed between index and the next real instruction */
+int label_follows(PeepholeState_t *st, int index, int label)
+{
+    Inst_t *inst;
+
+    for(index = next_inst(st, index); index >= 0; index = next_inst(st, index))
+    {
+        inst = &st->buf->insts[index];
+        if(inst->op != INST_LABEL)
+            return 0;
+        if(inst->opnds[0].val.num == label)
+            return 1;
+    }
+
+    return 0;
+}
+
+int reg_live_after(PeepholeState_t *st, int index, int reg)
+{
+    return (st->live_out[index] & REG_BIT(reg)) != 0 || reg == REG_RSP || reg == REG_RBP;
+}
+
+/******** Rules ********/
+/* Each returns how many times it applied at index (0 if it didn't) */
+
+int peep_self_move(PeepholeState_t *st, int index)
+{
+    Inst_t *inst;
+
+    inst = &st->buf->insts[index];
+    if(inst->op != INST_MOVL && inst->op != INST_MOVQ)
+        return 0;
+    if(inst->opnds[0].type != OPND_REG || !opnd_equal(&inst->opnds[0], &inst->opnds[1]))
+        return 0;
+
+    delete_inst(st, index);
+    return 1;
+}
+
+int peep_store_load(PeepholeState_t *st, int index)
+{
+    Inst_t *store, *load;
+    int next;
+
+    store = &st->buf->insts[index];
+    if(store->op != INST_MOVL && store->op != INST_MOVQ)
+        return 0;
+    if(store->opnds[0].type != OPND_REG || store->opnds[1].type != OPND_MEM ||
+        store->opnds[1].reg == store->opnds[0].reg)
+    {
+        return 0;
+    }
+
+    next = next_inst(st, index);
+    if(next < 0)
+        return 0;
+    load = &st->buf->insts[next];
+    if(load->op != store->op || !opnd_equal(&load->opnds[0], &store->opnds[1]) ||
+        load->opnds[1].type != OPND_REG)
+    {
+        return 0;
+    }
+
+    if(opnd_equal(&load->opnds[1], &store->opnds[0]))
+        delete_inst(st, next);
+    else
+        load->opnds[0] = store->opnds[0];
+
+    return 1;
+}
+
+int peep_load_store(PeepholeState_t *st, int index)
+{
+    Inst_t *load, *store;
+    int next;
+
+    load = &st->buf->insts[index];
+    if(load->op != INST_MOVL && load->op != INST_MOVQ)
+        return 0;
+    if(load->opnds[0].type != OPND_MEM || load->opnds[1].type != OPND_REG ||
+        load->opnds[0].reg == load->opnds[1].reg)
+    {
+        return 0;
+    }
+
+    next = next_inst(st, index);
+    if(next < 0)
+        return 0;
+    store = &st->buf->insts[next];
+    if(store->op != load->op || !opnd_equal(&store->opnds[0], &load->opnds[1]) ||
+        !opnd_equal(&store->opnds[1], &load->opnds[0]))
+    {
+        return 0;
+    }
+
+    delete_inst(st, next);
+    return 1;
+}
+
+int peep_copy_forward(PeepholeState_t *st, int index)
+{
+    Inst_t *copy, *user;
+    Operand_t *source, *replaced, *other;
+    int temp, next, use, def;
+
+    copy = &st->buf->insts[index];
+    if(copy->op != INST_MOVL || copy->opnds[1].type != OPND_REG)
+        return 0;
+    source = &copy->opnds[0];
+    temp = copy->opnds[1].reg;
+    if(opnd_regs(source) & REG_BIT(temp))
+        return 0;
+
+    next = next_inst(st, index);
+    if(next < 0)
+        return 0;
+    user = &st->buf->insts[next];
+    if(user->num_opnds != 2)
+        return 0;
+
+    replaced = NULL;
+    other = NULL;
+    switch(user->op)
+    {
+        case INST_MOVL:
+        case INST_ADDL:
+        case INST_SUBL:
+        case INST_IMULL:
+        case INST_CMPL:
+            if(opnd_is_reg(&user->opnds[0], temp))
+            {
+                replaced = &user->opnds[0];
+                other = &user->opnds[1];
+            }
+            else if(user->op == INST_CMPL && opnd_is_reg(&user->opnds[1], temp) &&
+                source->type != OPND_IMM)
+            {
+                replaced = &user->opnds[1];
+                other = &user->opnds[0];
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    if(replaced == NULL || (opnd_regs(other) & REG_BIT(temp)))
+        return 0;
+    if(opnd_is_mem(source) && opnd_is_mem(other))
+        return 0;
+
+    /* Only worth it when the copy dies */
+    inst_regs(user, &use, &def);
+    if(reg_live_after(st, next, temp) || (def & REG_BIT(temp)))
+        return 0;
+
+    *replaced = *source;
+    delete_inst(st, index);
+    st->live_valid_from = next + 1;
+
+    return 1;
+}
+
+int peep_coalesce(PeepholeState_t *st, int index)
+{
+    Inst_t *copy, *inst;
+    int temp, dest, cur, chain_regs;
+
+    copy = &st->buf->insts[index];
+    if(copy->op != INST_MOVL || copy->opnds[1].type != OPND_REG)
+        return 0;
+    temp = copy->opnds[1].reg;
+    if(opnd_regs(&copy->opnds[0]) & REG_BIT(temp))
+        return 0;
+
+    /* Walks the arithmetic done on temp */
+    chain_regs = 0;
+    for(cur = next_inst(st, index); cur >= 0; cur = next_inst(st, cur))
+    {
+        inst = &st->buf->insts[cur];
+        if(inst->op == INST_NEGL && opnd_is_reg(&inst->opnds[0], temp))
+            continue;
+
+        if(inst->op != INST_ADDL && inst->op != INST_SUBL && inst->op != INST_IMULL &&
+            inst->op != INST_SARL && inst->op != INST_SHRL)
+        {
+            break;
+        }
+        if(inst->num_opnds != 2 || !opnd_is_reg(&inst->opnds[1], temp) ||
+            (opnd_regs(&inst->opnds[0]) & REG_BIT(temp)))
+        {
+            return 0;
+        }
+        chain_regs |= opnd_regs(&inst->opnds[0]);
+    }
+    if(cur < 0)
+        return 0;
+
+    /* Ends with the result moved to where it's wanted */
+    inst = &st->buf->insts[cur];
+    if(inst->op != INST_MOVL || !opnd_is_reg(&inst->opnds[0], temp) ||
+        inst->opnds[1].type != OPND_REG)
+    {
+        return 0;
+    }
+    dest = inst->opnds[1].reg;
+    if(dest == temp || dest == REG_RSP || dest == REG_RBP)
+        return 0;
+    if(reg_live_after(st, cur, temp) || (chain_regs & REG_BIT(dest)))
+        return 0;
+    if(opnd_is_mem(&copy->opnds[0]) && (opnd_regs(&copy->opnds[0]) & REG_BIT(dest)))
+        return 0;
+
+    copy->opnds[1] = opnd_reg32(dest);
+    for(index = next_inst(st, index); index != cur; index = next_inst(st, index))
+    {
+        inst = &st->buf->insts[index];
+        inst->opnds[inst->num_opnds - 1] = opnd_reg32(dest);
+    }
+    delete_inst(st, cur);
+    st->live_valid_from = cur + 1;
+
+    return 1;
+}
+
+int peep_dead_move(PeepholeState_t *st, int index)
+{
+    Inst_t *inst;
+
+    inst = &st->buf->insts[index];
+    if(inst->op != INST_MOVL && inst->op != INST_MOVQ && inst->op != INST_LEAQ)
+        return 0;
+    if(inst->opnds[1].type != OPND_REG || reg_live_after(st, index, inst->opnds[1].reg))
+        return 0;
+
+    delete_inst(st, index);
+    return 1;
+}
+
+int peep_const_cmp(PeepholeState_t *st, int index)
+{
+    Inst_t *load, *cmp, *jcc;
+    int cmp_index, jcc_index, after;
+
+    load = &st->buf->insts[index];
+    if(load->op != INST_MOVL || load->opnds[0].type != OPND_IMM ||
+        load->opnds[1].type != OPND_REG)
+    {
+        return 0;
+    }
+
+    cmp_index = next_inst(st, index);
+    if(cmp_index < 0)
+        return 0;
+    cmp = &st->buf->insts[cmp_index];
+    if(cmp->op != INST_CMPL || cmp->opnds[0].type != OPND_IMM ||
+        !opnd_equal(&cmp->opnds[1], &load->opnds[1]))
+    {
+        return 0;
+    }
+
+    jcc_index = next_inst(st, cmp_index);
+    if(jcc_index < 0)
+        return 0;
+    jcc = &st->buf->insts[jcc_index];
+    if(!peep_is_jcc(jcc->op) || reg_live_after(st, cmp_index, load->opnds[1].reg))
+        return 0;
+
+    /* Nothing else may want the flags */
+    after = next_inst(st, jcc_index);
+    if(after >= 0 && peep_is_jcc(st->buf->insts[after].op))
+        return 0;
+
+    if(jcc_taken(jcc->op, cmp->opnds[0].val.num, load->opnds[0].val.num))
+        jcc->op = INST_JMP;
+    else
+        delete_inst(st, jcc_index);
+    delete_inst(st, index);
+    delete_inst(st, cmp_index);
+    st->live_valid_from = jcc_index + 1;
+
+    return 1;
+}
+
+int peep_jcc_over_jmp(PeepholeState_t *st, int index)
+{
+    Inst_t *jcc, *jmp;
+    int jmp_index;
+
+    jcc = &st->buf->insts[index];
+    if(!peep_is_jcc(jcc->op))
+        return 0;
+
+    jmp_index = next_inst(st, index);
+    if(jmp_index < 0)
+        return 0;
+    jmp = &st->buf->insts[jmp_index];
+    if(jmp->op != INST_JMP || !label_follows(st, jmp_index, jcc->opnds[0].val.num))
+        return 0;
+
+    jcc->op = inverse_jcc(jcc->op);
+    retarget_jump(st, index, jmp->opnds[0].val.num);
+    delete_inst(st, jmp_index);
+
+    return 1;
+}
+
+int peep_jump_to_next(PeepholeState_t *st, int index)
+{
+    Inst_t *inst;
+
+    inst = &st->buf->insts[index];
+    if(!peep_is_jump(inst->op) || !label_follows(st, index, inst->opnds[0].val.num))
+        return 0;
+
+    delete_inst(st, index);
+    return 1;
+}
+
+int peep_thread(PeepholeState_t *st, int index)
+{
+    Inst_t *inst, *target;
+    int label, cur;
+
+    inst = &st->buf->insts[index];
+    if(!peep_is_jump(inst->op))
+        return 0;
+    label = inst->opnds[0].val.num;
+
+    cur = st->label_index[label];
+    if(cur < 0)
+        return 0;
+    while(cur >= 0 && st->buf->insts[cur].op == INST_LABEL)
+        cur = next_inst(st, cur);
+    if(cur < 0)
+        return 0;
+
+    target = &st->buf->insts[cur];
+    if(target->op != INST_JMP || target->opnds[0].val.num == label)
+        return 0;
+
+    retarget_jump(st, index, target->opnds[0].val.num);
+    return 1;
+}
+
+int peep_unreachable(PeepholeState_t *st, int index)
+{
+    Inst_t *inst;
+    int cur, removed;
+
+    inst = &st->buf->insts[index];
+    if(inst->op != INST_JMP && inst->op != INST_RET && inst->op != INST_TAIL_JMP)
+        return 0;
+
+    removed = 0;
+    for(cur = next_inst(st, index); cur >= 0; cur = next_inst(st, cur))
+    {
+        if(st->buf->insts[cur].op == INST_LABEL)
+            break;
+        delete_inst(st, cur);
+        ++removed;
+    }
+
+    /* Counted per instruction */
+    return removed;
+}
+
+int peep_unused_label(PeepholeState_t *st, int index)
+{
+    Inst_t *inst;
+
+    inst = &st->buf->insts[index];
+    if(inst->op != INST_LABEL || st->label_refs[inst->opnds[0].val.num] > 0)
+        return 0;
+
+    delete_inst(st, index);
+    return 1;
+}
+
+int peep_nop_leave(PeepholeState_t *st, int index)
+{
+    int next;
+
+    if(st->buf->insts[index].op != INST_NOP)
+        return 0;
+
+    next = next_inst(st, index);
+    if(next < 0 || st->buf->insts[next].op != INST_LEAVE)
+        return 0;
+
+    delete_inst(st, index);
+    return 1;
+}
+
+/******** Driver ********/
+
+/* Drops deleted instructions from the buffer */
+void compact_inst_buf(PeepholeState_t *st)
+{
+    int i, num_kept;
+
+    num_kept = 0;
+    for(i = 0; i < st->buf->num_insts; ++i)
+        if(!st->deleted[i])
+            st->buf->insts[num_kept++] = st->buf->insts[i];
+
+    st->buf->num_insts = num_kept;
+}
+
+/* Indexed by PeepholeRule */
+PeepholeRule_t peephole_rules[NUM_PEEPHOLE_RULES] = {peep_self_move, peep_store_load,
+    peep_load_store, peep_const_cmp, peep_coalesce, peep_copy_forward, peep_dead_move,
+    peep_jcc_over_jmp, peep_jump_to_next, peep_thread, peep_unreachable,
+    peep_unused_label, peep_nop_leave};
+
+int peephole_rule_uses_liveness(enum PeepholeRule rule)
+{
+    return rule == PEEP_CONST_CMP || rule == PEEP_COALESCE || rule == PEEP_COPY_FORWARD ||
+        rule == PEEP_DEAD_MOVE;
+}
+
+/* Returns 1 if anything changed */
+int peephole_pass(InstBuf_t *buf)
+{
+    PeepholeState_t st;
+    int i, rule, hits, changed;
+
+    init_peephole_state(&st, buf);
+    compute_liveness(&st);
+
+    changed = 0;
+    for(i = 0; i < buf->num_insts; ++i)
+    {
+        if(st.deleted[i])
+            continue;
+
+        /* First rule that applies wins */
+        for(rule = 0; rule < NUM_PEEPHOLE_RULES; ++rule)
+        {
+            if(peephole_rule_uses_liveness(rule) && i < st.live_valid_from)
+                continue;
+
+            hits = peephole_rules[rule](&st, i);
+            if(hits > 0)
+            {
+                peephole_hits[rule] += hits;
+                changed = 1;
+                break;
+            }
+        }
+    }
+
+    compact_inst_buf(&st);
+    free_peephole_state(&st);
+
+    return changed;
+}
+
+void peephole_optimize(InstBuf_t *buf)
+{
+    assert(buf != NULL);
+
+    int passes;
+
+    passes = 0;
+    while(passes < MAX_PEEPHOLE_PASSES && peephole_pass(buf))
+        ++passes;
+}
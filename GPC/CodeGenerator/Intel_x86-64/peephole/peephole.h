@@ -0,0 +1,49 @@
+/*
+    Damon Gwinn
+    Peephole optimizer for finished functions
+
+    Slides a small window over a function's instruction buffer (prologue and epilogue
+    included) and rewrites patterns the code generator leaves behind. Passes repeat
+    until nothing changes or MAX_PEEPHOLE_PASSES is hit.
+
+    Register rules only fire on registers that are dead afterwards, which comes from a
+    liveness pass over the function (labels and jumps give the control flow). Liveness
+    is recomputed every pass, and a rule never reuses it inside a range it just changed.
+
+    RULES:
+        - self-move: movl %r, %r
+        - store-load: movl %r, M then movl M, X reuses %r
+        - load-store: movl M, %r then movl %r, M drops the store
+        - const-cmp: cmp and jcc on two constants become a jmp or nothing
+        - coalesce: movl S, %t, arithmetic on %t, movl %t, %d works on %d directly
+        - copy-forward: movl S, %t then a use of %t uses S when %t dies there
+        - dead-move: moves into a register nothing reads
+        - jcc-over-jmp: jcc L1; jmp L2; L1: becomes the inverse jcc L2
+        - jump-to-next: jumps to the label right after them
+        - thread: jumps to a jmp go straight to its target
+        - unreachable: code after a jmp up to the next label
+        - unused-label: labels nothing jumps to
+        - nop-leave: the nop before leave
+*/
+
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include <stdio.h>
+#include "../inst_buf/inst_buf.h"
+
+#define MAX_PEEPHOLE_PASSES 16
+
+/* In the order they are tried */
+enum PeepholeRule{PEEP_SELF_MOVE, PEEP_STORE_LOAD, PEEP_LOAD_STORE, PEEP_CONST_CMP,
+    PEEP_COALESCE, PEEP_COPY_FORWARD, PEEP_DEAD_MOVE, PEEP_JCC_OVER_JMP, PEEP_JUMP_TO_NEXT,
+    PEEP_THREAD, PEEP_UNREACHABLE, PEEP_UNUSED_LABEL, PEEP_NOP_LEAVE, NUM_PEEPHOLE_RULES};
+
+/* Rewrites buf in place */
+void peephole_optimize(InstBuf_t *buf);
+
+/* Hits for every rule since the last reset, over all functions */
+void reset_peephole_stats();
+void print_peephole_stats(FILE *f);
+
+#endif
@@ -0,0 +1,192 @@
+/*
+    Damon Gwinn
+    Keeps scalar locals in callee-saved registers (see reg_locals.h)
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include "reg_locals.h"
+#include "../inst_buf/inst_buf.h"
+#include "../stackmng/stackmng.h"
+#include "../register_types.h"
+
+/* Candidates in order of preference */
+int local_reg_ids[] = {REG_RBX, REG_R12, REG_R13, REG_R14, REG_R15};
+
+/* Gives how many loops each instruction is inside of */
+/* A loop is everything from a label up to a later jump back to it */
+int *get_loop_depths(InstBuf_t *body)
+{
+    int *depths, *label_index;
+    int max_label, i, start;
+    Inst_t *inst;
+
+    max_label = 0;
+    for(i = 0; i < body->num_insts; ++i)
+        if(body->insts[i].op == INST_LABEL && body->insts[i].opnds[0].val.num > max_label)
+            max_label = body->insts[i].opnds[0].val.num;
+
+    label_index = (int *)malloc((max_label + 1) * sizeof(int));
+    depths = (int *)calloc(body->num_insts + 1, sizeof(int));
+    assert(label_index != NULL);
+    assert(depths != NULL);
+
+    for(i = 0; i <= max_label; ++i)
+        label_index[i] = -1;
+    for(i = 0; i < body->num_insts; ++i)
+        if(body->insts[i].op == INST_LABEL)
+            label_index[body->insts[i].opnds[0].val.num] = i;
+
+    /* Marks loop bounds, then sums them up */
+    for(i = 0; i < body->num_insts; ++i)
+    {
+        inst = &body->insts[i];
+        if(inst->op < INST_JMP || inst->op > INST_JAE)
+            continue;
+        if(inst->opnds[0].val.num > max_label)
+            continue;
+
+        start = label_index[inst->opnds[0].val.num];
+        if(start >= 0 && start <= i)
+        {
+            ++depths[start];
+            --depths[i + 1];
+        }
+    }
+    for(i = 1; i < body->num_insts; ++i)
+        depths[i] += depths[i - 1];
+
+    free(label_index);
+    return depths;
+}
+
+/* Slot index of a local or argument operand, -1 for anything else */
+int local_slot(Operand_t *opnd, int frame_size)
+{
+    if(opnd->type != OPND_MEM || opnd->reg != REG_RBP)
+        return -1;
+    if(opnd->val.num >= 0 || -opnd->val.num > frame_size)
+        return -1;
+    if((-opnd->val.num) % DOUBLEWORD != 0)
+        return -1;
+
+    return -opnd->val.num / DOUBLEWORD;
+}
+
+int promote_locals(InstBuf_t *body, StackScope_t *scope, RegStack_t *reg_stack)
+{
+    assert(body != NULL);
+    assert(scope != NULL);
+    assert(reg_stack != NULL);
+
+    int frame_size, num_slots, num_regs, num_promoted;
+    int *depths, *slot_reg;
+    long *weights;
+    char *pinned;
+    int i, j, slot, best, weight_exp;
+    Inst_t *inst;
+    ListNode_t *cur;
+    StackNode_t *node;
+
+    /* Arguments then locals, every doubleword from -4(%rbp) down */
+    frame_size = scope->z_offset + scope->x_offset;
+    num_slots = frame_size / DOUBLEWORD + 1;
+    if(frame_size == 0 || body->num_insts == 0)
+        return 0;
+
+    weights = (long *)calloc(num_slots, sizeof(long));
+    pinned = (char *)calloc(num_slots, sizeof(char));
+    slot_reg = (int *)malloc(num_slots * sizeof(int));
+    assert(weights != NULL);
+    assert(pinned != NULL);
+    assert(slot_reg != NULL);
+
+    /* Array elements are also reached through an index register */
+    for(cur = scope->x; cur != NULL; cur = cur->next)
+    {
+        node = (StackNode_t *)cur->cur;
+        if(!node->is_array)
+            continue;
+        for(i = 0; i < node->size / DOUBLEWORD; ++i)
+            pinned[node->offset / DOUBLEWORD - i] = 1;
+    }
+
+    /* Weighing every use */
+    depths = get_loop_depths(body);
+    for(i = 0; i < body->num_insts; ++i)
+    {
+        inst = &body->insts[i];
+        weight_exp = depths[i];
+        if(weight_exp > MAX_LOOP_WEIGHT_DEPTH)
+            weight_exp = MAX_LOOP_WEIGHT_DEPTH;
+
+        for(j = 0; j < inst->num_opnds; ++j)
+        {
+            slot = local_slot(&inst->opnds[j], frame_size);
+            if(slot < 0)
+                continue;
+
+            /* Address taken or used as a quadword, either way it has to stay in memory */
+            if(inst->op == INST_LEAQ || inst->op == INST_MOVQ)
+                pinned[slot] = 1;
+            else
+            {
+                long weight = 1;
+                int k;
+                for(k = 0; k < weight_exp; ++k)
+                    weight *= LOOP_USE_WEIGHT;
+                weights[slot] += weight;
+            }
+        }
+    }
+    free(depths);
+
+    /* Handing out free callee-saved registers, heaviest slot first */
+    for(i = 0; i < num_slots; ++i)
+        slot_reg[i] = REG_NONE;
+
+    num_promoted = 0;
+    num_regs = sizeof(local_reg_ids) / sizeof(local_reg_ids[0]);
+    for(i = 0; i < num_regs; ++i)
+    {
+        if(reg_stack->regs_used & (1 << local_reg_ids[i]))
+            continue;
+
+        best = -1;
+        for(slot = 1; slot < num_slots; ++slot)
+        {
+            if(pinned[slot] || slot_reg[slot] != REG_NONE || weights[slot] == 0)
+                continue;
+            if(best < 0 || weights[slot] > weights[best])
+                best = slot;
+        }
+        if(best < 0)
+            break;
+
+        slot_reg[best] = local_reg_ids[i];
+        reg_stack->regs_used |= 1 << local_reg_ids[i];
+        ++num_promoted;
+    }
+
+    /* Rewriting the promoted slots */
+    if(num_promoted > 0)
+    {
+        for(i = 0; i < body->num_insts; ++i)
+        {
+            inst = &body->insts[i];
+            for(j = 0; j < inst->num_opnds; ++j)
+            {
+                slot = local_slot(&inst->opnds[j], frame_size);
+                if(slot >= 0 && slot_reg[slot] != REG_NONE)
+                    inst->opnds[j] = opnd_reg32(slot_reg[slot]);
+            }
+        }
+    }
+
+    free(weights);
+    free(pinned);
+    free(slot_reg);
+
+    return num_promoted;
+}
@@ -0,0 +1,31 @@
+/*
+    Damon Gwinn
+    Keeps scalar locals in callee-saved registers
+
+    Runs over a finished function body and moves the most used local variables and
+    arguments (x and z doublewords, see codegen.h) out of the stack frame and into
+    callee-saved registers the body doesn't already use. Every -offset(%rbp) operand
+    naming a promoted slot is rewritten to the register.
+
+    A slot stays on the stack if its address is taken (leaq, as read does), if it is
+    ever moved as a quadword or if it is an array element.
+
+    Uses are weighted by loop depth (found from backward jumps) so loop counters win
+    over variables that are only touched once.
+*/
+
+#ifndef REG_LOCALS_H
+#define REG_LOCALS_H
+
+#include "../inst_buf/inst_buf.h"
+#include "../stackmng/stackmng.h"
+
+/* How much more a use one loop deeper counts for */
+#define LOOP_USE_WEIGHT 8
+#define MAX_LOOP_WEIGHT_DEPTH 6
+
+/* Returns how many locals were promoted */
+/* NOTE: Promoted registers are marked used in reg_stack so the function saves them */
+int promote_locals(InstBuf_t *body, StackScope_t *scope, RegStack_t *reg_stack);
+
+#endif
@@ -6,15 +6,30 @@
 #ifndef REGISTER_TYPES_H
 #define REGISTER_TYPES_H
 
+    /* Register ids used by the instruction buffer (in x86-64 encoding order) */
+    enum RegId{REG_RAX, REG_RCX, REG_RDX, REG_RBX, REG_RSP, REG_RBP, REG_RSI, REG_RDI,
+        REG_R8, REG_R9, REG_R10, REG_R11, REG_R12, REG_R13, REG_R14, REG_R15,
+        REG_RIP, NUM_REG_IDS};
+
+    #define REG_NONE -1
+
+    /* Vector registers are numbered apart from the above, %xmm0-15 and %ymm0-15 */
+    /* NOTE: All of them are clobbered by calls */
+    #define NUM_VREGS 16
+    #define XMM_SIZE 16
+    #define YMM_SIZE 32
+
     /* TODO: Add division and stack chasing registers */
 
     /* Return register */
     #define RETURN_REG_64 "%rax"
     #define RETURN_REG_32 "%eax"
+    #define RETURN_REG REG_RAX
 
     /* Non-local register */
     #define NON_LOCAL_REG_64 "%rcx"
     #define NON_LOCAL_REG_32 "%ecx"
+    #define NON_LOCAL_REG REG_RCX
 
     /* Argument registers */
     /* TODO: Add remaining registers */
@@ -22,14 +37,18 @@
 
     #define ARG_REG_1_64 "%rdi"
     #define ARG_REG_1_32 "%edi"
+    #define ARG_REG_1 REG_RDI
 
     #define ARG_REG_2_64 "%rsi"
     #define ARG_REG_2_32 "%esi"
+    #define ARG_REG_2 REG_RSI
 
     #define ARG_REG_3_64 "%rdx"
     #define ARG_REG_3_32 "%edx"
+    #define ARG_REG_3 REG_RDX
 
     #define ARG_REG_4_64 "%rcx"
     #define ARG_REG_4_32 "%ecx"
+    #define ARG_REG_4 REG_RCX
 
 #endif
@@ -10,6 +10,7 @@
 #include "stackmng.h"
 #include "../register_types.h"
 #include "../codegen.h"
+#include "../inst_buf/inst_buf.h"
 #include "../../../Parser/List/List.h"
 
 /* Sets num_args_alloced to 0 */
@@ -68,6 +69,29 @@ char *get_arg_reg32_num(int num)
     return NULL;
 }
 
+/* Register id of the given argument, REG_NONE if there are too many arguments */
+int get_arg_reg_id(int num)
+{
+    if(num == 0)
+    {
+        return ARG_REG_1;
+    }
+    else if(num == 1)
+    {
+        return ARG_REG_2;
+    }
+    else if(num == 2)
+    {
+        return ARG_REG_3;
+    }
+    else if(num == 3)
+    {
+        return ARG_REG_4;
+    }
+
+    return REG_NONE;
+}
+
 /******** stackmng *********/
 stackmng_t *global_stackmng = NULL;
 
@@ -166,6 +190,105 @@ StackNode_t *add_l_t(char *label)
     return new_node;
 }
 
+/* Adds quadword to t (kept 8 byte aligned) */
+StackNode_t *add_q_t(char *label)
+{
+    assert(global_stackmng != NULL);
+    assert(global_stackmng->cur_scope != NULL);
+
+    StackScope_t *cur_scope;
+    StackNode_t *new_node;
+    int offset;
+
+    cur_scope = global_stackmng->cur_scope;
+
+    cur_scope->t_offset += QUADWORD;
+
+    offset = CONST_STACK_OFFSET_BYTES +
+        cur_scope->z_offset + cur_scope->x_offset + cur_scope->t_offset;
+    if(offset % QUADWORD != 0)
+    {
+        cur_scope->t_offset += DOUBLEWORD;
+        offset += DOUBLEWORD;
+    }
+
+    new_node = init_stack_node(offset, label, QUADWORD);
+
+    if(cur_scope->t == NULL)
+    {
+        cur_scope->t = CreateListNode(new_node, LIST_UNSPECIFIED);
+    }
+    else
+    {
+        cur_scope->t = PushListNodeBack(cur_scope->t,
+            CreateListNode(new_node, LIST_UNSPECIFIED));
+    }
+
+    #ifdef DEBUG_CODEGEN
+        fprintf(stderr, "DEBUG: Added %s to t_offset %d\n", label, offset);
+    #endif
+
+    return new_node;
+}
+
+/* Gets a temporary for spilling a register, reusing one freed by free_spill_t if possible */
+/* Spill temporaries are quadwords so they can hold either register width */
+int add_spill_t()
+{
+    assert(global_stackmng != NULL);
+    assert(global_stackmng->cur_scope != NULL);
+
+    StackScope_t *cur_scope;
+    ListNode_t *free_node;
+    StackNode_t *spill;
+
+    cur_scope = global_stackmng->cur_scope;
+
+    if(cur_scope->t_free != NULL)
+    {
+        free_node = cur_scope->t_free;
+        cur_scope->t_free = free_node->next;
+
+        spill = (StackNode_t *)free_node->cur;
+        free(free_node);
+    }
+    else
+    {
+        spill = add_q_t(SPILL_LABEL);
+    }
+
+    return spill->offset;
+}
+
+/* Marks the spill temporary at offset as free for reuse */
+void free_spill_t(int offset)
+{
+    assert(global_stackmng != NULL);
+    assert(global_stackmng->cur_scope != NULL);
+
+    StackScope_t *cur_scope;
+    ListNode_t *cur;
+    StackNode_t *spill;
+
+    cur_scope = global_stackmng->cur_scope;
+
+    spill = NULL;
+    for(cur = cur_scope->t; cur != NULL; cur = cur->next)
+    {
+        spill = (StackNode_t *)cur->cur;
+        if(spill->offset == offset)
+            break;
+    }
+    assert(cur != NULL);
+    assert(strcmp(spill->label, SPILL_LABEL) == 0);
+
+    if(cur_scope->t_free == NULL)
+        cur_scope->t_free = CreateListNode(spill, LIST_UNSPECIFIED);
+    else
+        cur_scope->t_free = PushListNodeFront(cur_scope->t_free,
+            CreateListNode(spill, LIST_UNSPECIFIED));
+}
+
 /* Adds doubleword to x */
 StackNode_t *add_l_x(char *label)
 {
@@ -202,6 +325,49 @@ StackNode_t *add_l_x(char *label)
     return new_node;
 }
 
+/* Adds an array of doublewords indexed s_range..e_range to x */
+/* The node's offset is that of the first element, the rest are at higher addresses */
+StackNode_t *add_array_x(char *label, int s_range, int e_range)
+{
+    assert(global_stackmng != NULL);
+    assert(global_stackmng->cur_scope != NULL);
+    assert(e_range >= s_range);
+
+    StackScope_t *cur_scope;
+    StackNode_t *new_node;
+    int offset, size;
+
+    cur_scope = global_stackmng->cur_scope;
+
+    size = (e_range - s_range + 1) * DOUBLEWORD;
+    cur_scope->x_offset += size;
+
+    offset = CONST_STACK_OFFSET_BYTES +
+        cur_scope->z_offset + cur_scope->x_offset;
+
+    new_node = init_stack_node(offset, label, size);
+    new_node->is_array = 1;
+    new_node->s_range = s_range;
+    new_node->e_range = e_range;
+
+    if(cur_scope->x == NULL)
+    {
+        cur_scope->x = CreateListNode(new_node, LIST_UNSPECIFIED);
+    }
+    else
+    {
+        cur_scope->x = PushListNodeBack(cur_scope->x,
+            CreateListNode(new_node, LIST_UNSPECIFIED));
+    }
+
+    #ifdef DEBUG_CODEGEN
+        fprintf(stderr, "DEBUG: Added array %s[%d..%d] to x_offset %d\n", label, s_range,
+            e_range, offset);
+    #endif
+
+    return new_node;
+}
+
 /* Adds doubleword to z */
 StackNode_t *add_l_z(char *label)
 {
@@ -310,55 +476,50 @@ void free_stackmng()
 RegStack_t *init_reg_stack()
 {
     /* See codegen.h for information on available general purpose registers */
-    ListNode_t *registers;
+    /* Caller-saved first so most functions never need to save anything */
+    int gpr_ids[] = {REG_R10, REG_R11, REG_R8, REG_R9,
+        REG_RBX, REG_R12, REG_R13, REG_R14, REG_R15};
+    int num_gprs, i;
+    ListNode_t *registers, *cur;
+    Register_t *reg;
 
     RegStack_t *reg_stack;
     reg_stack = (RegStack_t *)malloc(sizeof(RegStack_t));
 
-    /* RBX */
-    Register_t *rbx;
-    rbx = (Register_t *)malloc(sizeof(Register_t));
-    rbx->bit_64 = strdup("%rbx");
-    rbx->bit_32 = strdup("%ebx");
-
-    /* RDI */
-    Register_t *rdi;
-    rdi = (Register_t *)malloc(sizeof(Register_t));
-    rdi->bit_64 = strdup("%rdi");
-    rdi->bit_32 = strdup("%edi");
-
-    /* RSI */
-    /*Register_t *rsi;
-    rsi = (Register_t *)malloc(sizeof(Register_t));
-    rsi->bit_64 = strdup("%rsi");
-    rsi->bit_32 = strdup("%esi");*/
-
-
-    registers = CreateListNode(rbx, LIST_UNSPECIFIED);
-    registers = PushListNodeBack(registers, CreateListNode(rdi, LIST_UNSPECIFIED));
-    /*registers = PushListNodeBack(registers, CreateListNode(rsi, LIST_UNSPECIFIED));*/
-
-    /*
-    registers = CreateListNode(rdi, LIST_UNSPECIFIED);
-    registers = PushListNodeBack(registers, CreateListNode(rsi, LIST_UNSPECIFIED));
-    registers = PushListNodeBack(registers, CreateListNode(rbx, LIST_UNSPECIFIED));
-    */
+    num_gprs = sizeof(gpr_ids) / sizeof(gpr_ids[0]);
+    registers = NULL;
+    for(i = num_gprs - 1; i >= 0; --i)
+    {
+        reg = (Register_t *)malloc(sizeof(Register_t));
+        reg->bit_64 = strdup(reg_name(gpr_ids[i], 8));
+        reg->bit_32 = strdup(reg_name(gpr_ids[i], 4));
+        reg->id = gpr_ids[i];
+
+        if(registers == NULL)
+            registers = CreateListNode(reg, LIST_UNSPECIFIED);
+        else
+            registers = PushListNodeFront(registers, CreateListNode(reg, LIST_UNSPECIFIED));
+    }
 
     reg_stack->num_registers_alloced = 0;
     reg_stack->registers_free = registers;
-    reg_stack->num_registers = 2;
+    reg_stack->num_registers = num_gprs;
+    reg_stack->regs_used = 0;
+
+    for(i = 0; i < NUM_REG_IDS; ++i)
+        reg_stack->regs_by_id[i] = NULL;
+    for(cur = registers; cur != NULL; cur = cur->next)
+    {
+        reg = (Register_t *)cur->cur;
+        reg_stack->regs_by_id[reg->id] = reg;
+    }
 
     return reg_stack;
 }
 
-/* NOTE: Getters return number greater than 0 if it had to kick a value out to temp */
-/* The returned int is the temp offset to restore the value */
-/* TODO: Doesn't actually kick variable out to temp yet */
-int get_register_64bit(RegStack_t *regstack, char *reg_64, Register_t **return_reg)
+/* Takes a specific register off the free list, NULL if it's already in use */
+Register_t *take_free_register(RegStack_t *regstack, int reg_id)
 {
-    assert(regstack != NULL);
-    assert(reg_64 != NULL);
-
     ListNode_t *cur_reg, *prev_reg;
     Register_t *reg;
 
@@ -367,7 +528,7 @@ int get_register_64bit(RegStack_t *regstack, char *reg_64, Register_t **return_r
     while(cur_reg != NULL)
     {
         reg = (Register_t *)cur_reg->cur;
-        if(strcmp(reg->bit_64, reg_64) == 0)
+        if(reg->id == reg_id)
         {
             regstack->num_registers_alloced++;
 
@@ -377,56 +538,106 @@ int get_register_64bit(RegStack_t *regstack, char *reg_64, Register_t **return_r
                 prev_reg->next = cur_reg->next;
 
             free(cur_reg);
-            *return_reg = reg;
+            reg_stack_mark_used(regstack, reg);
 
-            return 0;
+            return reg;
         }
 
         prev_reg = cur_reg;
         cur_reg = cur_reg->next;
     }
 
-    fprintf(stderr, "ERROR: Kicking out values in registers not currently supported!\n");
-    exit(1);
+    return NULL;
 }
 
-/* NOTE: Getters return number greater than 0 if it had to kick a value out to temp */
-/* The returned int is the temp offset to restore the value */
-/* TODO: Doesn't actually kick variable out to temp yet */
-int get_register_32bit(RegStack_t *regstack, char *reg_32, Register_t **return_reg)
+/* Gets a specific register, kicking its current value out to a temporary if needed */
+/* Returns the temp offset holding the old value, 0 if the register was free */
+int get_register_id(RegStack_t *regstack, int reg_id, int size, Register_t **return_reg,
+    InstBuf_t *inst_list)
 {
     assert(regstack != NULL);
-    assert(reg_32 != NULL);
+    assert(return_reg != NULL);
+    assert(inst_list != NULL);
 
-    ListNode_t *cur_reg, *prev_reg;
     Register_t *reg;
+    int temp_offset;
 
-    cur_reg = regstack->registers_free;
-    prev_reg = NULL;
-    while(cur_reg != NULL)
+    reg = take_free_register(regstack, reg_id);
+    if(reg != NULL)
     {
-        reg = (Register_t *)cur_reg->cur;
-        if(strcmp(reg->bit_32, reg_32) == 0)
-        {
-            regstack->num_registers_alloced++;
+        *return_reg = reg;
+        return 0;
+    }
 
-            if(prev_reg == NULL)
-                regstack->registers_free = cur_reg->next;
-            else
-                prev_reg->next = cur_reg->next;
+    if(reg_id < 0 || reg_id >= NUM_REG_IDS || regstack->regs_by_id[reg_id] == NULL)
+    {
+        fprintf(stderr, "ERROR: Register %d is not a general purpose register!\n", reg_id);
+        exit(1);
+    }
 
-            free(cur_reg);
-            *return_reg = reg;
+    /* Still allocated to whoever holds it, they get it back in restore_register */
+    reg = regstack->regs_by_id[reg_id];
+    temp_offset = add_spill_t();
+    if(size == 8)
+        add_inst2(inst_list, INST_MOVQ, opnd_reg64(reg_id), opnd_mem(REG_RBP, -temp_offset));
+    else
+        add_inst2(inst_list, INST_MOVL, opnd_reg32(reg_id), opnd_mem(REG_RBP, -temp_offset));
 
-            return 0;
-        }
+    *return_reg = reg;
+    return temp_offset;
+}
 
-        prev_reg = cur_reg;
-        cur_reg = cur_reg->next;
+/* Gives back a register from a getter, restoring the value it kicked out (if any) */
+void restore_register(RegStack_t *regstack, Register_t *reg, int temp_offset, int size,
+    InstBuf_t *inst_list)
+{
+    assert(regstack != NULL);
+    assert(reg != NULL);
+    assert(inst_list != NULL);
+
+    if(temp_offset == 0)
+    {
+        push_reg_stack(regstack, reg);
+        return;
     }
 
-    fprintf(stderr, "ERROR: Kicking out values in registers not currently supported!\n");
-    exit(1);
+    if(size == 8)
+        add_inst2(inst_list, INST_MOVQ, opnd_mem(REG_RBP, -temp_offset), opnd_reg64(reg->id));
+    else
+        add_inst2(inst_list, INST_MOVL, opnd_mem(REG_RBP, -temp_offset), opnd_reg32(reg->id));
+    free_spill_t(temp_offset);
+}
+
+/* NOTE: Getters return number greater than 0 if it had to kick a value out to temp */
+/* The returned int is the temp offset to restore the value */
+int get_register_64bit(RegStack_t *regstack, char *reg_64, Register_t **return_reg,
+    InstBuf_t *inst_list)
+{
+    assert(reg_64 != NULL);
+
+    return get_register_id(regstack, reg_id_from_name(reg_64, 8), 8, return_reg, inst_list);
+}
+
+/* NOTE: Getters return number greater than 0 if it had to kick a value out to temp */
+/* The returned int is the temp offset to restore the value */
+int get_register_32bit(RegStack_t *regstack, char *reg_32, Register_t **return_reg,
+    InstBuf_t *inst_list)
+{
+    assert(reg_32 != NULL);
+
+    return get_register_id(regstack, reg_id_from_name(reg_32, 4), 4, return_reg, inst_list);
+}
+
+void restore_register_64bit(RegStack_t *regstack, Register_t *reg, int temp_offset,
+    InstBuf_t *inst_list)
+{
+    restore_register(regstack, reg, temp_offset, 8, inst_list);
+}
+
+void restore_register_32bit(RegStack_t *regstack, Register_t *reg, int temp_offset,
+    InstBuf_t *inst_list)
+{
+    restore_register(regstack, reg, temp_offset, 4, inst_list);
 }
 
 void push_reg_stack(RegStack_t *reg_stack, Register_t *reg)
@@ -468,7 +679,12 @@ Register_t *front_reg_stack(RegStack_t *reg_stack)
 {
     assert(reg_stack != NULL);
 
-    return (Register_t *)reg_stack->registers_free->cur;
+    Register_t *reg;
+
+    reg = (Register_t *)reg_stack->registers_free->cur;
+    reg_stack_mark_used(reg_stack, reg);
+
+    return reg;
 }
 
 Register_t *pop_reg_stack(RegStack_t *reg_stack)
@@ -487,6 +703,7 @@ Register_t *pop_reg_stack(RegStack_t *reg_stack)
 
         reg = (Register_t *)register_node->cur;
         free(register_node);
+        reg_stack_mark_used(reg_stack, reg);
 
         return reg;
     }
@@ -499,6 +716,53 @@ int get_num_registers(RegStack_t *reg_stack)
     return reg_stack->num_registers - reg_stack->num_registers_alloced;
 }
 
+/* Records that reg has been written in the current function */
+void reg_stack_mark_used(RegStack_t *reg_stack, Register_t *reg)
+{
+    reg_stack->regs_used |= 1 << reg->id;
+}
+
+/* rbp is handled by the function header itself */
+int reg_is_callee_saved(int reg_id)
+{
+    switch(reg_id)
+    {
+        case REG_RBX:
+        case REG_R12:
+        case REG_R13:
+        case REG_R14:
+        case REG_R15:
+            return 1;
+
+        default:
+            return 0;
+    }
+}
+
+/* Fills reg_ids (NUM_REG_IDS long) with every used callee-saved register */
+/* Returns how many there are */
+int get_callee_saved_used(RegStack_t *reg_stack, int *reg_ids)
+{
+    assert(reg_stack != NULL);
+    assert(reg_ids != NULL);
+
+    int id, num;
+
+    num = 0;
+    for(id = 0; id < NUM_REG_IDS; ++id)
+        if((reg_stack->regs_used & (1 << id)) && reg_is_callee_saved(id))
+            reg_ids[num++] = id;
+
+    return num;
+}
+
+void reset_regs_used(RegStack_t *reg_stack)
+{
+    assert(reg_stack != NULL);
+
+    reg_stack->regs_used = 0;
+}
+
 void free_reg_stack(RegStack_t *reg_stack)
 {
     assert(reg_stack != NULL);
@@ -542,6 +806,7 @@ StackScope_t *init_stackscope()
     new_scope->t = NULL;
     new_scope->x = NULL;
     new_scope->z = NULL;
+    new_scope->t_free = NULL;
 
     new_scope->prev_scope = NULL;
 
@@ -621,6 +886,7 @@ StackScope_t *free_stackscope(StackScope_t *stackscope)
         free_stackscope_list(stackscope->t);
         free_stackscope_list(stackscope->x);
         free_stackscope_list(stackscope->z);
+        DestroyList(stackscope->t_free);
         free(stackscope);
     }
     return prev_scope;
@@ -637,6 +903,7 @@ void free_all_stackscopes(StackScope_t *stackscope)
         free_stackscope_list(stackscope->t);
         free_stackscope_list(stackscope->x);
         free_stackscope_list(stackscope->z);
+        DestroyList(stackscope->t_free);
         free(stackscope);
 
         stackscope = prev_scope;
@@ -669,6 +936,9 @@ StackNode_t *init_stack_node(int offset, char *label, int size)
     new_node->offset = offset;
     new_node->label = strdup(label);
     new_node->size = size;
+    new_node->is_array = 0;
+    new_node->s_range = 0;
+    new_node->e_range = 0;
 
     return new_node;
 }
@@ -12,9 +12,15 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "../../../Parser/List/List.h"
+#include "../register_types.h"
+#include "../inst_buf/inst_buf.h"
 
 #define CONST_STACK_OFFSET_BYTES 0 /* gcc will handle what's there */
 #define DOUBLEWORD 4
+#define QUADWORD 8
+
+/* Label of temporaries used for spilling registers */
+#define SPILL_LABEL "TEMP_SPILL"
 
 typedef struct StackScope StackScope_t;
 typedef struct StackNode StackNode_t;
@@ -26,6 +32,7 @@ int num_args_alloced;
 void free_arg_regs();
 char *get_arg_reg64_num(int num);
 char *get_arg_reg32_num(int num);
+int get_arg_reg_id(int num);
 
 /****** stackmng *******/
 typedef struct stackmng
@@ -42,7 +49,11 @@ int get_needed_stack_space();
 void push_stackscope();
 void pop_stackscope();
 StackNode_t *add_l_t(char *);
+StackNode_t *add_q_t(char *);
+int add_spill_t();
+void free_spill_t(int offset);
 StackNode_t *add_l_x(char *);
+StackNode_t *add_array_x(char *, int s_range, int e_range);
 StackNode_t *add_l_z(char *);
 StackNode_t *find_in_temp(char *);
 StackNode_t *find_label(char *);
@@ -56,22 +67,37 @@ typedef struct RegStack
     ListNode_t *registers_free;
     int num_registers_alloced;
     int num_registers;
+
+    /* Bit per RegId of every register handed out since the last reset_regs_used */
+    int regs_used;
+
+    /* Every register managed by the stack, free or not, NULL for special registers */
+    Register_t *regs_by_id[NUM_REG_IDS];
 } RegStack_t;
 
 RegStack_t *init_reg_stack();
 
-/* NOTE: Getters return number greater than 1 if it had to kick a value out to temp */
+/* NOTE: Getters return number greater than 0 if it had to kick a value out to temp */
 /* The returned int is the temp offset to restore the value */
-int get_register_64bit(RegStack_t *, char *reg_64, Register_t **);
-int get_register_32bit(RegStack_t *, char *reg_32, Register_t **);
-void restore_register_64bit(RegStack_t *, Register_t *, int temp_offset);
-void restore_register_32bit(RegStack_t *, Register_t *, int temp_offset);
+/* Kicking out and restoring write their moves to the given instruction list */
+int get_register_64bit(RegStack_t *, char *reg_64, Register_t **, InstBuf_t *);
+int get_register_32bit(RegStack_t *, char *reg_32, Register_t **, InstBuf_t *);
+int get_register_id(RegStack_t *, int reg_id, int size, Register_t **, InstBuf_t *);
+void restore_register_64bit(RegStack_t *, Register_t *, int temp_offset, InstBuf_t *);
+void restore_register_32bit(RegStack_t *, Register_t *, int temp_offset, InstBuf_t *);
+void restore_register(RegStack_t *, Register_t *, int temp_offset, int size, InstBuf_t *);
 void push_reg_stack(RegStack_t *, Register_t *);
 void swap_reg_stack(RegStack_t *);
 Register_t *front_reg_stack(RegStack_t *);
 Register_t *pop_reg_stack(RegStack_t *);
 int get_num_registers(RegStack_t *);
 
+/* For saving callee-saved registers around a function body */
+void reg_stack_mark_used(RegStack_t *, Register_t *);
+int reg_is_callee_saved(int reg_id);
+int get_callee_saved_used(RegStack_t *, int *reg_ids);
+void reset_regs_used(RegStack_t *);
+
 void free_reg_stack(RegStack_t *);
 
 /********* Register_t **********/
@@ -79,6 +105,7 @@ typedef struct Register
 {
     char *bit_64;
     char *bit_32;
+    int id; /* See RegId in register_types.h */
 } Register_t;
 
 
@@ -89,6 +116,9 @@ typedef struct StackScope
     int t_offset, x_offset, z_offset;
     ListNode_t *t, *x, *z;
 
+    /* Spill temporaries in t not currently holding anything (not owned) */
+    ListNode_t *t_free;
+
     StackScope_t *prev_scope;
 } StackScope_t;
 
@@ -107,6 +137,10 @@ typedef struct StackNode
     int offset;
     char *label;
     int size;
+
+    /* Arrays only (see add_array_x) */
+    int is_array;
+    int s_range, e_range;
 } StackNode_t;
 
 /* WARNING: init_stack_node makes copy of given label */
@@ -0,0 +1,1078 @@
+/*
+    Damon Gwinn
+    Lowering from the parse tree, CFG utilities, dominators and printing for the IR
+    See ir.h for details
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdint.h>
+#include "ir.h"
+#include "../../flags.h"
+#include "../../Parser/List/List.h"
+#include "../../Parser/ParseTree/tree.h"
+#include "../../Parser/ParseTree/tree_types.h"
+#include "../../Parser/LexAndYacc/y.tab.h"
+
+/* Keep in sync with enum IrOp */
+const char *ir_op_names[NUM_IR_OPS] = {"const", "undef", "arg", "neg", "add", "sub", "mul",
+    "div", "and", "or", "get", "set", "load", "store", "load_elem", "store_elem", "call",
+    "proc", "read", "phi", "jmp", "br", "ret"};
+
+const int ir_op_has_dest[NUM_IR_OPS] = {1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 0, 1, 0, 1, 0, 1,
+    0, 1, 1, 0, 0, 0};
+
+/* State while lowering one body */
+typedef struct IrLower
+{
+    IrFunc_t *func;
+    IrBlock_t *cur;
+} IrLower_t;
+
+IrInst_t *ir_new_inst(IrFunc_t *func, enum IrOp op, int num_args);
+void ir_attach(IrBlock_t *block, IrInst_t *inst);
+void ir_lower_vars(IrLower_t *lower, ListNode_t *decls, int args, int promote, int *arg_num);
+void ir_lower_stmt(IrLower_t *lower, struct Statement *stmt);
+int ir_add_stmt(IrFunc_t *func, struct Statement *stmt, IrBlock_t *entry);
+int ir_stmt_cmp(const void *a, const void *b);
+void ir_lower_assign(IrLower_t *lower, struct Expression *var, int value, int line_num);
+void ir_lower_proc_call(IrLower_t *lower, struct Statement *stmt);
+void ir_lower_if(IrLower_t *lower, struct Statement *stmt, int index);
+void ir_lower_while(IrLower_t *lower, struct Statement *stmt, int index);
+void ir_lower_for(IrLower_t *lower, struct Statement *stmt, int index);
+void ir_lower_cond(IrLower_t *lower, struct Expression *expr, IrBlock_t *if_true,
+    IrBlock_t *if_false);
+int ir_lower_expr(IrLower_t *lower, struct Expression *expr);
+int ir_find_var(IrFunc_t *func, char *id);
+void ir_jump(IrLower_t *lower, IrBlock_t *to);
+
+void ir_dfs_rpo(IrBlock_t *block, IrBlock_t **post, int *num_post);
+IrBlock_t *ir_intersect(IrBlock_t *a, IrBlock_t *b);
+void ir_number_dom_tree(IrBlock_t *block, int *counter);
+void ir_add_block_to(IrBlock_t ***list, int *num, IrBlock_t *block);
+const char *ir_relop_name(int relop);
+void ir_print_value(int value, FILE *f);
+
+/******** BUILDING BLOCKS ********/
+
+IrBlock_t *ir_new_block(IrFunc_t *func)
+{
+    assert(func != NULL);
+
+    IrBlock_t *block;
+
+    block = (IrBlock_t *)calloc(1, sizeof(IrBlock_t));
+    assert(block != NULL);
+    block->id = func->num_blocks;
+    block->rpo = -1;
+
+    if(func->num_blocks == func->max_blocks)
+    {
+        func->max_blocks = (func->max_blocks == 0) ? 16 : func->max_blocks * 2;
+        func->blocks = (IrBlock_t **)realloc(func->blocks,
+            func->max_blocks * sizeof(IrBlock_t *));
+        assert(func->blocks != NULL);
+    }
+    func->blocks[func->num_blocks++] = block;
+
+    return block;
+}
+
+/* A new instruction, not in any block yet */
+IrInst_t *ir_new_inst(IrFunc_t *func, enum IrOp op, int num_args)
+{
+    IrInst_t *inst;
+    IrValue_t *value;
+
+    inst = (IrInst_t *)calloc(1, sizeof(IrInst_t));
+    assert(inst != NULL);
+    inst->op = op;
+    inst->var = -1;
+    inst->dest = -1;
+    inst->num_args = num_args;
+    if(num_args > 0)
+    {
+        inst->args = (int *)malloc(num_args * sizeof(int));
+        assert(inst->args != NULL);
+        memset(inst->args, -1, num_args * sizeof(int));
+    }
+
+    if(ir_op_has_dest[op])
+    {
+        if(func->num_values == func->max_values)
+        {
+            func->max_values = (func->max_values == 0) ? 64 : func->max_values * 2;
+            func->values = (IrValue_t *)realloc(func->values,
+                func->max_values * sizeof(IrValue_t));
+            assert(func->values != NULL);
+        }
+
+        inst->dest = func->num_values++;
+        value = &func->values[inst->dest];
+        memset(value, 0, sizeof(IrValue_t));
+        value->def = inst;
+        value->var = -1;
+    }
+
+    return inst;
+}
+
+/* Adds inst to the end of block */
+void ir_attach(IrBlock_t *block, IrInst_t *inst)
+{
+    assert(block != NULL);
+
+    inst->block = block;
+    inst->prev = block->last;
+    if(block->last != NULL)
+        block->last->next = inst;
+    else
+        block->first = inst;
+    block->last = inst;
+}
+
+IrInst_t *ir_append(IrFunc_t *func, IrBlock_t *block, enum IrOp op, int num_args)
+{
+    IrInst_t *inst;
+
+    inst = ir_new_inst(func, op, num_args);
+    ir_attach(block, inst);
+
+    return inst;
+}
+
+/* Adds to the start of block (where phis go) */
+IrInst_t *ir_prepend(IrFunc_t *func, IrBlock_t *block, enum IrOp op, int num_args)
+{
+    assert(block != NULL);
+
+    IrInst_t *inst;
+
+    inst = ir_new_inst(func, op, num_args);
+    inst->block = block;
+    inst->next = block->first;
+    if(block->first != NULL)
+        block->first->prev = inst;
+    else
+        block->last = inst;
+    block->first = inst;
+
+    return inst;
+}
+
+/* Unlinks and frees an instruction */
+/* NOTE: The value it defined stays behind with a NULL def */
+void ir_remove(IrFunc_t *func, IrInst_t *inst)
+{
+    assert(inst != NULL);
+
+    IrBlock_t *block;
+
+    if(inst->dest >= 0)
+        func->values[inst->dest].def = NULL;
+
+    block = inst->block;
+    if(inst->prev != NULL)
+        inst->prev->next = inst->next;
+    else
+        block->first = inst->next;
+
+    if(inst->next != NULL)
+        inst->next->prev = inst->prev;
+    else
+        block->last = inst->prev;
+
+    free(inst->args);
+    free(inst);
+}
+
+/* Adds a CFG edge */
+void ir_link(IrBlock_t *from, IrBlock_t *to)
+{
+    assert(from->num_succs < 2);
+
+    from->succs[from->num_succs++] = to;
+
+    if(to->num_preds == to->max_preds)
+    {
+        to->max_preds = (to->max_preds == 0) ? 2 : to->max_preds * 2;
+        to->preds = (IrBlock_t **)realloc(to->preds, to->max_preds * sizeof(IrBlock_t *));
+        assert(to->preds != NULL);
+    }
+    to->preds[to->num_preds++] = from;
+}
+
+int ir_pred_index(IrBlock_t *block, IrBlock_t *pred)
+{
+    int i;
+
+    for(i = 0; i < block->num_preds; ++i)
+        if(block->preds[i] == pred)
+            return i;
+
+    return -1;
+}
+
+void ir_free(IrFunc_t *func)
+{
+    IrBlock_t *block;
+    IrInst_t *inst, *next;
+    int i;
+
+    if(func == NULL)
+        return;
+
+    for(i = 0; i < func->num_blocks; ++i)
+    {
+        block = func->blocks[i];
+        inst = block->first;
+        while(inst != NULL)
+        {
+            next = inst->next;
+            free(inst->args);
+            free(inst);
+            inst = next;
+        }
+
+        free(block->preds);
+        free(block->children);
+        free(block->frontier);
+        free(block);
+    }
+
+    for(i = 0; i < func->num_values; ++i)
+        free(func->values[i].uses);
+
+    free(func->blocks);
+    free(func->rpo_order);
+    free(func->values);
+    free(func->var_ids);
+    free(func->stmts);
+    free(func);
+}
+
+/******** LOWERING ********/
+
+IrFunc_t *ir_build(Tree_t *tree)
+{
+    IrFunc_t *func;
+
+    func = ir_lower(tree);
+    ir_build_ssa(func);
+    ir_build_uses(func);
+    assert(ir_verify(func) == 0);
+
+    return func;
+}
+
+IrFunc_t *ir_lower(Tree_t *tree)
+{
+    assert(tree != NULL);
+
+    IrLower_t lower;
+    IrFunc_t *func;
+    ListNode_t *args, *decls, *subprograms;
+    struct Statement *body;
+    int promote, arg_num;
+
+    if(tree->type == TREE_PROGRAM_TYPE)
+    {
+        args = NULL;
+        decls = tree->tree_data.program_data.var_declaration;
+        subprograms = tree->tree_data.program_data.subprograms;
+        body = tree->tree_data.program_data.body_statement;
+    }
+    else
+    {
+        assert(tree->type == TREE_SUBPROGRAM);
+        args = tree->tree_data.subprogram_data.args_var;
+        decls = tree->tree_data.subprogram_data.declarations;
+        subprograms = tree->tree_data.subprogram_data.subprograms;
+        body = tree->tree_data.subprogram_data.statement_list;
+    }
+
+    func = (IrFunc_t *)calloc(1, sizeof(IrFunc_t));
+    assert(func != NULL);
+    func->name = (tree->type == TREE_PROGRAM_TYPE) ? tree->tree_data.program_data.program_id :
+        tree->tree_data.subprogram_data.id;
+
+    lower.func = func;
+    lower.cur = ir_new_block(func);
+
+    /* Gives every promoted variable its starting value */
+    promote = !(nonlocal_flag() && subprograms != NULL);
+    arg_num = 0;
+    ir_lower_vars(&lower, args, 1, promote, &arg_num);
+    ir_lower_vars(&lower, decls, 0, promote, &arg_num);
+
+    if(body != NULL)
+        ir_lower_stmt(&lower, body);
+
+    ir_append(func, lower.cur, IR_RET, 0);
+
+    qsort(func->stmts, func->num_stmts, sizeof(IrStmt_t), ir_stmt_cmp);
+
+    return func;
+}
+
+/* Adds the scalars of decls as promoted variables */
+void ir_lower_vars(IrLower_t *lower, ListNode_t *decls, int args, int promote, int *arg_num)
+{
+    IrFunc_t *func;
+    IrInst_t *inst, *set;
+    Tree_t *decl;
+    ListNode_t *ids;
+
+    func = lower->func;
+    while(decls != NULL)
+    {
+        decl = (Tree_t *)decls->cur;
+        ids = (decl->type == TREE_VAR_DECL) ? decl->tree_data.var_decl_data.ids :
+            decl->tree_data.arr_decl_data.ids;
+
+        while(ids != NULL)
+        {
+            if(promote && decl->type == TREE_VAR_DECL)
+            {
+                func->var_ids = (char **)realloc(func->var_ids,
+                    (func->num_vars + 1) * sizeof(char *));
+                assert(func->var_ids != NULL);
+                func->var_ids[func->num_vars] = (char *)ids->cur;
+
+                if(args)
+                {
+                    inst = ir_append(func, lower->cur, IR_ARG, 0);
+                    inst->imm = *arg_num;
+                }
+                else
+                {
+                    inst = ir_append(func, lower->cur, IR_UNDEF, 0);
+                }
+                inst->line_num = decl->line_num;
+
+                set = ir_append(func, lower->cur, IR_SET, 1);
+                set->var = func->num_vars;
+                set->args[0] = inst->dest;
+                set->line_num = decl->line_num;
+
+                ++func->num_vars;
+            }
+
+            if(args)
+                ++(*arg_num);
+            ids = ids->next;
+        }
+
+        decls = decls->next;
+    }
+}
+
+int ir_find_var(IrFunc_t *func, char *id)
+{
+    int i;
+
+    for(i = 0; i < func->num_vars; ++i)
+        if(strcmp(func->var_ids[i], id) == 0)
+            return i;
+
+    return -1;
+}
+
+/* Ends the current block with a jmp */
+void ir_jump(IrLower_t *lower, IrBlock_t *to)
+{
+    ir_append(lower->func, lower->cur, IR_JMP, 0);
+    ir_link(lower->cur, to);
+}
+
+void ir_lower_stmt(IrLower_t *lower, struct Statement *stmt)
+{
+    assert(stmt != NULL);
+
+    ListNode_t *stmt_list;
+    int value, index;
+
+    index = ir_add_stmt(lower->func, stmt, lower->cur);
+    switch(stmt->type)
+    {
+        case STMT_VAR_ASSIGN:
+            value = ir_lower_expr(lower, stmt->stmt_data.var_assign_data.expr);
+            ir_lower_assign(lower, stmt->stmt_data.var_assign_data.var, value,
+                stmt->line_num);
+            break;
+
+        case STMT_PROCEDURE_CALL:
+            ir_lower_proc_call(lower, stmt);
+            break;
+
+        case STMT_COMPOUND_STATEMENT:
+            stmt_list = stmt->stmt_data.compound_statement;
+            while(stmt_list != NULL)
+            {
+                ir_lower_stmt(lower, (struct Statement *)stmt_list->cur);
+                stmt_list = stmt_list->next;
+            }
+            break;
+
+        case STMT_IF_THEN:
+            ir_lower_if(lower, stmt, index);
+            break;
+
+        case STMT_WHILE:
+            ir_lower_while(lower, stmt, index);
+            break;
+
+        case STMT_FOR:
+            ir_lower_for(lower, stmt, index);
+            break;
+
+        default:
+            fprintf(stderr, "ERROR: Unrecognized statement type in IR lowering\n");
+            exit(1);
+    }
+}
+
+/* Records where stmt starts, returns its index in func->stmts */
+/* NOTE: Index, not pointer, since lowering the arms grows the array */
+int ir_add_stmt(IrFunc_t *func, struct Statement *stmt, IrBlock_t *entry)
+{
+    if(func->num_stmts == func->max_stmts)
+    {
+        func->max_stmts = (func->max_stmts == 0) ? 16 : 2 * func->max_stmts;
+        func->stmts = (IrStmt_t *)realloc(func->stmts, func->max_stmts * sizeof(IrStmt_t));
+        assert(func->stmts != NULL);
+    }
+
+    func->stmts[func->num_stmts].stmt = stmt;
+    func->stmts[func->num_stmts].entry = entry;
+    func->stmts[func->num_stmts].arms[0] = NULL;
+    func->stmts[func->num_stmts].arms[1] = NULL;
+
+    return func->num_stmts++;
+}
+
+int ir_stmt_cmp(const void *a, const void *b)
+{
+    struct Statement *stmt_a, *stmt_b;
+
+    stmt_a = ((const IrStmt_t *)a)->stmt;
+    stmt_b = ((const IrStmt_t *)b)->stmt;
+    if(stmt_a == stmt_b)
+        return 0;
+
+    return ((uintptr_t)stmt_a < (uintptr_t)stmt_b) ? -1 : 1;
+}
+
+IrStmt_t *ir_find_stmt(IrFunc_t *func, struct Statement *stmt)
+{
+    IrStmt_t key;
+
+    key.stmt = stmt;
+    return (IrStmt_t *)bsearch(&key, func->stmts, func->num_stmts, sizeof(IrStmt_t),
+        ir_stmt_cmp);
+}
+
+/* Stores value into a variable or array element */
+void ir_lower_assign(IrLower_t *lower, struct Expression *var, int value, int line_num)
+{
+    IrInst_t *inst;
+    int index, var_index;
+
+    if(var->type == EXPR_ARRAY_ACCESS)
+    {
+        index = ir_lower_expr(lower, var->expr_data.array_access_data.array_expr);
+        inst = ir_append(lower->func, lower->cur, IR_STORE_ELEM, 2);
+        inst->sym = var->expr_data.array_access_data.id;
+        inst->args[0] = index;
+        inst->args[1] = value;
+    }
+    else
+    {
+        assert(var->type == EXPR_VAR_ID);
+        var_index = ir_find_var(lower->func, var->expr_data.id);
+        if(var_index >= 0)
+        {
+            inst = ir_append(lower->func, lower->cur, IR_SET, 1);
+            inst->var = var_index;
+        }
+        else
+        {
+            inst = ir_append(lower->func, lower->cur, IR_STORE, 1);
+            inst->sym = var->expr_data.id;
+        }
+        inst->args[0] = value;
+    }
+
+    inst->line_num = line_num;
+}
+
+void ir_lower_proc_call(IrLower_t *lower, struct Statement *stmt)
+{
+    IrInst_t *inst;
+    ListNode_t *args, *cur;
+    int num_args, i;
+
+    args = stmt->stmt_data.procedure_call_data.expr_args;
+
+    /* read defines its arguments */
+    if(strcmp(stmt->stmt_data.procedure_call_data.id, "read") == 0)
+    {
+        while(args != NULL)
+        {
+            inst = ir_append(lower->func, lower->cur, IR_READ, 0);
+            inst->line_num = stmt->line_num;
+            ir_lower_assign(lower, (struct Expression *)args->cur, inst->dest,
+                stmt->line_num);
+            args = args->next;
+        }
+        return;
+    }
+
+    num_args = 0;
+    for(cur = args; cur != NULL; cur = cur->next)
+        ++num_args;
+
+    inst = ir_new_inst(lower->func, IR_PROC, num_args);
+    for(i = 0; i < num_args; ++i)
+    {
+        inst->args[i] = ir_lower_expr(lower, (struct Expression *)args->cur);
+        args = args->next;
+    }
+
+    /* Goes after its arguments */
+    ir_attach(lower->cur, inst);
+    inst->sym = stmt->stmt_data.procedure_call_data.id;
+    inst->line_num = stmt->line_num;
+}
+
+/* NOTE: The else block is there even without an else arm, so both edges can be told apart */
+void ir_lower_if(IrLower_t *lower, struct Statement *stmt, int index)
+{
+    IrBlock_t *then_block, *else_block, *join_block;
+
+    then_block = ir_new_block(lower->func);
+    join_block = ir_new_block(lower->func);
+    else_block = ir_new_block(lower->func);
+    lower->func->stmts[index].arms[0] = then_block;
+    lower->func->stmts[index].arms[1] = else_block;
+
+    ir_lower_cond(lower, stmt->stmt_data.if_then_data.relop_expr, then_block, else_block);
+
+    lower->cur = then_block;
+    ir_lower_stmt(lower, stmt->stmt_data.if_then_data.if_stmt);
+    ir_jump(lower, join_block);
+
+    lower->cur = else_block;
+    if(stmt->stmt_data.if_then_data.else_stmt != NULL)
+        ir_lower_stmt(lower, stmt->stmt_data.if_then_data.else_stmt);
+    ir_jump(lower, join_block);
+
+    lower->cur = join_block;
+}
+
+/* Same shape as codegen_while: jump to the test, body, test at the bottom */
+void ir_lower_while(IrLower_t *lower, struct Statement *stmt, int index)
+{
+    IrBlock_t *body_block, *test_block, *exit_block;
+
+    body_block = ir_new_block(lower->func);
+    test_block = ir_new_block(lower->func);
+    exit_block = ir_new_block(lower->func);
+    lower->func->stmts[index].arms[0] = body_block;
+    lower->func->stmts[index].arms[1] = exit_block;
+
+    ir_jump(lower, test_block);
+
+    lower->cur = body_block;
+    ir_lower_stmt(lower, stmt->stmt_data.while_data.while_stmt);
+    ir_jump(lower, test_block);
+
+    lower->cur = test_block;
+    ir_lower_cond(lower, stmt->stmt_data.while_data.relop_expr, body_block, exit_block);
+
+    lower->cur = exit_block;
+}
+
+/* Same shape as codegen_for */
+void ir_lower_for(IrLower_t *lower, struct Statement *stmt, int index)
+{
+    IrBlock_t *body_block, *test_block, *exit_block;
+    IrInst_t *inst;
+    struct Expression *for_var;
+    int var_value, one, to;
+
+    if(stmt->stmt_data.for_data.for_assign_type == STMT_FOR_ASSIGN_VAR)
+    {
+        ir_lower_stmt(lower, stmt->stmt_data.for_data.for_assign_data.var_assign);
+        for_var = stmt->stmt_data.for_data.for_assign_data.var_assign->stmt_data.var_assign_data.var;
+    }
+    else
+    {
+        for_var = stmt->stmt_data.for_data.for_assign_data.var;
+    }
+    assert(for_var->type == EXPR_VAR_ID);
+
+    body_block = ir_new_block(lower->func);
+    test_block = ir_new_block(lower->func);
+    exit_block = ir_new_block(lower->func);
+    lower->func->stmts[index].arms[0] = body_block;
+    lower->func->stmts[index].arms[1] = exit_block;
+
+    ir_jump(lower, test_block);
+
+    /* Body and increment */
+    lower->cur = body_block;
+    ir_lower_stmt(lower, stmt->stmt_data.for_data.do_for);
+
+    var_value = ir_lower_expr(lower, for_var);
+    inst = ir_append(lower->func, lower->cur, IR_CONST, 0);
+    inst->imm = 1;
+    one = inst->dest;
+    inst = ir_append(lower->func, lower->cur, IR_ADD, 2);
+    inst->args[0] = var_value;
+    inst->args[1] = one;
+    inst->line_num = stmt->line_num;
+    ir_lower_assign(lower, for_var, inst->dest, stmt->line_num);
+    ir_jump(lower, test_block);
+
+    /* Test: var < to */
+    lower->cur = test_block;
+    var_value = ir_lower_expr(lower, for_var);
+    to = ir_lower_expr(lower, stmt->stmt_data.for_data.to);
+    inst = ir_append(lower->func, lower->cur, IR_BR, 2);
+    inst->imm = LT;
+    inst->args[0] = var_value;
+    inst->args[1] = to;
+    inst->line_num = stmt->line_num;
+    ir_link(test_block, body_block);
+    ir_link(test_block, exit_block);
+
+    lower->cur = exit_block;
+}
+
+/* Branches to if_true or if_false on a relop (short-circuiting and/or) */
+void ir_lower_cond(IrLower_t *lower, struct Expression *expr, IrBlock_t *if_true,
+    IrBlock_t *if_false)
+{
+    assert(expr != NULL);
+    assert(expr->type == EXPR_RELOP);
+
+    IrBlock_t *rest;
+    IrInst_t *inst;
+    int left, right;
+
+    switch(expr->expr_data.relop_data.type)
+    {
+        case AND:
+            rest = ir_new_block(lower->func);
+            ir_lower_cond(lower, expr->expr_data.relop_data.left, rest, if_false);
+            lower->cur = rest;
+            ir_lower_cond(lower, expr->expr_data.relop_data.right, if_true, if_false);
+            break;
+
+        case OR:
+            rest = ir_new_block(lower->func);
+            ir_lower_cond(lower, expr->expr_data.relop_data.left, if_true, rest);
+            lower->cur = rest;
+            ir_lower_cond(lower, expr->expr_data.relop_data.right, if_true, if_false);
+            break;
+
+        case NOT:
+            ir_lower_cond(lower, expr->expr_data.relop_data.left, if_false, if_true);
+            break;
+
+        default:
+            left = ir_lower_expr(lower, expr->expr_data.relop_data.left);
+            right = ir_lower_expr(lower, expr->expr_data.relop_data.right);
+
+            inst = ir_append(lower->func, lower->cur, IR_BR, 2);
+            inst->imm = expr->expr_data.relop_data.type;
+            inst->args[0] = left;
+            inst->args[1] = right;
+            inst->line_num = expr->line_num;
+            ir_link(lower->cur, if_true);
+            ir_link(lower->cur, if_false);
+            break;
+    }
+}
+
+/* Returns the value holding the result */
+int ir_lower_expr(IrLower_t *lower, struct Expression *expr)
+{
+    assert(expr != NULL);
+
+    IrInst_t *inst;
+    ListNode_t *args;
+    int left, right, num_args, i, var_index;
+
+    switch(expr->type)
+    {
+        case EXPR_INUM:
+            inst = ir_append(lower->func, lower->cur, IR_CONST, 0);
+            inst->imm = expr->expr_data.i_num;
+            break;
+
+        case EXPR_VAR_ID:
+            var_index = ir_find_var(lower->func, expr->expr_data.id);
+            if(var_index >= 0)
+            {
+                inst = ir_append(lower->func, lower->cur, IR_GET, 0);
+                inst->var = var_index;
+            }
+            else
+            {
+                inst = ir_append(lower->func, lower->cur, IR_LOAD, 0);
+                inst->sym = expr->expr_data.id;
+            }
+            break;
+
+        case EXPR_ARRAY_ACCESS:
+            left = ir_lower_expr(lower, expr->expr_data.array_access_data.array_expr);
+            inst = ir_append(lower->func, lower->cur, IR_LOAD_ELEM, 1);
+            inst->sym = expr->expr_data.array_access_data.id;
+            inst->args[0] = left;
+            break;
+
+        case EXPR_SIGN_TERM:
+            left = ir_lower_expr(lower, expr->expr_data.sign_term);
+            inst = ir_append(lower->func, lower->cur, IR_NEG, 1);
+            inst->args[0] = left;
+            break;
+
+        case EXPR_ADDOP:
+            left = ir_lower_expr(lower, expr->expr_data.addop_data.left_expr);
+            right = ir_lower_expr(lower, expr->expr_data.addop_data.right_term);
+            switch(expr->expr_data.addop_data.addop_type)
+            {
+                case PLUS:
+                    inst = ir_append(lower->func, lower->cur, IR_ADD, 2);
+                    break;
+                case MINUS:
+                    inst = ir_append(lower->func, lower->cur, IR_SUB, 2);
+                    break;
+                default:
+                    inst = ir_append(lower->func, lower->cur, IR_OR, 2);
+                    break;
+            }
+            inst->args[0] = left;
+            inst->args[1] = right;
+            break;
+
+        case EXPR_MULOP:
+            left = ir_lower_expr(lower, expr->expr_data.mulop_data.left_term);
+            right = ir_lower_expr(lower, expr->expr_data.mulop_data.right_factor);
+            switch(expr->expr_data.mulop_data.mulop_type)
+            {
+                case STAR:
+                    inst = ir_append(lower->func, lower->cur, IR_MUL, 2);
+                    break;
+                case SLASH:
+                    inst = ir_append(lower->func, lower->cur, IR_DIV, 2);
+                    break;
+                default:
+                    inst = ir_append(lower->func, lower->cur, IR_AND, 2);
+                    break;
+            }
+            inst->args[0] = left;
+            inst->args[1] = right;
+            break;
+
+        case EXPR_FUNCTION_CALL:
+            args = expr->expr_data.function_call_data.args_expr;
+            num_args = 0;
+            while(args != NULL)
+            {
+                ++num_args;
+                args = args->next;
+            }
+
+            inst = ir_new_inst(lower->func, IR_CALL, num_args);
+            args = expr->expr_data.function_call_data.args_expr;
+            for(i = 0; i < num_args; ++i)
+            {
+                inst->args[i] = ir_lower_expr(lower, (struct Expression *)args->cur);
+                args = args->next;
+            }
+            ir_attach(lower->cur, inst);
+            inst->sym = expr->expr_data.function_call_data.id;
+            break;
+
+        default:
+            /* Reals (and relops outside of conditions) have no lowering yet */
+            inst = ir_append(lower->func, lower->cur, IR_UNDEF, 0);
+            break;
+    }
+
+    inst->line_num = expr->line_num;
+    return inst->dest;
+}
+
+/******** DOMINATORS ********/
+
+/* Post-order DFS over the CFG */
+void ir_dfs_rpo(IrBlock_t *block, IrBlock_t **post, int *num_post)
+{
+    int i;
+
+    block->rpo = 0; /* Visited */
+    for(i = 0; i < block->num_succs; ++i)
+        if(block->succs[i]->rpo == -1)
+            ir_dfs_rpo(block->succs[i], post, num_post);
+
+    post[(*num_post)++] = block;
+}
+
+/* Nearest common dominator of a and b */
+IrBlock_t *ir_intersect(IrBlock_t *a, IrBlock_t *b)
+{
+    while(a != b)
+    {
+        while(a->rpo > b->rpo)
+            a = a->idom;
+        while(b->rpo > a->rpo)
+            b = b->idom;
+    }
+
+    return a;
+}
+
+void ir_add_block_to(IrBlock_t ***list, int *num, IrBlock_t *block)
+{
+    int i;
+
+    for(i = 0; i < *num; ++i)
+        if((*list)[i] == block)
+            return;
+
+    *list = (IrBlock_t **)realloc(*list, (*num + 1) * sizeof(IrBlock_t *));
+    assert(*list != NULL);
+    (*list)[(*num)++] = block;
+}
+
+void ir_number_dom_tree(IrBlock_t *block, int *counter)
+{
+    int i;
+
+    block->dom_pre = (*counter)++;
+    for(i = 0; i < block->num_children; ++i)
+        ir_number_dom_tree(block->children[i], counter);
+    block->dom_post = (*counter)++;
+}
+
+/* Iterative algorithm of Cooper, Harvey and Kennedy over reverse post-order */
+/* Also builds the dominator tree and dominance frontiers */
+void ir_compute_dominators(IrFunc_t *func)
+{
+    assert(func != NULL);
+    assert(func->num_blocks > 0);
+
+    IrBlock_t **post, *block, *pred, *new_idom, *runner;
+    int num_post, changed, counter, i, j;
+
+    for(i = 0; i < func->num_blocks; ++i)
+    {
+        block = func->blocks[i];
+        block->rpo = -1;
+        block->idom = NULL;
+        free(block->children);
+        block->children = NULL;
+        block->num_children = 0;
+        free(block->frontier);
+        block->frontier = NULL;
+        block->num_frontier = 0;
+    }
+
+    /* Reverse post-order */
+    post = (IrBlock_t **)malloc(func->num_blocks * sizeof(IrBlock_t *));
+    assert(post != NULL);
+    num_post = 0;
+    ir_dfs_rpo(func->blocks[0], post, &num_post);
+
+    free(func->rpo_order);
+    func->rpo_order = (IrBlock_t **)malloc(num_post * sizeof(IrBlock_t *));
+    assert(func->rpo_order != NULL);
+    func->num_rpo = num_post;
+    for(i = 0; i < num_post; ++i)
+    {
+        func->rpo_order[i] = post[num_post - 1 - i];
+        func->rpo_order[i]->rpo = i;
+    }
+    free(post);
+
+    /* Immediate dominators (the entry is its own until the end) */
+    func->blocks[0]->idom = func->blocks[0];
+    changed = 1;
+    while(changed)
+    {
+        changed = 0;
+        for(i = 1; i < func->num_rpo; ++i)
+        {
+            block = func->rpo_order[i];
+            new_idom = NULL;
+            for(j = 0; j < block->num_preds; ++j)
+            {
+                pred = block->preds[j];
+                if(pred->idom == NULL)
+                    continue;
+
+                new_idom = (new_idom == NULL) ? pred : ir_intersect(pred, new_idom);
+            }
+
+            if(new_idom != block->idom)
+            {
+                block->idom = new_idom;
+                changed = 1;
+            }
+        }
+    }
+
+    /* Dominance frontiers */
+    for(i = 0; i < func->num_rpo; ++i)
+    {
+        block = func->rpo_order[i];
+        if(block->num_preds < 2)
+            continue;
+
+        for(j = 0; j < block->num_preds; ++j)
+        {
+            runner = block->preds[j];
+            if(runner->rpo == -1)
+                continue;
+
+            while(runner != block->idom)
+            {
+                ir_add_block_to(&runner->frontier, &runner->num_frontier, block);
+                runner = runner->idom;
+            }
+        }
+    }
+
+    /* Dominator tree */
+    func->blocks[0]->idom = NULL;
+    for(i = 1; i < func->num_rpo; ++i)
+    {
+        block = func->rpo_order[i];
+        ir_add_block_to(&block->idom->children, &block->idom->num_children, block);
+    }
+
+    counter = 0;
+    ir_number_dom_tree(func->blocks[0], &counter);
+}
+
+/* Whether a dominates b (every block dominates itself) */
+int ir_dominates(IrBlock_t *a, IrBlock_t *b)
+{
+    if(a->rpo == -1 || b->rpo == -1)
+        return 0;
+
+    return a->dom_pre <= b->dom_pre && b->dom_post <= a->dom_post;
+}
+
+/******** PRINTING ********/
+
+const char *ir_relop_name(int relop)
+{
+    switch(relop)
+    {
+        case EQ:
+            return "eq";
+        case NE:
+            return "ne";
+        case LT:
+            return "lt";
+        case LE:
+            return "le";
+        case GT:
+            return "gt";
+        case GE:
+            return "ge";
+        default:
+            return "?";
+    }
+}
+
+void ir_print_value(int value, FILE *f)
+{
+    if(value < 0)
+        fprintf(f, "undef");
+    else
+        fprintf(f, "%%%d", value);
+}
+
+void ir_print(IrFunc_t *func, FILE *f)
+{
+    assert(func != NULL);
+
+    IrBlock_t *block;
+    IrInst_t *inst;
+    int i, j;
+
+    fprintf(f, "IR: %s%s\n", func->name, func->in_ssa ? " (SSA)" : "");
+    for(i = 0; i < func->num_blocks; ++i)
+    {
+        block = func->blocks[i];
+        fprintf(f, "  b%d:", block->id);
+        if(block->num_preds > 0)
+        {
+            fprintf(f, " preds");
+            for(j = 0; j < block->num_preds; ++j)
+                fprintf(f, " b%d", block->preds[j]->id);
+        }
+        if(block->idom != NULL)
+            fprintf(f, ", idom b%d", block->idom->id);
+        if(block->rpo == -1 && i > 0)
+            fprintf(f, " (unreachable)");
+        fprintf(f, "\n");
+
+        for(inst = block->first; inst != NULL; inst = inst->next)
+        {
+            fprintf(f, "    ");
+            if(inst->dest >= 0)
+            {
+                fprintf(f, "%%%d = ", inst->dest);
+            }
+            fprintf(f, "%s", ir_op_names[inst->op]);
+
+            if(inst->op == IR_BR)
+                fprintf(f, " %s", ir_relop_name(inst->imm));
+            else if(inst->op == IR_CONST || inst->op == IR_ARG)
+                fprintf(f, " %d", inst->imm);
+
+            if(inst->var >= 0)
+                fprintf(f, " %s", func->var_ids[inst->var]);
+            if(inst->sym != NULL)
+                fprintf(f, " %s", inst->sym);
+
+            for(j = 0; j < inst->num_args; ++j)
+            {
+                fprintf(f, (j == 0 && inst->var < 0 && inst->sym == NULL) ? " " : ", ");
+                ir_print_value(inst->args[j], f);
+                if(inst->op == IR_PHI)
+                    fprintf(f, " (b%d)", block->preds[j]->id);
+            }
+
+            if(inst->op == IR_JMP || inst->op == IR_BR)
+            {
+                fprintf(f, " ->");
+                for(j = 0; j < block->num_succs; ++j)
+                    fprintf(f, " b%d", block->succs[j]->id);
+            }
+
+            fprintf(f, "\n");
+        }
+    }
+    fprintf(f, "\n");
+}
+
+/* For -dump-ir */
+void ir_dump(Tree_t *tree, FILE *f)
+{
+    IrFunc_t *func;
+
+    func = ir_build(tree);
+    ir_print(func, f);
+    ir_free(func);
+}
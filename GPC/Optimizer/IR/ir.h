@@ -0,0 +1,186 @@
+/*
+    Damon Gwinn
+    Mid-level IR: basic blocks, a control flow graph and SSA form
+
+    A program or subprogram body is lowered from its parse tree into basic blocks of
+    three-address instructions. Every instruction defines at most one value, numbered
+    per function, and every block ends in exactly one terminator (jmp, br or ret), so
+    the CFG is explicit in the succs/preds of the blocks.
+
+    Scalar variables of the body (declarations and arguments) are promoted to SSA
+    values: after ir_build_ssa every assignment defines a new value and phi
+    instructions merge them where control flow joins. Everything else (arrays, the
+    function return value, variables of enclosing scopes) stays in memory behind
+    load and store instructions.
+
+    ANALYSES:
+        - Dominators: immediate dominators, the dominator tree and dominance frontiers
+        - Use-def: every value knows the instruction defining it and all of its uses
+        - ir_verify checks that every use is dominated by its definition
+        - Sparse conditional constant propagation: which blocks can run (see sccp.c),
+            used by dead code elimination in the optimizer
+
+    LOWERING NOTES:
+        - Control flow matches codegen: a for loop jumps to its test first, the test
+            is var < to, and the increment is at the bottom of the body
+        - and/or/not in conditions are lowered with short-circuit branches
+        - Every statement records the block its code starts in, and an if or loop the
+            blocks of its arms (ir_find_stmt), so results can be taken back to the tree
+        - An if always gets an else block, even when it has no else arm
+        - With -non-local, nested subprograms can touch any variable, so nothing is
+            promoted in a body that has any
+
+    NOTE: The IR points into the parse tree for names, so it must be freed before the
+        tree is
+*/
+
+#ifndef IR_H
+#define IR_H
+
+#include <stdio.h>
+#include "../../Parser/ParseTree/tree.h"
+#include "../../Parser/ParseTree/tree_types.h"
+
+/* Keep in sync with ir_op_names and ir_op_has_dest in ir.c */
+enum IrOp{IR_CONST, IR_UNDEF, IR_ARG, IR_NEG, IR_ADD, IR_SUB, IR_MUL, IR_DIV, IR_AND, IR_OR,
+    IR_GET, IR_SET, IR_LOAD, IR_STORE, IR_LOAD_ELEM, IR_STORE_ELEM, IR_CALL, IR_PROC,
+    IR_READ, IR_PHI, IR_JMP, IR_BR, IR_RET, NUM_IR_OPS};
+
+/*
+    OPERATIONS:
+        - const imm, undef, arg imm (the imm'th argument)
+        - neg a, add/sub/mul/div/and/or a, b
+        - get var / set var, a: promoted variables (gone after ir_build_ssa)
+        - load sym / store sym, a: scalars left in memory
+        - load_elem sym, i / store_elem sym, i, a: array elements
+        - call sym, args... (function, defines a value) / proc sym, args...
+        - read: reads an integer from input
+        - phi var, a...: one argument per predecessor, in the order of block->preds
+        - jmp / br imm, a, b (imm is the relop, succs[0] when true, succs[1] when false)
+        - ret
+*/
+typedef struct IrInst
+{
+    enum IrOp op;
+    int dest; /* Value defined, -1 if none */
+
+    int num_args;
+    int *args; /* Value ids */
+
+    int imm;
+    int var; /* Promoted variable for get, set and phi, -1 otherwise */
+    char *sym; /* Memory or call target */
+
+    int line_num;
+    struct IrBlock *block;
+    struct IrInst *prev;
+    struct IrInst *next;
+} IrInst_t;
+
+typedef struct IrBlock
+{
+    int id;
+    IrInst_t *first;
+    IrInst_t *last; /* The terminator once the block is finished */
+
+    int num_preds, max_preds;
+    struct IrBlock **preds;
+
+    int num_succs;
+    struct IrBlock *succs[2];
+
+    /* Filled in by ir_compute_dominators */
+    int rpo; /* -1 when unreachable */
+    struct IrBlock *idom; /* NULL for the entry */
+    int num_children;
+    struct IrBlock **children; /* In the dominator tree */
+    int dom_pre, dom_post; /* Dominator tree numbering for ir_dominates */
+    int num_frontier;
+    struct IrBlock **frontier;
+
+    /* Filled in by ir_propagate_consts */
+    int executable;
+    int succ_executable[2];
+} IrBlock_t;
+
+typedef struct IrUse
+{
+    IrInst_t *inst;
+    int arg;
+} IrUse_t;
+
+typedef struct IrValue
+{
+    IrInst_t *def; /* NULL once the defining instruction is gone */
+    int var; /* Promoted variable this is a version of, -1 for temporaries */
+
+    int num_uses, max_uses;
+    IrUse_t *uses; /* Filled in by ir_build_uses */
+} IrValue_t;
+
+/* Where a statement of the parse tree was lowered */
+typedef struct IrStmt
+{
+    struct Statement *stmt;
+    IrBlock_t *entry; /* Block its code starts in */
+    IrBlock_t *arms[2]; /* if: then and else, while and for: body and exit, NULL otherwise */
+} IrStmt_t;
+
+typedef struct IrFunc
+{
+    char *name;
+
+    int num_blocks, max_blocks;
+    IrBlock_t **blocks; /* blocks[0] is the entry */
+
+    int num_rpo;
+    IrBlock_t **rpo_order; /* Reachable blocks in reverse post-order */
+
+    int num_values, max_values;
+    IrValue_t *values;
+
+    int num_vars;
+    char **var_ids; /* Promoted variables */
+
+    int num_stmts, max_stmts;
+    IrStmt_t *stmts; /* Sorted by stmt */
+
+    int in_ssa;
+} IrFunc_t;
+
+/* Lowers a TREE_PROGRAM_TYPE or TREE_SUBPROGRAM into blocks (not yet SSA) */
+IrFunc_t *ir_lower(Tree_t *tree);
+
+/* Lowering, SSA and use-def in one go */
+IrFunc_t *ir_build(Tree_t *tree);
+
+void ir_free(IrFunc_t *func);
+
+/* Dominators */
+void ir_compute_dominators(IrFunc_t *func);
+int ir_dominates(IrBlock_t *a, IrBlock_t *b);
+
+/* SSA and use-def chains (see ssa.c) */
+void ir_build_ssa(IrFunc_t *func);
+void ir_build_uses(IrFunc_t *func);
+int ir_verify(IrFunc_t *func);
+
+/* Marks the blocks and branch edges that can run (see sccp.c) */
+void ir_propagate_consts(IrFunc_t *func);
+
+/* Where stmt was lowered, NULL if it wasn't */
+IrStmt_t *ir_find_stmt(IrFunc_t *func, struct Statement *stmt);
+
+/* Building blocks for passes over the IR */
+IrBlock_t *ir_new_block(IrFunc_t *func);
+IrInst_t *ir_append(IrFunc_t *func, IrBlock_t *block, enum IrOp op, int num_args);
+IrInst_t *ir_prepend(IrFunc_t *func, IrBlock_t *block, enum IrOp op, int num_args);
+void ir_remove(IrFunc_t *func, IrInst_t *inst);
+void ir_link(IrBlock_t *from, IrBlock_t *to);
+int ir_pred_index(IrBlock_t *block, IrBlock_t *pred);
+
+/* Prints the function to f (shown with -dump-ir) */
+void ir_print(IrFunc_t *func, FILE *f);
+void ir_dump(Tree_t *tree, FILE *f);
+
+#endif
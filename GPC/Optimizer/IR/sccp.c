@@ -0,0 +1,340 @@
+/*
+    Damon Gwinn
+    Sparse conditional constant propagation over the SSA form (Wegman and Zadeck)
+
+    Every value starts out unknown and every block unreached. Starting from the entry,
+    the instructions of a block are evaluated when it is first reached, and again
+    whenever one of their arguments changes. A value is a number while every
+    definition of it that can run gives the same one, and varies otherwise. A br on
+    two numbers only reaches the side it takes, so a block behind a condition that
+    never holds is never reached, and the values from it don't reach the phis after it.
+
+    Afterwards block->executable tells whether a block can run and
+    block->succ_executable[i] whether the edge to block->succs[i] can be taken.
+
+    NOTE: Arguments, undefined values (reals too), loads, calls, read, and/or and
+        divisions that would trap always vary
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <limits.h>
+#include "ir.h"
+#include "../../Parser/LexAndYacc/y.tab.h"
+
+enum IrLattice{IR_UNKNOWN, IR_NUMBER, IR_VARIES};
+
+typedef struct IrEdge
+{
+    IrBlock_t *from;
+    int succ;
+} IrEdge_t;
+
+/* State while propagating through one function */
+typedef struct IrConsts
+{
+    IrFunc_t *func;
+    enum IrLattice *state; /* Per value */
+    int *num;
+
+    /* Edges newly found to be taken */
+    int num_edges, max_edges;
+    IrEdge_t *edges;
+
+    /* Values that changed since their uses were last evaluated */
+    int num_changed, max_changed;
+    int *changed;
+} IrConsts_t;
+
+void ir_reach_edge(IrConsts_t *consts, IrBlock_t *from, int succ);
+void ir_visit_block(IrConsts_t *consts, IrBlock_t *block);
+void ir_visit_inst(IrConsts_t *consts, IrInst_t *inst);
+void ir_visit_phi(IrConsts_t *consts, IrInst_t *inst);
+void ir_visit_br(IrConsts_t *consts, IrInst_t *inst);
+int ir_fold(IrInst_t *inst, int a, int b, int *result);
+int ir_compare(int relop, int a, int b);
+void ir_set_value(IrConsts_t *consts, int value, enum IrLattice state, int num);
+
+void ir_propagate_consts(IrFunc_t *func)
+{
+    assert(func != NULL);
+    assert(func->in_ssa);
+
+    IrConsts_t consts;
+    IrEdge_t edge;
+    IrValue_t *value;
+    IrInst_t *inst;
+    int i, cur;
+
+    consts.func = func;
+    consts.state = (enum IrLattice *)calloc(func->num_values + 1, sizeof(enum IrLattice));
+    consts.num = (int *)calloc(func->num_values + 1, sizeof(int));
+    assert(consts.state != NULL);
+    assert(consts.num != NULL);
+    consts.num_edges = consts.max_edges = 0;
+    consts.edges = NULL;
+    consts.num_changed = consts.max_changed = 0;
+    consts.changed = NULL;
+
+    for(i = 0; i < func->num_blocks; ++i)
+    {
+        func->blocks[i]->executable = 0;
+        func->blocks[i]->succ_executable[0] = 0;
+        func->blocks[i]->succ_executable[1] = 0;
+    }
+
+    ir_visit_block(&consts, func->blocks[0]);
+    while(consts.num_edges > 0 || consts.num_changed > 0)
+    {
+        while(consts.num_edges > 0)
+        {
+            edge = consts.edges[--consts.num_edges];
+            if(!edge.from->succ_executable[edge.succ])
+            {
+                edge.from->succ_executable[edge.succ] = 1;
+                if(!edge.from->succs[edge.succ]->executable)
+                {
+                    ir_visit_block(&consts, edge.from->succs[edge.succ]);
+                }
+                else
+                {
+                    /* Only the phis see which edge was taken */
+                    for(inst = edge.from->succs[edge.succ]->first;
+                        inst != NULL && inst->op == IR_PHI; inst = inst->next)
+                        ir_visit_phi(&consts, inst);
+                }
+            }
+        }
+
+        while(consts.num_changed > 0 && consts.num_edges == 0)
+        {
+            cur = consts.changed[--consts.num_changed];
+            value = &func->values[cur];
+            for(i = 0; i < value->num_uses; ++i)
+                if(value->uses[i].inst->block->executable)
+                    ir_visit_inst(&consts, value->uses[i].inst);
+        }
+    }
+
+    free(consts.state);
+    free(consts.num);
+    free(consts.edges);
+    free(consts.changed);
+}
+
+/* Queues the edge from->succs[succ] */
+void ir_reach_edge(IrConsts_t *consts, IrBlock_t *from, int succ)
+{
+    if(from->succ_executable[succ])
+        return;
+
+    if(consts->num_edges == consts->max_edges)
+    {
+        consts->max_edges = (consts->max_edges == 0) ? 16 : 2 * consts->max_edges;
+        consts->edges = (IrEdge_t *)realloc(consts->edges,
+            consts->max_edges * sizeof(IrEdge_t));
+        assert(consts->edges != NULL);
+    }
+
+    consts->edges[consts->num_edges].from = from;
+    consts->edges[consts->num_edges].succ = succ;
+    ++consts->num_edges;
+}
+
+/* A block is reached for the first time */
+void ir_visit_block(IrConsts_t *consts, IrBlock_t *block)
+{
+    IrInst_t *inst;
+
+    block->executable = 1;
+    for(inst = block->first; inst != NULL; inst = inst->next)
+        ir_visit_inst(consts, inst);
+}
+
+void ir_visit_inst(IrConsts_t *consts, IrInst_t *inst)
+{
+    int a, b, result;
+
+    switch(inst->op)
+    {
+        case IR_CONST:
+            ir_set_value(consts, inst->dest, IR_NUMBER, inst->imm);
+            break;
+
+        case IR_PHI:
+            ir_visit_phi(consts, inst);
+            break;
+
+        case IR_NEG:
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MUL:
+        case IR_DIV:
+            a = inst->args[0];
+            b = (inst->op == IR_NEG) ? a : inst->args[1];
+            if(a < 0 || b < 0 || consts->state[a] == IR_VARIES ||
+                consts->state[b] == IR_VARIES)
+            {
+                ir_set_value(consts, inst->dest, IR_VARIES, 0);
+            }
+            else if(consts->state[a] == IR_NUMBER && consts->state[b] == IR_NUMBER)
+            {
+                if(ir_fold(inst, consts->num[a], consts->num[b], &result))
+                    ir_set_value(consts, inst->dest, IR_NUMBER, result);
+                else
+                    ir_set_value(consts, inst->dest, IR_VARIES, 0);
+            }
+            break;
+
+        case IR_JMP:
+            ir_reach_edge(consts, inst->block, 0);
+            break;
+
+        case IR_BR:
+            ir_visit_br(consts, inst);
+            break;
+
+        default:
+            if(inst->dest >= 0)
+                ir_set_value(consts, inst->dest, IR_VARIES, 0);
+            break;
+    }
+}
+
+/* Meets the arguments coming in over edges that can be taken */
+void ir_visit_phi(IrConsts_t *consts, IrInst_t *inst)
+{
+    IrBlock_t *pred;
+    enum IrLattice state;
+    int i, j, arg, num, taken;
+
+    state = IR_UNKNOWN;
+    num = 0;
+    for(i = 0; i < inst->num_args && state != IR_VARIES; ++i)
+    {
+        pred = inst->block->preds[i];
+        taken = 0;
+        for(j = 0; j < pred->num_succs; ++j)
+            if(pred->succs[j] == inst->block && pred->succ_executable[j])
+                taken = 1;
+        if(!taken)
+            continue;
+
+        arg = inst->args[i];
+        if(arg < 0 || consts->state[arg] == IR_VARIES)
+            state = IR_VARIES;
+        else if(consts->state[arg] == IR_NUMBER)
+        {
+            if(state == IR_UNKNOWN)
+            {
+                state = IR_NUMBER;
+                num = consts->num[arg];
+            }
+            else if(num != consts->num[arg])
+                state = IR_VARIES;
+        }
+    }
+
+    if(state != IR_UNKNOWN)
+        ir_set_value(consts, inst->dest, state, num);
+}
+
+/* Takes the side a comparison of two numbers picks, both if either varies */
+void ir_visit_br(IrConsts_t *consts, IrInst_t *inst)
+{
+    int a, b;
+
+    a = inst->args[0];
+    b = inst->args[1];
+    if(a < 0 || b < 0 || consts->state[a] == IR_VARIES || consts->state[b] == IR_VARIES)
+    {
+        ir_reach_edge(consts, inst->block, 0);
+        ir_reach_edge(consts, inst->block, 1);
+    }
+    else if(consts->state[a] == IR_NUMBER && consts->state[b] == IR_NUMBER)
+    {
+        if(ir_compare(inst->imm, consts->num[a], consts->num[b]))
+            ir_reach_edge(consts, inst->block, 0);
+        else
+            ir_reach_edge(consts, inst->block, 1);
+    }
+}
+
+/* Returns 0 when the operation would trap */
+/* NOTE: Wraps like the generated code */
+int ir_fold(IrInst_t *inst, int a, int b, int *result)
+{
+    switch(inst->op)
+    {
+        case IR_NEG:
+            *result = (int)(0U - (unsigned)a);
+            return 1;
+        case IR_ADD:
+            *result = (int)((unsigned)a + (unsigned)b);
+            return 1;
+        case IR_SUB:
+            *result = (int)((unsigned)a - (unsigned)b);
+            return 1;
+        case IR_MUL:
+            *result = (int)((unsigned)a * (unsigned)b);
+            return 1;
+        case IR_DIV:
+            if(b == 0 || (a == INT_MIN && b == -1))
+                return 0;
+            *result = a / b;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+int ir_compare(int relop, int a, int b)
+{
+    switch(relop)
+    {
+        case EQ:
+            return a == b;
+        case NE:
+            return a != b;
+        case LT:
+            return a < b;
+        case LE:
+            return a <= b;
+        case GT:
+            return a > b;
+        case GE:
+            return a >= b;
+        default:
+            fprintf(stderr, "ERROR: Unrecognized relop in constant propagation\n");
+            exit(1);
+    }
+}
+
+/* Values only ever go from unknown to a number to varying */
+void ir_set_value(IrConsts_t *consts, int value, enum IrLattice state, int num)
+{
+    if(consts->state[value] == IR_VARIES)
+        return;
+    if(consts->state[value] == IR_NUMBER && state == IR_NUMBER)
+    {
+        if(consts->num[value] == num)
+            return;
+        state = IR_VARIES;
+    }
+    if(consts->state[value] == state)
+        return;
+    if(state == IR_UNKNOWN)
+        return;
+
+    consts->state[value] = state;
+    consts->num[value] = num;
+
+    if(consts->num_changed == consts->max_changed)
+    {
+        consts->max_changed = (consts->max_changed == 0) ? 16 : 2 * consts->max_changed;
+        consts->changed = (int *)realloc(consts->changed, consts->max_changed * sizeof(int));
+        assert(consts->changed != NULL);
+    }
+    consts->changed[consts->num_changed++] = value;
+}
@@ -0,0 +1,359 @@
+/*
+    Damon Gwinn
+    SSA construction and use-def chains for the IR
+
+    Phis are placed on the iterated dominance frontier of every block that sets a
+    variable (Cytron et al.). A walk down the dominator tree then renames: a get
+    becomes the variable's current value, a set makes its argument the current value,
+    and both are removed, leaving nothing but values.
+
+    NOTE: Phis are minimal, not pruned by liveness, so some of them can be dead
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include "ir.h"
+
+/* Current value of every variable during renaming */
+typedef struct IrVarStacks
+{
+    int *depth;
+    int *max_depth;
+    int **values;
+} IrVarStacks_t;
+
+void ir_insert_phis(IrFunc_t *func);
+void ir_rename(IrFunc_t *func, IrBlock_t *block, IrVarStacks_t *stacks, int *repl);
+void ir_push_var(IrVarStacks_t *stacks, int var, int value);
+int ir_top_var(IrVarStacks_t *stacks, int var);
+void ir_add_use(IrValue_t *value, IrInst_t *inst, int arg);
+
+void ir_build_ssa(IrFunc_t *func)
+{
+    assert(func != NULL);
+    assert(func->in_ssa == 0);
+
+    IrVarStacks_t stacks;
+    int *repl;
+    int i;
+
+    ir_compute_dominators(func);
+    ir_insert_phis(func);
+
+    stacks.depth = (int *)calloc(func->num_vars + 1, sizeof(int));
+    stacks.max_depth = (int *)calloc(func->num_vars + 1, sizeof(int));
+    stacks.values = (int **)calloc(func->num_vars + 1, sizeof(int *));
+    repl = (int *)malloc((func->num_values + 1) * sizeof(int));
+    assert(stacks.depth != NULL);
+    assert(stacks.max_depth != NULL);
+    assert(stacks.values != NULL);
+    assert(repl != NULL);
+
+    /* Gets are the only values replaced */
+    for(i = 0; i < func->num_values; ++i)
+        repl[i] = i;
+
+    ir_rename(func, func->blocks[0], &stacks, repl);
+
+    for(i = 0; i < func->num_vars; ++i)
+        free(stacks.values[i]);
+    free(stacks.values);
+    free(stacks.depth);
+    free(stacks.max_depth);
+    free(repl);
+
+    func->in_ssa = 1;
+}
+
+/* Places phis for every variable */
+void ir_insert_phis(IrFunc_t *func)
+{
+    IrBlock_t **work, *block, *frontier;
+    IrInst_t *inst, *phi;
+    int *has_phi, *queued;
+    int num_work, var, i;
+
+    work = (IrBlock_t **)malloc(func->num_blocks * sizeof(IrBlock_t *));
+    has_phi = (int *)malloc(func->num_blocks * sizeof(int));
+    queued = (int *)malloc(func->num_blocks * sizeof(int));
+    assert(work != NULL);
+    assert(has_phi != NULL);
+    assert(queued != NULL);
+
+    /* Hold the last variable handled so they never need clearing */
+    for(i = 0; i < func->num_blocks; ++i)
+    {
+        has_phi[i] = -1;
+        queued[i] = -1;
+    }
+
+    for(var = 0; var < func->num_vars; ++var)
+    {
+        /* Blocks setting var */
+        num_work = 0;
+        for(i = 0; i < func->num_rpo; ++i)
+        {
+            block = func->rpo_order[i];
+            for(inst = block->first; inst != NULL; inst = inst->next)
+            {
+                if(inst->op == IR_SET && inst->var == var)
+                {
+                    work[num_work++] = block;
+                    queued[block->id] = var;
+                    break;
+                }
+            }
+        }
+
+        while(num_work > 0)
+        {
+            block = work[--num_work];
+            for(i = 0; i < block->num_frontier; ++i)
+            {
+                frontier = block->frontier[i];
+                if(has_phi[frontier->id] == var)
+                    continue;
+
+                phi = ir_prepend(func, frontier, IR_PHI, frontier->num_preds);
+                phi->var = var;
+                func->values[phi->dest].var = var;
+                has_phi[frontier->id] = var;
+
+                /* A phi is a new definition of var */
+                if(queued[frontier->id] != var)
+                {
+                    queued[frontier->id] = var;
+                    work[num_work++] = frontier;
+                }
+            }
+        }
+    }
+
+    free(work);
+    free(has_phi);
+    free(queued);
+}
+
+void ir_push_var(IrVarStacks_t *stacks, int var, int value)
+{
+    if(stacks->depth[var] == stacks->max_depth[var])
+    {
+        stacks->max_depth[var] = (stacks->max_depth[var] == 0) ? 8 : stacks->max_depth[var] * 2;
+        stacks->values[var] = (int *)realloc(stacks->values[var],
+            stacks->max_depth[var] * sizeof(int));
+        assert(stacks->values[var] != NULL);
+    }
+
+    stacks->values[var][stacks->depth[var]++] = value;
+}
+
+/* -1 (undef) if var has no value on this path */
+int ir_top_var(IrVarStacks_t *stacks, int var)
+{
+    if(stacks->depth[var] == 0)
+        return -1;
+
+    return stacks->values[var][stacks->depth[var] - 1];
+}
+
+/* Renames block, then its children in the dominator tree */
+void ir_rename(IrFunc_t *func, IrBlock_t *block, IrVarStacks_t *stacks, int *repl)
+{
+    IrInst_t *inst, *next;
+    IrBlock_t *succ;
+    int *pushed;
+    int num_pushed, i, j;
+
+    pushed = NULL;
+    num_pushed = 0;
+    for(inst = block->first; inst != NULL; inst = next)
+    {
+        next = inst->next;
+
+        if(inst->op != IR_PHI)
+        {
+            for(i = 0; i < inst->num_args; ++i)
+                if(inst->args[i] >= 0)
+                    inst->args[i] = repl[inst->args[i]];
+        }
+
+        if(inst->op == IR_PHI || inst->op == IR_SET)
+        {
+            pushed = (int *)realloc(pushed, (num_pushed + 1) * sizeof(int));
+            assert(pushed != NULL);
+            pushed[num_pushed++] = inst->var;
+
+            if(inst->op == IR_PHI)
+            {
+                ir_push_var(stacks, inst->var, inst->dest);
+            }
+            else
+            {
+                ir_push_var(stacks, inst->var, inst->args[0]);
+                if(inst->args[0] >= 0 && func->values[inst->args[0]].var == -1)
+                    func->values[inst->args[0]].var = inst->var;
+                ir_remove(func, inst);
+            }
+        }
+        else if(inst->op == IR_GET)
+        {
+            repl[inst->dest] = ir_top_var(stacks, inst->var);
+            ir_remove(func, inst);
+        }
+    }
+
+    /* Phi arguments for the edges leaving block */
+    for(i = 0; i < block->num_succs; ++i)
+    {
+        succ = block->succs[i];
+        for(j = 0; j < succ->num_preds; ++j)
+        {
+            if(succ->preds[j] != block)
+                continue;
+
+            for(inst = succ->first; inst != NULL && inst->op == IR_PHI; inst = inst->next)
+                inst->args[j] = ir_top_var(stacks, inst->var);
+        }
+    }
+
+    for(i = 0; i < block->num_children; ++i)
+        ir_rename(func, block->children[i], stacks, repl);
+
+    for(i = 0; i < num_pushed; ++i)
+        --stacks->depth[pushed[i]];
+    free(pushed);
+}
+
+void ir_add_use(IrValue_t *value, IrInst_t *inst, int arg)
+{
+    if(value->num_uses == value->max_uses)
+    {
+        value->max_uses = (value->max_uses == 0) ? 4 : value->max_uses * 2;
+        value->uses = (IrUse_t *)realloc(value->uses, value->max_uses * sizeof(IrUse_t));
+        assert(value->uses != NULL);
+    }
+
+    value->uses[value->num_uses].inst = inst;
+    value->uses[value->num_uses].arg = arg;
+    ++value->num_uses;
+}
+
+/* (Re)builds the def and uses of every value */
+void ir_build_uses(IrFunc_t *func)
+{
+    assert(func != NULL);
+
+    IrBlock_t *block;
+    IrInst_t *inst;
+    int i, j;
+
+    for(i = 0; i < func->num_values; ++i)
+    {
+        func->values[i].def = NULL;
+        func->values[i].num_uses = 0;
+    }
+
+    for(i = 0; i < func->num_blocks; ++i)
+    {
+        block = func->blocks[i];
+        for(inst = block->first; inst != NULL; inst = inst->next)
+        {
+            if(inst->dest >= 0)
+                func->values[inst->dest].def = inst;
+
+            for(j = 0; j < inst->num_args; ++j)
+                if(inst->args[j] >= 0)
+                    ir_add_use(&func->values[inst->args[j]], inst, j);
+        }
+    }
+}
+
+/* Checks that every use is dominated by its definition and every block is well formed */
+/* Returns the number of problems, printing each one to stderr */
+int ir_verify(IrFunc_t *func)
+{
+    assert(func != NULL);
+
+    IrBlock_t *block, *def_block;
+    IrInst_t *inst, *def;
+    int *position;
+    int errors, pos, i, j;
+
+    errors = 0;
+    position = (int *)calloc(func->num_values + 1, sizeof(int));
+    assert(position != NULL);
+
+    for(i = 0; i < func->num_rpo; ++i)
+    {
+        pos = 0;
+        for(inst = func->rpo_order[i]->first; inst != NULL; inst = inst->next)
+            if(inst->dest >= 0)
+                position[inst->dest] = pos++;
+    }
+
+    for(i = 0; i < func->num_rpo; ++i)
+    {
+        block = func->rpo_order[i];
+        if(block->last == NULL ||
+            (block->last->op == IR_JMP && block->num_succs != 1) ||
+            (block->last->op == IR_BR && block->num_succs != 2) ||
+            (block->last->op == IR_RET && block->num_succs != 0) ||
+            (block->last->op != IR_JMP && block->last->op != IR_BR && block->last->op != IR_RET))
+        {
+            fprintf(stderr, "IR ERROR: b%d does not end in a matching terminator\n", block->id);
+            ++errors;
+        }
+
+        pos = 0;
+        for(inst = block->first; inst != NULL; inst = inst->next)
+        {
+            if(inst->op == IR_PHI && inst->num_args != block->num_preds)
+            {
+                fprintf(stderr, "IR ERROR: phi %%%d in b%d has %d args for %d preds\n",
+                    inst->dest, block->id, inst->num_args, block->num_preds);
+                ++errors;
+            }
+
+            for(j = 0; j < inst->num_args; ++j)
+            {
+                if(inst->args[j] < 0)
+                    continue;
+
+                def = func->values[inst->args[j]].def;
+                if(def == NULL)
+                {
+                    fprintf(stderr, "IR ERROR: %%%d used in b%d has no definition\n",
+                        inst->args[j], block->id);
+                    ++errors;
+                    continue;
+                }
+
+                def_block = def->block;
+                if(inst->op == IR_PHI)
+                {
+                    if(j < block->num_preds && !ir_dominates(def_block, block->preds[j]))
+                    {
+                        fprintf(stderr, "IR ERROR: phi arg %%%d does not reach b%d\n",
+                            inst->args[j], block->preds[j]->id);
+                        ++errors;
+                    }
+                }
+                else if((def_block == block) ? (position[inst->args[j]] >= pos) :
+                    !ir_dominates(def_block, block))
+                {
+                    fprintf(stderr, "IR ERROR: %%%d used in b%d before it is defined\n",
+                        inst->args[j], block->id);
+                    ++errors;
+                }
+            }
+
+            if(inst->dest >= 0)
+                ++pos;
+        }
+    }
+
+    free(position);
+    return errors;
+}
@@ -0,0 +1,741 @@
+/*
+    Damon Gwinn
+    Compile-time evaluator for pure functions
+
+    See evaluator.h
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include "evaluator.h"
+#include "optimizer.h"
+#include "../Parser/List/List.h"
+#include "../Parser/ParseTree/tree.h"
+#include "../Parser/ParseTree/tree_types.h"
+#include "../Parser/LexAndYacc/y.tab.h"
+
+/* A registered subprogram */
+typedef struct EvalFunc
+{
+    Tree_t *sub;
+    int pure;
+    int visible; /* Callable from the bodies optimized from now on */
+
+    int num_args;
+    int num_names;
+    char **names; /* Arguments, then locals, then the return variable */
+
+    int num_callees;
+    int *callees; /* Functions its body calls (itself included) */
+} EvalFunc_t;
+
+/* One call being run */
+typedef struct EvalFrame
+{
+    EvalFunc_t *func;
+    int *vals;
+    int *is_set;
+    int *steps; /* Shared by every call made for one replaced call */
+    int depth;
+} EvalFrame_t;
+
+/* Every subprogram registered so far, innermost last */
+/* NOTE: Entries are never removed so callees can keep their index */
+int num_eval_funcs = 0;
+int max_eval_funcs = 0;
+EvalFunc_t *eval_funcs = NULL;
+
+void eval_add_name(EvalFunc_t *func, char *id);
+int eval_name_index(EvalFunc_t *func, char *id);
+int eval_lookup(char *id);
+int eval_pure_stmt(int index, struct Statement *stmt);
+int eval_pure_expr(int index, struct Expression *expr);
+
+int eval_run(int index, int *args, int *result, int *steps, int depth);
+int eval_stmt(EvalFrame_t *frame, struct Statement *stmt);
+int eval_assign(EvalFrame_t *frame, struct Expression *var, struct Expression *expr);
+int eval_expr(EvalFrame_t *frame, struct Expression *expr, int *val);
+int eval_relop(EvalFrame_t *frame, struct Expression *expr, int *truth);
+int eval_call(EvalFrame_t *frame, struct Expression *call, int *val);
+
+void eval_calls_stmt(struct Statement *stmt, int *num_evaluated);
+void eval_calls_expr(struct Expression **expr, int *num_evaluated);
+
+/******** REGISTRY ********/
+
+void eval_register(Tree_t *sub)
+{
+    assert(sub != NULL);
+    assert(sub->type == TREE_SUBPROGRAM);
+
+    struct Subprogram *sub_data;
+    EvalFunc_t *func;
+    ListNode_t *decls, *ids;
+    Tree_t *decl;
+    int pass, index;
+
+    sub_data = &sub->tree_data.subprogram_data;
+
+    /* What was nested in sub can't be called from outside of it */
+    eval_unregister(sub_data->subprograms);
+
+    if(num_eval_funcs == max_eval_funcs)
+    {
+        max_eval_funcs = (max_eval_funcs == 0) ? 8 : max_eval_funcs * 2;
+        eval_funcs = (EvalFunc_t *)realloc(eval_funcs, max_eval_funcs * sizeof(EvalFunc_t));
+        assert(eval_funcs != NULL);
+    }
+
+    index = num_eval_funcs++;
+    func = &eval_funcs[index];
+    func->sub = sub;
+    func->pure = (sub_data->sub_type == TREE_SUBPROGRAM_FUNC &&
+        sub_data->return_type == INT_TYPE && sub_data->subprograms == NULL &&
+        sub_data->statement_list != NULL);
+    func->visible = 1;
+    func->num_args = 0;
+    func->num_names = 0;
+    func->names = NULL;
+    func->num_callees = 0;
+    func->callees = NULL;
+
+    /* Arguments, then locals */
+    for(pass = 0; pass < 2; ++pass)
+    {
+        decls = (pass == 0) ? sub_data->args_var : sub_data->declarations;
+        while(decls != NULL)
+        {
+            decl = (Tree_t *)decls->cur;
+            if(decl->type != TREE_VAR_DECL || decl->tree_data.var_decl_data.type != INT_TYPE)
+                func->pure = 0;
+
+            ids = (decl->type == TREE_VAR_DECL) ? decl->tree_data.var_decl_data.ids :
+                decl->tree_data.arr_decl_data.ids;
+            while(ids != NULL)
+            {
+                eval_add_name(func, (char *)ids->cur);
+                ids = ids->next;
+            }
+
+            decls = decls->next;
+        }
+
+        if(pass == 0)
+            func->num_args = func->num_names;
+    }
+    eval_add_name(func, sub_data->id);
+
+    if(func->pure)
+        func->pure = eval_pure_stmt(index, sub_data->statement_list);
+}
+
+void eval_unregister(ListNode_t *subprograms)
+{
+    int i;
+
+    while(subprograms != NULL)
+    {
+        for(i = 0; i < num_eval_funcs; ++i)
+            if(eval_funcs[i].sub == (Tree_t *)subprograms->cur)
+                eval_funcs[i].visible = 0;
+
+        subprograms = subprograms->next;
+    }
+}
+
+void eval_add_name(EvalFunc_t *func, char *id)
+{
+    func->names = (char **)realloc(func->names, (func->num_names + 1) * sizeof(char *));
+    assert(func->names != NULL);
+    func->names[func->num_names++] = id;
+}
+
+/* -1 if id is not one of the function's own names */
+int eval_name_index(EvalFunc_t *func, char *id)
+{
+    int i;
+
+    for(i = 0; i < func->num_names; ++i)
+        if(strcmp(func->names[i], id) == 0)
+            return i;
+
+    return -1;
+}
+
+/* The innermost visible subprogram named id, -1 if there is none */
+int eval_lookup(char *id)
+{
+    int i;
+
+    for(i = num_eval_funcs - 1; i >= 0; --i)
+        if(eval_funcs[i].visible &&
+            strcmp(eval_funcs[i].sub->tree_data.subprogram_data.id, id) == 0)
+        {
+            return i;
+        }
+
+    return -1;
+}
+
+/* Whether stmt only touches the function's own names */
+int eval_pure_stmt(int index, struct Statement *stmt)
+{
+    ListNode_t *cur;
+    struct Expression *var;
+
+    switch(stmt->type)
+    {
+        case STMT_VAR_ASSIGN:
+            var = stmt->stmt_data.var_assign_data.var;
+            return var->type == EXPR_VAR_ID &&
+                eval_name_index(&eval_funcs[index], var->expr_data.id) >= 0 &&
+                eval_pure_expr(index, stmt->stmt_data.var_assign_data.expr);
+
+        case STMT_COMPOUND_STATEMENT:
+            cur = stmt->stmt_data.compound_statement;
+            while(cur != NULL)
+            {
+                if(!eval_pure_stmt(index, (struct Statement *)cur->cur))
+                    return 0;
+                cur = cur->next;
+            }
+            return 1;
+
+        case STMT_IF_THEN:
+            if(!eval_pure_expr(index, stmt->stmt_data.if_then_data.relop_expr) ||
+                !eval_pure_stmt(index, stmt->stmt_data.if_then_data.if_stmt))
+            {
+                return 0;
+            }
+            return stmt->stmt_data.if_then_data.else_stmt == NULL ||
+                eval_pure_stmt(index, stmt->stmt_data.if_then_data.else_stmt);
+
+        case STMT_WHILE:
+            return eval_pure_expr(index, stmt->stmt_data.while_data.relop_expr) &&
+                eval_pure_stmt(index, stmt->stmt_data.while_data.while_stmt);
+
+        case STMT_FOR:
+            if(stmt->stmt_data.for_data.for_assign_type == STMT_FOR_ASSIGN_VAR)
+            {
+                if(!eval_pure_stmt(index, stmt->stmt_data.for_data.for_assign_data.var_assign))
+                    return 0;
+            }
+            else if(!eval_pure_expr(index, stmt->stmt_data.for_data.for_assign_data.var))
+            {
+                return 0;
+            }
+            return eval_pure_expr(index, stmt->stmt_data.for_data.to) &&
+                eval_pure_stmt(index, stmt->stmt_data.for_data.do_for);
+
+        /* Procedure calls (read and write included) */
+        default:
+            return 0;
+    }
+}
+
+/* Whether expr only reads the function's own names and calls pure functions */
+int eval_pure_expr(int index, struct Expression *expr)
+{
+    EvalFunc_t *func;
+    ListNode_t *cur;
+    int callee;
+
+    func = &eval_funcs[index];
+    switch(expr->type)
+    {
+        case EXPR_INUM:
+            return 1;
+
+        case EXPR_VAR_ID:
+            return eval_name_index(func, expr->expr_data.id) >= 0;
+
+        case EXPR_RELOP:
+            return eval_pure_expr(index, expr->expr_data.relop_data.left) &&
+                (expr->expr_data.relop_data.right == NULL ||
+                eval_pure_expr(index, expr->expr_data.relop_data.right));
+
+        case EXPR_SIGN_TERM:
+            return eval_pure_expr(index, expr->expr_data.sign_term);
+
+        case EXPR_ADDOP:
+            return (expr->expr_data.addop_data.addop_type == PLUS ||
+                expr->expr_data.addop_data.addop_type == MINUS) &&
+                eval_pure_expr(index, expr->expr_data.addop_data.left_expr) &&
+                eval_pure_expr(index, expr->expr_data.addop_data.right_term);
+
+        case EXPR_MULOP:
+            return (expr->expr_data.mulop_data.mulop_type == STAR ||
+                expr->expr_data.mulop_data.mulop_type == SLASH) &&
+                eval_pure_expr(index, expr->expr_data.mulop_data.left_term) &&
+                eval_pure_expr(index, expr->expr_data.mulop_data.right_factor);
+
+        case EXPR_FUNCTION_CALL:
+            /* Not visible yet to itself, so it's checked by name */
+            if(strcmp(expr->expr_data.function_call_data.id,
+                func->sub->tree_data.subprogram_data.id) == 0)
+            {
+                callee = index;
+            }
+            else
+            {
+                callee = eval_lookup(expr->expr_data.function_call_data.id);
+                if(callee < 0 || !eval_funcs[callee].pure)
+                    return 0;
+            }
+
+            func->callees = (int *)realloc(func->callees, (func->num_callees + 1) * sizeof(int));
+            assert(func->callees != NULL);
+            func->callees[func->num_callees++] = callee;
+
+            cur = expr->expr_data.function_call_data.args_expr;
+            while(cur != NULL)
+            {
+                if(!eval_pure_expr(index, (struct Expression *)cur->cur))
+                    return 0;
+                cur = cur->next;
+            }
+            return 1;
+
+        /* Arrays, reals and non-local variables */
+        default:
+            return 0;
+    }
+}
+
+/******** INTERPRETER ********/
+
+/* Runs a pure function on args */
+/* Returns 0 if it has to be left for runtime */
+int eval_run(int index, int *args, int *result, int *steps, int depth)
+{
+    EvalFrame_t frame;
+    EvalFunc_t *func;
+    int i, ok;
+
+    func = &eval_funcs[index];
+    assert(func->pure);
+
+    frame.func = func;
+    frame.vals = (int *)calloc(func->num_names, sizeof(int));
+    frame.is_set = (int *)calloc(func->num_names, sizeof(int));
+    assert(frame.vals != NULL);
+    assert(frame.is_set != NULL);
+    frame.steps = steps;
+    frame.depth = depth;
+
+    for(i = 0; i < func->num_args; ++i)
+    {
+        frame.vals[i] = args[i];
+        frame.is_set[i] = 1;
+    }
+
+    /* The return variable is the last name */
+    ok = eval_stmt(&frame, func->sub->tree_data.subprogram_data.statement_list) &&
+        frame.is_set[func->num_names - 1];
+    if(ok)
+        *result = frame.vals[func->num_names - 1];
+
+    free(frame.vals);
+    free(frame.is_set);
+    return ok;
+}
+
+/* Returns 0 if it has to be left for runtime */
+int eval_stmt(EvalFrame_t *frame, struct Statement *stmt)
+{
+    ListNode_t *cur;
+    struct Expression *var;
+    int truth, end, index;
+
+    if(++*frame->steps > EVAL_MAX_STEPS)
+        return 0;
+
+    switch(stmt->type)
+    {
+        case STMT_VAR_ASSIGN:
+            return eval_assign(frame, stmt->stmt_data.var_assign_data.var,
+                stmt->stmt_data.var_assign_data.expr);
+
+        case STMT_COMPOUND_STATEMENT:
+            cur = stmt->stmt_data.compound_statement;
+            while(cur != NULL)
+            {
+                if(!eval_stmt(frame, (struct Statement *)cur->cur))
+                    return 0;
+                cur = cur->next;
+            }
+            return 1;
+
+        case STMT_IF_THEN:
+            if(!eval_relop(frame, stmt->stmt_data.if_then_data.relop_expr, &truth))
+                return 0;
+            if(truth)
+                return eval_stmt(frame, stmt->stmt_data.if_then_data.if_stmt);
+            if(stmt->stmt_data.if_then_data.else_stmt != NULL)
+                return eval_stmt(frame, stmt->stmt_data.if_then_data.else_stmt);
+            return 1;
+
+        case STMT_WHILE:
+            while(1)
+            {
+                if(!eval_relop(frame, stmt->stmt_data.while_data.relop_expr, &truth))
+                    return 0;
+                if(!truth)
+                    return 1;
+                if(!eval_stmt(frame, stmt->stmt_data.while_data.while_stmt))
+                    return 0;
+            }
+
+        /* NOTE: The end is exclusive and evaluated before every iteration */
+        case STMT_FOR:
+            if(stmt->stmt_data.for_data.for_assign_type == STMT_FOR_ASSIGN_VAR)
+            {
+                if(!eval_stmt(frame, stmt->stmt_data.for_data.for_assign_data.var_assign))
+                    return 0;
+                var = stmt->stmt_data.for_data.for_assign_data.var_assign->
+                    stmt_data.var_assign_data.var;
+            }
+            else
+            {
+                var = stmt->stmt_data.for_data.for_assign_data.var;
+            }
+
+            index = eval_name_index(frame->func, var->expr_data.id);
+            assert(index >= 0);
+            while(1)
+            {
+                if(!frame->is_set[index] || !eval_expr(frame, stmt->stmt_data.for_data.to, &end))
+                    return 0;
+                if(frame->vals[index] >= end)
+                    return 1;
+                if(!eval_stmt(frame, stmt->stmt_data.for_data.do_for))
+                    return 0;
+                if(!frame->is_set[index] || ++*frame->steps > EVAL_MAX_STEPS)
+                    return 0;
+                frame->vals[index] = (int)((unsigned int)frame->vals[index] + 1);
+            }
+
+        default:
+            return 0;
+    }
+}
+
+int eval_assign(EvalFrame_t *frame, struct Expression *var, struct Expression *expr)
+{
+    int index, val;
+
+    if(!eval_expr(frame, expr, &val))
+        return 0;
+
+    index = eval_name_index(frame->func, var->expr_data.id);
+    assert(index >= 0);
+    frame->vals[index] = val;
+    frame->is_set[index] = 1;
+    return 1;
+}
+
+/* Returns 0 if it has to be left for runtime */
+int eval_expr(EvalFrame_t *frame, struct Expression *expr, int *val)
+{
+    int index, left, right;
+
+    switch(expr->type)
+    {
+        case EXPR_INUM:
+            *val = expr->expr_data.i_num;
+            return 1;
+
+        /* Reading garbage is left for runtime */
+        case EXPR_VAR_ID:
+            index = eval_name_index(frame->func, expr->expr_data.id);
+            assert(index >= 0);
+            if(!frame->is_set[index])
+                return 0;
+            *val = frame->vals[index];
+            return 1;
+
+        case EXPR_SIGN_TERM:
+            if(!eval_expr(frame, expr->expr_data.sign_term, &left))
+                return 0;
+            *val = (int)(0U - (unsigned int)left);
+            return 1;
+
+        case EXPR_ADDOP:
+            return eval_expr(frame, expr->expr_data.addop_data.left_expr, &left) &&
+                eval_expr(frame, expr->expr_data.addop_data.right_term, &right) &&
+                fold_int_op(expr->expr_data.addop_data.addop_type, left, right, val);
+
+        case EXPR_MULOP:
+            return eval_expr(frame, expr->expr_data.mulop_data.left_term, &left) &&
+                eval_expr(frame, expr->expr_data.mulop_data.right_factor, &right) &&
+                fold_int_op(expr->expr_data.mulop_data.mulop_type, left, right, val);
+
+        case EXPR_FUNCTION_CALL:
+            return eval_call(frame, expr, val);
+
+        default:
+            return 0;
+    }
+}
+
+/* NOTE: Both sides of and and or are evaluated, so one that traps is never skipped */
+int eval_relop(EvalFrame_t *frame, struct Expression *expr, int *truth)
+{
+    int left, right;
+
+    assert(expr->type == EXPR_RELOP);
+
+    switch(expr->expr_data.relop_data.type)
+    {
+        case NOT:
+            if(!eval_relop(frame, expr->expr_data.relop_data.left, &left))
+                return 0;
+            *truth = !left;
+            return 1;
+
+        case AND:
+        case OR:
+            if(!eval_relop(frame, expr->expr_data.relop_data.left, &left) ||
+                !eval_relop(frame, expr->expr_data.relop_data.right, &right))
+            {
+                return 0;
+            }
+            *truth = (expr->expr_data.relop_data.type == AND) ? (left && right) :
+                (left || right);
+            return 1;
+
+        default:
+            break;
+    }
+
+    if(!eval_expr(frame, expr->expr_data.relop_data.left, &left) ||
+        !eval_expr(frame, expr->expr_data.relop_data.right, &right))
+    {
+        return 0;
+    }
+
+    switch(expr->expr_data.relop_data.type)
+    {
+        case EQ:
+            *truth = (left == right);
+            return 1;
+        case NE:
+            *truth = (left != right);
+            return 1;
+        case LT:
+            *truth = (left < right);
+            return 1;
+        case LE:
+            *truth = (left <= right);
+            return 1;
+        case GT:
+            *truth = (left > right);
+            return 1;
+        case GE:
+            *truth = (left >= right);
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* A call made from a running function, to one of its callees */
+int eval_call(EvalFrame_t *frame, struct Expression *call, int *val)
+{
+    EvalFunc_t *callee;
+    ListNode_t *cur;
+    int i, ok, index, num_args, *args;
+
+    if(frame->depth >= EVAL_MAX_DEPTH)
+        return 0;
+
+    index = -1;
+    for(i = 0; i < frame->func->num_callees && index < 0; ++i)
+    {
+        callee = &eval_funcs[frame->func->callees[i]];
+        if(strcmp(callee->sub->tree_data.subprogram_data.id,
+            call->expr_data.function_call_data.id) == 0)
+        {
+            index = frame->func->callees[i];
+        }
+    }
+    assert(index >= 0);
+    callee = &eval_funcs[index];
+
+    num_args = 0;
+    for(cur = call->expr_data.function_call_data.args_expr; cur != NULL; cur = cur->next)
+        ++num_args;
+    if(num_args != callee->num_args)
+        return 0;
+
+    args = (int *)malloc((num_args + 1) * sizeof(int));
+    assert(args != NULL);
+
+    ok = 1;
+    cur = call->expr_data.function_call_data.args_expr;
+    for(i = 0; i < num_args && ok; ++i)
+    {
+        ok = eval_expr(frame, (struct Expression *)cur->cur, &args[i]);
+        cur = cur->next;
+    }
+
+    if(ok)
+        ok = eval_run(index, args, val, frame->steps, frame->depth + 1);
+
+    free(args);
+    return ok;
+}
+
+/******** REPLACING CALLS ********/
+
+int eval_calls(struct Statement *body)
+{
+    int num_evaluated;
+
+    if(body == NULL)
+        return 0;
+
+    num_evaluated = 0;
+    eval_calls_stmt(body, &num_evaluated);
+    return num_evaluated;
+}
+
+void eval_calls_stmt(struct Statement *stmt, int *num_evaluated)
+{
+    ListNode_t *cur;
+    struct Expression *var;
+
+    switch(stmt->type)
+    {
+        case STMT_VAR_ASSIGN:
+            var = stmt->stmt_data.var_assign_data.var;
+            if(var->type == EXPR_ARRAY_ACCESS)
+                eval_calls_expr(&var->expr_data.array_access_data.array_expr, num_evaluated);
+            eval_calls_expr(&stmt->stmt_data.var_assign_data.expr, num_evaluated);
+            break;
+
+        case STMT_PROCEDURE_CALL:
+            cur = stmt->stmt_data.procedure_call_data.expr_args;
+            while(cur != NULL)
+            {
+                eval_calls_expr((struct Expression **)&cur->cur, num_evaluated);
+                cur = cur->next;
+            }
+            break;
+
+        case STMT_COMPOUND_STATEMENT:
+            cur = stmt->stmt_data.compound_statement;
+            while(cur != NULL)
+            {
+                eval_calls_stmt((struct Statement *)cur->cur, num_evaluated);
+                cur = cur->next;
+            }
+            break;
+
+        case STMT_IF_THEN:
+            eval_calls_expr(&stmt->stmt_data.if_then_data.relop_expr, num_evaluated);
+            eval_calls_stmt(stmt->stmt_data.if_then_data.if_stmt, num_evaluated);
+            if(stmt->stmt_data.if_then_data.else_stmt != NULL)
+                eval_calls_stmt(stmt->stmt_data.if_then_data.else_stmt, num_evaluated);
+            break;
+
+        case STMT_WHILE:
+            eval_calls_expr(&stmt->stmt_data.while_data.relop_expr, num_evaluated);
+            eval_calls_stmt(stmt->stmt_data.while_data.while_stmt, num_evaluated);
+            break;
+
+        case STMT_FOR:
+            if(stmt->stmt_data.for_data.for_assign_type == STMT_FOR_ASSIGN_VAR)
+                eval_calls_stmt(stmt->stmt_data.for_data.for_assign_data.var_assign,
+                    num_evaluated);
+            eval_calls_expr(&stmt->stmt_data.for_data.to, num_evaluated);
+            eval_calls_stmt(stmt->stmt_data.for_data.do_for, num_evaluated);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Arguments first, so calls nested in them can turn into numbers too */
+void eval_calls_expr(struct Expression **expr, int *num_evaluated)
+{
+    ListNode_t *cur;
+    int index, num_args, steps, result, ok, i, *args;
+
+    switch((*expr)->type)
+    {
+        case EXPR_RELOP:
+            eval_calls_expr(&(*expr)->expr_data.relop_data.left, num_evaluated);
+            if((*expr)->expr_data.relop_data.right != NULL)
+                eval_calls_expr(&(*expr)->expr_data.relop_data.right, num_evaluated);
+            return;
+
+        case EXPR_SIGN_TERM:
+            eval_calls_expr(&(*expr)->expr_data.sign_term, num_evaluated);
+            return;
+
+        case EXPR_ADDOP:
+            eval_calls_expr(&(*expr)->expr_data.addop_data.left_expr, num_evaluated);
+            eval_calls_expr(&(*expr)->expr_data.addop_data.right_term, num_evaluated);
+            return;
+
+        case EXPR_MULOP:
+            eval_calls_expr(&(*expr)->expr_data.mulop_data.left_term, num_evaluated);
+            eval_calls_expr(&(*expr)->expr_data.mulop_data.right_factor, num_evaluated);
+            return;
+
+        case EXPR_ARRAY_ACCESS:
+            eval_calls_expr(&(*expr)->expr_data.array_access_data.array_expr, num_evaluated);
+            return;
+
+        case EXPR_FUNCTION_CALL:
+            break;
+
+        default:
+            return;
+    }
+
+    num_args = 0;
+    ok = 1;
+    cur = (*expr)->expr_data.function_call_data.args_expr;
+    while(cur != NULL)
+    {
+        eval_calls_expr((struct Expression **)&cur->cur, num_evaluated);
+        if(((struct Expression *)cur->cur)->type != EXPR_INUM)
+            ok = 0;
+        ++num_args;
+        cur = cur->next;
+    }
+
+    index = eval_lookup((*expr)->expr_data.function_call_data.id);
+    if(!ok || index < 0 || !eval_funcs[index].pure || eval_funcs[index].num_args != num_args)
+        return;
+
+    args = (int *)malloc((num_args + 1) * sizeof(int));
+    assert(args != NULL);
+    cur = (*expr)->expr_data.function_call_data.args_expr;
+    for(i = 0; i < num_args; ++i)
+    {
+        args[i] = ((struct Expression *)cur->cur)->expr_data.i_num;
+        cur = cur->next;
+    }
+
+    steps = 0;
+    ok = eval_run(index, args, &result, &steps, 0);
+    free(args);
+    if(!ok)
+        return;
+
+    #ifdef DEBUG_OPTIMIZER
+        fprintf(stderr, "OPTIMIZER: Evaluated call to %s on line %d to %d\n",
+            (*expr)->expr_data.function_call_data.id, (*expr)->line_num, result);
+    #endif
+
+    i = (*expr)->line_num;
+    destroy_expr(*expr);
+    *expr = mk_inum(i, result);
+    ++*num_evaluated;
+}
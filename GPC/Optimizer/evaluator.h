@@ -0,0 +1,40 @@
+/*
+    Damon Gwinn
+    Compile-time evaluator for pure functions
+
+    Every subprogram is registered once it has been optimized, like for the inliner.
+    A function is pure when it returns an integer and its body only touches its own
+    arguments, locals and return variable (integers only), calling nothing but itself
+    and pure functions it can see. Calls to a pure function whose arguments are all
+    numbers are run by a small interpreter over the parse tree and replaced by the
+    number returned.
+
+    The interpreter gives up (leaving the call for runtime) when the body:
+        - Reads a variable before assigning it, or returns without assigning the result
+        - Divides by zero (or INT_MIN by -1)
+        - Runs more than EVAL_MAX_STEPS statements and loop iterations in total, or
+            recurses deeper than EVAL_MAX_DEPTH
+    Arithmetic wraps around like the generated code does.
+*/
+
+#ifndef EVALUATOR_H
+#define EVALUATOR_H
+
+#include "../Parser/ParseTree/tree.h"
+#include "../Parser/ParseTree/tree_types.h"
+
+/* Most work done for one call made with numbers */
+#define EVAL_MAX_STEPS 100000
+#define EVAL_MAX_DEPTH 200
+
+/* Makes sub callable from later bodies (and forgets what was nested in it) */
+void eval_register(Tree_t *sub);
+
+/* Forgets every subprogram in the list */
+void eval_unregister(ListNode_t *subprograms);
+
+/* Replaces calls to pure functions made with numbers in body by their result */
+/* Returns how many calls were replaced */
+int eval_calls(struct Statement *body);
+
+#endif
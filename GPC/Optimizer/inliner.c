@@ -0,0 +1,811 @@
+/*
+    Damon Gwinn
+    Inliner for small leaf subprograms
+
+    See inliner.h
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include "inliner.h"
+#include "optimizer.h"
+#include "../Parser/List/List.h"
+#include "../Parser/ParseTree/tree.h"
+#include "../Parser/ParseTree/tree_types.h"
+#include "../Parser/LexAndYacc/y.tab.h"
+
+/* A registered subprogram */
+typedef struct InlineSub
+{
+    Tree_t *sub;
+    int cost; /* -1 when it can't be inlined */
+
+    int num_args;
+    int num_names;
+    char **names; /* Arguments, then locals, then the return variable */
+} InlineSub_t;
+
+/* One call being inlined */
+typedef struct InlineSite
+{
+    InlineSub_t *callee;
+    char **new_names; /* Matching callee->names */
+} InlineSite_t;
+
+typedef struct Inliner
+{
+    ListNode_t **decls;
+    char *self_id;
+    ListHandle_t pre; /* Inlined function bodies to run before the current statement */
+    int num_inlined;
+} Inliner_t;
+
+/* Subprograms visible to the body being optimized, innermost last */
+int num_inline_subs = 0;
+int max_inline_subs = 0;
+InlineSub_t *inline_subs = NULL;
+
+/* Numbers the inlined calls to keep their locals apart */
+int num_inline_sites = 0;
+
+void inline_add_name(InlineSub_t *entry, char *id);
+int inline_name_index(InlineSub_t *entry, char *id);
+int inline_cost_stmt(InlineSub_t *entry, struct Statement *stmt);
+int inline_cost_expr(InlineSub_t *entry, struct Expression *expr);
+int inline_add_cost(int a, int b);
+
+InlineSub_t *inline_lookup(Inliner_t *inl, char *id, ListNode_t *args);
+struct Statement *inline_expand(Inliner_t *inl, InlineSub_t *callee, ListNode_t *args,
+    int line_num, char **ret_id);
+struct Statement *inline_copy_stmt(InlineSite_t *site, struct Statement *stmt);
+struct Expression *inline_copy_expr(InlineSite_t *site, struct Expression *expr);
+char *inline_rename(InlineSite_t *site, char *id);
+
+void inline_stmt(Inliner_t *inl, struct Statement **stmt);
+void inline_expr(Inliner_t *inl, struct Expression **expr);
+void inline_wrap(Inliner_t *inl, struct Statement **stmt);
+void inline_wrap_loop(Inliner_t *inl, struct Statement **stmt, struct Statement **body);
+char *inline_for_var(struct Statement *for_stmt);
+int inline_reads_var(struct Expression *expr, char *id);
+
+/******** REGISTRY ********/
+
+void inline_register(Tree_t *sub)
+{
+    assert(sub != NULL);
+    assert(sub->type == TREE_SUBPROGRAM);
+
+    struct Subprogram *sub_data;
+    InlineSub_t *entry;
+    ListNode_t *decls, *ids;
+    Tree_t *decl;
+    int pass;
+
+    sub_data = &sub->tree_data.subprogram_data;
+
+    /* What was nested in sub can't be called from outside of it */
+    inline_unregister(sub_data->subprograms);
+
+    if(num_inline_subs == max_inline_subs)
+    {
+        max_inline_subs = (max_inline_subs == 0) ? 8 : max_inline_subs * 2;
+        inline_subs = (InlineSub_t *)realloc(inline_subs,
+            max_inline_subs * sizeof(InlineSub_t));
+        assert(inline_subs != NULL);
+    }
+
+    entry = &inline_subs[num_inline_subs++];
+    entry->sub = sub;
+    entry->cost = 0;
+    entry->num_args = 0;
+    entry->num_names = 0;
+    entry->names = NULL;
+
+    if(sub_data->subprograms != NULL || sub_data->statement_list == NULL ||
+        (sub_data->sub_type == TREE_SUBPROGRAM_FUNC && sub_data->return_type != INT_TYPE))
+    {
+        entry->cost = -1;
+    }
+
+    /* Arguments, then locals */
+    for(pass = 0; pass < 2; ++pass)
+    {
+        decls = (pass == 0) ? sub_data->args_var : sub_data->declarations;
+        while(decls != NULL)
+        {
+            decl = (Tree_t *)decls->cur;
+            if(decl->type != TREE_VAR_DECL || decl->tree_data.var_decl_data.type != INT_TYPE)
+                entry->cost = -1;
+
+            ids = (decl->type == TREE_VAR_DECL) ? decl->tree_data.var_decl_data.ids :
+                decl->tree_data.arr_decl_data.ids;
+            while(ids != NULL)
+            {
+                inline_add_name(entry, (char *)ids->cur);
+                ids = ids->next;
+            }
+
+            decls = decls->next;
+        }
+
+        if(pass == 0)
+            entry->num_args = entry->num_names;
+    }
+
+    if(sub_data->sub_type == TREE_SUBPROGRAM_FUNC)
+        inline_add_name(entry, sub_data->id);
+
+    if(entry->cost == 0)
+        entry->cost = inline_cost_stmt(entry, sub_data->statement_list);
+}
+
+void inline_unregister(ListNode_t *subprograms)
+{
+    int i, j;
+
+    while(subprograms != NULL)
+    {
+        for(i = 0; i < num_inline_subs; ++i)
+        {
+            if(inline_subs[i].sub != (Tree_t *)subprograms->cur)
+                continue;
+
+            free(inline_subs[i].names);
+            for(j = i + 1; j < num_inline_subs; ++j)
+                inline_subs[j - 1] = inline_subs[j];
+            --num_inline_subs;
+            break;
+        }
+
+        subprograms = subprograms->next;
+    }
+}
+
+void inline_add_name(InlineSub_t *entry, char *id)
+{
+    entry->names = (char **)realloc(entry->names, (entry->num_names + 1) * sizeof(char *));
+    assert(entry->names != NULL);
+    entry->names[entry->num_names++] = id;
+}
+
+/* -1 if id is not one of the subprogram's own names */
+int inline_name_index(InlineSub_t *entry, char *id)
+{
+    int i;
+
+    for(i = 0; i < entry->num_names; ++i)
+        if(strcmp(entry->names[i], id) == 0)
+            return i;
+
+    return -1;
+}
+
+int inline_add_cost(int a, int b)
+{
+    if(a < 0 || b < 0)
+        return -1;
+
+    return a + b;
+}
+
+/* Size of a statement, -1 if it keeps its subprogram from being inlined */
+int inline_cost_stmt(InlineSub_t *entry, struct Statement *stmt)
+{
+    ListNode_t *cur;
+    struct Expression *var;
+    int cost;
+
+    cost = 1;
+    switch(stmt->type)
+    {
+        case STMT_VAR_ASSIGN:
+            cost = inline_add_cost(cost, inline_cost_expr(entry, stmt->stmt_data.var_assign_data.var));
+            cost = inline_add_cost(cost, inline_cost_expr(entry, stmt->stmt_data.var_assign_data.expr));
+            break;
+
+        case STMT_PROCEDURE_CALL:
+            if(strcmp(stmt->stmt_data.procedure_call_data.id, "write") != 0 &&
+                strcmp(stmt->stmt_data.procedure_call_data.id, "read") != 0)
+            {
+                return -1;
+            }
+
+            cur = stmt->stmt_data.procedure_call_data.expr_args;
+            while(cur != NULL)
+            {
+                cost = inline_add_cost(cost, inline_cost_expr(entry, (struct Expression *)cur->cur));
+                cur = cur->next;
+            }
+            break;
+
+        case STMT_COMPOUND_STATEMENT:
+            cur = stmt->stmt_data.compound_statement;
+            while(cur != NULL)
+            {
+                cost = inline_add_cost(cost, inline_cost_stmt(entry, (struct Statement *)cur->cur));
+                cur = cur->next;
+            }
+            break;
+
+        case STMT_IF_THEN:
+            cost = inline_add_cost(cost, inline_cost_expr(entry, stmt->stmt_data.if_then_data.relop_expr));
+            cost = inline_add_cost(cost, inline_cost_stmt(entry, stmt->stmt_data.if_then_data.if_stmt));
+            if(stmt->stmt_data.if_then_data.else_stmt != NULL)
+                cost = inline_add_cost(cost,
+                    inline_cost_stmt(entry, stmt->stmt_data.if_then_data.else_stmt));
+            break;
+
+        case STMT_WHILE:
+            cost = inline_add_cost(cost, inline_cost_expr(entry, stmt->stmt_data.while_data.relop_expr));
+            cost = inline_add_cost(cost, inline_cost_stmt(entry, stmt->stmt_data.while_data.while_stmt));
+            break;
+
+        case STMT_FOR:
+            if(stmt->stmt_data.for_data.for_assign_type == STMT_FOR_ASSIGN_VAR)
+            {
+                cost = inline_add_cost(cost,
+                    inline_cost_stmt(entry, stmt->stmt_data.for_data.for_assign_data.var_assign));
+            }
+            else
+            {
+                var = stmt->stmt_data.for_data.for_assign_data.var;
+                cost = inline_add_cost(cost, inline_cost_expr(entry, var));
+            }
+            cost = inline_add_cost(cost, inline_cost_expr(entry, stmt->stmt_data.for_data.to));
+            cost = inline_add_cost(cost, inline_cost_stmt(entry, stmt->stmt_data.for_data.do_for));
+            break;
+
+        default:
+            return -1;
+    }
+
+    return cost;
+}
+
+/* Size of an expression, -1 if it keeps its subprogram from being inlined */
+int inline_cost_expr(InlineSub_t *entry, struct Expression *expr)
+{
+    int cost;
+
+    cost = 1;
+    switch(expr->type)
+    {
+        case EXPR_INUM:
+            break;
+
+        case EXPR_VAR_ID:
+            if(inline_name_index(entry, expr->expr_data.id) < 0)
+                return -1;
+            break;
+
+        case EXPR_RELOP:
+            cost = inline_add_cost(cost, inline_cost_expr(entry, expr->expr_data.relop_data.left));
+            if(expr->expr_data.relop_data.right != NULL)
+                cost = inline_add_cost(cost,
+                    inline_cost_expr(entry, expr->expr_data.relop_data.right));
+            break;
+
+        case EXPR_SIGN_TERM:
+            cost = inline_add_cost(cost, inline_cost_expr(entry, expr->expr_data.sign_term));
+            break;
+
+        case EXPR_ADDOP:
+            cost = inline_add_cost(cost, inline_cost_expr(entry, expr->expr_data.addop_data.left_expr));
+            cost = inline_add_cost(cost, inline_cost_expr(entry, expr->expr_data.addop_data.right_term));
+            break;
+
+        case EXPR_MULOP:
+            cost = inline_add_cost(cost, inline_cost_expr(entry, expr->expr_data.mulop_data.left_term));
+            cost = inline_add_cost(cost,
+                inline_cost_expr(entry, expr->expr_data.mulop_data.right_factor));
+            break;
+
+        /* Arrays, reals and calls (not a leaf) */
+        default:
+            return -1;
+    }
+
+    return cost;
+}
+
+/******** INLINING ********/
+
+int inline_calls(ListNode_t **decls, struct Statement **body, char *self_id)
+{
+    Inliner_t inl;
+
+    if(*body == NULL)
+        return 0;
+
+    inl.decls = decls;
+    inl.self_id = self_id;
+    inl.num_inlined = 0;
+    InitListHandle(&inl.pre);
+
+    inline_stmt(&inl, body);
+
+    return inl.num_inlined;
+}
+
+/* The subprogram a call to id with args would inline, NULL if none */
+InlineSub_t *inline_lookup(Inliner_t *inl, char *id, ListNode_t *args)
+{
+    InlineSub_t *entry;
+    int i, num_args;
+
+    if(inl->self_id != NULL && strcmp(inl->self_id, id) == 0)
+        return NULL;
+
+    /* Innermost declaration wins */
+    for(i = num_inline_subs - 1; i >= 0; --i)
+    {
+        entry = &inline_subs[i];
+        if(strcmp(entry->sub->tree_data.subprogram_data.id, id) != 0)
+            continue;
+
+        if(entry->cost < 0 || entry->cost > INLINE_MAX_COST)
+            return NULL;
+
+        num_args = 0;
+        while(args != NULL)
+        {
+            ++num_args;
+            args = args->next;
+        }
+
+        return (num_args == entry->num_args) ? entry : NULL;
+    }
+
+    return NULL;
+}
+
+/* Copy of the callee's body run on args (which it takes over) */
+/* ret_id is set to the local holding a function's result */
+struct Statement *inline_expand(Inliner_t *inl, InlineSub_t *callee, ListNode_t *args,
+    int line_num, char **ret_id)
+{
+    InlineSite_t site;
+    ListHandle_t stmts;
+    Tree_t *decl;
+    char name[64];
+    int i;
+
+    #ifdef DEBUG_OPTIMIZER
+        fprintf(stderr, "OPTIMIZER: Inlining %s on line %d\n",
+            callee->sub->tree_data.subprogram_data.id, line_num);
+    #endif
+
+    site.callee = callee;
+    site.new_names = (char **)malloc(callee->num_names * sizeof(char *));
+    assert(site.new_names != NULL);
+
+    /* NOTE: '$' can't appear in a Pascal identifier, so these never clash */
+    for(i = 0; i < callee->num_names; ++i)
+    {
+        snprintf(name, sizeof(name), "$inl%d_%.40s", num_inline_sites, callee->names[i]);
+        site.new_names[i] = tree_strdup(name);
+
+        decl = mk_vardecl(line_num, mk_listnode(tree_strdup(name), LIST_STRING), INT_TYPE);
+        if(*inl->decls == NULL)
+            *inl->decls = mk_listnode(decl, LIST_TREE);
+        else
+            PushListNodeBack(*inl->decls, mk_listnode(decl, LIST_TREE));
+    }
+    ++num_inline_sites;
+
+    /* Arguments are passed by value */
+    InitListHandle(&stmts);
+    for(i = 0; i < callee->num_args; ++i)
+    {
+        assert(args != NULL);
+        PushListHandleBack(&stmts, mk_listnode(mk_varassign(line_num,
+            mk_varid(line_num, tree_strdup(site.new_names[i])), (struct Expression *)args->cur),
+            LIST_STMT));
+        args = args->next;
+    }
+
+    PushListHandleBack(&stmts, mk_listnode(inline_copy_stmt(&site,
+        callee->sub->tree_data.subprogram_data.statement_list), LIST_STMT));
+
+    if(ret_id != NULL)
+        *ret_id = site.new_names[callee->num_names - 1];
+
+    free(site.new_names);
+    ++inl->num_inlined;
+
+    return mk_compoundstatement(line_num, stmts.head);
+}
+
+/* NOTE: A NULL site copies without renaming */
+char *inline_rename(InlineSite_t *site, char *id)
+{
+    int index;
+
+    if(site == NULL)
+        return tree_strdup(id);
+
+    index = inline_name_index(site->callee, id);
+    assert(index >= 0);
+
+    return tree_strdup(site->new_names[index]);
+}
+
+struct Statement *inline_copy_stmt(InlineSite_t *site, struct Statement *stmt)
+{
+    ListHandle_t list;
+    ListNode_t *cur;
+    struct Statement *else_stmt;
+
+    switch(stmt->type)
+    {
+        case STMT_VAR_ASSIGN:
+            return mk_varassign(stmt->line_num,
+                inline_copy_expr(site, stmt->stmt_data.var_assign_data.var),
+                inline_copy_expr(site, stmt->stmt_data.var_assign_data.expr));
+
+        case STMT_PROCEDURE_CALL:
+            InitListHandle(&list);
+            cur = stmt->stmt_data.procedure_call_data.expr_args;
+            while(cur != NULL)
+            {
+                PushListHandleBack(&list, mk_listnode(inline_copy_expr(site,
+                    (struct Expression *)cur->cur), LIST_EXPR));
+                cur = cur->next;
+            }
+            return mk_procedurecall(stmt->line_num,
+                tree_strdup(stmt->stmt_data.procedure_call_data.id), list.head);
+
+        case STMT_COMPOUND_STATEMENT:
+            InitListHandle(&list);
+            cur = stmt->stmt_data.compound_statement;
+            while(cur != NULL)
+            {
+                PushListHandleBack(&list, mk_listnode(inline_copy_stmt(site,
+                    (struct Statement *)cur->cur), LIST_STMT));
+                cur = cur->next;
+            }
+            return mk_compoundstatement(stmt->line_num, list.head);
+
+        case STMT_IF_THEN:
+            else_stmt = stmt->stmt_data.if_then_data.else_stmt;
+            return mk_ifthen(stmt->line_num,
+                inline_copy_expr(site, stmt->stmt_data.if_then_data.relop_expr),
+                inline_copy_stmt(site, stmt->stmt_data.if_then_data.if_stmt),
+                (else_stmt == NULL) ? NULL : inline_copy_stmt(site, else_stmt));
+
+        case STMT_WHILE:
+            return mk_while(stmt->line_num,
+                inline_copy_expr(site, stmt->stmt_data.while_data.relop_expr),
+                inline_copy_stmt(site, stmt->stmt_data.while_data.while_stmt));
+
+        case STMT_FOR:
+            if(stmt->stmt_data.for_data.for_assign_type == STMT_FOR_ASSIGN_VAR)
+            {
+                return mk_forassign(stmt->line_num,
+                    inline_copy_stmt(site, stmt->stmt_data.for_data.for_assign_data.var_assign),
+                    inline_copy_expr(site, stmt->stmt_data.for_data.to),
+                    inline_copy_stmt(site, stmt->stmt_data.for_data.do_for));
+            }
+            return mk_forvar(stmt->line_num,
+                inline_copy_expr(site, stmt->stmt_data.for_data.for_assign_data.var),
+                inline_copy_expr(site, stmt->stmt_data.for_data.to),
+                inline_copy_stmt(site, stmt->stmt_data.for_data.do_for));
+
+        default:
+            assert(0 && "Bad statement type");
+            return NULL;
+    }
+}
+
+struct Expression *inline_copy_expr(InlineSite_t *site, struct Expression *expr)
+{
+    struct Expression *right;
+    ListHandle_t args;
+    ListNode_t *cur;
+
+    switch(expr->type)
+    {
+        case EXPR_INUM:
+            return mk_inum(expr->line_num, expr->expr_data.i_num);
+
+        case EXPR_VAR_ID:
+            return mk_varid(expr->line_num, inline_rename(site, expr->expr_data.id));
+
+        case EXPR_RELOP:
+            right = expr->expr_data.relop_data.right;
+            return mk_relop(expr->line_num, expr->expr_data.relop_data.type,
+                inline_copy_expr(site, expr->expr_data.relop_data.left),
+                (right == NULL) ? NULL : inline_copy_expr(site, right));
+
+        case EXPR_SIGN_TERM:
+            return mk_signterm(expr->line_num, inline_copy_expr(site, expr->expr_data.sign_term));
+
+        case EXPR_ADDOP:
+            return mk_addop(expr->line_num, expr->expr_data.addop_data.addop_type,
+                inline_copy_expr(site, expr->expr_data.addop_data.left_expr),
+                inline_copy_expr(site, expr->expr_data.addop_data.right_term));
+
+        case EXPR_MULOP:
+            return mk_mulop(expr->line_num, expr->expr_data.mulop_data.mulop_type,
+                inline_copy_expr(site, expr->expr_data.mulop_data.left_term),
+                inline_copy_expr(site, expr->expr_data.mulop_data.right_factor));
+
+        case EXPR_ARRAY_ACCESS:
+            return mk_arrayaccess(expr->line_num,
+                inline_rename(site, expr->expr_data.array_access_data.id),
+                inline_copy_expr(site, expr->expr_data.array_access_data.array_expr));
+
+        case EXPR_FUNCTION_CALL:
+            InitListHandle(&args);
+            cur = expr->expr_data.function_call_data.args_expr;
+            while(cur != NULL)
+            {
+                PushListHandleBack(&args, mk_listnode(inline_copy_expr(site,
+                    (struct Expression *)cur->cur), LIST_EXPR));
+                cur = cur->next;
+            }
+            return mk_functioncall(expr->line_num,
+                tree_strdup(expr->expr_data.function_call_data.id), args.head);
+
+        case EXPR_RNUM:
+            return mk_rnum(expr->line_num, expr->expr_data.r_num);
+
+        default:
+            assert(0 && "Bad expression type");
+            return NULL;
+    }
+}
+
+/* Places the inlined function bodies gathered for a statement in front of it */
+void inline_wrap(Inliner_t *inl, struct Statement **stmt)
+{
+    if(inl->pre.head == NULL)
+        return;
+
+    PushListHandleBack(&inl->pre, mk_listnode(*stmt, LIST_STMT));
+    *stmt = mk_compoundstatement((*stmt)->line_num, inl->pre.head);
+    InitListHandle(&inl->pre);
+}
+
+/* Same for a loop test evaluated every iteration: the bodies also rerun at the end of the loop body */
+void inline_wrap_loop(Inliner_t *inl, struct Statement **stmt, struct Statement **body)
+{
+    ListHandle_t again;
+    ListNode_t *cur;
+
+    if(inl->pre.head == NULL)
+        return;
+
+    InitListHandle(&again);
+    PushListHandleBack(&again, mk_listnode(*body, LIST_STMT));
+    for(cur = inl->pre.head; cur != NULL; cur = cur->next)
+        PushListHandleBack(&again, mk_listnode(inline_copy_stmt(NULL,
+            (struct Statement *)cur->cur), LIST_STMT));
+    *body = mk_compoundstatement((*body)->line_num, again.head);
+
+    inline_wrap(inl, stmt);
+}
+
+char *inline_for_var(struct Statement *for_stmt)
+{
+    if(for_stmt->stmt_data.for_data.for_assign_type == STMT_FOR_ASSIGN_VAR)
+        return for_stmt->stmt_data.for_data.for_assign_data.var_assign->
+            stmt_data.var_assign_data.var->expr_data.id;
+
+    return for_stmt->stmt_data.for_data.for_assign_data.var->expr_data.id;
+}
+
+/* Whether evaluating expr reads the variable id */
+int inline_reads_var(struct Expression *expr, char *id)
+{
+    ListNode_t *cur;
+
+    switch(expr->type)
+    {
+        case EXPR_VAR_ID:
+            return strcmp(expr->expr_data.id, id) == 0;
+
+        case EXPR_RELOP:
+            return inline_reads_var(expr->expr_data.relop_data.left, id) ||
+                (expr->expr_data.relop_data.right != NULL &&
+                inline_reads_var(expr->expr_data.relop_data.right, id));
+
+        case EXPR_SIGN_TERM:
+            return inline_reads_var(expr->expr_data.sign_term, id);
+
+        case EXPR_ADDOP:
+            return inline_reads_var(expr->expr_data.addop_data.left_expr, id) ||
+                inline_reads_var(expr->expr_data.addop_data.right_term, id);
+
+        case EXPR_MULOP:
+            return inline_reads_var(expr->expr_data.mulop_data.left_term, id) ||
+                inline_reads_var(expr->expr_data.mulop_data.right_factor, id);
+
+        case EXPR_ARRAY_ACCESS:
+            return inline_reads_var(expr->expr_data.array_access_data.array_expr, id);
+
+        case EXPR_FUNCTION_CALL:
+            for(cur = expr->expr_data.function_call_data.args_expr; cur != NULL; cur = cur->next)
+                if(inline_reads_var((struct Expression *)cur->cur, id))
+                    return 1;
+            return 0;
+
+        default:
+            return 0;
+    }
+}
+
+void inline_stmt(Inliner_t *inl, struct Statement **stmt)
+{
+    struct Statement *cur_stmt, *init;
+    struct Expression *var;
+    InlineSub_t *callee;
+    ListNode_t *cur;
+
+    cur_stmt = *stmt;
+    InitListHandle(&inl->pre);
+    switch(cur_stmt->type)
+    {
+        case STMT_VAR_ASSIGN:
+            var = cur_stmt->stmt_data.var_assign_data.var;
+            if(var->type == EXPR_ARRAY_ACCESS)
+                inline_expr(inl, &var->expr_data.array_access_data.array_expr);
+            inline_expr(inl, &cur_stmt->stmt_data.var_assign_data.expr);
+            inline_wrap(inl, stmt);
+            break;
+
+        case STMT_PROCEDURE_CALL:
+            if(strcmp(cur_stmt->stmt_data.procedure_call_data.id, "read") == 0)
+                break;
+
+            cur = cur_stmt->stmt_data.procedure_call_data.expr_args;
+            while(cur != NULL)
+            {
+                inline_expr(inl, (struct Expression **)&cur->cur);
+                cur = cur->next;
+            }
+
+            callee = inline_lookup(inl, cur_stmt->stmt_data.procedure_call_data.id,
+                cur_stmt->stmt_data.procedure_call_data.expr_args);
+            if(callee != NULL && callee->sub->tree_data.subprogram_data.sub_type ==
+                TREE_SUBPROGRAM_PROC)
+            {
+                *stmt = inline_expand(inl, callee,
+                    cur_stmt->stmt_data.procedure_call_data.expr_args, cur_stmt->line_num, NULL);
+            }
+            inline_wrap(inl, stmt);
+            break;
+
+        case STMT_COMPOUND_STATEMENT:
+            cur = cur_stmt->stmt_data.compound_statement;
+            while(cur != NULL)
+            {
+                inline_stmt(inl, (struct Statement **)&cur->cur);
+                cur = cur->next;
+            }
+            break;
+
+        case STMT_IF_THEN:
+            inline_expr(inl, &cur_stmt->stmt_data.if_then_data.relop_expr);
+            inline_wrap(inl, stmt);
+
+            inline_stmt(inl, &cur_stmt->stmt_data.if_then_data.if_stmt);
+            if(cur_stmt->stmt_data.if_then_data.else_stmt != NULL)
+                inline_stmt(inl, &cur_stmt->stmt_data.if_then_data.else_stmt);
+            break;
+
+        case STMT_WHILE:
+            inline_stmt(inl, &cur_stmt->stmt_data.while_data.while_stmt);
+
+            InitListHandle(&inl->pre);
+            inline_expr(inl, &cur_stmt->stmt_data.while_data.relop_expr);
+            inline_wrap_loop(inl, stmt, &cur_stmt->stmt_data.while_data.while_stmt);
+            break;
+
+        /* NOTE: The bound is tested every iteration, the for assignment only once */
+        case STMT_FOR:
+            inline_stmt(inl, &cur_stmt->stmt_data.for_data.do_for);
+
+            /* The copy at the end of the body runs before the for variable is bumped */
+            InitListHandle(&inl->pre);
+            if(!inline_reads_var(cur_stmt->stmt_data.for_data.to, inline_for_var(cur_stmt)))
+                inline_expr(inl, &cur_stmt->stmt_data.for_data.to);
+            if(inl->pre.head == NULL)
+            {
+                if(cur_stmt->stmt_data.for_data.for_assign_type == STMT_FOR_ASSIGN_VAR)
+                {
+                    inline_expr(inl, &cur_stmt->stmt_data.for_data.for_assign_data.var_assign->
+                        stmt_data.var_assign_data.expr);
+                    inline_wrap(inl, stmt);
+                }
+                break;
+            }
+
+            inline_wrap_loop(inl, stmt, &cur_stmt->stmt_data.for_data.do_for);
+
+            /* The bound may read the for variable, so the for assignment goes first */
+            if(cur_stmt->stmt_data.for_data.for_assign_type == STMT_FOR_ASSIGN_VAR)
+            {
+                init = cur_stmt->stmt_data.for_data.for_assign_data.var_assign;
+                cur_stmt->stmt_data.for_data.for_assign_data.var = mk_varid(init->line_num,
+                    tree_strdup(inline_for_var(cur_stmt)));
+                cur_stmt->stmt_data.for_data.for_assign_type = STMT_FOR_VAR;
+
+                cur = mk_listnode(init, LIST_STMT);
+                *stmt = mk_compoundstatement(cur_stmt->line_num,
+                    PushListNodeFront(mk_listnode(*stmt, LIST_STMT), cur));
+                inline_stmt(inl, (struct Statement **)&cur->cur);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Replaces function calls in expr, adding their bodies to inl->pre */
+void inline_expr(Inliner_t *inl, struct Expression **expr)
+{
+    InlineSub_t *callee;
+    ListNode_t *cur;
+    char *ret_id;
+
+    switch((*expr)->type)
+    {
+        case EXPR_RELOP:
+            /* The right side may never be evaluated */
+            if((*expr)->expr_data.relop_data.type == AND || (*expr)->expr_data.relop_data.type == OR)
+                return;
+
+            inline_expr(inl, &(*expr)->expr_data.relop_data.left);
+            if((*expr)->expr_data.relop_data.right != NULL)
+                inline_expr(inl, &(*expr)->expr_data.relop_data.right);
+            break;
+
+        case EXPR_SIGN_TERM:
+            inline_expr(inl, &(*expr)->expr_data.sign_term);
+            break;
+
+        case EXPR_ADDOP:
+            inline_expr(inl, &(*expr)->expr_data.addop_data.left_expr);
+            inline_expr(inl, &(*expr)->expr_data.addop_data.right_term);
+            break;
+
+        case EXPR_MULOP:
+            inline_expr(inl, &(*expr)->expr_data.mulop_data.left_term);
+            inline_expr(inl, &(*expr)->expr_data.mulop_data.right_factor);
+            break;
+
+        case EXPR_ARRAY_ACCESS:
+            inline_expr(inl, &(*expr)->expr_data.array_access_data.array_expr);
+            break;
+
+        case EXPR_FUNCTION_CALL:
+            /* Arguments first, so their bodies come first */
+            cur = (*expr)->expr_data.function_call_data.args_expr;
+            while(cur != NULL)
+            {
+                inline_expr(inl, (struct Expression **)&cur->cur);
+                cur = cur->next;
+            }
+
+            callee = inline_lookup(inl, (*expr)->expr_data.function_call_data.id,
+                (*expr)->expr_data.function_call_data.args_expr);
+            if(callee == NULL ||
+                callee->sub->tree_data.subprogram_data.sub_type != TREE_SUBPROGRAM_FUNC)
+            {
+                break;
+            }
+
+            PushListHandleBack(&inl->pre, mk_listnode(inline_expand(inl, callee,
+                (*expr)->expr_data.function_call_data.args_expr, (*expr)->line_num, &ret_id),
+                LIST_STMT));
+            *expr = mk_varid((*expr)->line_num, tree_strdup(ret_id));
+            break;
+
+        default:
+            break;
+    }
+}
@@ -0,0 +1,46 @@
+/*
+    Damon Gwinn
+    Inliner for small leaf subprograms
+
+    Every subprogram is registered once it has been optimized. Bodies optimized after it
+    (its enclosing subprogram, later siblings and the program) get calls to it replaced
+    by a copy of its body when it is small enough and a leaf:
+        - No nested subprograms and no calls other than read and write
+        - Only touches its own arguments, locals and (for functions) its return variable
+        - Integers only, no arrays
+    Such a body can't recurse and can't see the caller's variables, so it is copied with
+    its names renamed to new locals of the caller. Arguments are assigned to them first
+    (by value, in order), and for functions the return variable becomes a local read
+    in place of the call.
+
+    A function call in an expression has its body placed right before the statement
+    holding it. Functions can't have side effects, so this only moves work earlier.
+    While conditions and for bounds are evaluated every iteration, so their bodies are
+    also copied to the end of the loop body (for bounds only when they don't read the
+    for variable, which changes after that point). Calls under and/or (may not be
+    evaluated at all) are left alone.
+
+    NOTE: The subprograms themselves are still generated for calls left behind
+*/
+
+#ifndef INLINER_H
+#define INLINER_H
+
+#include "../Parser/ParseTree/tree.h"
+#include "../Parser/ParseTree/tree_types.h"
+
+/* Largest body inlined, counting every statement and expression node */
+#define INLINE_MAX_COST 40
+
+/* Makes sub available to later bodies (and forgets what was nested in it) */
+void inline_register(Tree_t *sub);
+
+/* Forgets every subprogram in the list */
+void inline_unregister(ListNode_t *subprograms);
+
+/* Inlines calls in body, declaring new locals in decls */
+/* self_id is the subprogram body belongs to (NULL for a program), never inlined into itself */
+/* Returns how many calls were inlined */
+int inline_calls(ListNode_t **decls, struct Statement **body, char *self_id);
+
+#endif
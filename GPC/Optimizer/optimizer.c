@@ -5,6 +5,67 @@
     OPTIMIZER INFO:
         - All non-referenced stack variables removed
         - All constant number expressions simplified to a single number
+        - Integer variables holding a known constant or a copy of another variable are
+            replaced by it wherever they are read (constant and copy propagation)
+        - Conditions on constants settled, dropping if arms and loops that never run and
+            statements that can't be reached
+        - Loop-invariant arithmetic computed once before the loop
+        - Multiplies by the for variable replaced by running additions
+        - Calls to pure functions with number arguments replaced by their result
+            (see evaluator.h)
+        - Calls to small leaf subprograms replaced by their bodies (see inliner.h)
+        - Arithmetic repeated in a run of statements computed once (common subexpressions)
+
+    CONSTANT AND COPY PROPAGATION:
+        Walks a body in execution order keeping what every local integer variable and
+        argument is known to hold (a constant, a copy of another variable, or unknown).
+        Both arms of an if are walked from the same state and merged after. Loops are
+        walked until the state at the top of the loop stops changing, and only then are
+        the condition (or for bound) and the body rewritten with that state.
+        Everything rewritten goes back through simplify_expr.
+
+    DEAD CODE ELIMINATION:
+        Runs after propagation and simplification, and is decided on the IR (see
+        IR/ir.h): the body is lowered to SSA form and constants are propagated along
+        the branches that can be taken (IR/sccp.c). A statement whose code is never
+        reached is removed, which includes everything after a while that never ends.
+        An if that only ever takes one arm becomes that arm, a while whose body is
+        never reached is removed, and so is a for (only the assignment to the for
+        variable is kept). A condition that could trap or call something is kept, only
+        its dead arms are emptied. Before that, and, or and not drop a side that is
+        settled (evaluated first, or true for and, false for or, so dropping it
+        changes nothing).
+        When anything changed (or a call was evaluated, see evaluator.h), propagation
+        runs again since fewer paths join.
+
+    LOOP-INVARIANT CODE MOTION:
+        Arithmetic in a while or for loop (body, condition and for bound) built only from
+        numbers and local integer variables the loop never assigns is computed once into
+        a new local before the loop. Outer loops go first, so an expression is hoisted
+        out of as many loops as it is invariant in.
+        Nothing that could trap is hoisted (a loop can run zero times), so division is
+        only moved when the divisor is a non-zero number.
+
+    INDUCTION VARIABLE STRENGTH REDUCTION:
+        In a for loop whose body never assigns the for variable i, every i * k (k a
+        number or a local integer variable the loop never assigns) becomes a new local
+        set to i * k before the loop and bumped by k at the end of the body. i * i
+        becomes a local bumped by a second one holding 2i + 1, which in turn is bumped
+        by 2. Both only use additions in the loop, and wrap exactly like the multiply.
+        Array indices are left alone while bounds checks are on, since a check is only
+        dropped when the index is built from for variables.
+
+    COMMON SUBEXPRESSION ELIMINATION:
+        Local value numbering over blocks, the runs of assignments and procedure calls
+        (nested compound statements included) between two if, while or for statements.
+        Arithmetic built from numbers and local integer variables (at least one) is
+        numbered as it is evaluated, children first, so two trees match when their
+        operator is the same and their operands match (either order for + and *). The
+        second time a tree is seen, a new local is set to it right before the statement
+        first computing it, and both are replaced by that local. Assigning or reading a
+        variable forgets every tree using it, and so does a call when non-local is on.
+        A tree is still first computed in the statement it came from, so a division by
+        zero traps in the same place. Conditions and for bounds are left alone.
 
     NOTE: Optimizer designed to work in unison with the parser
 
@@ -17,7 +78,11 @@
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
+#include <limits.h>
 #include "optimizer.h"
+#include "inliner.h"
+#include "evaluator.h"
+#include "IR/ir.h"
 #include "../flags.h"
 #include "../Parser/ParseTree/tree.h"
 #include "../Parser/ParseTree/tree_types.h"
@@ -41,8 +106,117 @@ void decrement_self_references(SymTab_t *symtab, struct Statement *stmt);
 void decrement_reference_id_expr(SymTab_t *symtab, char *id, struct Expression *expr);
 void decrement_reference_expr(SymTab_t *symtab, struct Expression *expr);
 
-void set_vars_lists(SymTab_t *, ListNode_t *, ListNode_t **, ListNode_t **);
-void add_to_list(ListNode_t **, void *obj);
+void set_vars_lists(SymTab_t *, ListNode_t *, ListHandle_t *, ListHandle_t *);
+void add_to_list(ListHandle_t *, void *obj);
+
+/* Constant and copy propagation */
+enum PropKind{PROP_UNKNOWN, PROP_CONST, PROP_COPY};
+
+typedef struct PropVal
+{
+    enum PropKind kind;
+    int num; /* Constant for PROP_CONST, variable index for PROP_COPY */
+} PropVal_t;
+
+/* What every tracked variable holds at one point in a body */
+/* NOTE: ids are shared by every copy of an env */
+typedef struct PropEnv
+{
+    int num_vars;
+    char **ids;
+    PropVal_t *vals;
+} PropEnv_t;
+
+void propagate_body(ListNode_t *args, ListNode_t *decls, struct Statement *body);
+void propagate_stmt(struct Statement *stmt, PropEnv_t *env, int rewrite);
+void propagate_loop(struct Statement *stmt, PropEnv_t *env, int rewrite);
+void propagate_assign(struct Statement *var_assign, PropEnv_t *env, int rewrite);
+void propagate_expr(struct Expression **expr, PropEnv_t *env);
+void prop_eval(struct Expression *expr, PropEnv_t *env, PropVal_t *val);
+void prop_substitute(struct Expression **expr, PropEnv_t *env);
+void prop_simplify(struct Expression **expr);
+
+/* Dead code elimination */
+int eliminate_dead_code(Tree_t *tree, struct Statement **body);
+void dead_stmt(IrFunc_t *func, struct Statement **stmt, int *num_removed);
+void dead_arm(IrFunc_t *func, struct Statement **arm, int line_num, int *num_removed);
+void dead_compound(IrFunc_t *func, struct Statement *stmt, int *num_removed);
+int dead_expr_safe(struct Expression *expr);
+int dead_relop(struct Expression **expr);
+
+/* Loop-invariant code motion */
+typedef struct Licm
+{
+    ListNode_t *args;
+    ListNode_t **decls;
+
+    /* The loop being hoisted from */
+    int num_assigned;
+    char **assigned;
+    int has_call;
+    ListHandle_t hoisted;
+} Licm_t;
+
+void hoist_loop_invariants(ListNode_t *args, ListNode_t **decls, struct Statement **body);
+void licm_stmt(Licm_t *licm, struct Statement **stmt);
+void licm_loop(Licm_t *licm, struct Statement **loop);
+void licm_find_assigned(Licm_t *licm, struct Statement *stmt);
+void licm_hoist_stmt(Licm_t *licm, struct Statement *stmt);
+void licm_hoist_expr(Licm_t *licm, struct Expression **expr);
+int licm_invariant(Licm_t *licm, struct Expression *expr);
+char *add_temp_local(ListNode_t **decls, char *prefix, int line_num);
+
+/* Induction variable strength reduction */
+typedef struct InductionVar
+{
+    char *id; /* Local holding i * k */
+    struct Expression *step; /* k, NULL for i * i */
+    char *odd_id; /* Local holding 2i + 1 for i * i */
+} InductionVar_t;
+
+typedef struct IvLoop
+{
+    Licm_t licm;
+    char *for_id;
+    int num_ivs;
+    InductionVar_t *ivs;
+} IvLoop_t;
+
+void reduce_induction_vars(ListNode_t *args, ListNode_t **decls, struct Statement **body);
+void iv_stmt(IvLoop_t *iv, struct Statement **stmt);
+void iv_loop(IvLoop_t *iv, struct Statement **loop);
+void iv_rewrite_stmt(IvLoop_t *iv, struct Statement *stmt);
+void iv_rewrite_expr(IvLoop_t *iv, struct Expression **expr);
+InductionVar_t *iv_find(IvLoop_t *iv, struct Expression *step, int line_num);
+
+/* Common subexpression elimination */
+typedef struct CseExpr
+{
+    struct Expression *expr;
+    struct Expression **site; /* Where it was first computed */
+    int stmt_index; /* Statement of the block holding site */
+    char *temp; /* Local holding it once it was seen again, NULL before */
+} CseExpr_t;
+
+typedef struct Cse
+{
+    ListNode_t *args;
+    ListNode_t **decls;
+
+    /* The block being worked on, statements are the cur of their node */
+    int num_stmts;
+    ListNode_t **stmts;
+    int num_avail;
+    CseExpr_t *avail;
+} Cse_t;
+
+void eliminate_common_subexprs(ListNode_t *args, ListNode_t **decls, struct Statement **body);
+void cse_stmt(Cse_t *cse, struct Statement **stmt);
+void cse_block(Cse_t *cse, ListNode_t *stmts);
+void cse_block_stmt(Cse_t *cse, ListNode_t *node);
+void cse_expr(Cse_t *cse, struct Expression **expr);
+void cse_kill(Cse_t *cse, char *id);
+void print_cse_stats(FILE *f);
 
 /* The main entry point for the optimizer */
 void optimize(SymTab_t *symtab, Tree_t *tree)
@@ -73,20 +247,22 @@ void optimize_prog(SymTab_t *symtab, Tree_t *prog)
     assert(prog != NULL);
     assert(prog->type == TREE_PROGRAM_TYPE);
 
-    ListNode_t *vars_to_check, *vars_to_remove, *cur;
+    ListHandle_t vars_to_check, vars_to_remove;
+    ListNode_t *cur;
     struct Program *prog_data;
     HashNode_t *node;
-    int replace_with, num_removed, done;
+    int replace_with, num_removed, done, num_changed;
 
     prog_data = &prog->tree_data.program_data;
-    vars_to_check = vars_to_remove = NULL;
+    InitListHandle(&vars_to_check);
+    InitListHandle(&vars_to_remove);
 
     if(optimize_flag() >= 2)
     {
         decrement_self_references(symtab, prog_data->body_statement);
         set_vars_lists(symtab, prog_data->var_declaration, &vars_to_check, &vars_to_remove);
 
-        cur = vars_to_remove;
+        cur = vars_to_remove.head;
         done = num_removed = 0;
         while(cur != NULL)
         {
@@ -102,21 +278,43 @@ void optimize_prog(SymTab_t *symtab, Tree_t *prog)
 
             if(cur == NULL && num_removed > 0)
             {
-                DestroyList(vars_to_check);
-                DestroyList(vars_to_remove);
+                DestroyList(vars_to_check.head);
+                DestroyList(vars_to_remove.head);
 
                 set_vars_lists(symtab, prog_data->var_declaration, &vars_to_check, &vars_to_remove);
-                cur = vars_to_remove;
+                cur = vars_to_remove.head;
                 num_removed = 0;
             }
         }
-        DestroyList(vars_to_check);
-        DestroyList(vars_to_remove);
+        DestroyList(vars_to_check.head);
+        DestroyList(vars_to_remove.head);
     }
 
     if(optimize_flag() >= 1)
     {
+        eval_calls(prog_data->body_statement);
+        inline_calls(&prog_data->var_declaration, &prog_data->body_statement, NULL);
+        inline_unregister(prog_data->subprograms);
+        eval_unregister(prog_data->subprograms);
+
+        propagate_body(NULL, prog_data->var_declaration, prog_data->body_statement);
         simplify_stmt_expr(prog_data->body_statement);
+        num_changed = eval_calls(prog_data->body_statement);
+        num_changed += eliminate_dead_code(prog, &prog_data->body_statement);
+        if(num_changed > 0)
+        {
+            /* Fewer paths can leave more variables known */
+            propagate_body(NULL, prog_data->var_declaration, prog_data->body_statement);
+            simplify_stmt_expr(prog_data->body_statement);
+            eliminate_dead_code(prog, &prog_data->body_statement);
+        }
+        hoist_loop_invariants(NULL, &prog_data->var_declaration, &prog_data->body_statement);
+        reduce_induction_vars(NULL, &prog_data->var_declaration, &prog_data->body_statement);
+        eliminate_common_subexprs(NULL, &prog_data->var_declaration,
+            &prog_data->body_statement);
+
+        /* The program is always optimized last */
+        print_cse_stats(stderr);
     }
 }
 
@@ -127,20 +325,22 @@ void optimize_subprog(SymTab_t *symtab, Tree_t *sub)
     assert(sub != NULL);
     assert(sub->type == TREE_SUBPROGRAM);
 
-    ListNode_t *vars_to_check, *vars_to_remove, *cur;
+    ListHandle_t vars_to_check, vars_to_remove;
+    ListNode_t *cur;
     struct Subprogram *sub_data;
     HashNode_t *node;
-    int replace_with, done, num_removed;
+    int replace_with, done, num_removed, num_changed;
 
     sub_data = &sub->tree_data.subprogram_data;
-    vars_to_check = vars_to_remove = NULL;
+    InitListHandle(&vars_to_check);
+    InitListHandle(&vars_to_remove);
 
     if(optimize_flag() >= 2)
     {
         decrement_self_references(symtab, sub_data->statement_list);
         set_vars_lists(symtab, sub_data->declarations, &vars_to_check, &vars_to_remove);
 
-        cur = vars_to_remove;
+        cur = vars_to_remove.head;
         done = num_removed = 0;
         while(cur != NULL)
         {
@@ -156,22 +356,46 @@ void optimize_subprog(SymTab_t *symtab, Tree_t *sub)
 
             if(cur == NULL && num_removed > 0)
             {
-                DestroyList(vars_to_check);
-                DestroyList(vars_to_remove);
+                DestroyList(vars_to_check.head);
+                DestroyList(vars_to_remove.head);
 
                 set_vars_lists(symtab, sub_data->declarations, &vars_to_check, &vars_to_remove);
-                cur = vars_to_remove;
+                cur = vars_to_remove.head;
                 num_removed = 0;
             }
         }
 
-        DestroyList(vars_to_check);
-        DestroyList(vars_to_remove);
+        DestroyList(vars_to_check.head);
+        DestroyList(vars_to_remove.head);
     }
 
     if(optimize_flag() >= 1)
     {
+        eval_calls(sub_data->statement_list);
+        inline_calls(&sub_data->declarations, &sub_data->statement_list, sub_data->id);
+
+        propagate_body(sub_data->args_var, sub_data->declarations, sub_data->statement_list);
         simplify_stmt_expr(sub_data->statement_list);
+        num_changed = eval_calls(sub_data->statement_list);
+        num_changed += eliminate_dead_code(sub, &sub_data->statement_list);
+        if(num_changed > 0)
+        {
+            /* Fewer paths can leave more variables known */
+            propagate_body(sub_data->args_var, sub_data->declarations,
+                sub_data->statement_list);
+            simplify_stmt_expr(sub_data->statement_list);
+            eliminate_dead_code(sub, &sub_data->statement_list);
+        }
+        hoist_loop_invariants(sub_data->args_var, &sub_data->declarations,
+            &sub_data->statement_list);
+        reduce_induction_vars(sub_data->args_var, &sub_data->declarations,
+            &sub_data->statement_list);
+        eliminate_common_subexprs(sub_data->args_var, &sub_data->declarations,
+            &sub_data->statement_list);
+
+        /* Calls after this point can inline or evaluate sub */
+        inline_register(sub);
+        eval_register(sub);
     }
 }
 
@@ -191,7 +415,10 @@ void decrement_self_references(SymTab_t *symtab, struct Statement *stmt)
         case STMT_VAR_ASSIGN:
             expr = stmt->stmt_data.var_assign_data.var;
             assert(expr != NULL);
-            assert(expr->type == EXPR_VAR_ID);
+
+            /* Arrays are never removed */
+            if(expr->type != EXPR_VAR_ID)
+                break;
             id = expr->expr_data.id;
 
             expr = expr = stmt->stmt_data.var_assign_data.expr;
@@ -223,17 +450,20 @@ void remove_var_decls(SymTab_t *symtab, char *id, ListNode_t *var_decls)
     while(var_decls != NULL)
     {
         var_decl = (Tree_t *)var_decls->cur;
-        assert(var_decl->type == TREE_VAR_DECL);
+        assert(var_decl->type == TREE_VAR_DECL || var_decl->type == TREE_ARR_DECL);
 
-        ids = var_decl->tree_data.var_decl_data.ids;
+        /* Arrays are never removed */
+        ids = NULL;
+        if(var_decl->type == TREE_VAR_DECL)
+            ids = var_decl->tree_data.var_decl_data.ids;
         prev = NULL;
         while(ids != NULL)
         {
             if(strcmp((char *)ids->cur, id) == 0)
             {
-                free(ids->cur);
+                tree_free(ids->cur);
                 temp = ids->next;
-                free(ids);
+                tree_free(ids);
                 ids = temp;
                 if(prev == NULL)
                 {
@@ -293,8 +523,7 @@ int remove_mutation_var_assign(SymTab_t *symtab, char *id, struct Statement *var
     struct Expression *var;
 
     var = var_assign->stmt_data.var_assign_data.var;
-    assert(var->type == EXPR_VAR_ID);
-    if(strcmp(var->expr_data.id, id) == 0)
+    if(var->type == EXPR_VAR_ID && strcmp(var->expr_data.id, id) == 0)
     {
         #ifdef DEBUG_OPTIMIZER
             fprintf(stderr, "OPTIMIZER: Removing var assign at line %d\n", var_assign->line_num);
@@ -331,7 +560,7 @@ int remove_mutation_compound_statement(SymTab_t *symtab, char *id, struct Statem
             ++return_val;
 
             temp = statement_list->next;
-            free(statement_list);
+            tree_free(statement_list);
             statement_list = temp;
 
             if(prev == NULL)
@@ -455,22 +684,20 @@ int simplify_expr(struct Expression **expr)
             return_val2 = simplify_expr(&(*expr)->expr_data.mulop_data.right_factor);
             if(return_val == 1 && return_val2 == 1)
             {
+                /* Division by zero is left for runtime */
+                if(fold_int_op((*expr)->expr_data.mulop_data.mulop_type,
+                    (*expr)->expr_data.mulop_data.left_term->expr_data.i_num,
+                    (*expr)->expr_data.mulop_data.right_factor->expr_data.i_num,
+                    &new_val) == 0)
+                {
+                    return 0;
+                }
+
                 #ifdef DEBUG_OPTIMIZER
                     fprintf(stderr, "OPTIMIZER: Simplying MULOP expression on line %d\n",
                         (*expr)->line_num);
                 #endif
 
-                if((*expr)->expr_data.mulop_data.mulop_type == STAR)
-                {
-                    new_val = (*expr)->expr_data.mulop_data.left_term->expr_data.i_num *
-                                (*expr)->expr_data.mulop_data.right_factor->expr_data.i_num;
-                }
-                else
-                {
-                    new_val = (*expr)->expr_data.mulop_data.left_term->expr_data.i_num /
-                                (*expr)->expr_data.mulop_data.right_factor->expr_data.i_num;
-                }
-
                 new_expr = mk_inum((*expr)->line_num, new_val);
 
                 destroy_expr(*expr);
@@ -588,15 +815,15 @@ void decrement_reference_expr(SymTab_t *symtab, struct Expression *expr)
 /* Gets a list of variables that can be safely removed (not referenced) and ones that will need
         to be checked
 */
-void set_vars_lists(SymTab_t *symtab, ListNode_t *vars, ListNode_t **vars_to_check,
-    ListNode_t **vars_to_remove)
+void set_vars_lists(SymTab_t *symtab, ListNode_t *vars, ListHandle_t *vars_to_check,
+    ListHandle_t *vars_to_remove)
 {
-    ListNode_t *check, *remove;
     ListNode_t *ids;
     HashNode_t *node;
     Tree_t *var_decl;
 
-    *vars_to_check = *vars_to_remove = NULL;
+    InitListHandle(vars_to_check);
+    InitListHandle(vars_to_remove);
     while(vars != NULL)
     {
         var_decl = (Tree_t *)vars->cur;
@@ -626,11 +853,2011 @@ void set_vars_lists(SymTab_t *symtab, ListNode_t *vars, ListNode_t **vars_to_che
     }
 }
 
-/* Adds to a list */
-void add_to_list(ListNode_t **list, void *obj)
+/* Adds to the back of a list */
+void add_to_list(ListHandle_t *list, void *obj)
+{
+    PushListHandleBack(list, CreateListNode(obj, LIST_UNSPECIFIED));
+}
+
+/******** CONSTANT AND COPY PROPAGATION ********/
+
+/* Folds an integer operation */
+/* Returns 0 if it has to be left for runtime (division by zero or overflow) */
+int fold_int_op(int type, int left, int right, int *result)
+{
+    switch(type)
+    {
+        case PLUS:
+            *result = (int)((unsigned int)left + (unsigned int)right);
+            return 1;
+        case MINUS:
+            *result = (int)((unsigned int)left - (unsigned int)right);
+            return 1;
+        case STAR:
+            *result = (int)((unsigned int)left * (unsigned int)right);
+            return 1;
+        case SLASH:
+            if(right == 0 || (left == INT_MIN && right == -1))
+                return 0;
+            *result = left / right;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Gathers integer variable ids from declarations, returns how many */
+/* NOTE: ids can be NULL to only count */
+int prop_collect_ids(ListNode_t *decls, char **ids)
+{
+    Tree_t *decl;
+    ListNode_t *cur;
+    int num;
+
+    num = 0;
+    while(decls != NULL)
+    {
+        decl = (Tree_t *)decls->cur;
+        if(decl->type == TREE_VAR_DECL && decl->tree_data.var_decl_data.type == INT_TYPE)
+        {
+            cur = decl->tree_data.var_decl_data.ids;
+            while(cur != NULL)
+            {
+                if(ids != NULL)
+                    ids[num] = (char *)cur->cur;
+                ++num;
+                cur = cur->next;
+            }
+        }
+
+        decls = decls->next;
+    }
+
+    return num;
+}
+
+void init_prop_env(PropEnv_t *env, ListNode_t *args, ListNode_t *decls)
+{
+    int num_args, i;
+
+    num_args = prop_collect_ids(args, NULL);
+    env->num_vars = num_args + prop_collect_ids(decls, NULL);
+
+    env->ids = (char **)malloc((env->num_vars + 1) * sizeof(char *));
+    env->vals = (PropVal_t *)malloc((env->num_vars + 1) * sizeof(PropVal_t));
+    assert(env->ids != NULL);
+    assert(env->vals != NULL);
+
+    prop_collect_ids(args, env->ids);
+    prop_collect_ids(decls, env->ids + num_args);
+    for(i = 0; i < env->num_vars; ++i)
+        env->vals[i].kind = PROP_UNKNOWN;
+}
+
+void copy_prop_env(PropEnv_t *dst, PropEnv_t *src)
+{
+    dst->num_vars = src->num_vars;
+    dst->ids = src->ids;
+    dst->vals = (PropVal_t *)malloc((src->num_vars + 1) * sizeof(PropVal_t));
+    assert(dst->vals != NULL);
+    memcpy(dst->vals, src->vals, src->num_vars * sizeof(PropVal_t));
+}
+
+int prop_val_equal(PropVal_t *a, PropVal_t *b)
+{
+    return a->kind == b->kind && (a->kind == PROP_UNKNOWN || a->num == b->num);
+}
+
+/* Keeps only what both envs agree on (where two paths join) */
+void meet_prop_env(PropEnv_t *env, PropEnv_t *other)
+{
+    int i;
+
+    for(i = 0; i < env->num_vars; ++i)
+        if(!prop_val_equal(&env->vals[i], &other->vals[i]))
+            env->vals[i].kind = PROP_UNKNOWN;
+}
+
+int prop_env_equal(PropEnv_t *a, PropEnv_t *b)
+{
+    int i;
+
+    for(i = 0; i < a->num_vars; ++i)
+        if(!prop_val_equal(&a->vals[i], &b->vals[i]))
+            return 0;
+
+    return 1;
+}
+
+int prop_find(PropEnv_t *env, char *id)
+{
+    int i;
+
+    for(i = 0; i < env->num_vars; ++i)
+        if(strcmp(env->ids[i], id) == 0)
+            return i;
+
+    return -1;
+}
+
+/* Forgets a variable's value along with every copy of it */
+void prop_kill(PropEnv_t *env, int index)
+{
+    int i;
+
+    env->vals[index].kind = PROP_UNKNOWN;
+    for(i = 0; i < env->num_vars; ++i)
+        if(env->vals[i].kind == PROP_COPY && env->vals[i].num == index)
+            env->vals[i].kind = PROP_UNKNOWN;
+}
+
+void prop_kill_all(PropEnv_t *env)
+{
+    int i;
+
+    for(i = 0; i < env->num_vars; ++i)
+        env->vals[i].kind = PROP_UNKNOWN;
+}
+
+/* Entry point for a program or subprogram body */
+void propagate_body(ListNode_t *args, ListNode_t *decls, struct Statement *body)
+{
+    PropEnv_t env;
+
+    init_prop_env(&env, args, decls);
+    if(env.num_vars > 0 && body != NULL)
+        propagate_stmt(body, &env, 1);
+
+    free(env.ids);
+    free(env.vals);
+}
+
+/* Runs a statement over env, rewriting its expressions with what is known if rewrite is set */
+void propagate_stmt(struct Statement *stmt, PropEnv_t *env, int rewrite)
+{
+    assert(stmt != NULL);
+    assert(env != NULL);
+
+    PropEnv_t else_env;
+    ListNode_t *cur;
+    struct Expression *arg;
+    char *proc_id;
+    int index;
+
+    switch(stmt->type)
+    {
+        case STMT_VAR_ASSIGN:
+            propagate_assign(stmt, env, rewrite);
+            break;
+
+        case STMT_PROCEDURE_CALL:
+            proc_id = stmt->stmt_data.procedure_call_data.id;
+            cur = stmt->stmt_data.procedure_call_data.expr_args;
+            while(cur != NULL)
+            {
+                arg = (struct Expression *)cur->cur;
+
+                /* read writes to its arguments */
+                if(strcmp(proc_id, "read") == 0)
+                {
+                    if(arg->type == EXPR_VAR_ID)
+                    {
+                        index = prop_find(env, arg->expr_data.id);
+                        if(index >= 0)
+                            prop_kill(env, index);
+                    }
+                    else if(arg->type == EXPR_ARRAY_ACCESS && rewrite)
+                        propagate_expr(&arg->expr_data.array_access_data.array_expr, env);
+                }
+                else if(rewrite)
+                {
+                    propagate_expr((struct Expression **)&cur->cur, env);
+                }
+
+                cur = cur->next;
+            }
+
+            /* Nested subprograms can change our variables with non-local on */
+            if(nonlocal_flag() && strcmp(proc_id, "write") != 0 && strcmp(proc_id, "read") != 0)
+                prop_kill_all(env);
+
+            break;
+
+        case STMT_COMPOUND_STATEMENT:
+            cur = stmt->stmt_data.compound_statement;
+            while(cur != NULL)
+            {
+                propagate_stmt((struct Statement *)cur->cur, env, rewrite);
+                cur = cur->next;
+            }
+
+            break;
+
+        case STMT_IF_THEN:
+            if(rewrite)
+                propagate_expr(&stmt->stmt_data.if_then_data.relop_expr, env);
+
+            copy_prop_env(&else_env, env);
+            propagate_stmt(stmt->stmt_data.if_then_data.if_stmt, env, rewrite);
+            if(stmt->stmt_data.if_then_data.else_stmt != NULL)
+                propagate_stmt(stmt->stmt_data.if_then_data.else_stmt, &else_env, rewrite);
+
+            meet_prop_env(env, &else_env);
+            free(else_env.vals);
+
+            break;
+
+        case STMT_WHILE:
+        case STMT_FOR:
+            propagate_loop(stmt, env, rewrite);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Loops are run until the state at their top settles */
+/* NOTE: The condition (or for bound) is evaluated at the top of every iteration */
+void propagate_loop(struct Statement *stmt, PropEnv_t *env, int rewrite)
 {
-    if(*list == NULL)
-        *list = CreateListNode(obj, LIST_UNSPECIFIED);
+    PropEnv_t head, body_env;
+    struct Statement *body;
+    struct Expression *for_var;
+    PropVal_t *for_val;
+    int for_index;
+
+    for_var = NULL;
+    if(stmt->type == STMT_FOR)
+    {
+        if(stmt->stmt_data.for_data.for_assign_type == STMT_FOR_ASSIGN_VAR)
+        {
+            propagate_assign(stmt->stmt_data.for_data.for_assign_data.var_assign, env, rewrite);
+            for_var = stmt->stmt_data.for_data.for_assign_data.var_assign->stmt_data.var_assign_data.var;
+        }
+        else
+        {
+            for_var = stmt->stmt_data.for_data.for_assign_data.var;
+        }
+        body = stmt->stmt_data.for_data.do_for;
+    }
     else
-        *list = PushListNodeBack(*list, CreateListNode(obj, LIST_UNSPECIFIED));
+    {
+        body = stmt->stmt_data.while_data.while_stmt;
+    }
+    for_index = (for_var != NULL) ? prop_find(env, for_var->expr_data.id) : -1;
+
+    /* Only ever loses facts, so this ends */
+    copy_prop_env(&head, env);
+    while(1)
+    {
+        copy_prop_env(&body_env, &head);
+        propagate_stmt(body, &body_env, 0);
+
+        /* The for update (see codegen_for) */
+        if(for_index >= 0)
+        {
+            for_val = &body_env.vals[for_index];
+            if(for_val->kind == PROP_CONST)
+            {
+                fold_int_op(PLUS, for_val->num, 1, &for_val->num);
+            }
+            else
+            {
+                prop_kill(&body_env, for_index);
+            }
+        }
+
+        meet_prop_env(&body_env, &head);
+        if(prop_env_equal(&body_env, &head))
+        {
+            free(body_env.vals);
+            break;
+        }
+
+        free(head.vals);
+        head = body_env;
+    }
+
+    if(rewrite)
+    {
+        if(stmt->type == STMT_FOR)
+            propagate_expr(&stmt->stmt_data.for_data.to, &head);
+        else
+            propagate_expr(&stmt->stmt_data.while_data.relop_expr, &head);
+
+        copy_prop_env(&body_env, &head);
+        propagate_stmt(body, &body_env, 1);
+        free(body_env.vals);
+    }
+
+    /* Loops are left from the top */
+    free(env->vals);
+    *env = head;
+}
+
+void propagate_assign(struct Statement *var_assign, PropEnv_t *env, int rewrite)
+{
+    assert(var_assign != NULL);
+    assert(var_assign->type == STMT_VAR_ASSIGN);
+
+    struct Expression *var;
+    PropVal_t val;
+    int index;
+
+    var = var_assign->stmt_data.var_assign_data.var;
+    if(rewrite)
+        propagate_expr(&var_assign->stmt_data.var_assign_data.expr, env);
+
+    if(var->type == EXPR_ARRAY_ACCESS)
+    {
+        if(rewrite)
+            propagate_expr(&var->expr_data.array_access_data.array_expr, env);
+        return;
+    }
+
+    assert(var->type == EXPR_VAR_ID);
+    index = prop_find(env, var->expr_data.id);
+    if(index < 0)
+        return;
+
+    prop_eval(var_assign->stmt_data.var_assign_data.expr, env, &val);
+    prop_kill(env, index);
+    if(val.kind == PROP_COPY && val.num == index)
+        val.kind = PROP_UNKNOWN;
+
+    env->vals[index] = val;
+}
+
+/* What an expression is known to be without changing it */
+void prop_eval(struct Expression *expr, PropEnv_t *env, PropVal_t *val)
+{
+    PropVal_t left, right;
+    int index;
+
+    val->kind = PROP_UNKNOWN;
+    switch(expr->type)
+    {
+        case EXPR_INUM:
+            val->kind = PROP_CONST;
+            val->num = expr->expr_data.i_num;
+            break;
+
+        case EXPR_VAR_ID:
+            index = prop_find(env, expr->expr_data.id);
+            if(index >= 0)
+            {
+                *val = env->vals[index];
+                if(val->kind == PROP_UNKNOWN)
+                {
+                    val->kind = PROP_COPY;
+                    val->num = index;
+                }
+            }
+            break;
+
+        case EXPR_SIGN_TERM:
+            prop_eval(expr->expr_data.sign_term, env, &left);
+            if(left.kind == PROP_CONST)
+            {
+                val->kind = PROP_CONST;
+                fold_int_op(MINUS, 0, left.num, &val->num);
+            }
+            break;
+
+        case EXPR_ADDOP:
+            prop_eval(expr->expr_data.addop_data.left_expr, env, &left);
+            prop_eval(expr->expr_data.addop_data.right_term, env, &right);
+            if(left.kind == PROP_CONST && right.kind == PROP_CONST &&
+                fold_int_op(expr->expr_data.addop_data.addop_type, left.num, right.num,
+                    &val->num))
+            {
+                val->kind = PROP_CONST;
+            }
+            break;
+
+        case EXPR_MULOP:
+            prop_eval(expr->expr_data.mulop_data.left_term, env, &left);
+            prop_eval(expr->expr_data.mulop_data.right_factor, env, &right);
+            if(left.kind == PROP_CONST && right.kind == PROP_CONST &&
+                fold_int_op(expr->expr_data.mulop_data.mulop_type, left.num, right.num,
+                    &val->num))
+            {
+                val->kind = PROP_CONST;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Replaces reads of known variables then folds what it can */
+void propagate_expr(struct Expression **expr, PropEnv_t *env)
+{
+    prop_substitute(expr, env);
+    prop_simplify(expr);
+}
+
+void prop_substitute(struct Expression **expr, PropEnv_t *env)
+{
+    struct Expression *new_expr;
+    ListNode_t *cur;
+    PropVal_t *val;
+    int index;
+
+    switch((*expr)->type)
+    {
+        case EXPR_VAR_ID:
+            index = prop_find(env, (*expr)->expr_data.id);
+            if(index < 0)
+                break;
+
+            val = &env->vals[index];
+            if(val->kind == PROP_CONST)
+            {
+                #ifdef DEBUG_OPTIMIZER
+                    fprintf(stderr, "OPTIMIZER: Propagating %s = %d on line %d\n",
+                        env->ids[index], val->num, (*expr)->line_num);
+                #endif
+
+                new_expr = mk_inum((*expr)->line_num, val->num);
+            }
+            else if(val->kind == PROP_COPY)
+            {
+                #ifdef DEBUG_OPTIMIZER
+                    fprintf(stderr, "OPTIMIZER: Propagating copy %s = %s on line %d\n",
+                        env->ids[index], env->ids[val->num], (*expr)->line_num);
+                #endif
+
+                new_expr = mk_varid((*expr)->line_num, tree_strdup(env->ids[val->num]));
+            }
+            else
+                break;
+
+            destroy_expr(*expr);
+            *expr = new_expr;
+            break;
+
+        case EXPR_RELOP:
+            prop_substitute(&(*expr)->expr_data.relop_data.left, env);
+            if((*expr)->expr_data.relop_data.right != NULL)
+                prop_substitute(&(*expr)->expr_data.relop_data.right, env);
+            break;
+
+        case EXPR_SIGN_TERM:
+            prop_substitute(&(*expr)->expr_data.sign_term, env);
+            break;
+
+        case EXPR_ADDOP:
+            prop_substitute(&(*expr)->expr_data.addop_data.left_expr, env);
+            prop_substitute(&(*expr)->expr_data.addop_data.right_term, env);
+            break;
+
+        case EXPR_MULOP:
+            prop_substitute(&(*expr)->expr_data.mulop_data.left_term, env);
+            prop_substitute(&(*expr)->expr_data.mulop_data.right_factor, env);
+            break;
+
+        case EXPR_ARRAY_ACCESS:
+            prop_substitute(&(*expr)->expr_data.array_access_data.array_expr, env);
+            break;
+
+        case EXPR_FUNCTION_CALL:
+            cur = (*expr)->expr_data.function_call_data.args_expr;
+            while(cur != NULL)
+            {
+                prop_substitute((struct Expression **)&cur->cur, env);
+                cur = cur->next;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* simplify_expr on every arithmetic expression below the relops */
+void prop_simplify(struct Expression **expr)
+{
+    if((*expr)->type == EXPR_RELOP)
+    {
+        prop_simplify(&(*expr)->expr_data.relop_data.left);
+        if((*expr)->expr_data.relop_data.right != NULL)
+            prop_simplify(&(*expr)->expr_data.relop_data.right);
+    }
+    else
+        simplify_expr(expr);
+}
+
+/******** DEAD CODE ELIMINATION ********/
+
+/* Entry point for a program or subprogram body, tree is the program or subprogram */
+/* Returns how many statements were removed or settled */
+int eliminate_dead_code(Tree_t *tree, struct Statement **body)
+{
+    IrFunc_t *func;
+    int num_removed;
+
+    if(*body == NULL)
+        return 0;
+
+    func = ir_build(tree);
+    ir_propagate_consts(func);
+
+    num_removed = 0;
+    dead_stmt(func, body, &num_removed);
+    if(*body == NULL)
+        *body = mk_compoundstatement(0, NULL);
+
+    ir_free(func);
+    return num_removed;
+}
+
+/* Removes the dead parts of stmt, *stmt becomes NULL if nothing is left */
+/* NOTE: Statements made here aren't in func, so they are never passed back in */
+void dead_stmt(IrFunc_t *func, struct Statement **stmt, int *num_removed)
+{
+    IrStmt_t *lowered;
+    struct Statement *taken, *assign;
+    int cond, then_runs, else_runs;
+
+    lowered = ir_find_stmt(func, *stmt);
+    assert(lowered != NULL);
+    if(!lowered->entry->executable)
+    {
+        #ifdef DEBUG_OPTIMIZER
+            fprintf(stderr, "OPTIMIZER: Removing unreachable statement on line %d\n",
+                (*stmt)->line_num);
+        #endif
+
+        ++*num_removed;
+        destroy_stmt(*stmt);
+        *stmt = NULL;
+        return;
+    }
+
+    switch((*stmt)->type)
+    {
+        case STMT_COMPOUND_STATEMENT:
+            dead_compound(func, *stmt, num_removed);
+            break;
+
+        case STMT_IF_THEN:
+            cond = dead_relop(&(*stmt)->stmt_data.if_then_data.relop_expr);
+            then_runs = lowered->arms[0]->executable;
+            else_runs = lowered->arms[1]->executable;
+            if(then_runs != else_runs &&
+                (cond >= 0 || dead_expr_safe((*stmt)->stmt_data.if_then_data.relop_expr)))
+            {
+                #ifdef DEBUG_OPTIMIZER
+                    fprintf(stderr, "OPTIMIZER: Condition of if on line %d is always %s\n",
+                        (*stmt)->line_num, then_runs ? "true" : "false");
+                #endif
+
+                taken = then_runs ? (*stmt)->stmt_data.if_then_data.if_stmt :
+                    (*stmt)->stmt_data.if_then_data.else_stmt;
+                if(!then_runs)
+                    destroy_stmt((*stmt)->stmt_data.if_then_data.if_stmt);
+                else if((*stmt)->stmt_data.if_then_data.else_stmt != NULL)
+                    destroy_stmt((*stmt)->stmt_data.if_then_data.else_stmt);
+
+                ++*num_removed;
+                *stmt = taken;
+                if(taken != NULL)
+                    dead_stmt(func, stmt, num_removed);
+                break;
+            }
+
+            dead_arm(func, &(*stmt)->stmt_data.if_then_data.if_stmt, (*stmt)->line_num,
+                num_removed);
+            if((*stmt)->stmt_data.if_then_data.else_stmt != NULL)
+                dead_arm(func, &(*stmt)->stmt_data.if_then_data.else_stmt,
+                    (*stmt)->line_num, num_removed);
+            break;
+
+        case STMT_WHILE:
+            cond = dead_relop(&(*stmt)->stmt_data.while_data.relop_expr);
+            if(!lowered->arms[0]->executable &&
+                (cond >= 0 || dead_expr_safe((*stmt)->stmt_data.while_data.relop_expr)))
+            {
+                #ifdef DEBUG_OPTIMIZER
+                    fprintf(stderr, "OPTIMIZER: Removing while loop that never runs on line %d\n",
+                        (*stmt)->line_num);
+                #endif
+
+                ++*num_removed;
+                destroy_stmt(*stmt);
+                *stmt = NULL;
+                break;
+            }
+
+            dead_arm(func, &(*stmt)->stmt_data.while_data.while_stmt, (*stmt)->line_num,
+                num_removed);
+            break;
+
+        case STMT_FOR:
+            /* NOTE: The test only reads the for variable besides the end */
+            if(!lowered->arms[0]->executable && dead_expr_safe((*stmt)->stmt_data.for_data.to))
+            {
+                #ifdef DEBUG_OPTIMIZER
+                    fprintf(stderr, "OPTIMIZER: Removing for loop that never runs on line %d\n",
+                        (*stmt)->line_num);
+                #endif
+
+                ++*num_removed;
+                if((*stmt)->stmt_data.for_data.for_assign_type == STMT_FOR_ASSIGN_VAR)
+                {
+                    /* The for variable is still set */
+                    assign = (*stmt)->stmt_data.for_data.for_assign_data.var_assign;
+                    destroy_stmt((*stmt)->stmt_data.for_data.do_for);
+                    destroy_expr((*stmt)->stmt_data.for_data.to);
+                    *stmt = assign;
+                }
+                else
+                {
+                    destroy_stmt(*stmt);
+                    *stmt = NULL;
+                }
+                break;
+            }
+
+            dead_arm(func, &(*stmt)->stmt_data.for_data.do_for, (*stmt)->line_num,
+                num_removed);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* An if arm or loop body, left as an empty compound statement when all of it is dead */
+void dead_arm(IrFunc_t *func, struct Statement **arm, int line_num, int *num_removed)
+{
+    dead_stmt(func, arm, num_removed);
+    if(*arm == NULL)
+        *arm = mk_compoundstatement(line_num, NULL);
+}
+
+/* Removes the dead statements of a compound statement */
+void dead_compound(IrFunc_t *func, struct Statement *stmt, int *num_removed)
+{
+    ListNode_t *cur, *prev, *next;
+
+    cur = stmt->stmt_data.compound_statement;
+    prev = NULL;
+    while(cur != NULL)
+    {
+        dead_stmt(func, (struct Statement **)&cur->cur, num_removed);
+        next = cur->next;
+        if(cur->cur == NULL)
+        {
+            tree_free(cur);
+            if(prev == NULL)
+                stmt->stmt_data.compound_statement = next;
+            else
+                prev->next = next;
+        }
+        else
+        {
+            prev = cur;
+        }
+        cur = next;
+    }
+}
+
+/* Whether expr can be left unevaluated, it can't trap or call anything */
+/* NOTE: Array accesses are checked, so they can trap */
+int dead_expr_safe(struct Expression *expr)
+{
+    struct Expression *divisor;
+
+    switch(expr->type)
+    {
+        case EXPR_INUM:
+        case EXPR_RNUM:
+        case EXPR_VAR_ID:
+            return 1;
+
+        case EXPR_SIGN_TERM:
+            return dead_expr_safe(expr->expr_data.sign_term);
+
+        case EXPR_ADDOP:
+            return dead_expr_safe(expr->expr_data.addop_data.left_expr) &&
+                dead_expr_safe(expr->expr_data.addop_data.right_term);
+
+        case EXPR_MULOP:
+            if(expr->expr_data.mulop_data.mulop_type == SLASH)
+            {
+                divisor = expr->expr_data.mulop_data.right_factor;
+                if(divisor->type != EXPR_INUM || divisor->expr_data.i_num == 0 ||
+                    divisor->expr_data.i_num == -1)
+                    return 0;
+            }
+            return dead_expr_safe(expr->expr_data.mulop_data.left_term) &&
+                dead_expr_safe(expr->expr_data.mulop_data.right_factor);
+
+        case EXPR_RELOP:
+            return dead_expr_safe(expr->expr_data.relop_data.left) &&
+                (expr->expr_data.relop_data.right == NULL ||
+                dead_expr_safe(expr->expr_data.relop_data.right));
+
+        default:
+            return 0;
+    }
+}
+
+/* Settles what it can of a condition */
+/* Returns 1 if always true, 0 if always false, -1 if it has to be left for runtime */
+/* NOTE: and and or stop early, so a side is only dropped when it isn't evaluated or */
+/*       doesn't change the result */
+int dead_relop(struct Expression **expr)
+{
+    struct Expression *left, *right;
+    int left_val, right_val, cond_val;
+
+    assert((*expr)->type == EXPR_RELOP);
+
+    left = (*expr)->expr_data.relop_data.left;
+    right = (*expr)->expr_data.relop_data.right;
+    switch((*expr)->expr_data.relop_data.type)
+    {
+        case NOT:
+            left_val = dead_relop(&(*expr)->expr_data.relop_data.left);
+            return (left_val < 0) ? -1 : !left_val;
+
+        case AND:
+        case OR:
+            left_val = dead_relop(&(*expr)->expr_data.relop_data.left);
+            right_val = dead_relop(&(*expr)->expr_data.relop_data.right);
+            left = (*expr)->expr_data.relop_data.left;
+            right = (*expr)->expr_data.relop_data.right;
+
+            /* The value that settles it on its own */
+            if((*expr)->expr_data.relop_data.type == AND)
+                cond_val = 0;
+            else
+                cond_val = 1;
+
+            if(left_val == cond_val)
+                return cond_val;
+            if(left_val == !cond_val)
+            {
+                *expr = right;
+                return right_val;
+            }
+            if(right_val == !cond_val)
+            {
+                *expr = left;
+                return -1;
+            }
+            return -1;
+
+        default:
+            break;
+    }
+
+    if(left->type != EXPR_INUM || right->type != EXPR_INUM)
+        return -1;
+
+    switch((*expr)->expr_data.relop_data.type)
+    {
+        case EQ:
+            return left->expr_data.i_num == right->expr_data.i_num;
+        case NE:
+            return left->expr_data.i_num != right->expr_data.i_num;
+        case LT:
+            return left->expr_data.i_num < right->expr_data.i_num;
+        case LE:
+            return left->expr_data.i_num <= right->expr_data.i_num;
+        case GT:
+            return left->expr_data.i_num > right->expr_data.i_num;
+        case GE:
+            return left->expr_data.i_num >= right->expr_data.i_num;
+        default:
+            return -1;
+    }
+}
+
+/******** LOOP-INVARIANT CODE MOTION ********/
+
+/* Entry point for a program or subprogram body */
+void hoist_loop_invariants(ListNode_t *args, ListNode_t **decls, struct Statement **body)
+{
+    Licm_t licm;
+
+    if(*body == NULL)
+        return;
+
+    licm.args = args;
+    licm.decls = decls;
+    licm.num_assigned = 0;
+    licm.assigned = NULL;
+    licm.has_call = 0;
+
+    licm_stmt(&licm, body);
+}
+
+/* Finds loops, outermost first */
+void licm_stmt(Licm_t *licm, struct Statement **stmt)
+{
+    ListNode_t *cur;
+
+    switch((*stmt)->type)
+    {
+        case STMT_COMPOUND_STATEMENT:
+            cur = (*stmt)->stmt_data.compound_statement;
+            while(cur != NULL)
+            {
+                licm_stmt(licm, (struct Statement **)&cur->cur);
+                cur = cur->next;
+            }
+            break;
+
+        case STMT_IF_THEN:
+            licm_stmt(licm, &(*stmt)->stmt_data.if_then_data.if_stmt);
+            if((*stmt)->stmt_data.if_then_data.else_stmt != NULL)
+                licm_stmt(licm, &(*stmt)->stmt_data.if_then_data.else_stmt);
+            break;
+
+        case STMT_WHILE:
+        case STMT_FOR:
+            licm_loop(licm, stmt);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Hoists out of one loop, then out of the loops inside it */
+/* NOTE: *loop becomes a compound statement of the hoisted assignments and the loop */
+void licm_loop(Licm_t *licm, struct Statement **loop)
+{
+    struct Statement *stmt;
+
+    stmt = *loop;
+    licm->num_assigned = 0;
+    licm->has_call = 0;
+    InitListHandle(&licm->hoisted);
+
+    licm_find_assigned(licm, stmt);
+    if(stmt->type == STMT_FOR)
+    {
+        licm_hoist_expr(licm, &stmt->stmt_data.for_data.to);
+        licm_hoist_stmt(licm, stmt->stmt_data.for_data.do_for);
+    }
+    else
+    {
+        licm_hoist_expr(licm, &stmt->stmt_data.while_data.relop_expr);
+        licm_hoist_stmt(licm, stmt->stmt_data.while_data.while_stmt);
+    }
+
+    if(licm->hoisted.head != NULL)
+    {
+        PushListHandleBack(&licm->hoisted, mk_listnode(stmt, LIST_STMT));
+        *loop = mk_compoundstatement(stmt->line_num, licm->hoisted.head);
+    }
+
+    free(licm->assigned);
+    licm->assigned = NULL;
+
+    /* Inner loops (their own assigned sets) */
+    if(stmt->type == STMT_FOR)
+        licm_stmt(licm, &stmt->stmt_data.for_data.do_for);
+    else
+        licm_stmt(licm, &stmt->stmt_data.while_data.while_stmt);
+}
+
+void licm_add_assigned(Licm_t *licm, char *id)
+{
+    licm->assigned = (char **)realloc(licm->assigned,
+        (licm->num_assigned + 1) * sizeof(char *));
+    assert(licm->assigned != NULL);
+    licm->assigned[licm->num_assigned++] = id;
+}
+
+/* Every variable stmt can change */
+void licm_find_assigned(Licm_t *licm, struct Statement *stmt)
+{
+    ListNode_t *cur;
+    struct Expression *var;
+
+    switch(stmt->type)
+    {
+        case STMT_VAR_ASSIGN:
+            var = stmt->stmt_data.var_assign_data.var;
+            licm_add_assigned(licm, (var->type == EXPR_VAR_ID) ? var->expr_data.id :
+                var->expr_data.array_access_data.id);
+            break;
+
+        case STMT_PROCEDURE_CALL:
+            cur = stmt->stmt_data.procedure_call_data.expr_args;
+            if(strcmp(stmt->stmt_data.procedure_call_data.id, "read") == 0)
+            {
+                while(cur != NULL)
+                {
+                    var = (struct Expression *)cur->cur;
+                    licm_add_assigned(licm, (var->type == EXPR_VAR_ID) ? var->expr_data.id :
+                        var->expr_data.array_access_data.id);
+                    cur = cur->next;
+                }
+            }
+            else if(strcmp(stmt->stmt_data.procedure_call_data.id, "write") != 0)
+            {
+                licm->has_call = 1;
+            }
+            break;
+
+        case STMT_COMPOUND_STATEMENT:
+            cur = stmt->stmt_data.compound_statement;
+            while(cur != NULL)
+            {
+                licm_find_assigned(licm, (struct Statement *)cur->cur);
+                cur = cur->next;
+            }
+            break;
+
+        case STMT_IF_THEN:
+            licm_find_assigned(licm, stmt->stmt_data.if_then_data.if_stmt);
+            if(stmt->stmt_data.if_then_data.else_stmt != NULL)
+                licm_find_assigned(licm, stmt->stmt_data.if_then_data.else_stmt);
+            break;
+
+        case STMT_WHILE:
+            licm_find_assigned(licm, stmt->stmt_data.while_data.while_stmt);
+            break;
+
+        case STMT_FOR:
+            if(stmt->stmt_data.for_data.for_assign_type == STMT_FOR_ASSIGN_VAR)
+                licm_find_assigned(licm, stmt->stmt_data.for_data.for_assign_data.var_assign);
+            else
+                licm_add_assigned(licm, stmt->stmt_data.for_data.for_assign_data.var->expr_data.id);
+            licm_find_assigned(licm, stmt->stmt_data.for_data.do_for);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Hoists from every expression evaluated inside the loop */
+void licm_hoist_stmt(Licm_t *licm, struct Statement *stmt)
+{
+    ListNode_t *cur;
+    struct Expression *var;
+
+    switch(stmt->type)
+    {
+        case STMT_VAR_ASSIGN:
+            var = stmt->stmt_data.var_assign_data.var;
+            if(var->type == EXPR_ARRAY_ACCESS)
+                licm_hoist_expr(licm, &var->expr_data.array_access_data.array_expr);
+            licm_hoist_expr(licm, &stmt->stmt_data.var_assign_data.expr);
+            break;
+
+        case STMT_PROCEDURE_CALL:
+            if(strcmp(stmt->stmt_data.procedure_call_data.id, "read") == 0)
+                break;
+
+            cur = stmt->stmt_data.procedure_call_data.expr_args;
+            while(cur != NULL)
+            {
+                licm_hoist_expr(licm, (struct Expression **)&cur->cur);
+                cur = cur->next;
+            }
+            break;
+
+        case STMT_COMPOUND_STATEMENT:
+            cur = stmt->stmt_data.compound_statement;
+            while(cur != NULL)
+            {
+                licm_hoist_stmt(licm, (struct Statement *)cur->cur);
+                cur = cur->next;
+            }
+            break;
+
+        case STMT_IF_THEN:
+            licm_hoist_expr(licm, &stmt->stmt_data.if_then_data.relop_expr);
+            licm_hoist_stmt(licm, stmt->stmt_data.if_then_data.if_stmt);
+            if(stmt->stmt_data.if_then_data.else_stmt != NULL)
+                licm_hoist_stmt(licm, stmt->stmt_data.if_then_data.else_stmt);
+            break;
+
+        case STMT_WHILE:
+            licm_hoist_expr(licm, &stmt->stmt_data.while_data.relop_expr);
+            licm_hoist_stmt(licm, stmt->stmt_data.while_data.while_stmt);
+            break;
+
+        case STMT_FOR:
+            if(stmt->stmt_data.for_data.for_assign_type == STMT_FOR_ASSIGN_VAR)
+                licm_hoist_stmt(licm, stmt->stmt_data.for_data.for_assign_data.var_assign);
+            licm_hoist_expr(licm, &stmt->stmt_data.for_data.to);
+            licm_hoist_stmt(licm, stmt->stmt_data.for_data.do_for);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Whether id is a local integer variable or argument */
+int licm_is_local(ListNode_t *decls, char *id)
+{
+    Tree_t *decl;
+    ListNode_t *ids;
+
+    while(decls != NULL)
+    {
+        decl = (Tree_t *)decls->cur;
+        if(decl->type == TREE_VAR_DECL && decl->tree_data.var_decl_data.type == INT_TYPE)
+        {
+            ids = decl->tree_data.var_decl_data.ids;
+            while(ids != NULL)
+            {
+                if(strcmp((char *)ids->cur, id) == 0)
+                    return 1;
+                ids = ids->next;
+            }
+        }
+
+        decls = decls->next;
+    }
+
+    return 0;
+}
+
+/* Whether expr has the same value on every iteration and can be computed early */
+int licm_invariant(Licm_t *licm, struct Expression *expr)
+{
+    struct Expression *divisor;
+    int i;
+
+    switch(expr->type)
+    {
+        case EXPR_INUM:
+            return 1;
+
+        case EXPR_VAR_ID:
+            if(!licm_is_local(licm->args, expr->expr_data.id) &&
+                !licm_is_local(*licm->decls, expr->expr_data.id))
+            {
+                return 0;
+            }
+
+            /* Nested subprograms can change our variables with non-local on */
+            if(licm->has_call && nonlocal_flag())
+                return 0;
+
+            for(i = 0; i < licm->num_assigned; ++i)
+                if(strcmp(licm->assigned[i], expr->expr_data.id) == 0)
+                    return 0;
+
+            return 1;
+
+        case EXPR_SIGN_TERM:
+            return licm_invariant(licm, expr->expr_data.sign_term);
+
+        case EXPR_ADDOP:
+            return licm_invariant(licm, expr->expr_data.addop_data.left_expr) &&
+                licm_invariant(licm, expr->expr_data.addop_data.right_term);
+
+        case EXPR_MULOP:
+            divisor = expr->expr_data.mulop_data.right_factor;
+            if(expr->expr_data.mulop_data.mulop_type == SLASH &&
+                (divisor->type != EXPR_INUM || divisor->expr_data.i_num == 0))
+            {
+                return 0;
+            }
+
+            return licm_invariant(licm, expr->expr_data.mulop_data.left_term) &&
+                licm_invariant(licm, divisor);
+
+        /* NOTE: Array elements stay put, but their index can still move (see below) */
+        default:
+            return 0;
+    }
+}
+
+/* Replaces the largest invariant subexpressions of expr with new locals */
+void licm_hoist_expr(Licm_t *licm, struct Expression **expr)
+{
+    struct Expression *var;
+    ListNode_t *cur;
+    char *name;
+
+    switch((*expr)->type)
+    {
+        /* Nothing to gain from a leaf */
+        case EXPR_INUM:
+        case EXPR_VAR_ID:
+        case EXPR_RNUM:
+            return;
+
+        case EXPR_RELOP:
+            licm_hoist_expr(licm, &(*expr)->expr_data.relop_data.left);
+            if((*expr)->expr_data.relop_data.right != NULL)
+                licm_hoist_expr(licm, &(*expr)->expr_data.relop_data.right);
+            return;
+
+        case EXPR_ARRAY_ACCESS:
+            licm_hoist_expr(licm, &(*expr)->expr_data.array_access_data.array_expr);
+            return;
+
+        case EXPR_FUNCTION_CALL:
+            cur = (*expr)->expr_data.function_call_data.args_expr;
+            while(cur != NULL)
+            {
+                licm_hoist_expr(licm, (struct Expression **)&cur->cur);
+                cur = cur->next;
+            }
+            return;
+
+        default:
+            break;
+    }
+
+    if(!licm_invariant(licm, *expr))
+    {
+        switch((*expr)->type)
+        {
+            case EXPR_SIGN_TERM:
+                licm_hoist_expr(licm, &(*expr)->expr_data.sign_term);
+                break;
+            case EXPR_ADDOP:
+                licm_hoist_expr(licm, &(*expr)->expr_data.addop_data.left_expr);
+                licm_hoist_expr(licm, &(*expr)->expr_data.addop_data.right_term);
+                break;
+            case EXPR_MULOP:
+                licm_hoist_expr(licm, &(*expr)->expr_data.mulop_data.left_term);
+                licm_hoist_expr(licm, &(*expr)->expr_data.mulop_data.right_factor);
+                break;
+            default:
+                break;
+        }
+        return;
+    }
+
+    #ifdef DEBUG_OPTIMIZER
+        fprintf(stderr, "OPTIMIZER: Hoisting loop invariant on line %d\n", (*expr)->line_num);
+    #endif
+
+    /* New local holding the value */
+    name = add_temp_local(licm->decls, "$licm", (*expr)->line_num);
+    var = mk_varid((*expr)->line_num, name);
+    PushListHandleBack(&licm->hoisted, mk_listnode(mk_varassign((*expr)->line_num, var, *expr),
+        LIST_STMT));
+
+    *expr = mk_varid((*expr)->line_num, tree_strdup(name));
+}
+
+/* Numbers the locals made by the optimizer */
+/* NOTE: '$' can't appear in a Pascal identifier, so these never clash */
+int num_temp_locals = 0;
+
+/* Declares a new local integer, returning its name */
+char *add_temp_local(ListNode_t **decls, char *prefix, int line_num)
+{
+    Tree_t *decl;
+    char name[32];
+
+    snprintf(name, sizeof(name), "%s%d", prefix, num_temp_locals++);
+    decl = mk_vardecl(line_num, mk_listnode(tree_strdup(name), LIST_STRING), INT_TYPE);
+    if(*decls == NULL)
+        *decls = mk_listnode(decl, LIST_TREE);
+    else
+        PushListNodeBack(*decls, mk_listnode(decl, LIST_TREE));
+
+    return tree_strdup(name);
+}
+
+
+/******** INDUCTION VARIABLE STRENGTH REDUCTION ********/
+
+/* Entry point for a program or subprogram body */
+void reduce_induction_vars(ListNode_t *args, ListNode_t **decls, struct Statement **body)
+{
+    IvLoop_t iv;
+
+    if(*body == NULL)
+        return;
+
+    iv.licm.args = args;
+    iv.licm.decls = decls;
+    iv.licm.num_assigned = 0;
+    iv.licm.assigned = NULL;
+    iv.licm.has_call = 0;
+    iv.num_ivs = 0;
+    iv.ivs = NULL;
+
+    iv_stmt(&iv, body);
+}
+
+/* Finds for loops, outermost first */
+void iv_stmt(IvLoop_t *iv, struct Statement **stmt)
+{
+    ListNode_t *cur;
+
+    switch((*stmt)->type)
+    {
+        case STMT_COMPOUND_STATEMENT:
+            cur = (*stmt)->stmt_data.compound_statement;
+            while(cur != NULL)
+            {
+                iv_stmt(iv, (struct Statement **)&cur->cur);
+                cur = cur->next;
+            }
+            break;
+
+        case STMT_IF_THEN:
+            iv_stmt(iv, &(*stmt)->stmt_data.if_then_data.if_stmt);
+            if((*stmt)->stmt_data.if_then_data.else_stmt != NULL)
+                iv_stmt(iv, &(*stmt)->stmt_data.if_then_data.else_stmt);
+            break;
+
+        case STMT_WHILE:
+            iv_stmt(iv, &(*stmt)->stmt_data.while_data.while_stmt);
+            break;
+
+        case STMT_FOR:
+            iv_loop(iv, stmt);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Copies a step or first value (a number or a variable) */
+struct Expression *iv_copy_step(struct Expression *step, int line_num)
+{
+    if(step->type == EXPR_INUM)
+        return mk_inum(line_num, step->expr_data.i_num);
+
+    assert(step->type == EXPR_VAR_ID);
+    return mk_varid(line_num, tree_strdup(step->expr_data.id));
+}
+
+struct Statement *iv_mk_assign(char *id, struct Expression *expr, int line_num)
+{
+    return mk_varassign(line_num, mk_varid(line_num, tree_strdup(id)), expr);
+}
+
+/* Reduces one for loop, then the for loops inside it */
+/* NOTE: *loop becomes a compound statement of the new locals and the loop (for assignment first */
+/* unless it assigns a number) */
+void iv_loop(IvLoop_t *iv, struct Statement **loop)
+{
+    struct Statement *stmt, *init, *body;
+    struct Expression *for_var, *first, *i_expr;
+    ListHandle_t before, after;
+    InductionVar_t *ind;
+    int line_num, i;
+
+    stmt = *loop;
+    line_num = stmt->line_num;
+    body = stmt->stmt_data.for_data.do_for;
+    if(stmt->stmt_data.for_data.for_assign_type == STMT_FOR_ASSIGN_VAR)
+    {
+        init = stmt->stmt_data.for_data.for_assign_data.var_assign;
+        for_var = init->stmt_data.var_assign_data.var;
+    }
+    else
+    {
+        init = NULL;
+        for_var = stmt->stmt_data.for_data.for_assign_data.var;
+    }
+    assert(for_var->type == EXPR_VAR_ID);
+
+    iv->for_id = for_var->expr_data.id;
+    iv->num_ivs = 0;
+    iv->ivs = NULL;
+    iv->licm.num_assigned = 0;
+    iv->licm.has_call = 0;
+    licm_find_assigned(&iv->licm, body);
+
+    /* The body must leave the for variable alone, and steps can't depend on it */
+    if(licm_invariant(&iv->licm, for_var))
+    {
+        licm_add_assigned(&iv->licm, iv->for_id);
+        iv_rewrite_stmt(iv, body);
+    }
+    free(iv->licm.assigned);
+    iv->licm.assigned = NULL;
+
+    if(iv->num_ivs > 0)
+    {
+        InitListHandle(&before);
+        InitListHandle(&after);
+
+        /* The new locals start from the for variable's first value */
+        /* A number is used directly, which keeps the loop counted (see codegen_unrolled_for), */
+        /* anything else has to be assigned to the for variable before them */
+        first = for_var;
+        if(init != NULL && init->stmt_data.var_assign_data.expr->type == EXPR_INUM)
+        {
+            first = init->stmt_data.var_assign_data.expr;
+        }
+        else if(init != NULL)
+        {
+            PushListHandleBack(&before, mk_listnode(init, LIST_STMT));
+            stmt->stmt_data.for_data.for_assign_type = STMT_FOR_VAR;
+            stmt->stmt_data.for_data.for_assign_data.var = mk_varid(line_num,
+                tree_strdup(iv->for_id));
+        }
+
+        for(i = 0; i < iv->num_ivs; ++i)
+        {
+            ind = &iv->ivs[i];
+            i_expr = iv_copy_step(first, line_num);
+            if(ind->step != NULL)
+            {
+                PushListHandleBack(&before, mk_listnode(iv_mk_assign(ind->id,
+                    mk_mulop(line_num, STAR, i_expr, iv_copy_step(ind->step, line_num)),
+                    line_num), LIST_STMT));
+                PushListHandleBack(&after, mk_listnode(iv_mk_assign(ind->id,
+                    mk_addop(line_num, PLUS, mk_varid(line_num, tree_strdup(ind->id)),
+                    iv_copy_step(ind->step, line_num)), line_num), LIST_STMT));
+            }
+            else
+            {
+                /* (i+1)^2 = i^2 + (2i + 1) */
+                PushListHandleBack(&before, mk_listnode(iv_mk_assign(ind->id,
+                    mk_mulop(line_num, STAR, i_expr, iv_copy_step(first, line_num)),
+                    line_num), LIST_STMT));
+                PushListHandleBack(&before, mk_listnode(iv_mk_assign(ind->odd_id,
+                    mk_addop(line_num, PLUS, mk_addop(line_num, PLUS,
+                    iv_copy_step(first, line_num), iv_copy_step(first, line_num)),
+                    mk_inum(line_num, 1)),
+                    line_num), LIST_STMT));
+                PushListHandleBack(&after, mk_listnode(iv_mk_assign(ind->id,
+                    mk_addop(line_num, PLUS, mk_varid(line_num, tree_strdup(ind->id)),
+                    mk_varid(line_num, tree_strdup(ind->odd_id))), line_num), LIST_STMT));
+                PushListHandleBack(&after, mk_listnode(iv_mk_assign(ind->odd_id,
+                    mk_addop(line_num, PLUS, mk_varid(line_num, tree_strdup(ind->odd_id)),
+                    mk_inum(line_num, 2)), line_num), LIST_STMT));
+            }
+        }
+
+        /* Bumped at the very end of the body, along with the for variable */
+        if(body->type == STMT_COMPOUND_STATEMENT && body->stmt_data.compound_statement != NULL)
+        {
+            PushListNodeBack(body->stmt_data.compound_statement, after.head);
+        }
+        else if(body->type == STMT_COMPOUND_STATEMENT)
+        {
+            body->stmt_data.compound_statement = after.head;
+        }
+        else
+        {
+            body = mk_compoundstatement(line_num,
+                PushListNodeFront(after.head, mk_listnode(body, LIST_STMT)));
+            stmt->stmt_data.for_data.do_for = body;
+        }
+
+        PushListHandleBack(&before, mk_listnode(stmt, LIST_STMT));
+        *loop = mk_compoundstatement(line_num, before.head);
+    }
+    free(iv->ivs);
+    iv->ivs = NULL;
+
+    iv_stmt(iv, &stmt->stmt_data.for_data.do_for);
+}
+
+/* Rewrites every expression evaluated in the loop body */
+void iv_rewrite_stmt(IvLoop_t *iv, struct Statement *stmt)
+{
+    ListNode_t *cur;
+    struct Expression *var;
+
+    switch(stmt->type)
+    {
+        case STMT_VAR_ASSIGN:
+            var = stmt->stmt_data.var_assign_data.var;
+            if(var->type == EXPR_ARRAY_ACCESS && !checks_flag())
+                iv_rewrite_expr(iv, &var->expr_data.array_access_data.array_expr);
+            iv_rewrite_expr(iv, &stmt->stmt_data.var_assign_data.expr);
+            break;
+
+        case STMT_PROCEDURE_CALL:
+            if(strcmp(stmt->stmt_data.procedure_call_data.id, "read") == 0)
+                break;
+
+            cur = stmt->stmt_data.procedure_call_data.expr_args;
+            while(cur != NULL)
+            {
+                iv_rewrite_expr(iv, (struct Expression **)&cur->cur);
+                cur = cur->next;
+            }
+            break;
+
+        case STMT_COMPOUND_STATEMENT:
+            cur = stmt->stmt_data.compound_statement;
+            while(cur != NULL)
+            {
+                iv_rewrite_stmt(iv, (struct Statement *)cur->cur);
+                cur = cur->next;
+            }
+            break;
+
+        case STMT_IF_THEN:
+            iv_rewrite_expr(iv, &stmt->stmt_data.if_then_data.relop_expr);
+            iv_rewrite_stmt(iv, stmt->stmt_data.if_then_data.if_stmt);
+            if(stmt->stmt_data.if_then_data.else_stmt != NULL)
+                iv_rewrite_stmt(iv, stmt->stmt_data.if_then_data.else_stmt);
+            break;
+
+        case STMT_WHILE:
+            iv_rewrite_expr(iv, &stmt->stmt_data.while_data.relop_expr);
+            iv_rewrite_stmt(iv, stmt->stmt_data.while_data.while_stmt);
+            break;
+
+        case STMT_FOR:
+            if(stmt->stmt_data.for_data.for_assign_type == STMT_FOR_ASSIGN_VAR)
+                iv_rewrite_stmt(iv, stmt->stmt_data.for_data.for_assign_data.var_assign);
+            iv_rewrite_expr(iv, &stmt->stmt_data.for_data.to);
+            iv_rewrite_stmt(iv, stmt->stmt_data.for_data.do_for);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Whether expr is the for variable */
+int iv_is_for_var(IvLoop_t *iv, struct Expression *expr)
+{
+    return expr->type == EXPR_VAR_ID && strcmp(expr->expr_data.id, iv->for_id) == 0;
+}
+
+/* Replaces i * k, k * i and i * i with the matching induction variable */
+void iv_rewrite_expr(IvLoop_t *iv, struct Expression **expr)
+{
+    struct Expression *left, *right, *step;
+    InductionVar_t *ind;
+    ListNode_t *cur;
+
+    switch((*expr)->type)
+    {
+        case EXPR_RELOP:
+            iv_rewrite_expr(iv, &(*expr)->expr_data.relop_data.left);
+            if((*expr)->expr_data.relop_data.right != NULL)
+                iv_rewrite_expr(iv, &(*expr)->expr_data.relop_data.right);
+            return;
+
+        case EXPR_SIGN_TERM:
+            iv_rewrite_expr(iv, &(*expr)->expr_data.sign_term);
+            return;
+
+        case EXPR_ADDOP:
+            iv_rewrite_expr(iv, &(*expr)->expr_data.addop_data.left_expr);
+            iv_rewrite_expr(iv, &(*expr)->expr_data.addop_data.right_term);
+            return;
+
+        /* NOTE: With bounds checks on, an index has to keep the for variable for its */
+        /*       check to be proven unneeded (see codegen_index_in_range) */
+        case EXPR_ARRAY_ACCESS:
+            if(!checks_flag())
+                iv_rewrite_expr(iv, &(*expr)->expr_data.array_access_data.array_expr);
+            return;
+
+        case EXPR_FUNCTION_CALL:
+            cur = (*expr)->expr_data.function_call_data.args_expr;
+            while(cur != NULL)
+            {
+                iv_rewrite_expr(iv, (struct Expression **)&cur->cur);
+                cur = cur->next;
+            }
+            return;
+
+        case EXPR_MULOP:
+            break;
+
+        default:
+            return;
+    }
+
+    left = (*expr)->expr_data.mulop_data.left_term;
+    right = (*expr)->expr_data.mulop_data.right_factor;
+    if((*expr)->expr_data.mulop_data.mulop_type != STAR)
+    {
+        iv_rewrite_expr(iv, &(*expr)->expr_data.mulop_data.left_term);
+        iv_rewrite_expr(iv, &(*expr)->expr_data.mulop_data.right_factor);
+        return;
+    }
+
+    /* NOTE: The for variable counts as assigned here, so it's never a step */
+    step = NULL;
+    if(iv_is_for_var(iv, left) && iv_is_for_var(iv, right))
+        step = NULL;
+    else if(iv_is_for_var(iv, left) && (right->type == EXPR_INUM ||
+        (right->type == EXPR_VAR_ID && licm_invariant(&iv->licm, right))))
+        step = right;
+    else if(iv_is_for_var(iv, right) && (left->type == EXPR_INUM ||
+        (left->type == EXPR_VAR_ID && licm_invariant(&iv->licm, left))))
+        step = left;
+    else
+    {
+        iv_rewrite_expr(iv, &(*expr)->expr_data.mulop_data.left_term);
+        iv_rewrite_expr(iv, &(*expr)->expr_data.mulop_data.right_factor);
+        return;
+    }
+
+    #ifdef DEBUG_OPTIMIZER
+        fprintf(stderr, "OPTIMIZER: Reducing multiply by induction variable %s on line %d\n",
+            iv->for_id, (*expr)->line_num);
+    #endif
+
+    ind = iv_find(iv, step, (*expr)->line_num);
+    step = mk_varid((*expr)->line_num, tree_strdup(ind->id));
+    destroy_expr(*expr);
+    *expr = step;
+}
+
+/* The induction variable for i * step (i * i when step is NULL), made if new */
+InductionVar_t *iv_find(IvLoop_t *iv, struct Expression *step, int line_num)
+{
+    InductionVar_t *ind;
+    int i;
+
+    for(i = 0; i < iv->num_ivs; ++i)
+    {
+        ind = &iv->ivs[i];
+        if(ind->step == NULL || step == NULL)
+        {
+            if(ind->step == step)
+                return ind;
+        }
+        else if(ind->step->type == step->type && (step->type == EXPR_INUM ?
+            ind->step->expr_data.i_num == step->expr_data.i_num :
+            strcmp(ind->step->expr_data.id, step->expr_data.id) == 0))
+        {
+            return ind;
+        }
+    }
+
+    iv->ivs = (InductionVar_t *)realloc(iv->ivs, (iv->num_ivs + 1) * sizeof(InductionVar_t));
+    assert(iv->ivs != NULL);
+    ind = &iv->ivs[iv->num_ivs++];
+
+    ind->id = add_temp_local(iv->licm.decls, "$iv", line_num);
+    ind->step = (step == NULL) ? NULL : iv_copy_step(step, line_num);
+    ind->odd_id = (step == NULL) ? add_temp_local(iv->licm.decls, "$iv", line_num) : NULL;
+
+    return ind;
+}
+
+
+/******** COMMON SUBEXPRESSION ELIMINATION ********/
+
+/* How many trees were computed once, and how many times they were used in total */
+int num_cse_exprs = 0;
+int num_cse_uses = 0;
+
+/* Entry point for a program or subprogram body */
+void eliminate_common_subexprs(ListNode_t *args, ListNode_t **decls, struct Statement **body)
+{
+    Cse_t cse;
+
+    if(*body == NULL)
+        return;
+
+    cse.args = args;
+    cse.decls = decls;
+    cse.num_stmts = 0;
+    cse.stmts = NULL;
+    cse.num_avail = 0;
+    cse.avail = NULL;
+
+    cse_stmt(&cse, body);
+
+    free(cse.stmts);
+    free(cse.avail);
+}
+
+/* Finds blocks */
+void cse_stmt(Cse_t *cse, struct Statement **stmt)
+{
+    ListNode_t *node;
+
+    switch((*stmt)->type)
+    {
+        case STMT_COMPOUND_STATEMENT:
+            cse->num_stmts = 0;
+            cse->num_avail = 0;
+            cse_block(cse, (*stmt)->stmt_data.compound_statement);
+            cse->num_stmts = 0;
+            cse->num_avail = 0;
+            break;
+
+        /* A block of one, becomes a compound statement if anything is computed early */
+        case STMT_VAR_ASSIGN:
+        case STMT_PROCEDURE_CALL:
+            node = mk_listnode(*stmt, LIST_STMT);
+            cse->num_stmts = 0;
+            cse->num_avail = 0;
+            cse_block(cse, node);
+            cse->num_stmts = 0;
+            cse->num_avail = 0;
+            if(node->next != NULL)
+                *stmt = mk_compoundstatement((*stmt)->line_num, node);
+            break;
+
+        case STMT_IF_THEN:
+            cse_stmt(cse, &(*stmt)->stmt_data.if_then_data.if_stmt);
+            if((*stmt)->stmt_data.if_then_data.else_stmt != NULL)
+                cse_stmt(cse, &(*stmt)->stmt_data.if_then_data.else_stmt);
+            break;
+
+        case STMT_WHILE:
+            cse_stmt(cse, &(*stmt)->stmt_data.while_data.while_stmt);
+            break;
+
+        case STMT_FOR:
+            cse_stmt(cse, &(*stmt)->stmt_data.for_data.do_for);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Numbers every block of a statement list */
+/* NOTE: Nested compound statements are part of the block, any other statement ends it */
+/* and has its own blocks found */
+void cse_block(Cse_t *cse, ListNode_t *stmts)
+{
+    struct Statement *stmt;
+
+    while(stmts != NULL)
+    {
+        stmt = (struct Statement *)stmts->cur;
+        if(stmt->type == STMT_VAR_ASSIGN || stmt->type == STMT_PROCEDURE_CALL)
+        {
+            cse_block_stmt(cse, stmts);
+        }
+        else if(stmt->type == STMT_COMPOUND_STATEMENT)
+        {
+            cse_block(cse, stmt->stmt_data.compound_statement);
+        }
+        else
+        {
+            cse_stmt(cse, (struct Statement **)&stmts->cur);
+            cse->num_stmts = 0;
+            cse->num_avail = 0;
+        }
+
+        /* Nodes are only ever added after the one holding a statement */
+        while(stmts != NULL && stmts->cur != stmt)
+            stmts = stmts->next;
+        stmts = stmts->next;
+    }
+}
+
+/* Numbers the expressions of one statement of the block, in evaluation order */
+void cse_block_stmt(Cse_t *cse, ListNode_t *node)
+{
+    struct Statement *stmt;
+    struct Expression *var;
+    ListNode_t *cur;
+
+    cse->stmts = (ListNode_t **)realloc(cse->stmts, (cse->num_stmts + 1) * sizeof(ListNode_t *));
+    assert(cse->stmts != NULL);
+    cse->stmts[cse->num_stmts++] = node;
+
+    stmt = (struct Statement *)node->cur;
+    if(stmt->type == STMT_VAR_ASSIGN)
+    {
+        var = stmt->stmt_data.var_assign_data.var;
+        if(var->type == EXPR_ARRAY_ACCESS)
+            cse_expr(cse, &var->expr_data.array_access_data.array_expr);
+        cse_expr(cse, &stmt->stmt_data.var_assign_data.expr);
+
+        /* NOTE: Array elements are never part of a tree */
+        if(var->type == EXPR_VAR_ID)
+            cse_kill(cse, var->expr_data.id);
+        return;
+    }
+
+    cur = stmt->stmt_data.procedure_call_data.expr_args;
+    if(strcmp(stmt->stmt_data.procedure_call_data.id, "read") == 0)
+    {
+        while(cur != NULL)
+        {
+            var = (struct Expression *)cur->cur;
+            if(var->type == EXPR_VAR_ID)
+                cse_kill(cse, var->expr_data.id);
+            cur = cur->next;
+        }
+        return;
+    }
+
+    while(cur != NULL)
+    {
+        cse_expr(cse, (struct Expression **)&cur->cur);
+        cur = cur->next;
+    }
+
+    /* Nested subprograms can change our variables with non-local on */
+    if(strcmp(stmt->stmt_data.procedure_call_data.id, "write") != 0 && nonlocal_flag())
+        cse->num_avail = 0;
+}
+
+/* Whether expr is arithmetic on numbers and local integer variables, reading at least one */
+/* Returns 2 if it reads a variable, 1 if it only has numbers */
+int cse_candidate(Cse_t *cse, struct Expression *expr)
+{
+    int left, right;
+
+    switch(expr->type)
+    {
+        case EXPR_INUM:
+            return 1;
+
+        case EXPR_VAR_ID:
+            return (licm_is_local(cse->args, expr->expr_data.id) ||
+                licm_is_local(*cse->decls, expr->expr_data.id)) ? 2 : 0;
+
+        case EXPR_SIGN_TERM:
+            return cse_candidate(cse, expr->expr_data.sign_term);
+
+        case EXPR_ADDOP:
+            if(expr->expr_data.addop_data.addop_type != PLUS &&
+                expr->expr_data.addop_data.addop_type != MINUS)
+            {
+                return 0;
+            }
+            left = cse_candidate(cse, expr->expr_data.addop_data.left_expr);
+            right = cse_candidate(cse, expr->expr_data.addop_data.right_term);
+            return (left == 0 || right == 0) ? 0 : ((left > right) ? left : right);
+
+        case EXPR_MULOP:
+            if(expr->expr_data.mulop_data.mulop_type != STAR &&
+                expr->expr_data.mulop_data.mulop_type != SLASH)
+            {
+                return 0;
+            }
+            left = cse_candidate(cse, expr->expr_data.mulop_data.left_term);
+            right = cse_candidate(cse, expr->expr_data.mulop_data.right_factor);
+            return (left == 0 || right == 0) ? 0 : ((left > right) ? left : right);
+
+        default:
+            return 0;
+    }
+}
+
+/* Whether two candidate trees compute the same value */
+int cse_equal(struct Expression *a, struct Expression *b)
+{
+    struct Expression *a_left, *a_right, *b_left, *b_right;
+    int commutes;
+
+    if(a->type != b->type)
+        return 0;
+
+    switch(a->type)
+    {
+        case EXPR_INUM:
+            return a->expr_data.i_num == b->expr_data.i_num;
+
+        case EXPR_VAR_ID:
+            return strcmp(a->expr_data.id, b->expr_data.id) == 0;
+
+        case EXPR_SIGN_TERM:
+            return cse_equal(a->expr_data.sign_term, b->expr_data.sign_term);
+
+        case EXPR_ADDOP:
+            if(a->expr_data.addop_data.addop_type != b->expr_data.addop_data.addop_type)
+                return 0;
+            commutes = (a->expr_data.addop_data.addop_type == PLUS);
+            a_left = a->expr_data.addop_data.left_expr;
+            a_right = a->expr_data.addop_data.right_term;
+            b_left = b->expr_data.addop_data.left_expr;
+            b_right = b->expr_data.addop_data.right_term;
+            break;
+
+        case EXPR_MULOP:
+            if(a->expr_data.mulop_data.mulop_type != b->expr_data.mulop_data.mulop_type)
+                return 0;
+            commutes = (a->expr_data.mulop_data.mulop_type == STAR);
+            a_left = a->expr_data.mulop_data.left_term;
+            a_right = a->expr_data.mulop_data.right_factor;
+            b_left = b->expr_data.mulop_data.left_term;
+            b_right = b->expr_data.mulop_data.right_factor;
+            break;
+
+        default:
+            return 0;
+    }
+
+    if(cse_equal(a_left, b_left) && cse_equal(a_right, b_right))
+        return 1;
+    return commutes && cse_equal(a_left, b_right) && cse_equal(a_right, b_left);
+}
+
+/* Whether expr reads id */
+int cse_reads(struct Expression *expr, char *id)
+{
+    switch(expr->type)
+    {
+        case EXPR_VAR_ID:
+            return strcmp(expr->expr_data.id, id) == 0;
+        case EXPR_SIGN_TERM:
+            return cse_reads(expr->expr_data.sign_term, id);
+        case EXPR_ADDOP:
+            return cse_reads(expr->expr_data.addop_data.left_expr, id) ||
+                cse_reads(expr->expr_data.addop_data.right_term, id);
+        case EXPR_MULOP:
+            return cse_reads(expr->expr_data.mulop_data.left_term, id) ||
+                cse_reads(expr->expr_data.mulop_data.right_factor, id);
+        default:
+            return 0;
+    }
+}
+
+/* Forgets every tree reading id */
+void cse_kill(Cse_t *cse, char *id)
+{
+    int i, num_kept;
+
+    num_kept = 0;
+    for(i = 0; i < cse->num_avail; ++i)
+        if(!cse_reads(cse->avail[i].expr, id))
+            cse->avail[num_kept++] = cse->avail[i];
+    cse->num_avail = num_kept;
+}
+
+/* Prints a candidate tree the way it would be written */
+void cse_print_expr(FILE *f, struct Expression *expr)
+{
+    switch(expr->type)
+    {
+        case EXPR_INUM:
+            fprintf(f, "%d", expr->expr_data.i_num);
+            break;
+        case EXPR_VAR_ID:
+            fprintf(f, "%s", expr->expr_data.id);
+            break;
+        case EXPR_SIGN_TERM:
+            fprintf(f, "-(");
+            cse_print_expr(f, expr->expr_data.sign_term);
+            fprintf(f, ")");
+            break;
+        case EXPR_ADDOP:
+            fprintf(f, "(");
+            cse_print_expr(f, expr->expr_data.addop_data.left_expr);
+            fprintf(f, (expr->expr_data.addop_data.addop_type == PLUS) ? " + " : " - ");
+            cse_print_expr(f, expr->expr_data.addop_data.right_term);
+            fprintf(f, ")");
+            break;
+        case EXPR_MULOP:
+            fprintf(f, "(");
+            cse_print_expr(f, expr->expr_data.mulop_data.left_term);
+            fprintf(f, (expr->expr_data.mulop_data.mulop_type == STAR) ? " * " : " / ");
+            cse_print_expr(f, expr->expr_data.mulop_data.right_factor);
+            fprintf(f, ")");
+            break;
+        default:
+            break;
+    }
+}
+
+/* The local holding an available tree, computing it early on its first reuse */
+char *cse_reuse(Cse_t *cse, CseExpr_t *avail)
+{
+    struct Expression *expr;
+    ListNode_t *node, *moved;
+    int line_num;
+
+    ++num_cse_uses;
+    if(avail->temp != NULL)
+        return avail->temp;
+
+    expr = avail->expr;
+    line_num = expr->line_num;
+
+    #ifdef DEBUG_OPTIMIZER
+        fprintf(stderr, "OPTIMIZER: Computing common subexpression ");
+        cse_print_expr(stderr, expr);
+        fprintf(stderr, " on line %d once\n", line_num);
+    #endif
+
+    avail->temp = add_temp_local(cse->decls, "$cse", line_num);
+    *avail->site = mk_varid(line_num, tree_strdup(avail->temp));
+
+    /* The statement moves to a new node after its own, which now computes the tree */
+    node = cse->stmts[avail->stmt_index];
+    moved = mk_listnode(node->cur, LIST_STMT);
+    moved->next = node->next;
+    node->next = moved;
+    node->cur = mk_varassign(line_num, mk_varid(line_num, tree_strdup(avail->temp)), expr);
+    cse->stmts[avail->stmt_index] = moved;
+
+    ++num_cse_exprs;
+    ++num_cse_uses;
+    return avail->temp;
+}
+
+/* Numbers the trees of expr, children first, replacing the ones already available */
+void cse_expr(Cse_t *cse, struct Expression **expr)
+{
+    CseExpr_t *avail;
+    ListNode_t *cur;
+    char *temp;
+    int i, line_num;
+
+    switch((*expr)->type)
+    {
+        case EXPR_INUM:
+        case EXPR_VAR_ID:
+        case EXPR_RNUM:
+            return;
+
+        case EXPR_RELOP:
+            cse_expr(cse, &(*expr)->expr_data.relop_data.left);
+            if((*expr)->expr_data.relop_data.right != NULL)
+                cse_expr(cse, &(*expr)->expr_data.relop_data.right);
+            return;
+
+        case EXPR_ARRAY_ACCESS:
+            cse_expr(cse, &(*expr)->expr_data.array_access_data.array_expr);
+            return;
+
+        case EXPR_FUNCTION_CALL:
+            cur = (*expr)->expr_data.function_call_data.args_expr;
+            while(cur != NULL)
+            {
+                cse_expr(cse, (struct Expression **)&cur->cur);
+                cur = cur->next;
+            }
+            return;
+
+        case EXPR_SIGN_TERM:
+            cse_expr(cse, &(*expr)->expr_data.sign_term);
+            break;
+
+        case EXPR_ADDOP:
+            cse_expr(cse, &(*expr)->expr_data.addop_data.left_expr);
+            cse_expr(cse, &(*expr)->expr_data.addop_data.right_term);
+            break;
+
+        case EXPR_MULOP:
+            cse_expr(cse, &(*expr)->expr_data.mulop_data.left_term);
+            cse_expr(cse, &(*expr)->expr_data.mulop_data.right_factor);
+            break;
+
+        default:
+            return;
+    }
+
+    if(cse_candidate(cse, *expr) != 2)
+        return;
+
+    for(i = 0; i < cse->num_avail; ++i)
+    {
+        if(cse_equal(cse->avail[i].expr, *expr))
+        {
+            line_num = (*expr)->line_num;
+            temp = cse_reuse(cse, &cse->avail[i]);
+            destroy_expr(*expr);
+            *expr = mk_varid(line_num, tree_strdup(temp));
+            return;
+        }
+    }
+
+    cse->avail = (CseExpr_t *)realloc(cse->avail, (cse->num_avail + 1) * sizeof(CseExpr_t));
+    assert(cse->avail != NULL);
+    avail = &cse->avail[cse->num_avail++];
+    avail->expr = *expr;
+    avail->site = expr;
+    avail->stmt_index = cse->num_stmts - 1;
+    avail->temp = NULL;
+}
+
+/* Prints how many common subexpressions were computed once */
+void print_cse_stats(FILE *f)
+{
+    if(num_cse_exprs > 0)
+        fprintf(f, "CSE: %d common subexpressions computed once for %d uses\n",
+            num_cse_exprs, num_cse_uses);
 }
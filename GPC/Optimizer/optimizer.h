@@ -24,4 +24,8 @@
 
 void optimize(SymTab_t *, Tree_t *);
 
+/* Folds an integer operation the way generated code computes it */
+/* Returns 0 if it has to be left for runtime (division by zero or overflow) */
+int fold_int_op(int type, int left, int right, int *result);
+
 #endif
@@ -0,0 +1,151 @@
+/*
+    Damon Gwinn
+    Bump allocator for objects that all die at the same time (ex: the parse tree)
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "Arena.h"
+
+/* Allocates a new chunk that can hold at least size bytes */
+/* Oversized chunks go behind the current chunk so its free space isn't lost */
+ArenaChunk_t *arena_new_chunk(Arena_t *arena, size_t size)
+{
+    ArenaChunk_t *chunk;
+    int oversized;
+
+    oversized = (size > arena->chunk_size);
+    if(!oversized)
+        size = arena->chunk_size;
+
+    chunk = (ArenaChunk_t *)malloc(sizeof(ArenaChunk_t) + size);
+    if(chunk == NULL)
+    {
+        fprintf(stderr, "ERROR: Arena out of memory!\n");
+        exit(1);
+    }
+
+    chunk->size = size;
+    chunk->used = 0;
+    if(oversized && arena->chunks != NULL)
+    {
+        chunk->next = arena->chunks->next;
+        arena->chunks->next = chunk;
+    }
+    else
+    {
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+
+    arena->bytes_reserved += size;
+    ++arena->num_chunks;
+
+    return chunk;
+}
+
+/* Creates an empty arena, a chunk_size of 0 uses ARENA_CHUNK_SIZE */
+Arena_t *InitArena(size_t chunk_size)
+{
+    Arena_t *arena;
+
+    arena = (Arena_t *)malloc(sizeof(Arena_t));
+
+    arena->chunks = NULL;
+    arena->chunk_size = (chunk_size == 0) ? ARENA_CHUNK_SIZE : chunk_size;
+    arena->bytes_alloced = 0;
+    arena->bytes_reserved = 0;
+    arena->num_allocs = 0;
+    arena->num_strings = 0;
+    arena->num_chunks = 0;
+
+    return arena;
+}
+
+/* Returns uninitialized memory owned by the arena */
+void *ArenaAlloc(Arena_t *arena, size_t size)
+{
+    assert(arena != NULL);
+
+    ArenaChunk_t *chunk;
+    void *mem;
+
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+
+    chunk = arena->chunks;
+    if(chunk == NULL || chunk->size - chunk->used < size)
+        chunk = arena_new_chunk(arena, size);
+
+    mem = chunk->data + chunk->used;
+    chunk->used += size;
+
+    arena->bytes_alloced += size;
+    ++arena->num_allocs;
+
+    return mem;
+}
+
+/* Copies a c string into the arena */
+char *ArenaStrdup(Arena_t *arena, const char *str)
+{
+    assert(str != NULL);
+
+    size_t len;
+    char *new_str;
+
+    len = strlen(str) + 1;
+    new_str = (char *)ArenaAlloc(arena, len);
+    memcpy(new_str, str, len);
+    ++arena->num_strings;
+
+    return new_str;
+}
+
+/* Copies the first len chars of str into the arena as a c string */
+char *ArenaStrndup(Arena_t *arena, const char *str, size_t len)
+{
+    assert(str != NULL);
+
+    char *new_str;
+
+    new_str = (char *)ArenaAlloc(arena, len + 1);
+    memcpy(new_str, str, len);
+    new_str[len] = '\0';
+    ++arena->num_strings;
+
+    return new_str;
+}
+
+/* Frees every chunk (and everything allocated) at once */
+void DestroyArena(Arena_t *arena)
+{
+    ArenaChunk_t *cur, *next;
+
+    if(arena == NULL)
+        return;
+
+    cur = arena->chunks;
+    while(cur != NULL)
+    {
+        next = cur->next;
+        free(cur);
+        cur = next;
+    }
+
+    free(arena);
+}
+
+/* Prints allocation stats */
+void PrintArenaStats(Arena_t *arena, FILE *f, char *name)
+{
+    assert(arena != NULL);
+
+    fprintf(f, "[ARENA:%s]\n", name);
+    fprintf(f, "  Nodes allocated: %d\n", arena->num_allocs - arena->num_strings);
+    fprintf(f, "  Strings copied:  %d\n", arena->num_strings);
+    fprintf(f, "  Bytes allocated: %lu\n", (unsigned long)arena->bytes_alloced);
+    fprintf(f, "  Bytes reserved:  %lu (%d chunks)\n",
+        (unsigned long)arena->bytes_reserved, arena->num_chunks);
+}
@@ -0,0 +1,61 @@
+/*
+    Damon Gwinn
+    Bump allocator for objects that all die at the same time (ex: the parse tree)
+
+    Memory is handed out from large chunks. Individual objects are never freed,
+    the whole arena is released at once with DestroyArena.
+*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* Default chunk size, allocations bigger than this get their own chunk */
+#define ARENA_CHUNK_SIZE 65536
+
+/* Every allocation is aligned to this (enough for all tree types) */
+#define ARENA_ALIGNMENT 8
+
+typedef struct ArenaChunk ArenaChunk_t;
+typedef struct ArenaChunk
+{
+    ArenaChunk_t *next;
+    size_t size;
+    size_t used;
+    char data[];
+} ArenaChunk_t;
+
+typedef struct Arena
+{
+    ArenaChunk_t *chunks;
+    size_t chunk_size;
+
+    /* Stats */
+    size_t bytes_alloced;
+    size_t bytes_reserved;
+    int num_allocs; /* Strings included */
+    int num_strings;
+    int num_chunks;
+} Arena_t;
+
+/* Creates an empty arena, a chunk_size of 0 uses ARENA_CHUNK_SIZE */
+Arena_t *InitArena(size_t chunk_size);
+
+/* Returns uninitialized memory owned by the arena */
+void *ArenaAlloc(Arena_t *arena, size_t size);
+
+/* Copies a c string into the arena */
+char *ArenaStrdup(Arena_t *arena, const char *str);
+
+/* Copies the first len chars of str into the arena as a c string */
+char *ArenaStrndup(Arena_t *arena, const char *str, size_t len);
+
+/* Frees every chunk (and everything allocated) at once */
+void DestroyArena(Arena_t *arena);
+
+/* Prints allocation stats */
+void PrintArenaStats(Arena_t *arena, FILE *f, char *name);
+
+#endif
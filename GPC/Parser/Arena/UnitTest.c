@@ -0,0 +1,41 @@
+/*
+    Damon Gwinn
+    For unit testing the Arena
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "Arena.h"
+
+int main()
+{
+    Arena_t *arena;
+    char *str, *big;
+    int *nums, i;
+
+    arena = InitArena(64);
+
+    nums = (int *)ArenaAlloc(arena, sizeof(int) * 10);
+    for(i = 0; i < 10; ++i)
+        nums[i] = i;
+
+    str = ArenaStrdup(arena, "meow");
+    fprintf(stderr, "%s %d %d\n", str, nums[0], nums[9]);
+    fprintf(stderr, "%d\n", ((unsigned long)str % ARENA_ALIGNMENT) == 0);
+
+    /* Slice of a longer string */
+    str = ArenaStrndup(arena, "meowmeow", 4);
+    fprintf(stderr, "%s %d\n", str, (int)strlen(str));
+
+    /* Bigger than a chunk */
+    big = (char *)ArenaAlloc(arena, 1000);
+    memset(big, 'a', 1000);
+    fprintf(stderr, "%c %s\n", big[999], str);
+
+    PrintArenaStats(arena, stderr, "test");
+
+    DestroyArena(arena);
+    arena = NULL;
+    return 0;
+}
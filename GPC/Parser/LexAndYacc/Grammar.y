@@ -35,7 +35,7 @@
     /* Ident list with line numbers */
     struct ident_list
     {
-        ListNode_t *list;
+        ListHandle_t list;
         int line_num;
     } ident_list;
 
@@ -80,6 +80,9 @@
 
     /* List */
     ListNode_t *list;
+
+    /* List being built (O(1) appends) */
+    ListHandle_t list_h;
 }
 
 /* Token keywords */
@@ -144,8 +147,8 @@
 
 /* TYPES FOR THE GRAMMAR */
 %type<ident_list> identifier_list
-%type<list> declarations
-%type<list> subprogram_declarations
+%type<list_h> declarations
+%type<list_h> subprogram_declarations
 %type<stmt> compound_statement
 
 %type<type_s> type
@@ -154,10 +157,10 @@
 %type<tree> subprogram_declaration
 %type<subprogram_head_s> subprogram_head
 %type<list> arguments
-%type<list> parameter_list
+%type<list_h> parameter_list
 
-%type<list> optional_statements
-%type<list> statement_list
+%type<list_h> optional_statements
+%type<list_h> statement_list
 %type<stmt> statement
 %type<stmt> variable_assignment
 %type<stmt> procedure_statement
@@ -171,7 +174,7 @@
 %type<expr> relop_paren
 %type<expr> relop_expression_single
 
-%type<list> expression_list
+%type<list_h> expression_list
 %type<expr> expression
 %type<expr> term
 %type<expr> factor
@@ -195,7 +198,7 @@ program
      '.'
      END_OF_FILE
      {
-         parse_tree = mk_program($2.line_num, $2.id, $4.list, $7, $8, $9);
+         parse_tree = mk_program($2.line_num, $2.id, $4.list.head, $7.head, $8.head, $9);
          return -1;
      }
     ;
@@ -230,12 +233,14 @@ mulop
 identifier_list
     : ident
         {
-            $$.list = CreateListNode($1.id, LIST_STRING);
+            InitListHandle(&$$.list);
+            PushListHandleBack(&$$.list, mk_listnode($1.id, LIST_STRING));
             $$.line_num = $1.line_num; /* TODO: List of line nums */
         }
     | identifier_list ',' ident
         {
-            $$.list = PushListNodeBack($1.list, CreateListNode($3.id, LIST_STRING));
+            $$.list = $1.list;
+            PushListHandleBack(&$$.list, mk_listnode($3.id, LIST_STRING));
             $$.line_num = $1.line_num;
         }
     ;
@@ -245,16 +250,14 @@ declarations
         {
             Tree_t *tree;
             if($5.type == ARRAY)
-                tree = mk_arraydecl($3.line_num, $3.list, $5.actual_type, $5.start, $5.end);
+                tree = mk_arraydecl($3.line_num, $3.list.head, $5.actual_type, $5.start, $5.end);
             else
-                tree = mk_vardecl($3.line_num, $3.list, $5.actual_type);
+                tree = mk_vardecl($3.line_num, $3.list.head, $5.actual_type);
 
-            if($1 == NULL)
-                $$ = CreateListNode(tree, LIST_TREE);
-            else
-                $$ = PushListNodeBack($1, CreateListNode(tree, LIST_TREE));
+            $$ = $1;
+            PushListHandleBack(&$$, mk_listnode(tree, LIST_TREE));
         }
-    | /* empty */ {$$ = NULL;}
+    | /* empty */ {InitListHandle(&$$);}
     ;
 
 type
@@ -281,12 +284,10 @@ standard_type
 subprogram_declarations
     : subprogram_declarations subprogram_declaration ';'
         {
-            if($1 == NULL)
-                $$ = CreateListNode($2, LIST_TREE);
-            else
-                $$ = PushListNodeBack($1, CreateListNode($2, LIST_TREE));
+            $$ = $1;
+            PushListHandleBack(&$$, mk_listnode($2, LIST_TREE));
         }
-    | /* empty */ {$$ = NULL;}
+    | /* empty */ {InitListHandle(&$$);}
     ;
 
 subprogram_declaration
@@ -296,9 +297,10 @@ subprogram_declaration
     compound_statement
         {
             if($1.sub_type == PROCEDURE)
-                $$ = mk_procedure($1.line_num, $1.id, $1.args, $2, $3, $4);
+                $$ = mk_procedure($1.line_num, $1.id, $1.args, $2.head, $3.head, $4);
             else
-                $$ = mk_function($1.line_num, $1.id, $1.args, $2, $3, $4, $1.return_type);
+                $$ = mk_function($1.line_num, $1.id, $1.args, $2.head, $3.head, $4,
+                    $1.return_type);
         }
     ;
 
@@ -324,7 +326,7 @@ subprogram_head
     ;
 
 arguments
-    : '(' parameter_list ')' {$$ = $2;}
+    : '(' parameter_list ')' {$$ = $2.head;}
     | /* empty */ {$$ = NULL;}
     ;
 
@@ -333,44 +335,48 @@ parameter_list
         {
             Tree_t *tree;
             if($3.type == ARRAY)
-                tree = mk_arraydecl($1.line_num, $1.list, $3.actual_type, $3.start, $3.end);
+                tree = mk_arraydecl($1.line_num, $1.list.head, $3.actual_type, $3.start, $3.end);
             else
-                tree = mk_vardecl($1.line_num, $1.list, $3.actual_type);
+                tree = mk_vardecl($1.line_num, $1.list.head, $3.actual_type);
 
-            $$ = CreateListNode(tree, LIST_TREE);
+            InitListHandle(&$$);
+            PushListHandleBack(&$$, mk_listnode(tree, LIST_TREE));
         }
     | parameter_list ';' identifier_list ':' type
         {
             Tree_t *tree;
             if($5.type == ARRAY)
-                tree = mk_arraydecl($3.line_num, $3.list, $5.actual_type, $5.start, $5.end);
+                tree = mk_arraydecl($3.line_num, $3.list.head, $5.actual_type, $5.start, $5.end);
             else
-                tree = mk_vardecl($3.line_num, $3.list, $5.actual_type);
+                tree = mk_vardecl($3.line_num, $3.list.head, $5.actual_type);
 
-            $$ = PushListNodeBack($1, CreateListNode(tree, LIST_TREE));
+            $$ = $1;
+            PushListHandleBack(&$$, mk_listnode(tree, LIST_TREE));
         }
     ;
 
 compound_statement
     : BBEGIN optional_statements END
         {
-            $$ = mk_compoundstatement(line_num, $2);
+            $$ = mk_compoundstatement(line_num, $2.head);
         }
     ;
 
 optional_statements
     : statement_list {$$ = $1;}
-    | /* empty */ {$$ = NULL;}
+    | /* empty */ {InitListHandle(&$$);}
     ;
 
 statement_list
     : statement
         {
-            $$ = CreateListNode($1, LIST_STMT);
+            InitListHandle(&$$);
+            PushListHandleBack(&$$, mk_listnode($1, LIST_STMT));
         }
     | statement_list ';' statement
         {
-            $$ = PushListNodeBack($1, CreateListNode($3, LIST_STMT));
+            $$ = $1;
+            PushListHandleBack(&$$, mk_listnode($3, LIST_STMT));
         }
     ;
 
@@ -451,7 +457,7 @@ procedure_statement
         }
     | ident '(' expression_list ')'
         {
-            $$ = mk_procedurecall($1.line_num, $1.id, $3);
+            $$ = mk_procedurecall($1.line_num, $1.id, $3.head);
         }
     ;
 
@@ -498,11 +504,13 @@ relop_expression_single
 expression_list
     : expression
         {
-            $$ = CreateListNode($1, LIST_EXPR);
+            InitListHandle(&$$);
+            PushListHandleBack(&$$, mk_listnode($1, LIST_EXPR));
         }
     | expression_list ',' expression
         {
-            $$ = PushListNodeBack($1, CreateListNode($3, LIST_EXPR));
+            $$ = $1;
+            PushListHandleBack(&$$, mk_listnode($3, LIST_EXPR));
         }
     ;
 
@@ -533,7 +541,7 @@ factor
         }
     | ident '(' expression_list ')'
         {
-            $$ = mk_functioncall($1.line_num, $1.id, $3);
+            $$ = mk_functioncall($1.line_num, $1.id, $3.head);
         }
     | int_num
         {
@@ -0,0 +1,110 @@
+/*
+    Damon Gwinn
+    Lexer throughput benchmark
+
+    Scans each file given BENCH_RUNS times (in memory, the parser isn't run) with whichever
+    lexer lex.yy.o was built from and prints the tokens per second. Identifiers go to the
+    tree arena like when parsing. Comparing them:
+        make bench CCFLAGS=-O2 && ./LexBench file.p ...
+        make clean && make bench CCFLAGS=-O2 LEXER=hand && ./LexBench file.p ...
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../ParseTree/tree.h"
+#include "../ParseTree/tree_types.h"
+#include "../List/List.h"
+#include "y.tab.h"
+
+#define BENCH_RUNS 200
+
+/* Normally in y.tab.c */
+YYSTYPE yylval;
+
+extern int yylex();
+extern int lex_scan_buffer(char *base, size_t size);
+extern void lex_end_buffer();
+
+/* Reads file followed by two NUL bytes, NULL on failure */
+char *bench_read(char *file, size_t *size);
+
+int main(int argc, char **argv)
+{
+    char *source;
+    size_t size;
+    long num_tokens;
+    int i, run, token;
+    struct timespec start, stop;
+    double seconds;
+
+    if(argc < 2)
+    {
+        fprintf(stderr, "Usage: %s [Pascal File] ...\n", argv[0]);
+        return 1;
+    }
+
+    for(i = 1; i < argc; ++i)
+    {
+        source = bench_read(argv[i], &size);
+        if(source == NULL)
+        {
+            fprintf(stderr, "Error opening file: %s\n", argv[i]);
+            return 1;
+        }
+
+        num_tokens = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for(run = 0; run < BENCH_RUNS; ++run)
+        {
+            if(!lex_scan_buffer(source, size + 2))
+            {
+                fprintf(stderr, "Lexer refused the buffer for %s\n", argv[i]);
+                return 1;
+            }
+
+            init_tree_arena();
+            while((token = yylex()) != END_OF_FILE && token != 0)
+                ++num_tokens;
+            destroy_tree_arena();
+            lex_end_buffer();
+        }
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+
+        seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+        printf("%s: %ld tokens (%d runs) in %.3f s, %.0f tokens/sec\n", argv[i],
+            num_tokens, BENCH_RUNS, seconds, (seconds > 0) ? num_tokens / seconds : 0);
+
+        free(source);
+    }
+
+    return 0;
+}
+
+char *bench_read(char *file, size_t *size)
+{
+    FILE *in;
+    char *source;
+    long len;
+
+    in = fopen(file, "r");
+    if(in == NULL)
+        return NULL;
+
+    fseek(in, 0, SEEK_END);
+    len = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    if(len < 0)
+    {
+        fclose(in);
+        return NULL;
+    }
+
+    source = (char *)malloc(len + 2);
+    *size = fread(source, 1, len, in);
+    source[*size] = '\0';
+    source[*size+1] = '\0';
+
+    fclose(in);
+    return source;
+}
@@ -0,0 +1,587 @@
+/*
+    Damon Gwinn
+    Hand written scanner, built in place of the flex one from Tokenizer.l
+
+    Gives Grammar.y the same tokens as Tokenizer.l (same yylval, line_num and yyin), but:
+        - Every character is classified with one table lookup and operators come from a
+            table of what they are alone and followed by '='
+        - Keywords are looked up in a perfect hash table on their first and last
+            characters and length, and match in any case since Pascal is case insensitive
+        - Whitespace, comments and identifiers are scanned 16 bytes at a time with SSE2
+            (when the compiler targets it)
+        - The whole source is scanned in memory, either the buffer given to
+            lex_scan_buffer or all of yyin read at the first call
+
+    Built instead of Tokenizer.l with LEXER=hand (see makefile)
+
+    NOTE: Identifiers keep their case, only keywords are folded. Unlike Tokenizer.l,
+          "Begin" and "BEGIN" are the keyword and not identifiers.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
+#include "../ErrVars.h"
+#include "../ParseTree/tree.h"
+#include "../ParseTree/tree_types.h"
+#include "../List/List.h"
+#include "y.tab.h"
+
+FILE *yyin = NULL;
+
+/* What the source is scanned from, always followed by two NUL bytes */
+static char *scan_pos = NULL;
+static char *scan_end = NULL;
+
+/* Buffer read from yyin, freed once scanned */
+static char *scan_owned = NULL;
+
+#define READ_CHUNK 4096
+
+/******** CHARACTER CLASSES *********/
+#define CLASS_OTHER 0
+#define CLASS_BLANK 1
+#define CLASS_NEWLINE 2
+#define CLASS_LETTER 3
+#define CLASS_DIGIT 4
+
+static unsigned char char_class[256];
+
+/* Token for a character alone, and followed by '=' (eq_token 0 when that's two tokens) */
+/* op_val is -1 when yylval isn't set */
+typedef struct Operator
+{
+    int token, op_val;
+    int eq_token, eq_op_val;
+} Operator_t;
+
+static Operator_t operators[256];
+
+/******** KEYWORDS *********/
+typedef struct Keyword
+{
+    char *word;
+    int token, op_val;
+
+    /* For DEBUG_FLEX */
+    char *name;
+
+    int len;
+} Keyword_t;
+
+/* Lowercase, the source is folded while comparing */
+static Keyword_t keywords[] =
+{
+    {"program", PROGRAM, -1, "PROGRAM", 0},
+    {"procedure", PROCEDURE, -1, "PROCEDURE", 0},
+    {"function", FUNCTION, -1, "FUNCTION", 0},
+    {"begin", BBEGIN, -1, "BEGIN", 0},
+    {"end", END, -1, "END", 0},
+    {"var", VARIABLE, -1, "VAR", 0},
+    {"array", ARRAY, -1, "ARRAY", 0},
+    {"of", OF, -1, "OF", 0},
+    {"if", IF, -1, "IF", 0},
+    {"then", THEN, -1, "THEN", 0},
+    {"else", ELSE, -1, "ELSE", 0},
+    {"for", FOR, -1, "FOR", 0},
+    {"to", TO, -1, "TO", 0},
+    {"do", DO, -1, "DO", 0},
+    {"while", WHILE, -1, "WHILE", 0},
+    {"and", AND, -1, "AND", 0},
+    {"or", OR, -1, "OR", 0},
+    {"div", MULOP, SLASH, "MULOP:div", 0},
+    {"integer", INT_TYPE, -1, "INT_TYPE", 0},
+    {"real", REAL_TYPE, -1, "REAL_TYPE", 0},
+    {NULL, 0, -1, NULL, 0}
+};
+
+#define KEYWORD_MIN_LEN 2
+#define KEYWORD_MAX_LEN 9
+
+/* No two keywords above share a slot (checked when the table is built) */
+#define KEYWORD_TABLE_SIZE 64
+#define KEYWORD_HASH(first, last, len) \
+    (((first) + 3 * (last) + (len)) & (KEYWORD_TABLE_SIZE - 1))
+
+/* Lowercase of a letter (digits are unchanged) */
+#define FOLD(c) ((c) | 0x20)
+
+static Keyword_t *keyword_table[KEYWORD_TABLE_SIZE];
+
+static int scanner_ready = 0;
+
+/* Builds the tables, once */
+void scanner_init();
+
+/* Reads all of yyin into scan_owned */
+void scanner_read_yyin();
+
+/* The keyword len characters at word spell (in any case), NULL if not one */
+Keyword_t *scanner_keyword(char *word, int len);
+
+/* Sets yylval to the number from start to stop */
+int scanner_number(char *start, char *stop, int is_real);
+
+/* Scanning loops, each stopping at end at the latest */
+char *scan_blanks(char *p, char *end);
+char *scan_id(char *p, char *end);
+char *scan_digits(char *p, char *end);
+char *scan_comment_end(char *p, char *end);
+char *scan_newline(char *p, char *end);
+int count_newlines(char *p, char *end);
+
+#ifdef DEBUG_FLEX
+void scanner_debug(int token, char *start, char *stop);
+#endif
+
+/* Scans base in place instead of reading yyin */
+/* NOTE: size counts the two NUL bytes at the end, and the buffer must be writable */
+/*       (numbers are NUL terminated in place while converted) */
+int lex_scan_buffer(char *base, size_t size)
+{
+    if(size < 2 || base[size-2] != '\0' || base[size-1] != '\0')
+        return 0;
+
+    scanner_init();
+    scan_pos = base;
+    scan_end = base + size - 2;
+    scan_owned = NULL;
+    return 1;
+}
+
+/* Done scanning the buffer given to lex_scan_buffer (base itself is not freed) */
+void lex_end_buffer()
+{
+    if(scan_owned != NULL)
+        free(scan_owned);
+
+    scan_owned = NULL;
+    scan_pos = NULL;
+    scan_end = NULL;
+}
+
+int yylex()
+{
+    char *start, *p;
+    Operator_t *op;
+    Keyword_t *keyword;
+    int token;
+
+    if(scan_pos == NULL)
+        scanner_read_yyin();
+
+    while(1)
+    {
+        start = p = scan_blanks(scan_pos, scan_end);
+        if(p == scan_end)
+        {
+            scan_pos = p;
+            #ifdef DEBUG_FLEX
+                fprintf(stderr, "[EOF]\n");
+            #endif
+
+            /* Anything in yyin afterwards is read at the next call */
+            if(scan_owned != NULL)
+                lex_end_buffer();
+            return END_OF_FILE;
+        }
+
+        switch(char_class[(unsigned char)*p])
+        {
+            case CLASS_NEWLINE:
+                #ifdef DEBUG_FLEX
+                    fprintf(stderr, "\n");
+                #endif
+                ++line_num;
+                scan_pos = p + 1;
+                continue;
+
+            case CLASS_LETTER:
+                p = scan_id(p + 1, scan_end);
+                keyword = scanner_keyword(start, p - start);
+                if(keyword != NULL)
+                {
+                    if(keyword->op_val != -1)
+                        yylval.op_val = keyword->op_val;
+                    token = keyword->token;
+                }
+                else
+                {
+                    /* Sliced straight out of the source */
+                    yylval.id = tree_strndup(start, p - start);
+                    token = ID;
+                }
+                break;
+
+            case CLASS_DIGIT:
+                p = scan_digits(p, scan_end);
+                if(p[0] == '.' && char_class[(unsigned char)p[1]] == CLASS_DIGIT)
+                {
+                    p = scan_digits(p + 1, scan_end);
+                    token = scanner_number(start, p, 1);
+                }
+                else
+                    token = scanner_number(start, p, 0);
+                break;
+
+            default:
+                /* Comments ("(*" only starts one when it's closed) */
+                if(p[0] == '(' && p[1] == '*' &&
+                    (p = scan_comment_end(p + 2, scan_end)) != NULL)
+                {
+                    #ifdef DEBUG_FLEX
+                        fprintf(stderr, "[COMMENT] ");
+                    #endif
+                    line_num += count_newlines(start + 2, p);
+                    scan_pos = p + 2;
+                    continue;
+                }
+                p = start;
+                if(p[0] == '/' && p[1] == '/')
+                {
+                    #ifdef DEBUG_FLEX
+                        fprintf(stderr, "[COMMENT] ");
+                    #endif
+                    scan_pos = scan_newline(p + 2, scan_end);
+                    continue;
+                }
+
+                if(p[0] == '.')
+                {
+                    if(p[1] == '.')
+                    {
+                        p += 2;
+                        token = DOTDOT;
+                        break;
+                    }
+                    if(char_class[(unsigned char)p[1]] == CLASS_DIGIT)
+                    {
+                        p = scan_digits(p + 1, scan_end);
+                        token = scanner_number(start, p, 1);
+                        break;
+                    }
+                }
+
+                op = &operators[(unsigned char)*p];
+                if(op->eq_token != 0 && p[1] == '=')
+                {
+                    if(op->eq_op_val != -1)
+                        yylval.op_val = op->eq_op_val;
+                    token = op->eq_token;
+                    p += 2;
+                }
+                else
+                {
+                    if(op->op_val != -1)
+                        yylval.op_val = op->op_val;
+                    token = op->token;
+                    p += 1;
+                }
+                break;
+        }
+
+        #ifdef DEBUG_FLEX
+            scanner_debug(token, start, p);
+        #endif
+        scan_pos = p;
+        return token;
+    }
+}
+
+void scanner_init()
+{
+    int c, slot;
+    Keyword_t *keyword;
+
+    if(scanner_ready)
+        return;
+
+    for(c = 0; c < 256; ++c)
+    {
+        if(c == ' ' || c == '\t')
+            char_class[c] = CLASS_BLANK;
+        else if(c == '\n')
+            char_class[c] = CLASS_NEWLINE;
+        else if((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+            char_class[c] = CLASS_LETTER;
+        else if(c >= '0' && c <= '9')
+            char_class[c] = CLASS_DIGIT;
+        else
+            char_class[c] = CLASS_OTHER;
+
+        /* Anything else is returned as itself (a char, like yytext[0]) */
+        operators[c].token = (char)c;
+        operators[c].op_val = -1;
+        operators[c].eq_token = 0;
+        operators[c].eq_op_val = -1;
+    }
+
+    operators['*'] = (Operator_t){MULOP, STAR, 0, -1};
+    operators['/'] = (Operator_t){MULOP, SLASH, 0, -1};
+    operators['+'] = (Operator_t){ADDOP, PLUS, 0, -1};
+    operators['-'] = (Operator_t){ADDOP, MINUS, 0, -1};
+    operators['='] = (Operator_t){RELOP, EQ, 0, -1};
+    operators['>'] = (Operator_t){RELOP, GT, RELOP, GE};
+    operators['<'] = (Operator_t){RELOP, LT, RELOP, LE};
+    operators['!'] = (Operator_t){'!', -1, RELOP, NE};
+    operators[':'] = (Operator_t){':', -1, ASSIGNOP, -1};
+
+    memset(keyword_table, 0, sizeof(keyword_table));
+    for(keyword = keywords; keyword->word != NULL; ++keyword)
+    {
+        keyword->len = strlen(keyword->word);
+        assert(keyword->len >= KEYWORD_MIN_LEN && keyword->len <= KEYWORD_MAX_LEN);
+
+        slot = KEYWORD_HASH(keyword->word[0], keyword->word[keyword->len-1], keyword->len);
+        if(keyword_table[slot] != NULL)
+        {
+            fprintf(stderr, "Keywords %s and %s share a slot, change KEYWORD_HASH!\n",
+                keyword_table[slot]->word, keyword->word);
+            exit(1);
+        }
+        keyword_table[slot] = keyword;
+    }
+
+    scanner_ready = 1;
+}
+
+void scanner_read_yyin()
+{
+    size_t size, capacity, num_read;
+
+    scanner_init();
+    if(yyin == NULL)
+        yyin = stdin;
+
+    size = 0;
+    capacity = READ_CHUNK;
+    scan_owned = (char *)malloc(capacity);
+    assert(scan_owned != NULL);
+    while((num_read = fread(scan_owned + size, 1, capacity - size - 2, yyin)) > 0)
+    {
+        size += num_read;
+        if(capacity - size - 2 == 0)
+        {
+            capacity *= 2;
+            scan_owned = (char *)realloc(scan_owned, capacity);
+            assert(scan_owned != NULL);
+        }
+    }
+
+    scan_owned[size] = '\0';
+    scan_owned[size+1] = '\0';
+    scan_pos = scan_owned;
+    scan_end = scan_owned + size;
+}
+
+Keyword_t *scanner_keyword(char *word, int len)
+{
+    Keyword_t *keyword;
+    int i;
+
+    if(len < KEYWORD_MIN_LEN || len > KEYWORD_MAX_LEN)
+        return NULL;
+
+    keyword = keyword_table[KEYWORD_HASH(FOLD(word[0]), FOLD(word[len-1]), len)];
+    if(keyword == NULL || keyword->len != len)
+        return NULL;
+
+    for(i = 0; i < len; ++i)
+        if(FOLD(word[i]) != keyword->word[i])
+            return NULL;
+
+    return keyword;
+}
+
+/* Converts in place like flex does, NUL terminating the number for a moment */
+int scanner_number(char *start, char *stop, int is_real)
+{
+    char saved;
+
+    saved = *stop;
+    *stop = '\0';
+    if(is_real)
+        yylval.f_val = atof(start);
+    else
+        yylval.i_val = atoi(start);
+    *stop = saved;
+
+    return (is_real) ? REAL_NUM : INT_NUM;
+}
+
+/******** SCANNING LOOPS *********/
+/* The SSE2 versions look at 16 bytes at once while that many are left, finishing with */
+/* the plain loop (bytes past end are never read) */
+
+char *scan_blanks(char *p, char *end)
+{
+    #ifdef __SSE2__
+        __m128i chunk, space, tab;
+        int mask;
+
+        space = _mm_set1_epi8(' ');
+        tab = _mm_set1_epi8('\t');
+        while(end - p >= 16)
+        {
+            chunk = _mm_loadu_si128((__m128i *)p);
+            mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, space),
+                _mm_cmpeq_epi8(chunk, tab)));
+            if(mask != 0xFFFF)
+                return p + __builtin_ctz(~mask);
+            p += 16;
+        }
+    #endif
+
+    while(p < end && char_class[(unsigned char)*p] == CLASS_BLANK)
+        ++p;
+    return p;
+}
+
+/* Past the letters and digits starting at p */
+char *scan_id(char *p, char *end)
+{
+    #ifdef __SSE2__
+        __m128i chunk, folded, letter, digit;
+        int mask;
+
+        while(end - p >= 16)
+        {
+            /* Bytes above 127 are negative, so never in either range */
+            chunk = _mm_loadu_si128((__m128i *)p);
+            folded = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+            letter = _mm_and_si128(_mm_cmpgt_epi8(folded, _mm_set1_epi8('a' - 1)),
+                _mm_cmplt_epi8(folded, _mm_set1_epi8('z' + 1)));
+            digit = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('0' - 1)),
+                _mm_cmplt_epi8(chunk, _mm_set1_epi8('9' + 1)));
+            mask = _mm_movemask_epi8(_mm_or_si128(letter, digit));
+            if(mask != 0xFFFF)
+                return p + __builtin_ctz(~mask);
+            p += 16;
+        }
+    #endif
+
+    while(p < end && (char_class[(unsigned char)*p] == CLASS_LETTER ||
+        char_class[(unsigned char)*p] == CLASS_DIGIT))
+    {
+        ++p;
+    }
+    return p;
+}
+
+/* Numbers are short, not worth the setup */
+char *scan_digits(char *p, char *end)
+{
+    while(p < end && char_class[(unsigned char)*p] == CLASS_DIGIT)
+        ++p;
+    return p;
+}
+
+/* The first "*)" from p on, NULL if there isn't one */
+char *scan_comment_end(char *p, char *end)
+{
+    #ifdef __SSE2__
+        __m128i star;
+        int mask;
+
+        star = _mm_set1_epi8('*');
+        while(end - p >= 16)
+        {
+            mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i *)p), star));
+            while(mask != 0)
+            {
+                /* One past the chunk is at worst the NUL after end */
+                if(p[__builtin_ctz(mask) + 1] == ')')
+                    return p + __builtin_ctz(mask);
+                mask &= mask - 1;
+            }
+            p += 16;
+        }
+    #endif
+
+    for(; p < end; ++p)
+        if(p[0] == '*' && p[1] == ')')
+            return p;
+    return NULL;
+}
+
+/* The first newline from p on (end if there isn't one) */
+char *scan_newline(char *p, char *end)
+{
+    #ifdef __SSE2__
+        __m128i newline;
+        int mask;
+
+        newline = _mm_set1_epi8('\n');
+        while(end - p >= 16)
+        {
+            mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i *)p), newline));
+            if(mask != 0)
+                return p + __builtin_ctz(mask);
+            p += 16;
+        }
+    #endif
+
+    while(p < end && *p != '\n')
+        ++p;
+    return p;
+}
+
+int count_newlines(char *p, char *end)
+{
+    int count;
+    #ifdef __SSE2__
+        __m128i newline;
+    #endif
+
+    count = 0;
+    #ifdef __SSE2__
+        newline = _mm_set1_epi8('\n');
+        while(end - p >= 16)
+        {
+            count += __builtin_popcount(_mm_movemask_epi8(
+                _mm_cmpeq_epi8(_mm_loadu_si128((__m128i *)p), newline)));
+            p += 16;
+        }
+    #endif
+
+    for(; p < end; ++p)
+        if(*p == '\n')
+            ++count;
+    return count;
+}
+
+#ifdef DEBUG_FLEX
+/* Prints the token like Tokenizer.l does */
+void scanner_debug(int token, char *start, char *stop)
+{
+    Keyword_t *keyword;
+    int len;
+
+    len = stop - start;
+    keyword = (token != ID) ? scanner_keyword(start, len) : NULL;
+    if(keyword != NULL)
+        fprintf(stderr, "[%s] ", keyword->name);
+    else if(token == ID)
+        fprintf(stderr, "[ID:%s] ", yylval.id);
+    else if(token == INT_NUM)
+        fprintf(stderr, "[INT_NUM:%d] ", yylval.i_val);
+    else if(token == REAL_NUM)
+        fprintf(stderr, "[REAL_NUM:%f] ", yylval.f_val);
+    else if(token == DOTDOT)
+        fprintf(stderr, "[DOTDOT] ");
+    else if(token == ASSIGNOP)
+        fprintf(stderr, "[ASSIGNOP] ");
+    else if(token == RELOP)
+        fprintf(stderr, "[RELOP:%.*s] ", len, start);
+    else if(token == MULOP)
+        fprintf(stderr, "[MULOP:%.*s] ", len, start);
+    else if(token == ADDOP)
+        fprintf(stderr, "[ADDOP:%.*s] ", len, start);
+    else
+        fprintf(stderr, "{%.*s} ", len, start);
+}
+#endif
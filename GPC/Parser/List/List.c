@@ -23,6 +23,34 @@ ListNode_t *CreateListNode(void *new_obj, enum ListType type)
     return new_node;
 }
 
+/* Sets a handle to the empty list */
+void InitListHandle(ListHandle_t *handle)
+{
+    assert(handle != NULL);
+
+    handle->head = NULL;
+    handle->tail = NULL;
+    handle->length = 0;
+}
+
+/* Appends to the back of the handle's list in O(1) */
+ListHandle_t *PushListHandleBack(ListHandle_t *handle, ListNode_t *new_node)
+{
+    assert(handle != NULL);
+    assert(new_node != NULL);
+
+    new_node->next = NULL;
+    if(handle->tail == NULL)
+        handle->head = new_node;
+    else
+        handle->tail->next = new_node;
+
+    handle->tail = new_node;
+    ++handle->length;
+
+    return handle;
+}
+
 /* Implemented FIFO style */
 ListNode_t *PushListNodeFront(ListNode_t *head_node, ListNode_t *new_head)
 {
@@ -24,15 +24,31 @@ typedef struct List
     ListNode_t *next;
 } ListNode_t;
 
+/* Handle to a list that also tracks its tail and length */
+/* Use this when building lists by appending (O(1) instead of walking the list) */
+typedef struct ListHandle
+{
+    ListNode_t *head;
+    ListNode_t *tail;
+    int length;
+} ListHandle_t;
+
 /* Creates a list node */
 ListNode_t *CreateListNode(void *new_obj, enum ListType type);
 
+/* Sets a handle to the empty list */
+void InitListHandle(ListHandle_t *handle);
+
+/* Appends to the back of the handle's list in O(1) */
+/* Returns the given handle */
+ListHandle_t *PushListHandleBack(ListHandle_t *handle, ListNode_t *new_node);
+
 /* This is FIFO style */
 /* Returns the new head node */
 ListNode_t *PushListNodeFront(ListNode_t *head_node, ListNode_t *new_head);
 
 /* This is a traditional array style */
-/* TODO: Make more efficient */
+/* NOTE: Walks the whole list, use a ListHandle_t when appending repeatedly */
 /* Returns the head node */
 ListNode_t *PushListNodeBack(ListNode_t *head_node, ListNode_t *new_node);
 
@@ -20,5 +20,15 @@ int main()
     fprintf(stderr, "%d, %d, %d\n", head->type, head->next->type, head->next->next->type);
 
     DestroyList(head);
+
+    ListHandle_t handle;
+    InitListHandle(&handle);
+    PushListHandleBack(&handle, CreateListNode(NULL, LIST_TREE));
+    PushListHandleBack(&handle, CreateListNode(NULL, LIST_STMT));
+    PushListHandleBack(&handle, CreateListNode(NULL, LIST_EXPR));
+    PrintList(handle.head, stderr, 0);
+    fprintf(stderr, "%d, %d\n", handle.length, handle.tail->type);
+
+    DestroyList(handle.head);
     return 0;
 }
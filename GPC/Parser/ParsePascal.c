@@ -5,6 +5,10 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "ParsePascal.h"
 #include "ErrVars.h"
 #include "ParseTree/tree.h"
@@ -15,22 +19,38 @@
 
 extern FILE *yyin;
 extern int yyparse();
+extern int lex_scan_buffer(char *base, size_t size);
+extern void lex_end_buffer();
 
 /* Initializes parser globals */
 void InitParser();
 
+char *map_source(char *file, size_t *size, size_t *map_size);
+
 Tree_t *ParsePascal(char *file)
 {
     int semcheck_return;
+    char *source;
+    size_t size, map_size;
 
     /**** CREATING THE PARSE TREE ****/
+    source = NULL;
     if(file != NULL)
     {
-        yyin = fopen(file, "r");
-        if(yyin == NULL)
+        /* The lexer scans the file in memory when it can be mapped, else reads it */
+        source = map_source(file, &size, &map_size);
+        if(source == NULL || !lex_scan_buffer(source, size + 2))
         {
-            fprintf(stderr, "Error opening file: %s\n", file);
-            exit(1);
+            if(source != NULL)
+                munmap(source, map_size);
+            source = NULL;
+
+            yyin = fopen(file, "r");
+            if(yyin == NULL)
+            {
+                fprintf(stderr, "Error opening file: %s\n", file);
+                exit(1);
+            }
         }
         file_to_parse = file;
     }
@@ -40,6 +60,13 @@ Tree_t *ParsePascal(char *file)
     InitParser();
     yyparse();
 
+    /* Tokens are copied into the tree, nothing points into the source anymore */
+    if(source != NULL)
+    {
+        lex_end_buffer();
+        munmap(source, map_size);
+    }
+
     #ifdef DEBUG_BISON
         if(parse_tree != NULL)
             tree_print(parse_tree, stderr, 0);
@@ -66,3 +93,48 @@ void InitParser()
     col_num = 1;
     parse_tree = NULL;
 }
+
+/* Maps a regular file into memory followed by the two NUL bytes the lexer needs */
+/* Returns NULL if it can't be mapped (ex: empty or not a regular file) */
+/* NOTE: The mapping is private and writable, the lexer writes to it but never the file */
+char *map_source(char *file, size_t *size, size_t *map_size)
+{
+    struct stat file_stat;
+    char *base;
+    long page_size;
+    int fd;
+
+    fd = open(file, O_RDONLY);
+    if(fd < 0)
+        return NULL;
+
+    if(fstat(fd, &file_stat) < 0 || !S_ISREG(file_stat.st_mode) || file_stat.st_size == 0)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    page_size = sysconf(_SC_PAGESIZE);
+    *size = (size_t)file_stat.st_size;
+    *map_size = (*size + 2 + page_size - 1) / page_size * page_size;
+
+    /* Zeroed pages with the file laid over the start, so whatever follows it is NUL */
+    base = (char *)mmap(NULL, *map_size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(base == MAP_FAILED)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    if(mmap(base, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        munmap(base, *map_size);
+        close(fd);
+        return NULL;
+    }
+
+    close(fd);
+    madvise(base, *size, MADV_SEQUENTIAL);
+    return base;
+}
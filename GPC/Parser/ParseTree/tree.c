@@ -8,8 +8,63 @@
 #include "../LexAndYacc/y.tab.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 
+Arena_t *tree_arena = NULL;
+
+/* Tree memory */
+void init_tree_arena()
+{
+    assert(tree_arena == NULL);
+    tree_arena = InitArena(0);
+}
+
+/* Releases the whole tree at once */
+void destroy_tree_arena()
+{
+    DestroyArena(tree_arena);
+    tree_arena = NULL;
+}
+
+void print_tree_arena_stats(FILE *f)
+{
+    if(tree_arena != NULL)
+        PrintArenaStats(tree_arena, f, "parse tree");
+}
+
+void *tree_alloc(size_t size)
+{
+    if(tree_arena != NULL)
+        return ArenaAlloc(tree_arena, size);
+
+    return malloc(size);
+}
+
+char *tree_strdup(char *str)
+{
+    if(tree_arena != NULL)
+        return ArenaStrdup(tree_arena, str);
+
+    return strdup(str);
+}
+
+/* Copies len chars of str, which doesn't have to end there (ex: a token in the source) */
+char *tree_strndup(char *str, size_t len)
+{
+    if(tree_arena != NULL)
+        return ArenaStrndup(tree_arena, str, len);
+
+    return strndup(str, len);
+}
+
+/* Only frees when not using the arena */
+void tree_free(void *ptr)
+{
+    if(tree_arena == NULL)
+        free(ptr);
+}
+
 /* NOTE: tree_print and destroy_tree implicitely call stmt and expr functions */
 /* Tree printing */
 void print_indent(FILE *f, int num_indent)
@@ -310,6 +365,11 @@ void expr_print(struct Expression *expr, FILE *f, int num_indent)
 void destroy_list(ListNode_t *list)
 {
     ListNode_t *cur, *prev;
+
+    /* Arena will free everything at once */
+    if(tree_arena != NULL)
+        return;
+
     if(list != NULL)
     {
         cur = list;
@@ -343,6 +403,9 @@ void destroy_list(ListNode_t *list)
 
 void destroy_tree(Tree_t *tree)
 {
+    if(tree_arena != NULL)
+        return;
+
     switch(tree->type)
     {
         case TREE_PROGRAM_TYPE:
@@ -385,6 +448,9 @@ void destroy_tree(Tree_t *tree)
 
 void destroy_stmt(struct Statement *stmt)
 {
+    if(tree_arena != NULL)
+        return;
+
     switch(stmt->type)
     {
         case STMT_VAR_ASSIGN:
@@ -443,6 +509,9 @@ void destroy_stmt(struct Statement *stmt)
 
 void destroy_expr(struct Expression *expr)
 {
+    if(tree_arena != NULL)
+        return;
+
     switch(expr->type)
     {
         case EXPR_RELOP:
@@ -491,11 +560,23 @@ void destroy_expr(struct Expression *expr)
     free(expr);
 }
 
+ListNode_t *mk_listnode(void *obj, enum ListType type)
+{
+    ListNode_t *new_node;
+    new_node = (ListNode_t *)tree_alloc(sizeof(ListNode_t));
+
+    new_node->type = type;
+    new_node->cur = obj;
+    new_node->next = NULL;
+
+    return new_node;
+}
+
 Tree_t *mk_program(int line_num, char *id, ListNode_t *args, ListNode_t *var_decl,
     ListNode_t *subprograms, struct Statement *compound_statement)
 {
     Tree_t *new_tree;
-    new_tree = (Tree_t *)malloc(sizeof(Tree_t));
+    new_tree = (Tree_t *)tree_alloc(sizeof(Tree_t));
 
     new_tree->line_num = line_num;
     new_tree->type = TREE_PROGRAM_TYPE;
@@ -513,7 +594,7 @@ Tree_t *mk_procedure(int line_num, char *id, ListNode_t *args, ListNode_t *var_d
     ListNode_t *subprograms, struct Statement *compound_statement)
 {
     Tree_t *new_tree;
-    new_tree = (Tree_t *)malloc(sizeof(Tree_t));
+    new_tree = (Tree_t *)tree_alloc(sizeof(Tree_t));
 
     new_tree->line_num = line_num;
     new_tree->type = TREE_SUBPROGRAM;
@@ -532,7 +613,7 @@ Tree_t *mk_function(int line_num, char *id, ListNode_t *args, ListNode_t *var_de
     ListNode_t *subprograms, struct Statement *compound_statement, int return_type)
 {
     Tree_t *new_tree;
-    new_tree = (Tree_t *)malloc(sizeof(Tree_t));
+    new_tree = (Tree_t *)tree_alloc(sizeof(Tree_t));
 
     new_tree->line_num = line_num;
     new_tree->type = TREE_SUBPROGRAM;
@@ -552,7 +633,7 @@ Tree_t *mk_function(int line_num, char *id, ListNode_t *args, ListNode_t *var_de
 Tree_t *mk_vardecl(int line_num, ListNode_t *ids, int type)
 {
     Tree_t *new_tree;
-    new_tree = (Tree_t *)malloc(sizeof(Tree_t));
+    new_tree = (Tree_t *)tree_alloc(sizeof(Tree_t));
 
     new_tree->line_num = line_num;
     new_tree->type = TREE_VAR_DECL;
@@ -565,7 +646,7 @@ Tree_t *mk_vardecl(int line_num, ListNode_t *ids, int type)
 Tree_t *mk_arraydecl(int line_num, ListNode_t *ids, int type, int start, int end)
 {
     Tree_t *new_tree;
-    new_tree = (Tree_t *)malloc(sizeof(Tree_t));
+    new_tree = (Tree_t *)tree_alloc(sizeof(Tree_t));
 
     new_tree->line_num = line_num;
     new_tree->type = TREE_ARR_DECL;
@@ -582,7 +663,7 @@ Tree_t *mk_arraydecl(int line_num, ListNode_t *ids, int type, int start, int end
 struct Statement *mk_varassign(int line_num, struct Expression *var, struct Expression *expr)
 {
     struct Statement *new_stmt;
-    new_stmt = (struct Statement *)malloc(sizeof(struct Statement));
+    new_stmt = (struct Statement *)tree_alloc(sizeof(struct Statement));
 
     new_stmt->line_num = line_num;
     new_stmt->type = STMT_VAR_ASSIGN;
@@ -595,7 +676,7 @@ struct Statement *mk_varassign(int line_num, struct Expression *var, struct Expr
 struct Statement *mk_procedurecall(int line_num, char *id, ListNode_t *expr_args)
 {
     struct Statement *new_stmt;
-    new_stmt = (struct Statement *)malloc(sizeof(struct Statement));
+    new_stmt = (struct Statement *)tree_alloc(sizeof(struct Statement));
 
     new_stmt->line_num = line_num;
     new_stmt->type = STMT_PROCEDURE_CALL;
@@ -608,7 +689,7 @@ struct Statement *mk_procedurecall(int line_num, char *id, ListNode_t *expr_args
 struct Statement *mk_compoundstatement(int line_num, ListNode_t *compound_statement)
 {
     struct Statement *new_stmt;
-    new_stmt = (struct Statement *)malloc(sizeof(struct Statement));
+    new_stmt = (struct Statement *)tree_alloc(sizeof(struct Statement));
 
     new_stmt->line_num = line_num;
     new_stmt->type = STMT_COMPOUND_STATEMENT;
@@ -621,7 +702,7 @@ struct Statement *mk_ifthen(int line_num, struct Expression *eval_relop, struct
                             struct Statement *else_stmt)
 {
     struct Statement *new_stmt;
-    new_stmt = (struct Statement *)malloc(sizeof(struct Statement));
+    new_stmt = (struct Statement *)tree_alloc(sizeof(struct Statement));
 
     new_stmt->line_num = line_num;
     new_stmt->type = STMT_IF_THEN;
@@ -636,7 +717,7 @@ struct Statement *mk_while(int line_num, struct Expression *eval_relop,
                             struct Statement *while_stmt)
 {
     struct Statement *new_stmt;
-    new_stmt = (struct Statement *)malloc(sizeof(struct Statement));
+    new_stmt = (struct Statement *)tree_alloc(sizeof(struct Statement));
 
     new_stmt->line_num = line_num;
     new_stmt->type = STMT_WHILE;
@@ -650,7 +731,7 @@ struct Statement *mk_forassign(int line_num, struct Statement *for_assign, struc
                                struct Statement *do_for)
 {
    struct Statement *new_stmt;
-   new_stmt = (struct Statement *)malloc(sizeof(struct Statement));
+   new_stmt = (struct Statement *)tree_alloc(sizeof(struct Statement));
 
    new_stmt->line_num = line_num;
    new_stmt->type = STMT_FOR;
@@ -668,7 +749,7 @@ struct Statement *mk_forvar(int line_num, struct Expression *for_var, struct Exp
                               struct Statement *do_for)
 {
   struct Statement *new_stmt;
-  new_stmt = (struct Statement *)malloc(sizeof(struct Statement));
+  new_stmt = (struct Statement *)tree_alloc(sizeof(struct Statement));
 
   new_stmt->line_num = line_num;
   new_stmt->type = STMT_FOR;
@@ -687,7 +768,7 @@ struct Expression *mk_relop(int line_num, int type, struct Expression *left,
                                 struct Expression *right)
 {
     struct Expression *new_expr;
-    new_expr = (struct Expression *)malloc(sizeof(struct Expression));
+    new_expr = (struct Expression *)tree_alloc(sizeof(struct Expression));
 
     new_expr->line_num = line_num;
     new_expr->type = EXPR_RELOP;
@@ -701,7 +782,7 @@ struct Expression *mk_relop(int line_num, int type, struct Expression *left,
 struct Expression *mk_signterm(int line_num, struct Expression *sign_term)
 {
     struct Expression *new_expr;
-    new_expr = (struct Expression *)malloc(sizeof(struct Expression));
+    new_expr = (struct Expression *)tree_alloc(sizeof(struct Expression));
 
     new_expr->line_num = line_num;
     new_expr->type = EXPR_SIGN_TERM;
@@ -714,7 +795,7 @@ struct Expression *mk_addop(int line_num, int type, struct Expression *left,
                                 struct Expression *right)
 {
     struct Expression *new_expr;
-    new_expr = (struct Expression *)malloc(sizeof(struct Expression));
+    new_expr = (struct Expression *)tree_alloc(sizeof(struct Expression));
 
     new_expr->line_num = line_num;
     new_expr->type = EXPR_ADDOP;
@@ -729,7 +810,7 @@ struct Expression *mk_mulop(int line_num, int type, struct Expression *left,
                                 struct Expression *right)
 {
     struct Expression *new_expr;
-    new_expr = (struct Expression *)malloc(sizeof(struct Expression));
+    new_expr = (struct Expression *)tree_alloc(sizeof(struct Expression));
 
     new_expr->line_num = line_num;
     new_expr->type = EXPR_MULOP;
@@ -743,7 +824,7 @@ struct Expression *mk_mulop(int line_num, int type, struct Expression *left,
 struct Expression *mk_varid(int line_num, char *id)
 {
     struct Expression *new_expr;
-    new_expr = (struct Expression *)malloc(sizeof(struct Expression));
+    new_expr = (struct Expression *)tree_alloc(sizeof(struct Expression));
 
     new_expr->line_num = line_num;
     new_expr->type = EXPR_VAR_ID;
@@ -755,7 +836,7 @@ struct Expression *mk_varid(int line_num, char *id)
 struct Expression *mk_arrayaccess(int line_num, char *id, struct Expression *index_expr)
 {
     struct Expression *new_expr;
-    new_expr = (struct Expression *)malloc(sizeof(struct Expression));
+    new_expr = (struct Expression *)tree_alloc(sizeof(struct Expression));
 
     new_expr->line_num = line_num;
     new_expr->type = EXPR_ARRAY_ACCESS;
@@ -768,7 +849,7 @@ struct Expression *mk_arrayaccess(int line_num, char *id, struct Expression *ind
 struct Expression *mk_functioncall(int line_num, char *id, ListNode_t *args)
 {
     struct Expression *new_expr;
-    new_expr = (struct Expression *)malloc(sizeof(struct Expression));
+    new_expr = (struct Expression *)tree_alloc(sizeof(struct Expression));
 
     new_expr->line_num = line_num;
     new_expr->type = EXPR_FUNCTION_CALL;
@@ -781,7 +862,7 @@ struct Expression *mk_functioncall(int line_num, char *id, ListNode_t *args)
 struct Expression *mk_inum(int line_num, int i_num)
 {
     struct Expression *new_expr;
-    new_expr = (struct Expression *)malloc(sizeof(struct Expression));
+    new_expr = (struct Expression *)tree_alloc(sizeof(struct Expression));
 
     new_expr->line_num = line_num;
     new_expr->type = EXPR_INUM;
@@ -793,7 +874,7 @@ struct Expression *mk_inum(int line_num, int i_num)
 struct Expression *mk_rnum(int line_num, float r_num)
 {
     struct Expression *new_expr;
-    new_expr = (struct Expression *)malloc(sizeof(struct Expression));
+    new_expr = (struct Expression *)tree_alloc(sizeof(struct Expression));
 
     new_expr->line_num = line_num;
     new_expr->type = EXPR_RNUM;
@@ -8,6 +8,7 @@
 #define LEAF NULL
 
 #include "../List/List.h"
+#include "../Arena/Arena.h"
 #include "tree_types.h"
 #include <stdio.h>
 
@@ -80,6 +81,21 @@ typedef struct Tree
 /* GLOBAL TREE */
 Tree_t *parse_tree;
 
+/* Arena every tree node, tree list node, and tree string is allocated from */
+/* NULL means nodes are malloc'd and freed one at a time by destroy_tree */
+extern Arena_t *tree_arena;
+
+/* Tree memory */
+/* NOTE: With an active arena the destroy functions below are no-ops, the whole
+    tree is released at once by destroy_tree_arena */
+void init_tree_arena();
+void destroy_tree_arena();
+void print_tree_arena_stats(FILE *f);
+void *tree_alloc(size_t size);
+char *tree_strdup(char *str);
+char *tree_strndup(char *str, size_t len);
+void tree_free(void *ptr);
+
 /* WARNING: Copies are NOT made. Make sure given pointers are safe! */
 /* WARNING: Destroying the tree WILL free given pointers. Do not reference after free! */
 
@@ -97,6 +113,9 @@ void destroy_tree(Tree_t *tree);
 void destroy_stmt(struct Statement *stmt);
 void destroy_expr(struct Expression *expr);
 
+/* List node for use inside the tree (allocated with the tree) */
+ListNode_t *mk_listnode(void *obj, enum ListType type);
+
 /* Tree routines */
 Tree_t *mk_program(int line_num, char *id, ListNode_t *args, ListNode_t *var_decl,
     ListNode_t *subprograms, struct Statement *compound_statement);
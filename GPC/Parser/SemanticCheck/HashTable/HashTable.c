@@ -144,7 +144,7 @@ void DestroyBuiltin(HashNode_t *node)
     assert(node != NULL);
     assert(node->hash_type == HASHTYPE_BUILTIN_PROCEDURE);
 
-    free(node->id);
+    tree_free(node->id);
     destroy_list(node->args);
 }
 
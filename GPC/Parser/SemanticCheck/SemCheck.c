@@ -17,6 +17,7 @@
 #include "SemCheck.h"
 #include "../../flags.h"
 #include "../../Optimizer/optimizer.h"
+#include "../../Optimizer/IR/ir.h"
 #include "../ParseTree/tree.h"
 #include "../ParseTree/tree_types.h"
 #include "./SymTab/SymTab.h"
@@ -81,20 +82,20 @@ void semcheck_add_builtins(SymTab_t *symtab)
     ListNode_t *args, *arg_ids;
 
     /**** READ PROCEDURE ****/
-    id = strdup("read");
+    id = tree_strdup("read");
 
     /* Only arg is a variable to read into */
-    arg_ids = CreateListNode(strdup("var"), LIST_STRING);
-    args = CreateListNode(mk_vardecl(-1, arg_ids, BUILTIN_ANY_TYPE), LIST_TREE);
+    arg_ids = mk_listnode(tree_strdup("var"), LIST_STRING);
+    args = mk_listnode(mk_vardecl(-1, arg_ids, BUILTIN_ANY_TYPE), LIST_TREE);
 
     AddBuiltinProc(symtab, id, args);
 
     /**** WRITE PROCEDURE ****/
-    id = strdup("write");
+    id = tree_strdup("write");
 
     /* Only arg is a variable to read into */
-    arg_ids = CreateListNode(strdup("var"), LIST_STRING);
-    args = CreateListNode(mk_vardecl(-1, arg_ids, BUILTIN_ANY_TYPE), LIST_TREE);
+    arg_ids = mk_listnode(tree_strdup("var"), LIST_STRING);
+    args = mk_listnode(mk_vardecl(-1, arg_ids, BUILTIN_ANY_TYPE), LIST_TREE);
 
     AddBuiltinProc(symtab, id, args);
 }
@@ -131,6 +132,11 @@ int semcheck_program(SymTab_t *symtab, Tree_t *tree)
         optimize(symtab, tree);
     }
 
+    if(dump_ir_flag() && return_val == 0)
+    {
+        ir_dump(tree, stderr);
+    }
+
     PopScope(symtab);
     return return_val;
 }
@@ -343,6 +349,11 @@ int semcheck_subprogram(SymTab_t *symtab, Tree_t *subprogram, int max_scope_lev)
         optimize(symtab, subprogram);
     }
 
+    if(dump_ir_flag() && return_val == 0)
+    {
+        ir_dump(subprogram, stderr);
+    }
+
     PopScope(symtab);
     return return_val;
 }
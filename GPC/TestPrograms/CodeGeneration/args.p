@@ -0,0 +1,34 @@
+(* Argument passing: a division in the fourth argument must not clobber the third *)
+(* (rdx), and parameters in separate groups each get their own register. The calls *)
+(* are made at -O0, -O1 inlines them *)
+(* Input: 5 3 *)
+(* Expected output: 3 5 8 1 4 2 -3 *)
+program args( input, output );
+ var x, y: integer;
+
+ procedure show(a, b, c, d: integer);
+ begin
+   write(a);
+   write(b);
+   write(c);
+   write(d)
+ end;
+
+ function diff(a: integer; b: integer): integer;
+ begin
+   diff := a - b
+ end;
+
+ procedure both(a: integer; b: integer);
+ begin
+   write(a / b);
+   write(b - a)
+ end;
+
+begin
+ read(x);
+ read(y);
+ show(y, x, y + 5, x / y);
+ write(diff(x + 2, y));
+ both(x, y - 1)
+end.
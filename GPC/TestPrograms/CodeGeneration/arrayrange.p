@@ -0,0 +1,17 @@
+(* The for variable is changed in the body, so the range of the loop says nothing *)
+(* about the index and it stays checked at every level: the third iteration writes *)
+(* a[14] and stops the program with "Array index out of range" and the line *)
+(* Expected output: 2 6 then the error for line 14 *)
+program arrayrange( input, output );
+ var i: integer;
+ var a: array[1..10] of integer;
+begin
+ for i := 1 to 11 do
+ begin
+   i := i * 2;
+   if i < 11 then
+     write(i);
+   a[i] := i
+ end;
+ write(a[2])
+end.
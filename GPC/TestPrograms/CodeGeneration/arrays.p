@@ -0,0 +1,27 @@
+(* Array bounds checks: at -O1 the loops over 1 to 11 are proven in range and their *)
+(* checks removed (BOUNDS: 3 of 6), the loop to n keeps its checks since n is read *)
+(* Input: 5 *)
+(* Expected output: 385 2 4 6 8 24 (the same with -checks=off) *)
+program arrays( input, output );
+ var i, n, s: integer;
+ var a: array[1..10] of integer;
+ var b: array[1..20] of integer;
+begin
+ for i := 1 to 11 do
+   a[i] := i * i;
+ s := 0;
+ for i := 1 to 11 do
+ begin
+   s := s + a[i];
+   b[2 * i - 1] := i
+ end;
+ write(s);
+
+ read(n);
+ for i := 1 to n do
+ begin
+   b[i] := 2 * i;
+   write(b[i])
+ end;
+ write(b[n - 1] * 3)
+end.
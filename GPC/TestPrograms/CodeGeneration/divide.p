@@ -0,0 +1,21 @@
+(* Division by numbers, including negative ones, without idivl at any level *)
+(* Expected output: -14 -12 33 14 -100 0 2 *)
+program divide( input, output );
+ var a, b: integer;
+begin
+  a := 100;
+  b := a / -7;
+  write(b);
+  b := a / -8;
+  write(b);
+  b := -a / -3;
+  write(b);
+  b := a / 7;
+  write(b);
+  b := a / -1;
+  write(b);
+  b := 3 / -4;
+  write(b);
+  b := -a / -50;
+  write(b)
+end.
@@ -0,0 +1,34 @@
+(* Tail calls at -O1: count calls itself ten million times, far deeper than the *)
+(* stack allows without the jump back (at -O0 it overflows), and start hands its *)
+(* result straight over to count, a tail call to a different function *)
+(* Expected output (-O1 or -O2): 20000000 20000007 1 *)
+program tailcall( input, output );
+ var r: integer;
+
+ function count(n: integer; acc: integer): integer;
+ begin
+   if n = 0 then
+     count := acc
+   else
+     count := count(n - 1, acc + 2)
+ end;
+
+ function start(n, extra: integer): integer;
+ begin
+   start := count(n, extra)
+ end;
+
+ procedure down(n: integer);
+ begin
+   if n = 0 then
+     write(1)
+   else
+     down(n - 1)
+ end;
+
+begin
+ r := count(10000000, 0);
+ write(r);
+ write(start(10000000, 7));
+ down(10000000)
+end.
@@ -0,0 +1,43 @@
+(* Vectorized loops at -O2: a[i] := b[i] + c[i] runs four iterations at once (eight *)
+(* with -march=x86-64-v3) and the normal loop runs the 19 mod 4 (or 8) left over, *)
+(* a[i] := a[i] * k is vectorized too from -march=x86-64-v2 on (pmulld), and the *)
+(* last loop reads the element written by the iteration before so it stays scalar *)
+(* Expected output: 42 570 1710 9 3 6 10 190 (the same with -march=x86-64, *)
+(* -march=x86-64-v2 and -march=x86-64-v3) *)
+program vector( input, output );
+ var i, k, s: integer;
+ var a: array[1..20] of integer;
+ var b: array[1..20] of integer;
+ var c: array[1..20] of integer;
+begin
+ for i := 1 to 21 do
+ begin
+   b[i] := i;
+   c[i] := 2 * i
+ end;
+ k := 3;
+
+ for i := 1 to 20 do
+   a[i] := b[i] + c[i];
+ write(a[14]);
+ s := 0;
+ for i := 1 to 20 do
+   s := s + a[i];
+ write(s);
+
+ for i := 1 to 20 do
+   a[i] := a[i] * k;
+ s := 0;
+ for i := 1 to 20 do
+   s := s + a[i];
+ write(s);
+ write(a[1]);
+
+ a[1] := 1;
+ for i := 2 to 20 do
+   a[i] := a[i - 1] + b[i];
+ write(a[2]);
+ write(a[3]);
+ write(a[4]);
+ write(a[19])
+end.
@@ -0,0 +1,28 @@
+(* Dead code found by constant propagation on the IR: at -O1 y is known to stay 1 *)
+(* through the loop, and no write(200), for loop or write(9) is generated, while *)
+(* one(7) still writes 7 *)
+(* Expected output: 100 7 5 *)
+program deadcode( input, output );
+ var x, y, i, n: integer;
+
+ function one(a: integer): integer;
+ begin
+   write(a);
+   one := 1
+ end;
+
+begin
+  x := 0;
+  y := 1;
+  n := 0;
+  while n < 10 do
+  begin
+    if x = 1 then
+      y := 2;
+    n := n + 1
+  end;
+  if y = 1 then write(100) else write(200);
+  for i := 5 to 3 do write(i);
+  if one(7) > 2 then write(9);
+  write(i)
+end.
@@ -14,6 +14,34 @@ int FLAG_NON_LOCAL_CHASING = 0;
 /* Set with -O1 and -O2 */
 int FLAG_OPTIMIZE = 0;
 
+/* Flag for dumping parse tree memory stats after compiling */
+/* Set with '-arena-stats' */
+int FLAG_ARENA_STATS = 0;
+
+/* Flag for writing an ELF object file instead of assembly */
+/* Set with '-obj' */
+int FLAG_OBJ = 0;
+
+/* Flag for running the program in-process instead of writing any output */
+/* Set with '-run' */
+int FLAG_RUN = 0;
+
+/* Flag for printing the SSA form of every body after optimizing */
+/* Set with '-dump-ir' */
+int FLAG_DUMP_IR = 0;
+
+/* Flag for how many copies of a counted for loop body to generate per iteration */
+/* Set with '-unroll=<factor>', defaults to 4 with -O2 and 1 (no unrolling) otherwise */
+int FLAG_UNROLL = 0;
+
+/* Flag for checking array indices against the declared range at runtime */
+/* Turned off with '-checks=off' */
+int FLAG_CHECKS = 1;
+
+/* Flag for which vector instructions the generated code may use */
+/* Set with '-march=x86-64', '-march=x86-64-v2' or '-march=x86-64-v3' */
+int FLAG_MARCH = MARCH_X86_64;
+
 void set_nonlocal_flag()
 {
     FLAG_NON_LOCAL_CHASING = 1;
@@ -30,6 +58,41 @@ void set_o2_flag()
         FLAG_OPTIMIZE = 2;
 }
 
+void set_arena_stats_flag()
+{
+    FLAG_ARENA_STATS = 1;
+}
+
+void set_obj_flag()
+{
+    FLAG_OBJ = 1;
+}
+
+void set_run_flag()
+{
+    FLAG_RUN = 1;
+}
+
+void set_dump_ir_flag()
+{
+    FLAG_DUMP_IR = 1;
+}
+
+void set_unroll_flag(int factor)
+{
+    FLAG_UNROLL = factor;
+}
+
+void set_checks_flag(int on)
+{
+    FLAG_CHECKS = on;
+}
+
+void set_march_flag(int level)
+{
+    FLAG_MARCH = level;
+}
+
 int nonlocal_flag()
 {
     return FLAG_NON_LOCAL_CHASING;
@@ -38,3 +101,33 @@ int optimize_flag()
 {
     return FLAG_OPTIMIZE;
 }
+int arena_stats_flag()
+{
+    return FLAG_ARENA_STATS;
+}
+int obj_flag()
+{
+    return FLAG_OBJ;
+}
+int run_flag()
+{
+    return FLAG_RUN;
+}
+int dump_ir_flag()
+{
+    return FLAG_DUMP_IR;
+}
+int unroll_flag()
+{
+    if(FLAG_UNROLL > 0)
+        return FLAG_UNROLL;
+    return (FLAG_OPTIMIZE >= 2) ? 4 : 1;
+}
+int checks_flag()
+{
+    return FLAG_CHECKS;
+}
+int march_flag()
+{
+    return FLAG_MARCH;
+}
@@ -6,11 +6,30 @@
 #ifndef FLAGS_H
 #define FLAGS_H
 
+/* Instruction set levels for -march, each one adding to the one before */
+#define MARCH_X86_64 1 /* SSE2, every x86-64 machine */
+#define MARCH_X86_64_V2 2 /* SSE4.1 */
+#define MARCH_X86_64_V3 3 /* AVX2 */
+
 void set_nonlocal_flag();
 void set_o1_flag();
 void set_o2_flag();
+void set_arena_stats_flag();
+void set_obj_flag();
+void set_run_flag();
+void set_dump_ir_flag();
+void set_unroll_flag(int factor);
+void set_checks_flag(int on);
+void set_march_flag(int level);
 
 int nonlocal_flag();
 int optimize_flag();
+int arena_stats_flag();
+int obj_flag();
+int run_flag();
+int dump_ir_flag();
+int unroll_flag();
+int checks_flag();
+int march_flag();
 
 #endif
@@ -14,13 +14,19 @@ void set_flags(char **, int);
 int main(int argc, char **argv)
 {
     Tree_t * parse_tree;
+    char *output_file;
     int required_args, args_left;
 
     required_args = 3;
 
+    /* -run takes the place of the output file */
+    if(argc >= 3 && strcmp(argv[2], "-run") == 0)
+        required_args = 2;
+
     if(argc < required_args)
     {
         fprintf(stderr, "USAGE: [exec] [INPUT_FILE] [OUTPUT_FILE] [OPTIONAL_FLAG_1] ...\n");
+        fprintf(stderr, "       [exec] [INPUT_FILE] -run [OPTIONAL_FLAG_1] ...\n");
         exit(1);
     }
 
@@ -31,15 +37,27 @@ int main(int argc, char **argv)
         set_flags(argv + required_args, args_left);
     }
 
+    /* Every tree node for this compile lives in one arena */
+    init_tree_arena();
+
+    output_file = (required_args == 3) ? argv[2] : NULL;
+
     parse_tree = ParsePascal(argv[1]);
     if(parse_tree != NULL)
     {
-        fprintf(stderr, "Generating code to file: %s\n", argv[2]);
-        codegen(parse_tree, argv[1], argv[2]);
-
-        destroy_tree(parse_tree);
-        parse_tree = NULL;
+        if(run_flag())
+            fprintf(stderr, "Running program in-process\n");
+        else
+            fprintf(stderr, "Generating code to file: %s\n", output_file);
+        codegen(parse_tree, argv[1], output_file);
     }
+
+    if(arena_stats_flag())
+        print_tree_arena_stats(stderr);
+
+    /* Frees the whole tree at once */
+    destroy_tree_arena();
+    parse_tree = NULL;
 }
 
 void set_flags(char **optional_args, int count)
@@ -65,6 +83,51 @@ void set_flags(char **optional_args, int count)
             fprintf(stderr, "O2 optimizations enabled!\n\n");
             set_o2_flag();
         }
+        else if(strcmp(optional_args[i], "-arena-stats") == 0)
+        {
+            set_arena_stats_flag();
+        }
+        else if(strcmp(optional_args[i], "-obj") == 0)
+        {
+            set_obj_flag();
+        }
+        else if(strcmp(optional_args[i], "-run") == 0)
+        {
+            set_run_flag();
+        }
+        else if(strcmp(optional_args[i], "-dump-ir") == 0)
+        {
+            set_dump_ir_flag();
+        }
+        else if(strncmp(optional_args[i], "-unroll=", 8) == 0)
+        {
+            if(atoi(optional_args[i] + 8) < 1)
+            {
+                fprintf(stderr, "ERROR: Unroll factor must be at least 1: %s\n", optional_args[i]);
+                exit(1);
+            }
+            set_unroll_flag(atoi(optional_args[i] + 8));
+        }
+        else if(strcmp(optional_args[i], "-checks=off") == 0)
+        {
+            set_checks_flag(0);
+        }
+        else if(strcmp(optional_args[i], "-checks=on") == 0)
+        {
+            set_checks_flag(1);
+        }
+        else if(strcmp(optional_args[i], "-march=x86-64") == 0)
+        {
+            set_march_flag(MARCH_X86_64);
+        }
+        else if(strcmp(optional_args[i], "-march=x86-64-v2") == 0)
+        {
+            set_march_flag(MARCH_X86_64_V2);
+        }
+        else if(strcmp(optional_args[i], "-march=x86-64-v3") == 0)
+        {
+            set_march_flag(MARCH_X86_64_V3);
+        }
         else
         {
             fprintf(stderr, "ERROR: Unrecognized flag: %s\n", optional_args[i]);